@@ -0,0 +1,309 @@
+#include "./Bench.h"
+#include "../Externals.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+
+// Returns the histogram bucket of a latency
+static int Bucket_Index(uint64_t value)
+{
+    if (value >= (1ULL << BENCH_MAX_VALUE_BITS))
+        value = (1ULL << BENCH_MAX_VALUE_BITS) - 1;
+    if (value < (1ULL << BENCH_SUB_BUCKET_BITS))
+        return (int)value;
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - BENCH_SUB_BUCKET_BITS;
+    return ((shift + 1) << BENCH_SUB_BUCKET_BITS) + (int)((value >> shift) & ((1ULL << BENCH_SUB_BUCKET_BITS) - 1));
+}
+
+// Returns the highest latency counted in a bucket
+static uint64_t Bucket_Value(int index)
+{
+    if (index < (1 << BENCH_SUB_BUCKET_BITS))
+        return (uint64_t)index;
+    int shift = (index >> BENCH_SUB_BUCKET_BITS) - 1;
+    uint64_t sub = (uint64_t)(index & ((1 << BENCH_SUB_BUCKET_BITS) - 1)) | (1ULL << BENCH_SUB_BUCKET_BITS);
+    return ((sub + 1) << shift) - 1;
+}
+
+uint64_t Bench_Now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+void Bench_Sleep_Until(uint64_t iTimeNs)
+{
+    struct timespec until = {iTimeNs / 1000000000ULL, iTimeNs % 1000000000ULL};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR)
+        ;
+}
+
+uint64_t Bench_Random(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+long long Bench_Parse_Size(const char *sSize)
+{
+    char *end = NULL;
+    errno = 0;
+    long long iSize = strtoll(sSize, &end, 10);
+    if (errno != 0 || end == sSize || iSize < 0)
+        return -1;
+    switch (*end)
+    {
+    case 'G': case 'g': iSize <<= 10; // fall through
+    case 'M': case 'm': iSize <<= 10; // fall through
+    case 'K': case 'k': iSize <<= 10; end++; break;
+    case '\0': break;
+    default: return -1;
+    }
+    return (*end == '\0' || strcasecmp(end, "B") == 0) ? iSize : -1;
+}
+
+/**
+ * @brief Returns the CPU time a process has used so far
+ * @param pid: The process (0 for the calling one)
+ * @return: User plus system time in nanoseconds, -1 if the process cannot be read
+ * @note: Other processes are read from /proc/<pid>/stat, their resolution is a clock tick
+ */
+long long Bench_CPU_Time(int pid)
+{
+    if (pid == 0)
+    {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) < 0)
+            return -1;
+        return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000LL + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000LL;
+    }
+
+    char sPath[64];
+    snprintf(sPath, sizeof(sPath), "/proc/%d/stat", pid);
+    FILE *file = fopen(sPath, "r");
+    if (file == NULL)
+        return -1;
+    char sStat[MAX_BUFFER_SIZE];
+    size_t n = fread(sStat, 1, sizeof(sStat) - 1, file);
+    fclose(file);
+    sStat[n] = '\0';
+
+    // utime and stime are the 14th and 15th fields, the name (2nd) may hold spaces so count from its ')'
+    char *field = strrchr(sStat, ')');
+    unsigned long iUserTicks, iSystemTicks;
+    if (field == NULL || sscanf(field + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &iUserTicks, &iSystemTicks) != 2)
+        return -1;
+    return (long long)(iUserTicks + iSystemTicks) * (1000000000LL / sysconf(_SC_CLK_TCK));
+}
+
+void Bench_Hist_Record(BENCH_HIST_STRUCT *hist, uint64_t iLatencyNs, int iFailed)
+{
+    hist->iCount++;
+    if (iFailed)
+        hist->iErrors++;
+    hist->iTotalNs += iLatencyNs;
+    if (iLatencyNs > hist->iMaxNs)
+        hist->iMaxNs = iLatencyNs;
+    hist->buckets[Bucket_Index(iLatencyNs)]++;
+}
+
+void Bench_Hist_Merge(BENCH_HIST_STRUCT *total, const BENCH_HIST_STRUCT *hist)
+{
+    total->iCount += hist->iCount;
+    total->iErrors += hist->iErrors;
+    total->iTotalNs += hist->iTotalNs;
+    if (hist->iMaxNs > total->iMaxNs)
+        total->iMaxNs = hist->iMaxNs;
+    for (int i = 0; i < BENCH_BUCKET_COUNT; i++)
+        total->buckets[i] += hist->buckets[i];
+}
+
+/**
+ * @brief Returns the latency below which a percentile of the operations completed
+ * @param hist: The histogram
+ * @param fPercentile: The percentile (0-100)
+ * @return: The latency in microseconds (upper bound of its bucket, at most the maximum seen)
+ */
+double Bench_Hist_Percentile(const BENCH_HIST_STRUCT *hist, double fPercentile)
+{
+    if (hist->iCount == 0)
+        return 0;
+    unsigned long iRank = (unsigned long)(fPercentile / 100.0 * hist->iCount + 0.5);
+    if (iRank < 1)
+        iRank = 1;
+    unsigned long iSeen = 0;
+    for (int i = 0; i < BENCH_BUCKET_COUNT; i++)
+    {
+        iSeen += hist->buckets[i];
+        if (iSeen >= iRank)
+        {
+            uint64_t value = Bucket_Value(i);
+            return (value < hist->iMaxNs ? value : hist->iMaxNs) / 1000.0;
+        }
+    }
+    return hist->iMaxNs / 1000.0;
+}
+
+/**
+ * @brief Parses a workload mix
+ * @param sMix: Comma separated "<operation>:<weight>" (e.g. "READ:70,INFO:20,LIST:10")
+ * @param mix: Filled with the operations and their weights
+ * @return: 0 on success, -1 if an operation is unknown or a weight is not positive
+ * @note: Operation names are the ones of CommandName (case insensitive)
+ */
+int Bench_Parse_Mix(const char *sMix, BENCH_MIX_STRUCT *mix)
+{
+    char sCopy[MAX_BUFFER_SIZE];
+    strncpy(sCopy, sMix, MAX_BUFFER_SIZE - 1);
+    sCopy[MAX_BUFFER_SIZE - 1] = '\0';
+    memset(mix, 0, sizeof(BENCH_MIX_STRUCT));
+
+    char *save = NULL;
+    for (char *item = strtok_r(sCopy, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save))
+    {
+        char *weight = strchr(item, ':');
+        if (weight != NULL)
+            *weight++ = '\0';
+        int op = -1;
+        for (int i = CMD_READ; i <= CMD_RENAME; i++)
+            if (strcasecmp(item, CommandName(i)) == 0)
+                op = i;
+        int iWeight = (weight != NULL) ? atoi(weight) : 1;
+        if (op < 0 || iWeight <= 0 || mix->iCount == BENCH_MAX_MIX)
+            return -1;
+        mix->ops[mix->iCount] = op;
+        mix->weights[mix->iCount] = iWeight;
+        mix->iTotalWeight += iWeight;
+        mix->iCount++;
+    }
+    return mix->iCount > 0 ? 0 : -1;
+}
+
+int Bench_Pick_Op(BENCH_MIX_STRUCT *mix, uint64_t *state)
+{
+    int iPick = (int)(Bench_Random(state) % (uint64_t)mix->iTotalWeight);
+    for (int i = 0; i < mix->iCount; i++)
+    {
+        if (iPick < mix->weights[i])
+            return mix->ops[i];
+        iPick -= mix->weights[i];
+    }
+    return mix->ops[mix->iCount - 1];
+}
+
+// Writes the row of one histogram
+static void Report_Row(FILE *stream, int iJson, const char *sName, const BENCH_HIST_STRUCT *hist, double fSeconds)
+{
+    double fMeanUs = hist->iCount ? hist->iTotalNs / 1000.0 / hist->iCount : 0;
+    double fRate = fSeconds > 0 ? hist->iCount / fSeconds : 0;
+    if (iJson)
+        fprintf(stream, "{\"op\":\"%s\",\"count\":%lu,\"errors\":%lu,\"ops_per_s\":%.1f,\"mean_us\":%.1f,"
+                        "\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"p999_us\":%.1f,\"max_us\":%.1f}",
+                sName, hist->iCount, hist->iErrors, fRate, fMeanUs, Bench_Hist_Percentile(hist, 50),
+                Bench_Hist_Percentile(hist, 90), Bench_Hist_Percentile(hist, 99), Bench_Hist_Percentile(hist, 99.9),
+                hist->iMaxNs / 1000.0);
+    else
+        fprintf(stream, "%-10s %10lu %8lu %11.1f %9.1f %9.1f %9.1f %9.1f %9.1f %10.1f\n",
+                sName, hist->iCount, hist->iErrors, fRate, fMeanUs, Bench_Hist_Percentile(hist, 50),
+                Bench_Hist_Percentile(hist, 90), Bench_Hist_Percentile(hist, 99), Bench_Hist_Percentile(hist, 99.9),
+                hist->iMaxNs / 1000.0);
+}
+
+/**
+ * @brief Writes the throughput and latency percentiles of every operation and of all of them
+ * @param stream: Where to write
+ * @param iJson: Non zero writes the members "seconds", "ops" and "total" of a JSON object (without braces)
+ * @param names: Name of every histogram
+ * @param hists: The merged histograms
+ * @param iCount: Number of histograms
+ * @param fSeconds: Measured duration (throughput is per second of it)
+ * @note: Operations that never ran are left out
+ */
+void Bench_Report(FILE *stream, int iJson, const char **names, BENCH_HIST_STRUCT *hists, int iCount, double fSeconds)
+{
+    BENCH_HIST_STRUCT *total = (BENCH_HIST_STRUCT *)calloc(1, sizeof(BENCH_HIST_STRUCT));
+    if (CheckNull(total, "[-]Bench_Report: Error in allocating memory"))
+        return;
+    for (int i = 0; i < iCount; i++)
+        Bench_Hist_Merge(total, &hists[i]);
+
+    if (iJson)
+        fprintf(stream, "\"seconds\":%.3f,\"ops\":[", fSeconds);
+    else
+        fprintf(stream, "%-10s %10s %8s %11s %9s %9s %9s %9s %9s %10s\n",
+                "op", "count", "errors", "ops/s", "mean_us", "p50_us", "p90_us", "p99_us", "p99.9_us", "max_us");
+
+    int iFirst = 1;
+    for (int i = 0; i < iCount; i++)
+    {
+        if (hists[i].iCount == 0)
+            continue;
+        if (iJson && !iFirst)
+            fprintf(stream, ",");
+        Report_Row(stream, iJson, names[i], &hists[i], fSeconds);
+        iFirst = 0;
+    }
+
+    if (iJson)
+        fprintf(stream, "],\"total\":");
+    Report_Row(stream, iJson, "TOTAL", total, fSeconds);
+    free(total);
+}
+
+int Bench_Connect(const char *sIP, int iPort)
+{
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0)
+        return -1;
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(iPort);
+    address.sin_addr.s_addr = inet_addr(sIP);
+    if (connect(sockfd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        close(sockfd);
+        return -1;
+    }
+
+    // Requests are small and latency bound
+    int iNoDelay = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &iNoDelay, sizeof(iNoDelay));
+    return sockfd;
+}
+
+int Bench_Listen(int iPort)
+{
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0)
+        return -1;
+
+    int iReuse = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof(iReuse));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(iPort);
+    address.sin_addr.s_addr = INADDR_ANY;
+    if (bind(sockfd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(sockfd, SOMAXCONN) < 0)
+    {
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
@@ -0,0 +1,68 @@
+// Helpers shared by the benchmarks (latency histograms, reports, sockets and workload mixes)
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define BENCH_SUB_BUCKET_BITS 4            // 16 linear buckets per power of 2 (values within 1/16)
+#define BENCH_MAX_VALUE_BITS 36            // Latencies up to 2^36 ns (~68 s), longer ones are clamped
+#define BENCH_BUCKET_COUNT ((BENCH_MAX_VALUE_BITS - BENCH_SUB_BUCKET_BITS + 1) << BENCH_SUB_BUCKET_BITS)
+#define BENCH_MAX_MIX 8                    // Most operations in a workload mix
+
+/*
+Every benchmark thread records into histograms of its own (no sharing while the load runs), the
+main thread merges them once the run is over. The histograms are log-linear like the ones of the
+Naming Server stats (Naming Sever/Stats.h), so the percentiles of a benchmark and of the server
+it measures are read with the same precision.
+*/
+
+typedef struct BENCH_HIST_STRUCT
+{
+    unsigned long iCount;
+    unsigned long iErrors;
+    uint64_t iTotalNs;
+    uint64_t iMaxNs;
+    unsigned long buckets[BENCH_BUCKET_COUNT];
+} BENCH_HIST_STRUCT;
+
+// Operations of a workload and their weights, parsed from "READ:70,INFO:20,LIST:10"
+typedef struct BENCH_MIX_STRUCT
+{
+    int iCount;
+    int ops[BENCH_MAX_MIX];                // Operation codes (CMD_*)
+    int weights[BENCH_MAX_MIX];
+    int iTotalWeight;
+} BENCH_MIX_STRUCT;
+
+// Monotonic time in nanoseconds
+uint64_t Bench_Now();
+// Sleeps until a Bench_Now() time (returns at once if it has passed)
+void Bench_Sleep_Until(uint64_t iTimeNs);
+// xorshift64* generator, the state must not be 0
+uint64_t Bench_Random(uint64_t *state);
+
+void Bench_Hist_Record(BENCH_HIST_STRUCT *hist, uint64_t iLatencyNs, int iFailed);
+void Bench_Hist_Merge(BENCH_HIST_STRUCT *total, const BENCH_HIST_STRUCT *hist);
+// Latency at a percentile (0-100) in microseconds
+double Bench_Hist_Percentile(const BENCH_HIST_STRUCT *hist, double fPercentile);
+
+// Parses a size with an optional K, M or G suffix (powers of 1024), returns -1 if it is not one
+long long Bench_Parse_Size(const char *sSize);
+// CPU time (user + system) of a process in nanoseconds, 0 for the calling one, -1 if it is gone
+long long Bench_CPU_Time(int pid);
+
+// Parses a mix of the named operations, returns -1 on an unknown name or a bad weight
+int Bench_Parse_Mix(const char *sMix, BENCH_MIX_STRUCT *mix);
+// Picks an operation of the mix by weight
+int Bench_Pick_Op(BENCH_MIX_STRUCT *mix, uint64_t *state);
+
+// Writes one row per operation (and a total) as text or JSON, fSeconds is the measured duration
+void Bench_Report(FILE *stream, int iJson, const char **names, BENCH_HIST_STRUCT *hists, int iCount, double fSeconds);
+
+// Blocking TCP helpers (return the socket, -1 on failure)
+int Bench_Connect(const char *sIP, int iPort);
+int Bench_Listen(int iPort);
+
+#endif
@@ -0,0 +1,63 @@
+// Microbenchmarks of the metadata structures: the mount trie and the path cache of the Naming
+// Server and the file trie of the Storage Server
+
+#ifndef __MICRO_H__
+#define __MICRO_H__
+
+#include <stdint.h>
+
+#define MICRO_MAX_PATH 256                 // Longest generated path (with its NUL)
+#define MICRO_CHUNK_PATHS 65536            // Paths generated at a time, outside of the timed sections
+#define MICRO_MAX_DIRS 12                  // Most directories above a file
+#define MICRO_FANOUT 24                    // Names a directory picks its subdirectories from
+#define MICRO_LIST_MIN_DIRS 5              // Listed directories are this deep (their subtrees stay small)
+#define MICRO_NS_SECTION_PATHS 4096        // Paths inserted per write section (a storage server registering)
+#define MICRO_JOURNAL_DIR "/tmp/microbench.XXXXXX" // Working directory of the mount table suite (mkdtemp template)
+#define MICRO_JOURNAL_MAX_PATHS 1048576   // Most paths of the registered storage server
+#define MICRO_JOURNAL_DROP 16              // The storage server comes back without every 16th path
+#define MICRO_JOURNAL_CACHE 1024           // Path cache capacity of the mount table suite
+#define MICRO_JOURNAL_IP "127.0.0.1"       // Address of the registered storage server
+#define MICRO_JOURNAL_PORT 40000           // Port a connection of the server comes from (plus its number)
+#define MICRO_JOURNAL_PORT_CLIENT 9700
+#define MICRO_JOURNAL_PORT_NSERVER 9701
+
+/*
+The generated tree follows the shape of real file systems: the number of directories above a file
+is binomial (mean ~5, 1 to MICRO_MAX_DIRS) and every directory picks its subdirectories from
+MICRO_FANOUT names with a quadratic skew, so a few directories are large and most are small.
+Path i is a pure function of i (its file name holds i), so any path can be rebuilt for a lookup
+without storing millions of them. Every path starts with "Mount", the token the structures skip.
+*/
+
+typedef struct MICRO_TIMER_STRUCT
+{
+    uint64_t iElapsedNs;
+    long long iCacheMisses;                 // -1 when the hardware counter is not available
+    uint64_t iStartNs;
+} MICRO_TIMER_STRUCT;
+
+// Builds path i and returns its length
+int Micro_Path(unsigned long i, char *path);
+// Builds the directory holding path i and returns the number of directories in it (0 for Mount)
+int Micro_Parent(unsigned long i, char *path);
+// Picks a path whose parent directory is deep enough to be listed
+unsigned long Micro_List_Index(uint64_t *state, unsigned long iPaths);
+
+// Timed sections accumulate into the timer (with the cache misses of the thread when available)
+void Micro_Timer_Reset(MICRO_TIMER_STRUCT *timer);
+void Micro_Timer_Start(MICRO_TIMER_STRUCT *timer);
+void Micro_Timer_Stop(MICRO_TIMER_STRUCT *timer);
+
+// Bytes of heap in use
+long long Micro_Heap_Used();
+// Records the result of an operation (fBytesPerPath < 0 when the operation does not size the structure)
+void Micro_Record(const char *sSuite, const char *sOp, unsigned long iPaths, unsigned long iOps, MICRO_TIMER_STRUCT *timer, double fBytesPerPath);
+
+// Suites: run every operation on a structure of iPaths paths, iOps times for the per operation
+// measurements, and return the heap used per path (-1 on failure)
+double Micro_NS_Trie(unsigned long iPaths, unsigned long iOps);
+double Micro_LRU(unsigned long iPaths, unsigned long iOps);
+double Micro_SS_Trie(unsigned long iPaths, unsigned long iOps);
+double Micro_NS_Journal(unsigned long iPaths, unsigned long iOps);
+
+#endif
@@ -0,0 +1,421 @@
+// Microbenchmark driver: runs the suites of the metadata structures at growing sizes, reports the
+// cost of every operation and compares it against a baseline run (regression gate)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "../Externals.h"
+#include "./Bench.h"
+#include "./Micro.h"
+
+#define MICRO_DEFAULT_SIZES "1K,100K,10M"
+#define MICRO_DEFAULT_OPS 100000
+#define MICRO_DEFAULT_SUITES "ns_trie,lru,ss_trie,ns_journal"
+#define MICRO_DEFAULT_BUDGET 2048          // MB of heap a structure may use before larger sizes are skipped
+#define MICRO_DEFAULT_TOLERANCE 25         // Percent slower (or bigger) than the baseline before failing
+#define MICRO_DEFAULT_REPEATS 3            // Runs of every suite, the fastest one is reported
+#define MICRO_MAX_SIZES 16
+#define MICRO_MAX_RESULTS 256
+#define MICRO_SEED 0x5DEECE66DULL
+
+// A result, the JSON report has one per line so a baseline can be read back line by line
+typedef struct MICRO_RESULT_STRUCT
+{
+    char sSuite[32];
+    char sOp[32];
+    unsigned long iPaths;
+    unsigned long iOps;
+    double fNsPerOp;
+    double fMissesPerOp;                    // -1 when not measured
+    double fBytesPerPath;                   // -1 for operations that do not size the structure
+} MICRO_RESULT_STRUCT;
+
+typedef struct MICRO_SUITE_STRUCT
+{
+    const char *sName;
+    double (*Run)(unsigned long iPaths, unsigned long iOps);
+    unsigned long iMaxEntries;              // The structure holds at most this many paths (0 for all of them)
+} MICRO_SUITE_STRUCT;
+
+static MICRO_SUITE_STRUCT Suites[] = {
+    {"ns_trie", Micro_NS_Trie, 0},
+    {"lru", Micro_LRU, 1048576},            // MAX_CACHE_CAPACITY of the Naming Server
+    {"ss_trie", Micro_SS_Trie, 0},
+    {"ns_journal", Micro_NS_Journal, MICRO_JOURNAL_MAX_PATHS},
+};
+
+static MICRO_RESULT_STRUCT Results[MICRO_MAX_RESULTS];
+static int iResultCount = 0;
+static int iCacheCounter = -2;              // perf event of the cache misses (-2 not opened yet, -1 not available)
+
+static const char *DirNames[] = {"src", "lib", "include", "docs", "test", "data", "build", "assets", "config", "scripts", "vendor", "tools"};
+static const char *Extensions[] = {"c", "h", "txt", "md", "json", "py", "log", "csv"};
+
+// splitmix64 finalizer
+static uint64_t Mix(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Directories above path i (name indexes), returns their number
+static int Micro_Dirs(unsigned long i, int *dirs)
+{
+    uint64_t r = Mix(MICRO_SEED + i * 0x9E3779B97F4A7C15ULL);
+    // Binomial: MICRO_MAX_DIRS - 1 trials of p = 12/32
+    int count = 1;
+    for (int k = 0; k < MICRO_MAX_DIRS - 1; k++)
+        count += ((r >> (k * 5)) & 31) < 12;
+
+    // Quadratic skew towards the first names of the fan-out
+    uint64_t s = r;
+    for (int k = 0; k < count; k++)
+    {
+        if (k % 4 == 0)
+            s = Mix(s);
+        double u = ((s >> ((k % 4) * 16)) & 0xFFFF) / 65536.0;
+        dirs[k] = (int)(u * u * MICRO_FANOUT);
+    }
+    return count;
+}
+
+// Appends the directories of path i, returns the length
+static int Append_Dirs(char *path, int n, const int *dirs, int count)
+{
+    int iNames = sizeof(DirNames) / sizeof(DirNames[0]);
+    for (int k = 0; k < count; k++)
+    {
+        if (dirs[k] < iNames)
+            n += snprintf(path + n, MICRO_MAX_PATH - n, "/%s", DirNames[dirs[k]]);
+        else
+            n += snprintf(path + n, MICRO_MAX_PATH - n, "/%s%d", DirNames[dirs[k] % iNames], dirs[k] / iNames);
+    }
+    return n;
+}
+
+int Micro_Path(unsigned long i, char *path)
+{
+    int dirs[MICRO_MAX_DIRS];
+    int count = Micro_Dirs(i, dirs);
+    int n = Append_Dirs(path, snprintf(path, MICRO_MAX_PATH, "Mount"), dirs, count);
+    return n + snprintf(path + n, MICRO_MAX_PATH - n, "/file%lu.%s", i, Extensions[i % (sizeof(Extensions) / sizeof(Extensions[0]))]);
+}
+
+int Micro_Parent(unsigned long i, char *path)
+{
+    int dirs[MICRO_MAX_DIRS];
+    int count = Micro_Dirs(i, dirs);
+    Append_Dirs(path, snprintf(path, MICRO_MAX_PATH, "Mount"), dirs, count);
+    return count;
+}
+
+unsigned long Micro_List_Index(uint64_t *state, unsigned long iPaths)
+{
+    int dirs[MICRO_MAX_DIRS];
+    while (1)
+    {
+        unsigned long i = Bench_Random(state) % iPaths;
+        if (Micro_Dirs(i, dirs) >= MICRO_LIST_MIN_DIRS)
+            return i;
+    }
+}
+
+// Opens the cache miss counter of the calling thread once (it is not available in most containers)
+static int Cache_Counter()
+{
+    if (iCacheCounter == -2)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        iCacheCounter = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (iCacheCounter < 0)
+            iCacheCounter = -1;
+    }
+    return iCacheCounter;
+}
+
+void Micro_Timer_Reset(MICRO_TIMER_STRUCT *timer)
+{
+    timer->iElapsedNs = 0;
+    timer->iCacheMisses = (Cache_Counter() < 0) ? -1 : 0;
+}
+
+void Micro_Timer_Start(MICRO_TIMER_STRUCT *timer)
+{
+    if (timer->iCacheMisses >= 0)
+    {
+        ioctl(iCacheCounter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(iCacheCounter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    timer->iStartNs = Bench_Now();
+}
+
+void Micro_Timer_Stop(MICRO_TIMER_STRUCT *timer)
+{
+    timer->iElapsedNs += Bench_Now() - timer->iStartNs;
+    if (timer->iCacheMisses >= 0)
+    {
+        ioctl(iCacheCounter, PERF_EVENT_IOC_DISABLE, 0);
+        long long iMisses = 0;
+        if (read(iCacheCounter, &iMisses, sizeof(iMisses)) == sizeof(iMisses))
+            timer->iCacheMisses += iMisses;
+    }
+}
+
+long long Micro_Heap_Used()
+{
+    struct mallinfo2 info = mallinfo2();
+    return (long long)(info.uordblks + info.hblkhd);
+}
+
+void Micro_Record(const char *sSuite, const char *sOp, unsigned long iPaths, unsigned long iOps, MICRO_TIMER_STRUCT *timer, double fBytesPerPath)
+{
+    if (iOps == 0)
+        return;
+    double fNsPerOp = (double)timer->iElapsedNs / iOps;
+    // A repeated run keeps the fastest measurement (the others were disturbed by the rest of the machine)
+    for (int i = 0; i < iResultCount; i++)
+    {
+        MICRO_RESULT_STRUCT *result = &Results[i];
+        if (strcmp(result->sSuite, sSuite) != 0 || strcmp(result->sOp, sOp) != 0 || result->iPaths != iPaths)
+            continue;
+        if (fNsPerOp < result->fNsPerOp)
+        {
+            result->fNsPerOp = fNsPerOp;
+            result->fMissesPerOp = (timer->iCacheMisses >= 0) ? (double)timer->iCacheMisses / iOps : -1;
+        }
+        if (fBytesPerPath >= 0 && fBytesPerPath < result->fBytesPerPath)
+            result->fBytesPerPath = fBytesPerPath;
+        return;
+    }
+    if (iResultCount == MICRO_MAX_RESULTS)
+        return;
+    MICRO_RESULT_STRUCT *result = &Results[iResultCount++];
+    strncpy(result->sSuite, sSuite, sizeof(result->sSuite) - 1);
+    strncpy(result->sOp, sOp, sizeof(result->sOp) - 1);
+    result->iPaths = iPaths;
+    result->iOps = iOps;
+    result->fNsPerOp = fNsPerOp;
+    result->fMissesPerOp = (timer->iCacheMisses >= 0) ? (double)timer->iCacheMisses / iOps : -1;
+    result->fBytesPerPath = fBytesPerPath;
+}
+
+/**
+ * @brief Compares the results with a baseline report (-j output of an earlier run)
+ * @param sBaseline: Path of the baseline report
+ * @param fTolerance: Percentage by which a result may be slower or bigger than the baseline
+ * @return: The number of regressions, -1 if the baseline cannot be read
+ * @note: Results without a baseline (other sizes or suites) are not compared
+ */
+static int Compare_Baseline(const char *sBaseline, double fTolerance)
+{
+    FILE *file = fopen(sBaseline, "r");
+    if (file == NULL)
+        return -1;
+
+    int iRegressions = 0;
+    char sLine[MAX_BUFFER_SIZE];
+    while (fgets(sLine, sizeof(sLine), file) != NULL)
+    {
+        char *item = strstr(sLine, "{\"suite\":");
+        MICRO_RESULT_STRUCT base;
+        if (item == NULL ||
+            sscanf(item, "{\"suite\":\"%31[^\"]\",\"op\":\"%31[^\"]\",\"paths\":%lu,\"ops\":%lu,\"ns_per_op\":%lf,\"misses_per_op\":%lf,\"bytes_per_path\":%lf}",
+                   base.sSuite, base.sOp, &base.iPaths, &base.iOps, &base.fNsPerOp, &base.fMissesPerOp, &base.fBytesPerPath) != 7)
+            continue;
+
+        for (int i = 0; i < iResultCount; i++)
+        {
+            MICRO_RESULT_STRUCT *result = &Results[i];
+            if (strcmp(result->sSuite, base.sSuite) != 0 || strcmp(result->sOp, base.sOp) != 0 || result->iPaths != base.iPaths)
+                continue;
+            double fLimit = 1 + fTolerance / 100;
+            if (result->fNsPerOp > base.fNsPerOp * fLimit)
+            {
+                fprintf(stderr, "regression: %s %s at %lu paths: %.1f -> %.1f ns/op (%+.0f%%)\n", result->sSuite, result->sOp,
+                        result->iPaths, base.fNsPerOp, result->fNsPerOp, (result->fNsPerOp / base.fNsPerOp - 1) * 100);
+                iRegressions++;
+            }
+            if (base.fBytesPerPath > 0 && result->fBytesPerPath > base.fBytesPerPath * fLimit)
+            {
+                fprintf(stderr, "regression: %s %s at %lu paths: %.1f -> %.1f bytes/path (%+.0f%%)\n", result->sSuite, result->sOp,
+                        result->iPaths, base.fBytesPerPath, result->fBytesPerPath, (result->fBytesPerPath / base.fBytesPerPath - 1) * 100);
+                iRegressions++;
+            }
+        }
+    }
+    fclose(file);
+    return iRegressions;
+}
+
+static void Usage(char *sProgram)
+{
+    fprintf(stderr, "Usage: %s [-n sizes] [-o ops] [-s suites] [-M budget_mb] [-R repeats] [-b baseline.json] [-T tolerance_percent] [-j]\n", sProgram);
+}
+
+int main(int argc, char *argv[])
+{
+    // Parse the command line options
+    // -n <sizes>   : comma separated numbers of paths (K, M and G suffixes are powers of 1024)
+    // -o <count>   : lookups, deletes and cache reads per measurement (listings are 1/100th)
+    // -s <suites>  : comma separated suites among ns_trie, lru, ss_trie and ns_journal
+    // -M <MB>      : heap a structure may use, larger sizes are skipped when the smaller ones predict more
+    // -R <count>   : runs of every suite and size, the fastest is reported
+    // -b <file>    : baseline report (-j) to compare with, exits with 3 on a regression
+    // -T <percent> : slowdown or growth tolerated against the baseline
+    // -j           : write the report as JSON (one result per line)
+    char sSizes[MAX_BUFFER_SIZE] = MICRO_DEFAULT_SIZES;
+    char sSuites[MAX_BUFFER_SIZE] = MICRO_DEFAULT_SUITES;
+    char *sBaseline = NULL;
+    long iOps = MICRO_DEFAULT_OPS;
+    long iBudgetMB = MICRO_DEFAULT_BUDGET;
+    double fTolerance = MICRO_DEFAULT_TOLERANCE;
+    long iRepeats = MICRO_DEFAULT_REPEATS;
+    int iJson = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:o:s:M:R:b:T:j")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': strncpy(sSizes, optarg, MAX_BUFFER_SIZE - 1); break;
+        case 'o': iOps = atol(optarg); break;
+        case 's': strncpy(sSuites, optarg, MAX_BUFFER_SIZE - 1); break;
+        case 'M': iBudgetMB = atol(optarg); break;
+        case 'R': iRepeats = atol(optarg); break;
+        case 'b': sBaseline = optarg; break;
+        case 'T': fTolerance = atof(optarg); break;
+        case 'j': iJson = 1; break;
+        default:
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    unsigned long sizes[MICRO_MAX_SIZES];
+    int iSizeCount = 0;
+    char *save = NULL;
+    for (char *item = strtok_r(sSizes, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save))
+    {
+        long long iSize = Bench_Parse_Size(item);
+        if (iSize < 1 || iSizeCount == MICRO_MAX_SIZES)
+        {
+            fprintf(stderr, "[-]Invalid size %s (at most %d sizes)\n", item, MICRO_MAX_SIZES);
+            return 1;
+        }
+        sizes[iSizeCount++] = (unsigned long)iSize;
+    }
+    if (iOps < 1 || iBudgetMB < 1 || iRepeats < 1 || fTolerance < 0)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    int iSuiteCount = sizeof(Suites) / sizeof(Suites[0]);
+    int selected[sizeof(Suites) / sizeof(Suites[0])] = {0};
+    for (char *item = strtok_r(sSuites, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save))
+    {
+        int iFound = 0;
+        for (int i = 0; i < iSuiteCount; i++)
+            if (strcmp(item, Suites[i].sName) == 0)
+                selected[i] = iFound = 1;
+        if (!iFound)
+        {
+            fprintf(stderr, "[-]Unknown suite %s (ns_trie, lru, ss_trie, ns_journal)\n", item);
+            return 1;
+        }
+    }
+
+    // Every suite runs its sizes in increasing order, the heap per path of a size predicts the next one
+    char sSkipped[MAX_BUFFER_SIZE] = "";
+    for (int s = 0; s < iSuiteCount; s++)
+    {
+        if (!selected[s])
+            continue;
+        double fBytesPerPath = -1;
+        for (int i = 0; i < iSizeCount; i++)
+        {
+            unsigned long iEntries = sizes[i];
+            if (Suites[s].iMaxEntries && iEntries > Suites[s].iMaxEntries)
+                iEntries = Suites[s].iMaxEntries;
+            double fPredictedMB = fBytesPerPath * iEntries / 1048576.0;
+            if (fBytesPerPath > 0 && fPredictedMB > iBudgetMB)
+            {
+                size_t n = strlen(sSkipped);
+                snprintf(sSkipped + n, sizeof(sSkipped) - n, "%s%s at %lu paths (~%.0f MB)", n ? ", " : "", Suites[s].sName, sizes[i], fPredictedMB);
+                continue;
+            }
+            for (long r = 0; r < iRepeats; r++)
+            {
+                double fMeasured = Suites[s].Run(sizes[i], (unsigned long)iOps);
+                if (fMeasured < 0)
+                {
+                    fprintf(stderr, "[-]Suite %s failed at %lu paths\n", Suites[s].sName, sizes[i]);
+                    return 1;
+                }
+                fBytesPerPath = fMeasured * sizes[i] / iEntries;
+            }
+        }
+    }
+
+    if (iJson)
+    {
+        printf("{\"ops\":%ld,\"repeats\":%ld,\"budget_mb\":%ld,\"cache_misses\":%s,\"skipped\":\"%s\",\"results\":[\n", iOps, iRepeats, iBudgetMB,
+               iCacheCounter >= 0 ? "true" : "false", sSkipped);
+        for (int i = 0; i < iResultCount; i++)
+            printf("%s{\"suite\":\"%s\",\"op\":\"%s\",\"paths\":%lu,\"ops\":%lu,\"ns_per_op\":%.2f,\"misses_per_op\":%.3f,\"bytes_per_path\":%.1f}\n",
+                   i ? "," : "", Results[i].sSuite, Results[i].sOp, Results[i].iPaths, Results[i].iOps, Results[i].fNsPerOp,
+                   Results[i].fMissesPerOp, Results[i].fBytesPerPath);
+        printf("]}\n");
+    }
+    else
+    {
+        printf("microbench: %ld ops per measurement, fastest of %ld runs, cache misses %s\n\n", iOps, iRepeats, iCacheCounter >= 0 ? "from perf" : "unavailable (perf_event_open denied)");
+        printf("%-10s %-12s %10s %9s %10s %9s %10s %11s\n", "suite", "op", "paths", "ops", "ns/op", "Mops/s", "misses/op", "bytes/path");
+        for (int i = 0; i < iResultCount; i++)
+        {
+            MICRO_RESULT_STRUCT *result = &Results[i];
+            printf("%-10s %-12s %10lu %9lu %10.1f %9.2f ", result->sSuite, result->sOp, result->iPaths, result->iOps,
+                   result->fNsPerOp, 1000.0 / result->fNsPerOp);
+            if (result->fMissesPerOp >= 0)
+                printf("%10.2f ", result->fMissesPerOp);
+            else
+                printf("%10s ", "-");
+            if (result->fBytesPerPath >= 0)
+                printf("%11.1f\n", result->fBytesPerPath);
+            else
+                printf("%11s\n", "-");
+        }
+        if (sSkipped[0] != '\0')
+            printf("\nskipped over the %ld MB budget (-M): %s\n", iBudgetMB, sSkipped);
+    }
+
+    if (sBaseline != NULL)
+    {
+        int iRegressions = Compare_Baseline(sBaseline, fTolerance);
+        if (iRegressions < 0)
+        {
+            fprintf(stderr, "[-]Cannot read the baseline %s\n", sBaseline);
+            return 1;
+        }
+        if (iRegressions > 0)
+        {
+            fprintf(stderr, "%d regressions over %.0f%% against %s\n", iRegressions, fTolerance, sBaseline);
+            return 3;
+        }
+        fprintf(stderr, "no regression over %.0f%% against %s\n", fTolerance, sBaseline);
+    }
+    return 0;
+}
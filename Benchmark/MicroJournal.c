@@ -0,0 +1,204 @@
+// Suite of the persisted mount table of the Naming Server (Mount_Table.c, Journal.c): a storage server
+// registers, the table is checkpointed, the server registers again without some of its paths and the
+// table is reloaded from the checkpoint and the journal. Every step is checked path by path, so the
+// suite fails (and microbench exits with 1) when the replay or a reconciliation loses track of a path.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include "../Naming Sever/Mount_Table.h"
+#include "../Naming Sever/Journal.h"
+#include "../Naming Sever/Trie.h"
+#include "../Naming Sever/LRU.h"
+#include "./Bench.h"
+#include "./Micro.h"
+
+// The state of the Naming Server the mount table works on
+SERVER_HANDLE_LIST_STRUCT *serverHandleList;
+MOUNT_TRIE_STRUCT *MountTrie;
+LRUCache *MountCache;
+
+/**
+ * @brief Registers a connection of the storage server with its paths, like Storage_Server_Handler_Thread
+ * @param iConnection: Numbers the connections (the ID of a server changes with every connection)
+ * @param iPaths: The server has the paths below iPaths, but the ones dropped every MICRO_JOURNAL_DROP when iDrop is set
+ * @param timer: Times the registration
+ * @return: The registered handle, NULL on failure
+ */
+static SERVER_HANDLE_STRUCT *Micro_Register(int iConnection, unsigned long iPaths, int iDrop, MICRO_TIMER_STRUCT *timer)
+{
+    SERVER_HANDLE_STRUCT serverHandle;
+    memset(&serverHandle, 0, sizeof(serverHandle));
+    strcpy(serverHandle.sServerIP, MICRO_JOURNAL_IP);
+    serverHandle.sServerPort = MICRO_JOURNAL_PORT + iConnection;
+    serverHandle.sServerPort_Client = MICRO_JOURNAL_PORT_CLIENT;
+    serverHandle.sServerPort_NServer = MICRO_JOURNAL_PORT_NSERVER;
+    serverHandle.sSocket_Write = -1;
+    serverHandle.sSocket_Read = -1;
+    SERVER_HANDLE_STRUCT *server = AddServer(&serverHandle, serverHandleList);
+    if (CheckNull(server, "[-]Micro_Register: Error in adding the server"))
+        return NULL;
+
+    // The \n separated paths of the init packet (sized first, paths are rebuilt from their index)
+    char path[MICRO_MAX_PATH];
+    size_t iSize = 1;
+    for (unsigned long i = 0; i < iPaths; i++)
+        iSize += Micro_Path(i, path) + 1;
+    char *paths = (char *)malloc(iSize);
+    if (CheckNull(paths, "[-]Micro_Register: Error in allocating memory"))
+        return NULL;
+    size_t iLength = 0;
+    for (unsigned long i = 0; i < iPaths; i++)
+    {
+        if (iDrop && i % MICRO_JOURNAL_DROP == 0)
+            continue;
+        iLength += Micro_Path(i, paths + iLength);
+        paths[iLength++] = '\n';
+    }
+    paths[iLength] = '\0';
+
+    Micro_Timer_Start(timer);
+    long iInserted = Mount_Table_Register(server, paths);
+    Micro_Timer_Stop(timer);
+    free(paths);
+    return (iInserted < 0) ? NULL : server;
+}
+
+/**
+ * @brief Checks every path of the table and the servers registered
+ * @param server: The handle every path must resolve to, NULL for a restored handle of the server's address
+ * @param iDropped: Set when the paths dropped every MICRO_JOURNAL_DROP must be gone
+ * @return: 0 when the table holds exactly the expected paths, -1 otherwise
+ * @note: A registration leaves a single handle, the handles it replaced are removed. A reload restores
+ *        every handle of the journal, the replaced ones without paths, until the server registers again
+ */
+static int Micro_Check(const char *sStep, unsigned long iPaths, SERVER_HANDLE_STRUCT *server, int iDropped)
+{
+    char path[MICRO_MAX_PATH];
+    unsigned long iWrong = 0;
+    for (unsigned long i = 0; i < iPaths; i++)
+    {
+        Micro_Path(i, path);
+        atomic_long *token;
+        SERVER_HANDLE_STRUCT *found = (SERVER_HANDLE_STRUCT *)Get_Server(Trie_Read_Lock(MountTrie, &token), path);
+        int iExpected = !(iDropped && i % MICRO_JOURNAL_DROP == 0);
+        int iCorrect = iExpected ? (found != NULL && (server != NULL ? found == server :
+                                     atomic_load(&found->iRestored) && strcmp(found->sServerIP, MICRO_JOURNAL_IP) == 0 &&
+                                     found->sServerPort_Client == MICRO_JOURNAL_PORT_CLIENT && found->sServerPort_NServer == MICRO_JOURNAL_PORT_NSERVER))
+                                 : (found == NULL);
+        Trie_Read_Unlock(token);
+        iWrong += !iCorrect;
+    }
+
+    int iServers = GetServerCount(serverHandleList);
+    if (iWrong > 0 || (server != NULL && iServers != 1))
+    {
+        fprintf(stderr, "[-]Micro_NS_Journal: After %s, %lu of %lu paths are wrong and %d servers are registered\n", sStep, iWrong, iPaths, iServers);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Measures and checks the persisted mount table: register, checkpoint, register again, reload
+ * @return: Heap used per path of the table, -1 on failure (or when a path was lost)
+ * @note: The server has at most MICRO_JOURNAL_MAX_PATHS paths, every registration builds its whole init packet
+ * @note: Runs in a temporary directory (the checkpoint and the journal are in the working directory),
+ *        every registration syncs the journal like a storage server joining the Naming Server
+ */
+double Micro_NS_Journal(unsigned long iPaths, unsigned long iOps)
+{
+    (void)iOps;
+    iPaths = (iPaths < MICRO_JOURNAL_MAX_PATHS) ? iPaths : MICRO_JOURNAL_MAX_PATHS;
+    char sDirectory[] = MICRO_JOURNAL_DIR;
+    char sWorkingDirectory[PATH_MAX];
+    if (CheckNull(getcwd(sWorkingDirectory, sizeof(sWorkingDirectory)), "[-]Micro_NS_Journal: Error in getting the working directory") ||
+        CheckNull(mkdtemp(sDirectory), "[-]Micro_NS_Journal: Error in creating the directory") ||
+        CheckError(chdir(sDirectory), "[-]Micro_NS_Journal: Error in entering the directory"))
+        return -1;
+
+    serverHandleList = InitializeServerHandleList();
+    MountTrie = Init_Trie("Mount");
+    MountCache = createCache(MICRO_JOURNAL_CACHE);
+    int err = (serverHandleList == NULL || MountTrie == NULL || MountCache == NULL) ? -1 : Journal_Open(JOURNAL_FILE, 0);
+    MICRO_TIMER_STRUCT timer;
+    double fBytesPerPath = -1;
+
+    // The server registers all its paths, they are all journaled
+    if (err == 0)
+    {
+        long long iHeapBefore = Micro_Heap_Used();
+        Micro_Timer_Reset(&timer);
+        SERVER_HANDLE_STRUCT *server = Micro_Register(0, iPaths, 0, &timer);
+        fBytesPerPath = (double)(Micro_Heap_Used() - iHeapBefore) / iPaths;
+        Micro_Record("ns_journal", "register", iPaths, iPaths, &timer, fBytesPerPath);
+        err = (server == NULL) ? -1 : Micro_Check("register", iPaths, server, 0);
+        if (err == 0)
+            SetInactive(server->ServerID, serverHandleList);
+    }
+
+    // The checkpoint takes the table, the journal is cut down to it
+    if (err == 0)
+    {
+        Micro_Timer_Reset(&timer);
+        Micro_Timer_Start(&timer);
+        err = Mount_Table_Checkpoint();
+        Micro_Timer_Stop(&timer);
+        Micro_Record("ns_journal", "checkpoint", iPaths, iPaths, &timer, -1);
+    }
+
+    // The server comes back without some of its paths: its disconnected handle is reconciled and the
+    // deletes go to the journal after the checkpoint
+    if (err == 0)
+    {
+        Micro_Timer_Reset(&timer);
+        SERVER_HANDLE_STRUCT *server = Micro_Register(1, iPaths, 1, &timer);
+        Micro_Record("ns_journal", "reregister", iPaths, iPaths, &timer, -1);
+        err = (server == NULL) ? -1 : Micro_Check("reregister", iPaths, server, 1);
+    }
+
+    // The Naming Server restarts: the table comes back from the checkpoint and the journal, on a restored handle
+    if (err == 0)
+    {
+        Journal_Close();
+        Delete_Trie(MountTrie);
+        free(serverHandleList);
+        serverHandleList = InitializeServerHandleList();
+        MountTrie = Init_Trie("Mount");
+        flushCache(MountCache);
+
+        uint64_t iSequence = 0;
+        Micro_Timer_Reset(&timer);
+        Micro_Timer_Start(&timer);
+        long iLoaded = (serverHandleList == NULL || MountTrie == NULL) ? -1 : Mount_Table_Load(&iSequence);
+        Micro_Timer_Stop(&timer);
+        Micro_Record("ns_journal", "reload", iPaths, iPaths, &timer, -1);
+        err = (iLoaded < 0) ? -1 : Micro_Check("reload", iPaths, NULL, 1);
+        if (err == 0)
+            err = Journal_Open(JOURNAL_FILE, iSequence);
+    }
+
+    // The server registers with the restarted Naming Server, its paths move off the restored handle
+    if (err == 0)
+    {
+        Micro_Timer_Reset(&timer);
+        SERVER_HANDLE_STRUCT *server = Micro_Register(2, iPaths, 1, &timer);
+        err = (server == NULL) ? -1 : Micro_Check("restart", iPaths, server, 1);
+    }
+
+    // Handles are never freed by the Naming Server, only the structures around them are
+    Journal_Close();
+    if (MountTrie != NULL)
+        Delete_Trie(MountTrie);
+    if (MountCache != NULL)
+        freeCache(MountCache);
+    unlink(JOURNAL_FILE);
+    unlink(MOUNT_CHECKPOINT_FILE);
+    unlink(MOUNT_CHECKPOINT_TEMP);
+    if (chdir(sWorkingDirectory) == 0)
+        rmdir(sDirectory);
+    return (err == 0) ? fBytesPerPath : -1;
+}
@@ -0,0 +1,177 @@
+// Suites of the Naming Server structures: the RCU mount trie (Trie.c) and the sharded path cache (LRU.c)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../Naming Sever/Trie.h"
+#include "../Naming Sever/LRU.h"
+#include "./Bench.h"
+#include "./Micro.h"
+
+// Every path of the benchmark belongs to the same (fake) storage server
+static int iServer;
+
+/**
+ * @brief Measures the mount trie: insert (registration), lookup, lookup of missing paths, listing, delete
+ * @return: Heap used per path, -1 on failure
+ * @note: Lookups enter a read section each like a resolution of the Naming Server, deletes open a
+ *        write section each like a DELETE request
+ */
+double Micro_NS_Trie(unsigned long iPaths, unsigned long iOps)
+{
+    char *chunk = (char *)malloc((size_t)MICRO_CHUNK_PATHS * MICRO_MAX_PATH);
+    char *buffer = (char *)malloc(MAX_BUFFER_SIZE);
+    if (CheckNull(chunk, "[-]Micro_NS_Trie: Error in allocating memory") || CheckNull(buffer, "[-]Micro_NS_Trie: Error in allocating memory"))
+        return -1;
+    long long iHeapBefore = Micro_Heap_Used();
+    MOUNT_TRIE_STRUCT *trie = Init_Trie("Mount");
+    if (CheckNull(trie, "[-]Micro_NS_Trie: Error in initializing the trie"))
+        return -1;
+    MICRO_TIMER_STRUCT timer;
+    uint64_t iRandom = 0x9E3779B97F4A7C15ULL ^ iPaths;
+    int err = 0;
+
+    // Insert, MICRO_NS_SECTION_PATHS per write section
+    Micro_Timer_Reset(&timer);
+    for (unsigned long iBase = 0; iBase < iPaths && err == 0; iBase += MICRO_CHUNK_PATHS)
+    {
+        unsigned long iCount = (iPaths - iBase < MICRO_CHUNK_PATHS) ? iPaths - iBase : MICRO_CHUNK_PATHS;
+        for (unsigned long j = 0; j < iCount; j++)
+            Micro_Path(iBase + j, chunk + j * MICRO_MAX_PATH);
+        Micro_Timer_Start(&timer);
+        for (unsigned long j = 0; j < iCount && err == 0; j += MICRO_NS_SECTION_PATHS)
+        {
+            Trie_Write_Begin(trie);
+            for (unsigned long k = j; k < iCount && k < j + MICRO_NS_SECTION_PATHS && err == 0; k++)
+                err = Insert_Path(trie, chunk + k * MICRO_MAX_PATH, &iServer);
+            Trie_Write_End(trie);
+        }
+        Micro_Timer_Stop(&timer);
+    }
+    double fBytesPerPath = (double)(Micro_Heap_Used() - iHeapBefore) / iPaths;
+    Micro_Record("ns_trie", "insert", iPaths, iPaths, &timer, fBytesPerPath);
+
+    // Lookups of random paths (hits), then of paths that were never inserted (misses)
+    for (int iMiss = 0; iMiss < 2 && err == 0; iMiss++)
+    {
+        Micro_Timer_Reset(&timer);
+        for (unsigned long iDone = 0; iDone < iOps && err == 0; iDone += MICRO_CHUNK_PATHS)
+        {
+            unsigned long iCount = (iOps - iDone < MICRO_CHUNK_PATHS) ? iOps - iDone : MICRO_CHUNK_PATHS;
+            for (unsigned long j = 0; j < iCount; j++)
+                Micro_Path(Bench_Random(&iRandom) % iPaths + (iMiss ? iPaths : 0), chunk + j * MICRO_MAX_PATH);
+            Micro_Timer_Start(&timer);
+            for (unsigned long j = 0; j < iCount; j++)
+            {
+                atomic_long *token;
+                void *server = Get_Server(Trie_Read_Lock(trie, &token), chunk + j * MICRO_MAX_PATH);
+                Trie_Read_Unlock(token);
+                err |= ((server != NULL) == iMiss);
+            }
+            Micro_Timer_Stop(&timer);
+        }
+        Micro_Record("ns_trie", iMiss ? "lookup_miss" : "lookup", iPaths, iOps, &timer, -1);
+    }
+
+    // Listings of directories deep in the tree, page by page like LIST requests
+    unsigned long iLists = (iOps / 100 > 0) ? iOps / 100 : 1;
+    TRIE_LIST_STRUCT list;
+    memset(&list, 0, sizeof(TRIE_LIST_STRUCT));
+    Micro_Timer_Reset(&timer);
+    for (unsigned long i = 0; i < iLists && err == 0; i++)
+    {
+        Micro_Parent(Micro_List_Index(&iRandom, iPaths), chunk);
+        Micro_Timer_Start(&timer);
+        do
+        {
+            atomic_long *token;
+            err = Get_Directory_Page(Trie_Read_Lock(trie, &token), chunk, &list, buffer, MAX_BUFFER_SIZE);
+            Trie_Read_Unlock(token);
+        } while (err >= 0 && list.sCursor[0] != '\0');
+        Micro_Timer_Stop(&timer);
+        err = (err < 0) ? err : 0;
+    }
+    Micro_Record("ns_trie", "list", iPaths, iLists, &timer, -1);
+
+    // Deletes of distinct paths (a prime stride visits every index once)
+    unsigned long iDeletes = (iOps < iPaths) ? iOps : iPaths;
+    Micro_Timer_Reset(&timer);
+    for (unsigned long iDone = 0; iDone < iDeletes && err == 0; iDone += MICRO_CHUNK_PATHS)
+    {
+        unsigned long iCount = (iDeletes - iDone < MICRO_CHUNK_PATHS) ? iDeletes - iDone : MICRO_CHUNK_PATHS;
+        for (unsigned long j = 0; j < iCount; j++)
+            Micro_Path(((iDone + j) * 2654435761UL) % iPaths, chunk + j * MICRO_MAX_PATH);
+        Micro_Timer_Start(&timer);
+        for (unsigned long j = 0; j < iCount && err == 0; j++)
+        {
+            Trie_Write_Begin(trie);
+            err = Delete_Path(trie, chunk + j * MICRO_MAX_PATH);
+            Trie_Write_End(trie);
+        }
+        Micro_Timer_Stop(&timer);
+    }
+    Micro_Record("ns_trie", "delete", iPaths, iDeletes, &timer, -1);
+
+    Delete_Trie(trie);
+    free(chunk);
+    free(buffer);
+    return (err == 0) ? fBytesPerPath : -1;
+}
+
+/**
+ * @brief Measures the path cache: put (with evictions past its capacity), get of cached paths, get of missing paths
+ * @return: Heap used per cached path, -1 on failure
+ * @note: The capacity is the number of paths up to MAX_CACHE_CAPACITY
+ */
+double Micro_LRU(unsigned long iPaths, unsigned long iOps)
+{
+    char *chunk = (char *)malloc((size_t)MICRO_CHUNK_PATHS * MICRO_MAX_PATH);
+    if (CheckNull(chunk, "[-]Micro_LRU: Error in allocating memory"))
+        return -1;
+    unsigned long iCapacity = (iPaths < MAX_CACHE_CAPACITY) ? iPaths : MAX_CACHE_CAPACITY;
+    long long iHeapBefore = Micro_Heap_Used();
+    LRUCache *cache = createCache((int)iCapacity);
+    if (CheckNull(cache, "[-]Micro_LRU: Error in creating the cache"))
+        return -1;
+    MICRO_TIMER_STRUCT timer;
+    uint64_t iRandom = 0xD1B54A32D192ED03ULL ^ iPaths;
+
+    Micro_Timer_Reset(&timer);
+    for (unsigned long iBase = 0; iBase < iPaths; iBase += MICRO_CHUNK_PATHS)
+    {
+        unsigned long iCount = (iPaths - iBase < MICRO_CHUNK_PATHS) ? iPaths - iBase : MICRO_CHUNK_PATHS;
+        for (unsigned long j = 0; j < iCount; j++)
+            Micro_Path(iBase + j, chunk + j * MICRO_MAX_PATH);
+        Micro_Timer_Start(&timer);
+        for (unsigned long j = 0; j < iCount; j++)
+            put(cache, chunk + j * MICRO_MAX_PATH, &iServer);
+        Micro_Timer_Stop(&timer);
+    }
+    double fBytesPerPath = (double)(Micro_Heap_Used() - iHeapBefore) / iCapacity;
+    Micro_Record("lru", "put", iPaths, iPaths, &timer, fBytesPerPath);
+
+    // Gets of the most recently put paths (the ones still cached), then of paths never put
+    for (int iMiss = 0; iMiss < 2; iMiss++)
+    {
+        Micro_Timer_Reset(&timer);
+        for (unsigned long iDone = 0; iDone < iOps; iDone += MICRO_CHUNK_PATHS)
+        {
+            unsigned long iCount = (iOps - iDone < MICRO_CHUNK_PATHS) ? iOps - iDone : MICRO_CHUNK_PATHS;
+            for (unsigned long j = 0; j < iCount; j++)
+            {
+                unsigned long i = iMiss ? iPaths + Bench_Random(&iRandom) % iPaths : iPaths - 1 - Bench_Random(&iRandom) % (iCapacity / 2 + 1);
+                Micro_Path(i, chunk + j * MICRO_MAX_PATH);
+            }
+            Micro_Timer_Start(&timer);
+            for (unsigned long j = 0; j < iCount; j++)
+                get(cache, chunk + j * MICRO_MAX_PATH);
+            Micro_Timer_Stop(&timer);
+        }
+        Micro_Record("lru", iMiss ? "get_miss" : "get", iPaths, iOps, &timer, -1);
+    }
+
+    freeCache(cache);
+    free(chunk);
+    return fBytesPerPath;
+}
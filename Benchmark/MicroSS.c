@@ -0,0 +1,110 @@
+// Suite of the Storage Server structure: the file trie holding the lock of every path (Trie.c)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../Storage Server/Trie.h"
+#include "../Externals.h"
+#include "./Bench.h"
+#include "./Micro.h"
+
+#define MICRO_SS_LIST_BUFFER (64 * 1024 * 1024) // Largest listing buffer (trie_paths does not bound its output)
+
+/**
+ * @brief Measures the file trie: insert, lookup (search and lock of a path), lookup of missing paths, listing, delete
+ * @return: Heap used per path, -1 on failure
+ * @note: Tokens are hashed into 512 slots without probing, so two names of a directory may share a node:
+ *        misses and deletes are not checked against the expected result, only their cost is measured
+ */
+double Micro_SS_Trie(unsigned long iPaths, unsigned long iOps)
+{
+    char *chunk = (char *)malloc((size_t)MICRO_CHUNK_PATHS * MICRO_MAX_PATH);
+    size_t iBufferSize = (iPaths * MICRO_MAX_PATH < MICRO_SS_LIST_BUFFER) ? iPaths * MICRO_MAX_PATH : MICRO_SS_LIST_BUFFER;
+    if (iBufferSize < 1024 * 1024)
+        iBufferSize = 1024 * 1024;
+    char *buffer = (char *)malloc(iBufferSize);
+    if (CheckNull(chunk, "[-]Micro_SS_Trie: Error in allocating memory") || CheckNull(buffer, "[-]Micro_SS_Trie: Error in allocating memory"))
+        return -1;
+    long long iHeapBefore = Micro_Heap_Used();
+    Trie *trie = trie_init();
+    if (CheckNull(trie, "[-]Micro_SS_Trie: Error in initializing the trie"))
+        return -1;
+    MICRO_TIMER_STRUCT timer;
+    uint64_t iRandom = 0xBF58476D1CE4E5B9ULL ^ iPaths;
+    int err = 0;
+
+    // Every operation tokenizes its path in place, so the timed loops work on the generated copies
+    Micro_Timer_Reset(&timer);
+    for (unsigned long iBase = 0; iBase < iPaths && err == 0; iBase += MICRO_CHUNK_PATHS)
+    {
+        unsigned long iCount = (iPaths - iBase < MICRO_CHUNK_PATHS) ? iPaths - iBase : MICRO_CHUNK_PATHS;
+        for (unsigned long j = 0; j < iCount; j++)
+            Micro_Path(iBase + j, chunk + j * MICRO_MAX_PATH);
+        Micro_Timer_Start(&timer);
+        for (unsigned long j = 0; j < iCount && err == 0; j++)
+            err = trie_insert(trie, chunk + j * MICRO_MAX_PATH);
+        Micro_Timer_Stop(&timer);
+    }
+    double fBytesPerPath = (double)(Micro_Heap_Used() - iHeapBefore) / iPaths;
+    Micro_Record("ss_trie", "insert", iPaths, iPaths, &timer, fBytesPerPath);
+
+    // A lookup is what a request does before touching a file: search the path, then take its lock
+    for (int iMiss = 0; iMiss < 2 && err == 0; iMiss++)
+    {
+        Micro_Timer_Reset(&timer);
+        for (unsigned long iDone = 0; iDone < iOps && err == 0; iDone += MICRO_CHUNK_PATHS / 2)
+        {
+            unsigned long iCount = (iOps - iDone < MICRO_CHUNK_PATHS / 2) ? iOps - iDone : MICRO_CHUNK_PATHS / 2;
+            for (unsigned long j = 0; j < iCount; j++)
+            {
+                char *path = chunk + 2 * j * MICRO_MAX_PATH;
+                Micro_Path(Bench_Random(&iRandom) % iPaths + (iMiss ? iPaths : 0), path);
+                memcpy(path + MICRO_MAX_PATH, path, MICRO_MAX_PATH);
+            }
+            Micro_Timer_Start(&timer);
+            for (unsigned long j = 0; j < iCount; j++)
+            {
+                char *path = chunk + 2 * j * MICRO_MAX_PATH;
+                if (trie_search(trie, path))
+                    err |= (trie_get_path_lock(trie, path + MICRO_MAX_PATH) == NULL);
+                else
+                    err |= !iMiss;
+            }
+            Micro_Timer_Stop(&timer);
+        }
+        Micro_Record("ss_trie", iMiss ? "lookup_miss" : "lookup", iPaths, iOps, &timer, -1);
+    }
+
+    unsigned long iLists = (iOps / 100 > 0) ? iOps / 100 : 1;
+    Micro_Timer_Reset(&timer);
+    for (unsigned long i = 0; i < iLists && err == 0; i++)
+    {
+        Micro_Parent(Micro_List_Index(&iRandom, iPaths), chunk);
+        buffer[0] = '\0';
+        Micro_Timer_Start(&timer);
+        err = trie_paths(trie, buffer, chunk);
+        Micro_Timer_Stop(&timer);
+    }
+    Micro_Record("ss_trie", "list", iPaths, iLists, &timer, -1);
+
+    // Deletes of distinct paths (a path already removed with a colliding directory costs a failed walk)
+    unsigned long iDeletes = (iOps < iPaths) ? iOps : iPaths;
+    Micro_Timer_Reset(&timer);
+    for (unsigned long iDone = 0; iDone < iDeletes && err == 0; iDone += MICRO_CHUNK_PATHS)
+    {
+        unsigned long iCount = (iDeletes - iDone < MICRO_CHUNK_PATHS) ? iDeletes - iDone : MICRO_CHUNK_PATHS;
+        for (unsigned long j = 0; j < iCount; j++)
+            Micro_Path(((iDone + j) * 2654435761UL) % iPaths, chunk + j * MICRO_MAX_PATH);
+        Micro_Timer_Start(&timer);
+        for (unsigned long j = 0; j < iCount; j++)
+            trie_delete(trie, chunk + j * MICRO_MAX_PATH);
+        Micro_Timer_Stop(&timer);
+    }
+    Micro_Record("ss_trie", "delete", iPaths, iDeletes, &timer, -1);
+
+    trie_destroy(trie);
+    free(chunk);
+    free(buffer);
+    return (err == 0) ? fBytesPerPath : -1;
+}
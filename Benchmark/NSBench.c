@@ -0,0 +1,593 @@
+// Load generator for the Naming Server: fake storage servers register a synthetic mount table and
+// simulated clients resolve its paths in a closed loop (back to back) or an open loop (fixed rate)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "../Externals.h"
+#include "../Wire.h"
+#include "./Bench.h"
+
+#define NSBENCH_DEFAULT_CLIENTS 16
+#define NSBENCH_DEFAULT_DURATION 10                // Seconds measured
+#define NSBENCH_DEFAULT_WARMUP 1                   // Seconds of load before measuring
+#define NSBENCH_DEFAULT_SERVERS 4
+#define NSBENCH_DEFAULT_FILES 256                  // Files registered by every fake server
+#define NSBENCH_FILES_PER_DIR 32
+#define NSBENCH_DEFAULT_PORT 9400                  // Fake server k listens for the NS on port + 2k
+#define NSBENCH_DEFAULT_WINDOW 64                  // Open loop: most requests in flight per client
+#define NSBENCH_DEFAULT_MIX "READ:60,WRITE:10,INFO:20,LIST:10"
+#define NSBENCH_MAX_CLIENTS 1024
+#define NSBENCH_MAX_SERVERS 256
+#define NSBENCH_MAX_WINDOW 4096
+#define NSBENCH_DRAIN_TIMEOUT 2                    // Open loop: seconds waiting for the last replies
+#define NSBENCH_THREAD_STACK (256 * 1024)
+
+/*
+Closed loop: every client sends its next request as soon as the previous reply arrives, so the
+offered load adapts to the server and the run measures its peak throughput.
+Open loop: the clients send at a fixed total rate whatever the server does (requests are
+pipelined on the v2 wire, up to a window per client). Latency is measured from the time a request
+was scheduled, not from when it could be sent, so a stalled server is charged for the requests
+queued behind the stall (no coordinated omission). Sends that had to wait for the window are
+reported as late.
+Only requests scheduled inside the measured window are counted. Requests for missing paths (-x)
+are expected to fail and are counted as errors only if they succeed.
+*/
+
+typedef struct NSBENCH_CONFIG_STRUCT
+{
+    char sIP[IP_LENGTH];
+    int iClients;
+    int iDuration;
+    int iWarmup;
+    double fRate;                                   // Requests per second over all clients (0 for a closed loop)
+    int iServers;
+    int iFiles;
+    int iFirstPort;
+    int iWindow;
+    int iMissPercent;
+    int iJson;
+    char sMix[MAX_BUFFER_SIZE];
+    BENCH_MIX_STRUCT mix;
+} NSBENCH_CONFIG_STRUCT;
+
+typedef struct NSBENCH_SERVER_STRUCT
+{
+    int iIndex;
+    int iListenSocket;
+    int iRegisterSocket;                            // Connection the server registered on
+    unsigned long ServerID;
+    pthread_t thread;
+} NSBENCH_SERVER_STRUCT;
+
+// A request of an open loop waiting for its reply
+typedef struct NSBENCH_INFLIGHT_STRUCT
+{
+    uint64_t iScheduledNs;
+    int iMixIndex;
+    int iMiss;
+} NSBENCH_INFLIGHT_STRUCT;
+
+typedef struct NSBENCH_CLIENT_STRUCT
+{
+    int iIndex;
+    int sockfd;
+    int iVersion;
+    unsigned long ClientID;
+    uint64_t iRandom;
+    BENCH_HIST_STRUCT hists[BENCH_MAX_MIX];         // One per operation of the mix
+    // Open loop
+    NSBENCH_INFLIGHT_STRUCT *inflight;              // Indexed by request ID % window
+    sem_t window;
+    atomic_ulong iSent;
+    atomic_ulong iReceived;
+    atomic_int iSendDone;
+    unsigned long iLate;
+    int iFailed;                                    // The connection broke
+} NSBENCH_CLIENT_STRUCT;
+
+static NSBENCH_CONFIG_STRUCT Config;
+static int iRunID;                                  // Names the mount table of the run (the NS keeps the paths of gone servers)
+static uint64_t iMeasureStartNs;
+static uint64_t iMeasureEndNs;
+static atomic_int iStop = 0;
+static pthread_barrier_t StartBarrier;
+
+// Returns the mix slot of an operation
+static int Mix_Index(int op)
+{
+    for (int i = 0; i < Config.mix.iCount; i++)
+        if (Config.mix.ops[i] == op)
+            return i;
+    return 0;
+}
+
+/**
+ * @brief Builds the path of a request from the synthetic mount table
+ * @param client: The client (its generator picks the server and the file)
+ * @param op: The operation (LIST gets a directory)
+ * @param iMiss: Non zero asks for a path no server registered
+ * @param path: Filled with the path (MAX_BUFFER_SIZE)
+ */
+static void Make_Path(NSBENCH_CLIENT_STRUCT *client, int op, int iMiss, char *path)
+{
+    uint64_t r = Bench_Random(&client->iRandom);
+    int iServer = (int)(r % Config.iServers);
+    int iFile = (int)((r >> 20) % Config.iFiles);
+    int iDir = iFile / NSBENCH_FILES_PER_DIR;
+    if (op == CMD_LIST)
+        snprintf(path, MAX_BUFFER_SIZE, "Mount/nsb%d-%d/d%d", iRunID, iServer, iDir);
+    else if (iMiss)
+        snprintf(path, MAX_BUFFER_SIZE, "Mount/nsb%d-%d/d%d/missing%d.txt", iRunID, iServer, iDir, iFile);
+    else
+        snprintf(path, MAX_BUFFER_SIZE, "Mount/nsb%d-%d/d%d/f%d.txt", iRunID, iServer, iDir, iFile);
+}
+
+/**
+ * @brief Registers a fake storage server with the Naming Server
+ * @param server: The server (iIndex set), its sockets and ID are filled
+ * @return: 0 on success, -1 on failure
+ * @note: The server registers "./nsb<run>-<k>", its directories and its files, like a storage
+ *        server exposing them from its working directory
+ */
+static int Register_Fake_Server(NSBENCH_SERVER_STRUCT *server)
+{
+    int iNSPort = Config.iFirstPort + 2 * server->iIndex;
+    server->iListenSocket = Bench_Listen(iNSPort);
+    if (server->iListenSocket < 0)
+    {
+        fprintf(stderr, "[-]Register_Fake_Server: Port %d is not available\n", iNSPort);
+        return -1;
+    }
+
+    server->iRegisterSocket = Bench_Connect(Config.sIP, NS_SERVER_PORT);
+    if (server->iRegisterSocket < 0)
+    {
+        fprintf(stderr, "[-]Register_Fake_Server: Error in connecting to the Naming Server\n");
+        return -1;
+    }
+    int iVersion = Wire_Client_Hello(server->iRegisterSocket);
+    if (iVersion == WIRE_VERSION_1)
+    {
+        // The Name Server did not answer the HELLO, reconnect and talk v1
+        close(server->iRegisterSocket);
+        server->iRegisterSocket = Bench_Connect(Config.sIP, NS_SERVER_PORT);
+    }
+    if (iVersion < 0 || server->iRegisterSocket < 0)
+        return -1;
+
+    // "./nsb<run>-<k>" and every directory and file below it, one per line
+    size_t iSize = (size_t)(Config.iFiles + Config.iFiles / NSBENCH_FILES_PER_DIR + 2) * 64;
+    SERVER_INIT_INFO_STRUCT init;
+    init.sServerPort_NServer = iNSPort;
+    init.sServerPort_Client = iNSPort + 1;
+    init.MountPaths = (char *)malloc(iSize);
+    if (CheckNull(init.MountPaths, "[-]Register_Fake_Server: Error in allocating memory"))
+        return -1;
+    size_t n = snprintf(init.MountPaths, iSize, "./nsb%d-%d\n", iRunID, server->iIndex);
+    for (int i = 0; i < Config.iFiles; i++)
+    {
+        if (i % NSBENCH_FILES_PER_DIR == 0)
+            n += snprintf(init.MountPaths + n, iSize - n, "./nsb%d-%d/d%d\n", iRunID, server->iIndex, i / NSBENCH_FILES_PER_DIR);
+        n += snprintf(init.MountPaths + n, iSize - n, "./nsb%d-%d/d%d/f%d.txt\n", iRunID, server->iIndex, i / NSBENCH_FILES_PER_DIR, i);
+    }
+    init.iMountPathsLength = n;
+
+    WIRE_CONTEXT_STRUCT ctx = {iVersion, 0};
+    int err = Send_Server_Init(server->iRegisterSocket, &ctx, &init);
+    free(init.MountPaths);
+    if (err <= 0 || Recv_All(server->iRegisterSocket, &server->ServerID, sizeof(unsigned long)) <= 0)
+    {
+        fprintf(stderr, "[-]Register_Fake_Server: Error in registering server %d\n", server->iIndex);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Thread of a fake storage server: accepts the connection of the Naming Server and
+ *        acknowledges whatever it forwards
+ */
+static void *Fake_Server_Thread(void *serverHandle)
+{
+    NSBENCH_SERVER_STRUCT *server = (NSBENCH_SERVER_STRUCT *)serverHandle;
+    int sockfd = accept(server->iListenSocket, NULL, NULL);
+    if (sockfd < 0)
+        return NULL;
+
+    WIRE_CONTEXT_STRUCT ctx = {WIRE_VERSION_UNKNOWN, 0};
+    REQUEST_STRUCT request;
+    while (Recv_Request(sockfd, &ctx, &request) > 0)
+    {
+        RESPONSE_STRUCT response;
+        memset(&response, 0, sizeof(RESPONSE_STRUCT));
+        response.iResponseOperation = request.iRequestOperation;
+        response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
+        response.iResponseServerID = server->ServerID;
+        strncpy(response.sResponseData, "Done", MAX_BUFFER_SIZE);
+        if (Send_Response(sockfd, &ctx, &response) <= 0)
+            break;
+    }
+    close(sockfd);
+    return NULL;
+}
+
+/**
+ * @brief Connects a simulated client to the Naming Server (receives its ID, negotiates the wire version)
+ * @return: 0 on success, -1 on failure
+ */
+static int Connect_Client(NSBENCH_CLIENT_STRUCT *client)
+{
+    client->sockfd = Bench_Connect(Config.sIP, NS_CLIENT_PORT);
+    if (client->sockfd < 0 || Recv_All(client->sockfd, &client->ClientID, sizeof(unsigned long)) <= 0)
+        return -1;
+    client->iVersion = Wire_Client_Hello(client->sockfd);
+    if (client->iVersion == WIRE_VERSION_1)
+    {
+        // Fall back to v1 on a new connection
+        close(client->sockfd);
+        client->sockfd = Bench_Connect(Config.sIP, NS_CLIENT_PORT);
+        if (client->sockfd < 0 || Recv_All(client->sockfd, &client->ClientID, sizeof(unsigned long)) <= 0)
+            return -1;
+    }
+    return client->iVersion > 0 ? 0 : -1;
+}
+
+// Fills a request of the mix
+static void Make_Request(NSBENCH_CLIENT_STRUCT *client, REQUEST_STRUCT *request, int *iMixIndex, int *iMiss)
+{
+    int op = Bench_Pick_Op(&Config.mix, &client->iRandom);
+    *iMixIndex = Mix_Index(op);
+    *iMiss = (op != CMD_LIST) && (int)(Bench_Random(&client->iRandom) % 100) < Config.iMissPercent;
+    memset(request, 0, sizeof(REQUEST_STRUCT));
+    request->iRequestOperation = op;
+    request->iRequestClientID = client->ClientID;
+    request->iRequestFlags = (op == CMD_WRITE) ? REQUEST_FLAG_APPEND : REQUEST_FLAG_NONE;
+    Make_Path(client, op, *iMiss, request->sRequestPath);
+}
+
+// Counts a reply if its request was scheduled inside the measured window
+static void Record_Reply(NSBENCH_CLIENT_STRUCT *client, uint64_t iScheduledNs, int iMixIndex, int iMiss, RESPONSE_STRUCT *response)
+{
+    if (iScheduledNs < iMeasureStartNs || iScheduledNs >= iMeasureEndNs)
+        return;
+    int iFailed = (response->iResponseFlags == RESPONSE_FLAG_FAILURE);
+    Bench_Hist_Record(&client->hists[iMixIndex], Bench_Now() - iScheduledNs, iFailed != iMiss);
+}
+
+// Closed loop: the next request leaves when the reply of the previous one arrived
+static void Run_Closed_Loop(NSBENCH_CLIENT_STRUCT *client)
+{
+    WIRE_CONTEXT_STRUCT ctx = {client->iVersion, 0};
+    while (!atomic_load_explicit(&iStop, memory_order_relaxed))
+    {
+        REQUEST_STRUCT request;
+        RESPONSE_STRUCT response;
+        int iMixIndex, iMiss;
+        Make_Request(client, &request, &iMixIndex, &iMiss);
+        ctx.iRequestID++;
+
+        uint64_t iStartNs = Bench_Now();
+        if (iStartNs >= iMeasureEndNs)
+            break;
+        if (Send_Request(client->sockfd, &ctx, &request) <= 0 || Recv_Response(client->sockfd, &ctx, &response) <= 0)
+        {
+            client->iFailed = 1;
+            break;
+        }
+        Record_Reply(client, iStartNs, iMixIndex, iMiss, &response);
+    }
+}
+
+// Open loop receiver: matches the replies to their requests by request ID
+static void *Open_Loop_Receiver_Thread(void *clientHandle)
+{
+    NSBENCH_CLIENT_STRUCT *client = (NSBENCH_CLIENT_STRUCT *)clientHandle;
+    WIRE_CONTEXT_STRUCT ctx = {client->iVersion, 0};
+    uint64_t iDeadlineNs = iMeasureEndNs + NSBENCH_DRAIN_TIMEOUT * 1000000000ULL;
+
+    while (!atomic_load(&client->iSendDone) || atomic_load(&client->iReceived) < atomic_load(&client->iSent))
+    {
+        RESPONSE_STRUCT response;
+        int iRecvStatus = Recv_Response(client->sockfd, &ctx, &response);
+        if (iRecvStatus < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            // Nothing for a while, give up on the missing replies once the run is over
+            if (Bench_Now() > iDeadlineNs)
+                break;
+            continue;
+        }
+        if (iRecvStatus <= 0)
+        {
+            client->iFailed = 1;
+            break;
+        }
+
+        NSBENCH_INFLIGHT_STRUCT *slot = &client->inflight[ctx.iRequestID % Config.iWindow];
+        Record_Reply(client, slot->iScheduledNs, slot->iMixIndex, slot->iMiss, &response);
+        atomic_fetch_add(&client->iReceived, 1);
+        sem_post(&client->window);
+    }
+    return NULL;
+}
+
+// Open loop: requests leave on a fixed schedule, the replies are collected by a receiver thread
+static void Run_Open_Loop(NSBENCH_CLIENT_STRUCT *client)
+{
+    // The receiver polls so it can stop on requests that never get a reply
+    struct timeval timeout = {0, 100 * 1000};
+    setsockopt(client->sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sem_init(&client->window, 0, Config.iWindow);
+
+    pthread_t tReceiver;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, NSBENCH_THREAD_STACK);
+    int iThreadStatus = pthread_create(&tReceiver, &attr, Open_Loop_Receiver_Thread, client);
+    pthread_attr_destroy(&attr);
+    if (iThreadStatus != 0)
+    {
+        client->iFailed = 1;
+        return;
+    }
+
+    // Every client sends at rate / clients, their schedules are spread over one interval
+    uint64_t iIntervalNs = (uint64_t)(1e9 * Config.iClients / Config.fRate);
+    uint64_t iNextNs = Bench_Now() + iIntervalNs * client->iIndex / Config.iClients;
+    WIRE_CONTEXT_STRUCT ctx = {client->iVersion, 0};
+    while (iNextNs < iMeasureEndNs && !atomic_load_explicit(&iStop, memory_order_relaxed) && !client->iFailed)
+    {
+        Bench_Sleep_Until(iNextNs);
+        if (sem_trywait(&client->window) < 0)
+        {
+            client->iLate++;
+            sem_wait(&client->window);
+        }
+
+        REQUEST_STRUCT request;
+        ctx.iRequestID++;
+        NSBENCH_INFLIGHT_STRUCT *slot = &client->inflight[ctx.iRequestID % Config.iWindow];
+        Make_Request(client, &request, &slot->iMixIndex, &slot->iMiss);
+        slot->iScheduledNs = iNextNs;
+        atomic_fetch_add(&client->iSent, 1);
+        if (Send_Request(client->sockfd, &ctx, &request) <= 0)
+        {
+            client->iFailed = 1;
+            break;
+        }
+        iNextNs += iIntervalNs;
+    }
+    atomic_store(&client->iSendDone, 1);
+    pthread_join(tReceiver, NULL);
+    sem_destroy(&client->window);
+}
+
+static void *Client_Thread(void *clientHandle)
+{
+    NSBENCH_CLIENT_STRUCT *client = (NSBENCH_CLIENT_STRUCT *)clientHandle;
+    int err = Connect_Client(client);
+    if (err < 0)
+        fprintf(stderr, "[-]Client_Thread: Client %d could not connect to the Naming Server\n", client->iIndex);
+    else if (Config.fRate > 0 && client->iVersion != WIRE_VERSION_2)
+    {
+        fprintf(stderr, "[-]Client_Thread: The open loop pipelines requests, it needs wire protocol v2\n");
+        err = -1;
+    }
+    client->iFailed = (err < 0);
+
+    // Everyone starts together once all the clients are connected
+    pthread_barrier_wait(&StartBarrier);
+    if (!client->iFailed)
+    {
+        if (Config.fRate > 0)
+            Run_Open_Loop(client);
+        else
+            Run_Closed_Loop(client);
+    }
+
+    if (client->sockfd >= 0)
+    {
+        REQUEST_STRUCT request;
+        memset(&request, 0, sizeof(REQUEST_STRUCT));
+        request.iRequestOperation = CLOSE_CONNECTION;
+        request.iRequestClientID = client->ClientID;
+        WIRE_CONTEXT_STRUCT ctx = {client->iVersion, 0};
+        Send_Request(client->sockfd, &ctx, &request);
+        close(client->sockfd);
+    }
+    return NULL;
+}
+
+// The clients and the fake servers need a descriptor each (twice with the NS on the same machine)
+static void Raise_File_Limit()
+{
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static void Usage(char *sProgram)
+{
+    fprintf(stderr, "Usage: %s [-c clients] [-d seconds] [-W warmup_seconds] [-r rate] [-m mix] [-s servers] [-f files]"
+                    " [-p port] [-o window] [-x miss_percent] [-i ns_ip] [-j]\n", sProgram);
+}
+
+int main(int argc, char *argv[])
+{
+    // Parse the command line options
+    // -c <count>   : number of simulated clients (one connection each)
+    // -d <seconds> : measured duration
+    // -W <seconds> : load before measuring
+    // -r <rate>    : open loop at rate requests per second over all clients (0, the default, runs a closed loop)
+    // -m <mix>     : operations and weights, e.g. READ:60,WRITE:10,INFO:20,LIST:10
+    // -s <count>   : number of fake storage servers
+    // -f <count>   : number of files registered by every fake server
+    // -p <port>    : fake server k listens for the Naming Server on port + 2k
+    // -o <count>   : open loop, most requests in flight per client
+    // -x <percent> : share of READ/WRITE/INFO requests for paths that do not exist
+    // -i <ip>      : address of the Naming Server
+    // -j           : write the report as JSON
+    Config.iClients = NSBENCH_DEFAULT_CLIENTS;
+    Config.iDuration = NSBENCH_DEFAULT_DURATION;
+    Config.iWarmup = NSBENCH_DEFAULT_WARMUP;
+    Config.iServers = NSBENCH_DEFAULT_SERVERS;
+    Config.iFiles = NSBENCH_DEFAULT_FILES;
+    Config.iFirstPort = NSBENCH_DEFAULT_PORT;
+    Config.iWindow = NSBENCH_DEFAULT_WINDOW;
+    strncpy(Config.sIP, NS_IP, IP_LENGTH - 1);
+    strncpy(Config.sMix, NSBENCH_DEFAULT_MIX, MAX_BUFFER_SIZE - 1);
+    int opt;
+    while ((opt = getopt(argc, argv, "c:d:W:r:m:s:f:p:o:x:i:j")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c': Config.iClients = atoi(optarg); break;
+        case 'd': Config.iDuration = atoi(optarg); break;
+        case 'W': Config.iWarmup = atoi(optarg); break;
+        case 'r': Config.fRate = atof(optarg); break;
+        case 'm': strncpy(Config.sMix, optarg, MAX_BUFFER_SIZE - 1); break;
+        case 's': Config.iServers = atoi(optarg); break;
+        case 'f': Config.iFiles = atoi(optarg); break;
+        case 'p': Config.iFirstPort = atoi(optarg); break;
+        case 'o': Config.iWindow = atoi(optarg); break;
+        case 'x': Config.iMissPercent = atoi(optarg); break;
+        case 'i': strncpy(Config.sIP, optarg, IP_LENGTH - 1); break;
+        case 'j': Config.iJson = 1; break;
+        default:
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (Config.iClients < 1 || Config.iClients > NSBENCH_MAX_CLIENTS || Config.iDuration < 1 || Config.iWarmup < 0 ||
+        Config.fRate < 0 || Config.iServers < 1 || Config.iServers > NSBENCH_MAX_SERVERS || Config.iFiles < 1 ||
+        Config.iWindow < 1 || Config.iWindow > NSBENCH_MAX_WINDOW || Config.iMissPercent < 0 || Config.iMissPercent > 100)
+    {
+        fprintf(stderr, "[-]Invalid option (at most %d clients, %d servers and a window of %d)\n", NSBENCH_MAX_CLIENTS, NSBENCH_MAX_SERVERS, NSBENCH_MAX_WINDOW);
+        Usage(argv[0]);
+        return 1;
+    }
+    if (Bench_Parse_Mix(Config.sMix, &Config.mix) < 0)
+    {
+        fprintf(stderr, "[-]Invalid mix %s\n", Config.sMix);
+        return 1;
+    }
+    for (int i = 0; i < Config.mix.iCount; i++)
+    {
+        // The other operations are forwarded to the storage servers or answered with an ACK later
+        int op = Config.mix.ops[i];
+        if (op != CMD_READ && op != CMD_WRITE && op != CMD_INFO && op != CMD_LIST)
+        {
+            fprintf(stderr, "[-]The mix can only resolve READ, WRITE, INFO and LIST\n");
+            return 1;
+        }
+    }
+    Raise_File_Limit();
+    iRunID = getpid();
+
+    // Register the synthetic mount table
+    NSBENCH_SERVER_STRUCT *servers = (NSBENCH_SERVER_STRUCT *)calloc(Config.iServers, sizeof(NSBENCH_SERVER_STRUCT));
+    NSBENCH_CLIENT_STRUCT *clients = (NSBENCH_CLIENT_STRUCT *)calloc(Config.iClients, sizeof(NSBENCH_CLIENT_STRUCT));
+    pthread_t *tClients = (pthread_t *)calloc(Config.iClients, sizeof(pthread_t));
+    if (CheckNull(servers, "[-]main: Error in allocating memory") || CheckNull(clients, "[-]main: Error in allocating memory") ||
+        CheckNull(tClients, "[-]main: Error in allocating memory"))
+        return 1;
+    for (int i = 0; i < Config.iServers; i++)
+    {
+        servers[i].iIndex = i;
+        if (Register_Fake_Server(&servers[i]) < 0 || pthread_create(&servers[i].thread, NULL, Fake_Server_Thread, &servers[i]) != 0)
+            return 1;
+        pthread_detach(servers[i].thread);
+    }
+
+    // Connect the clients, the load starts when all of them are connected
+    pthread_barrier_init(&StartBarrier, NULL, Config.iClients + 1);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, NSBENCH_THREAD_STACK);
+    for (int i = 0; i < Config.iClients; i++)
+    {
+        clients[i].iIndex = i;
+        clients[i].sockfd = -1;
+        clients[i].iRandom = 0x9E3779B97F4A7C15ULL * (i + 1);
+        clients[i].inflight = (NSBENCH_INFLIGHT_STRUCT *)calloc(Config.iWindow, sizeof(NSBENCH_INFLIGHT_STRUCT));
+        if (CheckNull(clients[i].inflight, "[-]main: Error in allocating memory") ||
+            pthread_create(&tClients[i], &attr, Client_Thread, &clients[i]) != 0)
+        {
+            fprintf(stderr, "[-]main: Error in starting client %d\n", i);
+            return 1;
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    uint64_t iStartNs = Bench_Now();
+    iMeasureStartNs = iStartNs + (uint64_t)Config.iWarmup * 1000000000ULL;
+    iMeasureEndNs = iMeasureStartNs + (uint64_t)Config.iDuration * 1000000000ULL;
+    pthread_barrier_wait(&StartBarrier);
+    Bench_Sleep_Until(iMeasureEndNs);
+    atomic_store(&iStop, 1);
+
+    // Merge the histograms of the clients
+    BENCH_HIST_STRUCT *hists = (BENCH_HIST_STRUCT *)calloc(Config.mix.iCount, sizeof(BENCH_HIST_STRUCT));
+    if (CheckNull(hists, "[-]main: Error in allocating memory"))
+        return 1;
+    int iFailedClients = 0;
+    unsigned long iLate = 0;
+    for (int i = 0; i < Config.iClients; i++)
+    {
+        pthread_join(tClients[i], NULL);
+        for (int j = 0; j < Config.mix.iCount; j++)
+            Bench_Hist_Merge(&hists[j], &clients[i].hists[j]);
+        iFailedClients += clients[i].iFailed;
+        iLate += clients[i].iLate;
+        free(clients[i].inflight);
+    }
+
+    const char *names[BENCH_MAX_MIX];
+    for (int i = 0; i < Config.mix.iCount; i++)
+        names[i] = CommandName(Config.mix.ops[i]);
+
+    if (Config.iJson)
+    {
+        printf("{\"clients\":%d,\"mode\":\"%s\",\"target_rate\":%.1f,\"servers\":%d,\"files\":%d,\"miss_percent\":%d,"
+               "\"mix\":\"%s\",\"failed_clients\":%d,\"late_sends\":%lu,",
+               Config.iClients, Config.fRate > 0 ? "open" : "closed", Config.fRate, Config.iServers, Config.iFiles,
+               Config.iMissPercent, Config.sMix, iFailedClients, iLate);
+        Bench_Report(stdout, 1, names, hists, Config.mix.iCount, Config.iDuration);
+        printf("}\n");
+    }
+    else
+    {
+        printf("nsbench: %d clients, %s loop", Config.iClients, Config.fRate > 0 ? "open" : "closed");
+        if (Config.fRate > 0)
+            printf(" at %.0f req/s (window %d)", Config.fRate, Config.iWindow);
+        printf(", %d s measured after %d s warmup\n", Config.iDuration, Config.iWarmup);
+        printf("mount table: %d servers x %d files, %d%% misses, mix %s\n\n", Config.iServers, Config.iFiles, Config.iMissPercent, Config.sMix);
+        Bench_Report(stdout, 0, names, hists, Config.mix.iCount, Config.iDuration);
+        if (Config.fRate > 0)
+            printf("\nlate sends (window full): %lu\n", iLate);
+        if (iFailedClients)
+            printf("clients with a broken connection: %d\n", iFailedClients);
+    }
+
+    for (int i = 0; i < Config.iServers; i++)
+        close(servers[i].iRegisterSocket);
+    free(hists);
+    free(servers);
+    free(clients);
+    free(tClients);
+    return iFailedClients ? 2 : 0;
+}
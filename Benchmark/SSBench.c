@@ -0,0 +1,561 @@
+// Data path benchmark for the Storage Server: starts a server over a temporary directory of
+// generated files and streams READ and WRITE requests to it the way the clients do
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "../Externals.h"
+#include "../Wire.h"
+#include "../Storage Server/ErrorCodes.h"
+#include "./Bench.h"
+
+#define SSBENCH_DEFAULT_READERS 4
+#define SSBENCH_DEFAULT_WRITERS 1
+#define SSBENCH_DEFAULT_SIZE (1024 * 1024)
+#define SSBENCH_MIN_SIZE 1024LL
+#define SSBENCH_MAX_SIZE (10LL << 30)
+#define SSBENCH_DEFAULT_DURATION 10                // Seconds measured
+#define SSBENCH_DEFAULT_WARMUP 1                   // Seconds of load before measuring
+#define SSBENCH_DEFAULT_PORT 9600                  // The server listens for the NS on port, for the clients on port + 1
+#define SSBENCH_DEFAULT_SERVER "../Storage Server/StorageServer"
+#define SSBENCH_DEFAULT_TEMP "/tmp"
+#define SSBENCH_MAX_THREADS 256
+#define SSBENCH_START_TIMEOUT 10                   // Seconds the server gets to register and listen
+#define SSBENCH_IO_TIMEOUT 30                      // Seconds a transfer may stall before it counts as failed
+#define SSBENCH_FILL_CHUNK (64 * 1024)
+#define SSBENCH_FRAME_DATA WIRE_DATA_CHUNK         // Data of a WRITE frame (the client sends its input in such pieces)
+
+/*
+The Storage Server registers with the Naming Server before it serves anyone, so ssbench plays the
+Naming Server for it (NS_SERVER_PORT must be free) and talks to its client port directly. Every
+operation is one connection, like a client after the Naming Server resolved the path:
+  READ:  request, data stream of the file, response
+  WRITE: request, empty data stream of the server, data stream of SSBENCH_FRAME_DATA byte frames, response
+Every reader and writer runs a closed loop. With -c distinct each one has a file of its own, with
+-c shared they all contend for the lock of a single file. Operations started inside the measured
+window are counted, the last of them may finish after it (the throughput is over the time they took).
+The CPU used per byte is measured for the server and for ssbench itself over the same interval.
+*/
+
+typedef struct SSBENCH_CONFIG_STRUCT
+{
+    int iReaders;
+    int iWriters;
+    long long iFileSize;
+    int iAppend;                                    // WRITE appends instead of overwriting
+    int iShared;                                    // Everyone uses the same file
+    int iDuration;
+    int iWarmup;
+    int iPort;
+    int iKeep;
+    int iJson;
+    char sServer[PATH_MAX];
+    char sTempParent[PATH_MAX];
+} SSBENCH_CONFIG_STRUCT;
+
+enum
+{
+    SSBENCH_OP_READ,
+    SSBENCH_OP_WRITE,
+    SSBENCH_OPS
+};
+
+typedef struct SSBENCH_WORKER_STRUCT
+{
+    int iIndex;
+    int iOperation;                                 // SSBENCH_OP_*
+    char sPath[MAX_BUFFER_SIZE];                    // Path of the request (Mount/f<i>.txt)
+    uint32_t iRequestID;
+    BENCH_HIST_STRUCT hist;
+    unsigned long long iBytes;                      // Data moved by the counted operations
+    uint64_t iLastEndNs;                            // End of the last counted operation
+} SSBENCH_WORKER_STRUCT;
+
+static SSBENCH_CONFIG_STRUCT Config;
+static char sTempDir[PATH_MAX];
+static uint64_t iMeasureStartNs;
+static uint64_t iMeasureEndNs;
+static atomic_int iStop = 0;
+static pthread_barrier_t StartBarrier;
+static char WriteData[SSBENCH_FRAME_DATA];        // Frame sent by the writers, filled once
+
+// Text written to the files and sent by the writers
+static void Fill_Pattern(char *buffer, size_t iSize)
+{
+    for (size_t i = 0; i < iSize; i++)
+        buffer[i] = (i % 64 == 63) ? '\n' : 'a' + (i % 26);
+}
+
+/**
+ * @brief Creates a file of the benchmark filled with text
+ * @return: 0 on success, -1 on failure
+ */
+static int Create_File(const char *sPath, long long iSize)
+{
+    int fd = open(sPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    char buffer[SSBENCH_FILL_CHUNK];
+    Fill_Pattern(buffer, sizeof(buffer));
+    for (long long iWritten = 0; iWritten < iSize;)
+    {
+        size_t iChunk = (iSize - iWritten < (long long)sizeof(buffer)) ? (size_t)(iSize - iWritten) : sizeof(buffer);
+        ssize_t n = write(fd, buffer, iChunk);
+        if (n <= 0)
+        {
+            close(fd);
+            return -1;
+        }
+        iWritten += n;
+    }
+    close(fd);
+    return 0;
+}
+
+/**
+ * @brief Starts the Storage Server in the mount directory and registers it
+ * @param iFakeNS: Listening socket on NS_SERVER_PORT, answers the registration of the server
+ * @param iRegisterSocket: Set to the connection the server registered on (kept open while it runs)
+ * @return: The pid of the server, -1 on failure
+ */
+static int Start_Storage_Server(int iFakeNS, int *iRegisterSocket)
+{
+    char sMountDir[PATH_MAX], sOutput[PATH_MAX];
+    snprintf(sMountDir, sizeof(sMountDir), "%s/mount", sTempDir);
+    snprintf(sOutput, sizeof(sOutput), "%s/ss.out", sTempDir);
+
+    // The server asks for its two ports on stdin
+    int pipefd[2];
+    if (pipe(pipefd) < 0)
+        return -1;
+    int pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0)
+    {
+        int out = open(sOutput, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out < 0 || chdir(sMountDir) < 0)
+            _exit(127);
+        dup2(pipefd[0], STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        dup2(out, STDERR_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        close(iFakeNS);
+        execl(Config.sServer, Config.sServer, (char *)NULL);
+        _exit(127);
+    }
+    close(pipefd[0]);
+    char sPorts[64];
+    int n = snprintf(sPorts, sizeof(sPorts), "%d %d\n", Config.iPort, Config.iPort + 1);
+    if (write(pipefd[1], sPorts, n) != n)
+        fprintf(stderr, "[-]Start_Storage_Server: Error in passing the ports to the server\n");
+    close(pipefd[1]);
+
+    // Registration: wire negotiation, init packet, server ID
+    struct timeval timeout = {SSBENCH_START_TIMEOUT, 0};
+    setsockopt(iFakeNS, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int sockfd = accept(iFakeNS, NULL, NULL);
+    if (sockfd < 0)
+    {
+        fprintf(stderr, "[-]Start_Storage_Server: The server did not register (see %s)\n", sOutput);
+        return pid;
+    }
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    WIRE_CONTEXT_STRUCT ctx = {WIRE_VERSION_UNKNOWN, 0};
+    ctx.iVersion = Wire_Detect_Version(sockfd);
+    if (ctx.iVersion == WIRE_VERSION_2)
+        ctx.iVersion = Wire_Server_Hello(sockfd);
+    SERVER_INIT_INFO_STRUCT init;
+    unsigned long ServerID = 1;
+    if (ctx.iVersion <= 0 || Recv_Server_Init(sockfd, &ctx, &init) <= 0 || Send_All(sockfd, &ServerID, sizeof(ServerID)) <= 0)
+    {
+        fprintf(stderr, "[-]Start_Storage_Server: Error in registering the server (see %s)\n", sOutput);
+        close(sockfd);
+        return pid;
+    }
+    free(init.MountPaths);
+    *iRegisterSocket = sockfd;
+    return pid;
+}
+
+// Waits for the client port of the server to accept connections
+static int Wait_For_Server()
+{
+    uint64_t iDeadline = Bench_Now() + SSBENCH_START_TIMEOUT * 1000000000ULL;
+    while (Bench_Now() < iDeadline)
+    {
+        int sockfd = Bench_Connect(LOCAL_MACHINE_IP, Config.iPort + 1);
+        if (sockfd >= 0)
+        {
+            close(sockfd);
+            return 0;
+        }
+        usleep(10000);
+    }
+    return -1;
+}
+
+// Opens the connection of one operation and sends its request
+static int Open_Request(SSBENCH_WORKER_STRUCT *worker, int op, int iFlags, WIRE_CONTEXT_STRUCT *ctx)
+{
+    int sockfd = Bench_Connect(LOCAL_MACHINE_IP, Config.iPort + 1);
+    if (sockfd < 0)
+        return -1;
+    struct timeval timeout = {SSBENCH_IO_TIMEOUT, 0};
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    REQUEST_STRUCT request;
+    memset(&request, 0, sizeof(REQUEST_STRUCT));
+    request.iRequestOperation = op;
+    request.iRequestFlags = iFlags;
+    strncpy(request.sRequestPath, worker->sPath, MAX_BUFFER_SIZE - 1);
+    memset(ctx, 0, sizeof(WIRE_CONTEXT_STRUCT));
+    ctx->iVersion = WIRE_VERSION_2;
+    ctx->iRequestID = ++worker->iRequestID;
+    if (Send_Request(sockfd, ctx, &request) <= 0)
+    {
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+// Receives the final response of an operation, returns 0 if the server reports a success
+static int Close_Request(int sockfd, WIRE_CONTEXT_STRUCT *ctx)
+{
+    RESPONSE_STRUCT response;
+    int err = Recv_Response(sockfd, ctx, &response);
+    close(sockfd);
+    return (err > 0 && response.iResponseErrorCode == ERROR_CODE_SUCCESS) ? 0 : -1;
+}
+
+/**
+ * @brief Reads the file of a worker
+ * @param iBytes: Set to the bytes of the file received
+ * @return: 0 on success, -1 on failure
+ */
+static int Read_File(SSBENCH_WORKER_STRUCT *worker, unsigned long long *iBytes)
+{
+    char buffer[SSBENCH_FILL_CHUNK];
+    WIRE_CONTEXT_STRUCT ctx;
+    int sockfd = Open_Request(worker, CMD_READ, REQUEST_FLAG_NONE, &ctx);
+    if (sockfd < 0)
+        return -1;
+
+    // Data frames until the end of the stream
+    WIRE_HEADER_STRUCT header;
+    WIRE_DATA_END_STRUCT streamEnd;
+    *iBytes = 0;
+    while (1)
+    {
+        if (Recv_Data_Header(sockfd, &header, &streamEnd) <= 0)
+        {
+            close(sockfd);
+            return -1;
+        }
+        if (header.iFrameType == FRAME_DATA_END)
+            break;
+        for (size_t iLeft = header.iPayloadLength; iLeft > 0;)
+        {
+            size_t iChunk = (iLeft < sizeof(buffer)) ? iLeft : sizeof(buffer);
+            if (Recv_All(sockfd, buffer, iChunk) <= 0)
+            {
+                close(sockfd);
+                return -1;
+            }
+            iLeft -= iChunk;
+            *iBytes += iChunk;
+        }
+    }
+    int err = Close_Request(sockfd, &ctx);
+    return (err == 0 && streamEnd.iStatus == WIRE_DATA_OK && streamEnd.iStreamBytes == *iBytes) ? 0 : -1;
+}
+
+/**
+ * @brief Writes (appends or overwrites) the file of a worker with Config.iFileSize bytes
+ * @param iBytes: Set to the bytes of data sent
+ * @return: 0 on success, -1 on failure
+ */
+static int Write_File(SSBENCH_WORKER_STRUCT *worker, unsigned long long *iBytes)
+{
+    WIRE_CONTEXT_STRUCT ctx;
+    int sockfd = Open_Request(worker, CMD_WRITE, Config.iAppend ? REQUEST_FLAG_APPEND : REQUEST_FLAG_OVERWRITE, &ctx);
+    if (sockfd < 0)
+        return -1;
+
+    // The server opens the file before it takes the data
+    WIRE_HEADER_STRUCT header;
+    WIRE_DATA_END_STRUCT streamEnd;
+    if (Recv_Data_Header(sockfd, &header, &streamEnd) <= 0 || header.iFrameType != FRAME_DATA_END || streamEnd.iStatus != WIRE_DATA_OK)
+    {
+        close(sockfd);
+        return -1;
+    }
+
+    *iBytes = 0;
+    while (*iBytes < (unsigned long long)Config.iFileSize)
+    {
+        unsigned long long iLeft = Config.iFileSize - *iBytes;
+        size_t iFrame = (iLeft < SSBENCH_FRAME_DATA) ? iLeft : SSBENCH_FRAME_DATA;
+        if (Send_Data(sockfd, &ctx, WriteData, iFrame) <= 0)
+        {
+            close(sockfd);
+            return -1;
+        }
+        *iBytes += iFrame;
+    }
+    streamEnd.iStreamBytes = *iBytes;
+    if (Send_Data_End(sockfd, &ctx, &streamEnd) <= 0)
+    {
+        close(sockfd);
+        return -1;
+    }
+    return Close_Request(sockfd, &ctx);
+}
+
+static void *Worker_Thread(void *workerHandle)
+{
+    SSBENCH_WORKER_STRUCT *worker = (SSBENCH_WORKER_STRUCT *)workerHandle;
+    pthread_barrier_wait(&StartBarrier);
+    while (!atomic_load(&iStop))
+    {
+        unsigned long long iBytes = 0;
+        uint64_t iStartNs = Bench_Now();
+        int err = (worker->iOperation == SSBENCH_OP_READ) ? Read_File(worker, &iBytes) : Write_File(worker, &iBytes);
+        uint64_t iEndNs = Bench_Now();
+        if (iStartNs < iMeasureStartNs || iStartNs >= iMeasureEndNs)
+            continue;
+        Bench_Hist_Record(&worker->hist, iEndNs - iStartNs, err < 0);
+        worker->iBytes += iBytes;
+        worker->iLastEndNs = iEndNs;
+    }
+    return NULL;
+}
+
+// Removes the temporary directory (the files of the benchmark and of the server)
+static void Remove_Temp_Dir()
+{
+    if (Config.iKeep || sTempDir[0] == '\0')
+        return;
+    int pid = fork();
+    if (pid == 0)
+    {
+        execlp("rm", "rm", "-rf", sTempDir, (char *)NULL);
+        _exit(127);
+    }
+    if (pid > 0)
+        waitpid(pid, NULL, 0);
+}
+
+static void Usage(char *sProgram)
+{
+    fprintf(stderr, "Usage: %s [-r readers] [-w writers] [-s file_size] [-m append|overwrite] [-c distinct|shared] [-d seconds]"
+                    " [-W warmup_seconds] [-e storage_server] [-p port] [-t temp_dir] [-k] [-j]\n", sProgram);
+}
+
+int main(int argc, char *argv[])
+{
+    // Parse the command line options
+    // -r <count>   : number of readers (each one reads a whole file at a time)
+    // -w <count>   : number of writers (each one writes a whole file at a time)
+    // -s <size>    : size of the files and of every write, 1K to 10G (K, M and G suffixes)
+    // -m <mode>    : WRITE appends or overwrites (overwrite by default)
+    // -c <mode>    : distinct files per reader/writer or a single shared file
+    // -d <seconds> : measured duration
+    // -W <seconds> : load before measuring
+    // -e <path>    : Storage Server binary
+    // -p <port>    : the server listens for the NS on port and for the clients on port + 1
+    // -t <dir>     : where the temporary directory is created
+    // -k           : keep the temporary directory
+    // -j           : write the report as JSON
+    Config.iReaders = SSBENCH_DEFAULT_READERS;
+    Config.iWriters = SSBENCH_DEFAULT_WRITERS;
+    Config.iFileSize = SSBENCH_DEFAULT_SIZE;
+    Config.iDuration = SSBENCH_DEFAULT_DURATION;
+    Config.iWarmup = SSBENCH_DEFAULT_WARMUP;
+    Config.iPort = SSBENCH_DEFAULT_PORT;
+    strncpy(Config.sServer, SSBENCH_DEFAULT_SERVER, PATH_MAX - 1);
+    strncpy(Config.sTempParent, SSBENCH_DEFAULT_TEMP, PATH_MAX - 1);
+    int iBadMode = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:w:s:m:c:d:W:e:p:t:kj")) != -1)
+    {
+        switch (opt)
+        {
+        case 'r': Config.iReaders = atoi(optarg); break;
+        case 'w': Config.iWriters = atoi(optarg); break;
+        case 's': Config.iFileSize = Bench_Parse_Size(optarg); break;
+        case 'm':
+            Config.iAppend = (strcasecmp(optarg, "append") == 0);
+            iBadMode |= !Config.iAppend && strcasecmp(optarg, "overwrite") != 0;
+            break;
+        case 'c':
+            Config.iShared = (strcasecmp(optarg, "shared") == 0);
+            iBadMode |= !Config.iShared && strcasecmp(optarg, "distinct") != 0;
+            break;
+        case 'd': Config.iDuration = atoi(optarg); break;
+        case 'W': Config.iWarmup = atoi(optarg); break;
+        case 'e': strncpy(Config.sServer, optarg, PATH_MAX - 1); break;
+        case 'p': Config.iPort = atoi(optarg); break;
+        case 't': strncpy(Config.sTempParent, optarg, PATH_MAX - 1); break;
+        case 'k': Config.iKeep = 1; break;
+        case 'j': Config.iJson = 1; break;
+        default:
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    int iWorkers = Config.iReaders + Config.iWriters;
+    if (iBadMode || Config.iReaders < 0 || Config.iWriters < 0 || iWorkers < 1 || iWorkers > SSBENCH_MAX_THREADS ||
+        Config.iFileSize < SSBENCH_MIN_SIZE || Config.iFileSize > SSBENCH_MAX_SIZE || Config.iDuration < 1 || Config.iWarmup < 0)
+    {
+        fprintf(stderr, "[-]Invalid option (1 to %d readers and writers, files of 1K to 10G)\n", SSBENCH_MAX_THREADS);
+        Usage(argv[0]);
+        return 1;
+    }
+    // The server is started from the temporary directory
+    char sServer[PATH_MAX];
+    if (realpath(Config.sServer, sServer) == NULL || access(sServer, X_OK) < 0)
+    {
+        fprintf(stderr, "[-]Storage Server binary %s not found (build it or pass -e)\n", Config.sServer);
+        return 1;
+    }
+    strncpy(Config.sServer, sServer, PATH_MAX - 1);
+    signal(SIGPIPE, SIG_IGN);
+
+    // ssbench answers the registration in place of the Naming Server
+    int iFakeNS = Bench_Listen(NS_SERVER_PORT);
+    if (iFakeNS < 0)
+    {
+        fprintf(stderr, "[-]Port %d is in use, stop the Naming Server (ssbench registers the Storage Server itself)\n", NS_SERVER_PORT);
+        return 1;
+    }
+
+    // Temporary directory: mount/ is served, ss.out gets the output of the server
+    snprintf(sTempDir, sizeof(sTempDir), "%s/ssbench-XXXXXX", Config.sTempParent);
+    char sMountDir[PATH_MAX];
+    if (mkdtemp(sTempDir) == NULL || snprintf(sMountDir, sizeof(sMountDir), "%s/mount", sTempDir) < 0 || mkdir(sMountDir, 0755) < 0)
+    {
+        fprintf(stderr, "[-]Error in creating a temporary directory in %s\n", Config.sTempParent);
+        return 1;
+    }
+    SSBENCH_WORKER_STRUCT *workers = (SSBENCH_WORKER_STRUCT *)calloc(iWorkers, sizeof(SSBENCH_WORKER_STRUCT));
+    pthread_t *tWorkers = (pthread_t *)calloc(iWorkers, sizeof(pthread_t));
+    if (CheckNull(workers, "[-]main: Error in allocating memory") || CheckNull(tWorkers, "[-]main: Error in allocating memory"))
+        return 1;
+    int iFiles = Config.iShared ? 1 : iWorkers;
+    for (int i = 0; i < iFiles; i++)
+    {
+        char sPath[PATH_MAX];
+        snprintf(sPath, sizeof(sPath), "%s/f%d.txt", sMountDir, i);
+        if (Create_File(sPath, Config.iFileSize) < 0)
+        {
+            fprintf(stderr, "[-]Error in creating %s\n", sPath);
+            Remove_Temp_Dir();
+            return 1;
+        }
+    }
+
+    int iRegisterSocket = -1;
+    int pid = Start_Storage_Server(iFakeNS, &iRegisterSocket);
+    if (pid < 0 || iRegisterSocket < 0 || Wait_For_Server() < 0)
+    {
+        fprintf(stderr, "[-]The Storage Server did not start\n");
+        if (pid > 0)
+            kill(pid, SIGKILL);
+        Remove_Temp_Dir();
+        return 1;
+    }
+
+    // Readers first, then writers
+    Fill_Pattern(WriteData, SSBENCH_FRAME_DATA);
+    pthread_barrier_init(&StartBarrier, NULL, iWorkers + 1);
+    for (int i = 0; i < iWorkers; i++)
+    {
+        workers[i].iIndex = i;
+        workers[i].iOperation = (i < Config.iReaders) ? SSBENCH_OP_READ : SSBENCH_OP_WRITE;
+        snprintf(workers[i].sPath, MAX_BUFFER_SIZE, "Mount/f%d.txt", Config.iShared ? 0 : i);
+        if (pthread_create(&tWorkers[i], NULL, Worker_Thread, &workers[i]) != 0)
+        {
+            fprintf(stderr, "[-]main: Error in starting worker %d\n", i);
+            kill(pid, SIGKILL);
+            Remove_Temp_Dir();
+            return 1;
+        }
+    }
+
+    iMeasureStartNs = Bench_Now() + (uint64_t)Config.iWarmup * 1000000000ULL;
+    iMeasureEndNs = iMeasureStartNs + (uint64_t)Config.iDuration * 1000000000ULL;
+    pthread_barrier_wait(&StartBarrier);
+    Bench_Sleep_Until(iMeasureStartNs);
+    long long iServerCPU = Bench_CPU_Time(pid), iBenchCPU = Bench_CPU_Time(0);
+    Bench_Sleep_Until(iMeasureEndNs);
+    atomic_store(&iStop, 1);
+
+    // Merge the readers and the writers
+    BENCH_HIST_STRUCT hists[SSBENCH_OPS];
+    unsigned long long iBytes[SSBENCH_OPS] = {0, 0};
+    uint64_t iLastEndNs = iMeasureEndNs;
+    memset(hists, 0, sizeof(hists));
+    for (int i = 0; i < iWorkers; i++)
+    {
+        pthread_join(tWorkers[i], NULL);
+        Bench_Hist_Merge(&hists[workers[i].iOperation], &workers[i].hist);
+        iBytes[workers[i].iOperation] += workers[i].iBytes;
+        if (workers[i].iLastEndNs > iLastEndNs)
+            iLastEndNs = workers[i].iLastEndNs;
+    }
+    iServerCPU = Bench_CPU_Time(pid) - iServerCPU;
+    iBenchCPU = Bench_CPU_Time(0) - iBenchCPU;
+    double fSeconds = (iLastEndNs - iMeasureStartNs) / 1e9;
+    unsigned long long iTotalBytes = iBytes[SSBENCH_OP_READ] + iBytes[SSBENCH_OP_WRITE];
+    double fServerNsPerByte = iTotalBytes ? (double)iServerCPU / iTotalBytes : 0;
+    double fBenchNsPerByte = iTotalBytes ? (double)iBenchCPU / iTotalBytes : 0;
+
+    const char *names[SSBENCH_OPS] = {CommandName(CMD_READ), CommandName(CMD_WRITE)};
+    if (Config.iJson)
+    {
+        printf("{\"readers\":%d,\"writers\":%d,\"file_size\":%lld,\"write_mode\":\"%s\",\"files\":\"%s\","
+               "\"read_mb_per_s\":%.2f,\"write_mb_per_s\":%.2f,\"server_cpu_ns_per_byte\":%.3f,\"bench_cpu_ns_per_byte\":%.3f,",
+               Config.iReaders, Config.iWriters, Config.iFileSize, Config.iAppend ? "append" : "overwrite",
+               Config.iShared ? "shared" : "distinct", iBytes[SSBENCH_OP_READ] / 1048576.0 / fSeconds,
+               iBytes[SSBENCH_OP_WRITE] / 1048576.0 / fSeconds, fServerNsPerByte, fBenchNsPerByte);
+        Bench_Report(stdout, 1, names, hists, SSBENCH_OPS, fSeconds);
+        printf("}\n");
+    }
+    else
+    {
+        printf("ssbench: %d readers, %d writers (%s) on %s of %lld bytes, %d s measured after %d s warmup\n\n",
+               Config.iReaders, Config.iWriters, Config.iAppend ? "append" : "overwrite",
+               Config.iShared ? "one shared file" : "distinct files", Config.iFileSize, Config.iDuration, Config.iWarmup);
+        Bench_Report(stdout, 0, names, hists, SSBENCH_OPS, fSeconds);
+        printf("\nthroughput: READ %.2f MB/s, WRITE %.2f MB/s over %.2f s\n", iBytes[SSBENCH_OP_READ] / 1048576.0 / fSeconds,
+               iBytes[SSBENCH_OP_WRITE] / 1048576.0 / fSeconds, fSeconds);
+        printf("cpu per byte: server %.3f ns, ssbench %.3f ns\n", fServerNsPerByte, fBenchNsPerByte);
+    }
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    close(iRegisterSocket);
+    close(iFakeNS);
+    Remove_Temp_Dir();
+    free(workers);
+    free(tWorkers);
+    return (hists[SSBENCH_OP_READ].iErrors + hists[SSBENCH_OP_WRITE].iErrors) ? 2 : 0;
+}
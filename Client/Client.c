@@ -16,14 +16,15 @@
 
 // Custom Header Files
 #include "../Externals.h"
+#include "../Wire.h"
 #include "../colour.h"
 #include "./Headers.h"
 #include "./Hash.h"
 #include "./ErrorCodes.h"
 
-FILE *Clientlog;
 HashTable *table;
 unsigned long iClientID;
+int iWireVersion = WIRE_VERSION_1;
 CLOCK *Clock;
 
 volatile sig_atomic_t signal_received = 0;
@@ -39,7 +40,7 @@ CLOCK *InitClock()
     CLOCK *C = (CLOCK *)malloc(sizeof(CLOCK));
     if (CheckNull(C, "[-]InitClock: Error in allocating memory"))
     {
-        fprintf(Clientlog, "[-]InitClock: Error in allocating memory \n");
+        LOG_ERROR("[-]InitClock: Error in allocating memory ");
         exit(EXIT_FAILURE);
     }
 
@@ -47,7 +48,7 @@ CLOCK *InitClock()
     C->bootTime = GetCurrTime(C);
     if (CheckError(C->bootTime, "[-]InitClock: Error in getting current time"))
     {
-        fprintf(Clientlog, "[-]InitClock: Error in getting current time\n");
+        LOG_ERROR("[-]InitClock: Error in getting current time");
         free(C);
         exit(EXIT_FAILURE);
     }
@@ -55,7 +56,7 @@ CLOCK *InitClock()
     int err = clock_gettime(CLOCK_MONOTONIC_RAW, &C->Btime);
     if (CheckError(err, "[-]InitClock: Error in getting current time"))
     {
-        fprintf(Clientlog, "[-]InitClock: Error in getting current time\n");
+        LOG_ERROR("[-]InitClock: Error in getting current time");
         free(C);
         exit(EXIT_FAILURE);
     }
@@ -72,19 +73,72 @@ double GetCurrTime(CLOCK *Clock)
 {
     if (CheckNull(Clock, "[-]GetCurrTime: Invalid clock object"))
     {
-        fprintf(Clientlog, "[-]GetCurrTime: Invalid clock object\n");
+        LOG_ERROR("[-]GetCurrTime: Invalid clock object");
         return -1;
     }
     struct timespec time;
     int err = clock_gettime(CLOCK_MONOTONIC_RAW, &time);
     if (CheckError(err, "[-]GetCurrTime: Error in getting current time"))
     {
-        fprintf(Clientlog, "[-]GetCurrTime: Error in getting current time\n");
+        LOG_ERROR("[-]GetCurrTime: Error in getting current time");
         return -1;
     }
     return (time.tv_sec + time.tv_nsec * 1e-9) - (Clock->bootTime);
 }
 
+/**
+ * @brief Negotiates the wire protocol version on a freshly identified connection
+ * @param sockfd The socket connected to the server (Client ID already received)
+ * @param ip The ip address of the server
+ * @param port The port of the server
+ * @return value of sockfd with a connection to the server
+ * @note A server that does not answer the HELLO only speaks v1, the connection is then
+ *       reopened (the HELLO bytes are garbage to it) and iWireVersion is set to v1
+ */
+int Negotiate_Wire_Version(int sockfd, char *ip, int port)
+{
+    iWireVersion = Wire_Client_Hello(sockfd);
+    if (iWireVersion == WIRE_VERSION_2)
+    {
+        LOG_INFO("[+]Negotiate_Wire_Version: Using wire protocol v2");
+        return sockfd;
+    }
+
+    // Fall back to v1 on a new connection
+    close(sockfd);
+    iWireVersion = WIRE_VERSION_1;
+
+    struct sockaddr_in server_address;
+    server_address.sin_family = AF_INET;
+    server_address.sin_port = htons(port);
+    server_address.sin_addr.s_addr = inet_addr(ip);
+    memset(server_address.sin_zero, '\0', sizeof(server_address.sin_zero));
+
+    sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (CheckError(sockfd, "[-]Negotiate_Wire_Version: Error in creating socket"))
+    {
+        LOG_ERROR("[-]Negotiate_Wire_Version: Error in creating socket");
+        exit(EXIT_FAILURE);
+    }
+
+    while (CheckError(connect(sockfd, (struct sockaddr *)&server_address, sizeof(server_address)), "[-]Negotiate_Wire_Version: Error in reconnecting to server"))
+    {
+        printf(RED "Retrying in %d seconds...\n" reset, SLEEP_TIME);
+        sleep(SLEEP_TIME);
+    }
+
+    int iRecvStatus = Recv_All(sockfd, &iClientID, sizeof(unsigned long));
+    if (iRecvStatus <= 0)
+    {
+        printf(RED "[-]Client: Connection to server failed\n" reset);
+        LOG_ERROR("[-]Client: Connection to server failed");
+        exit(EXIT_FAILURE);
+    }
+
+    LOG_INFO("[+]Negotiate_Wire_Version: Server only speaks wire protocol v1 (Client ID %lu)", iClientID);
+    return sockfd;
+}
+
 /**
  * @brief Polls the socket to check if it is online and reconnects if it is not
  * @param sockfd The socket to poll
@@ -94,7 +148,7 @@ double GetCurrTime(CLOCK *Clock)
  */
 int pollServer(int sockfd, char *ip, int port)
 {
-    fprintf(Clientlog, "[+]pollServer: Polling server [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]pollServer: Polling server");
 
     // Poll the socket to check if it is writable using poll()
     struct pollfd fds[1];
@@ -107,7 +161,7 @@ int pollServer(int sockfd, char *ip, int port)
     {
         printf(RED "[-]pollServer: Error in poll\n" reset);
         perror("poll");
-        fprintf(Clientlog, "[-]pollServer: Error in poll [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]pollServer: Error in poll");
         exit(EXIT_FAILURE);
     }
     else if (result == 0)
@@ -125,7 +179,7 @@ int pollServer(int sockfd, char *ip, int port)
         sockfd = socket(AF_INET, SOCK_STREAM, 0);
         if (CheckError(sockfd, "[-]pollServer: Error in creating socket"))
         {
-            fprintf(Clientlog, "[-]Error in creating socket [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Error in creating socket");
             exit(EXIT_FAILURE);
         }
 
@@ -147,18 +201,20 @@ int pollServer(int sockfd, char *ip, int port)
             if (iRecvStatus == 0)
             {
                 printf(RED "[-]Client: Connection to server failed\n" reset);
-                fprintf(Clientlog, "[-]Client: Connection to server failed [Time Stamp: %f]\n", GetCurrTime(Clock));
+                LOG_ERROR("[-]Client: Connection to server failed");
                 exit(EXIT_FAILURE);
             }
         } while (CheckError(iRecvStatus, "[-]Error in receiving Client ID"));
+        sockfd = Negotiate_Wire_Version(sockfd, ip, port);
+        ResetPipeline();
 
         printf(GRN "[+]pollServer: Reconnected to the server with ID-%lu\n" reset, iClientID);
-        fprintf(Clientlog, "[+]pollServer: Reconnected to the server with ID-%lu [Time Stamp: %f]\n", iClientID, GetCurrTime(Clock));
+        LOG_INFO("[+]pollServer: Reconnected to the server with ID-%lu", iClientID);
     }
     else
     {
         // Socket is writable
-        fprintf(Clientlog, "[+]pollServer: Server is online [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_INFO("[+]pollServer: Server is online");
     }
 
     return sockfd;
@@ -182,11 +238,11 @@ void INThandler()
     if (c == 'y' || c == 'Y')
     {
         printf(RED "[-]Client: Exiting\n" reset);
-        fprintf(Clientlog, "[-]Client: Exiting [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Client: Exiting");
         exit(1);
     }
     printf(GRN "[+]Continuing...\n" reset);
-    fprintf(Clientlog, "[+]Continuing... [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Continuing...");
 
     signal_received = 0;
 
@@ -208,22 +264,22 @@ int sanitize(char *cInput)
 {
     if (cInput == NULL)
     {
-        fprintf(Clientlog, "[-]sanitize: Null input\n");
+        LOG_ERROR("[-]sanitize: Null input");
         return 1;
     }
     if (strlen(cInput) == 0)
     {
-        fprintf(Clientlog, "[-]sanitize: Empty input\n");
+        LOG_ERROR("[-]sanitize: Empty input");
         return 1;
     }
     if (cInput[0] == '\0')
     {
-        fprintf(Clientlog, "[-]sanitize: Null character\n");
+        LOG_ERROR("[-]sanitize: Null character");
         return 1;
     }   
     if(cInput[0] == '\n')
     {
-        fprintf(Clientlog, "[-]sanitize: Newline character\n");
+        LOG_ERROR("[-]sanitize: Newline character");
         return 1;
     }
     return 0;
@@ -242,8 +298,10 @@ int main(int argc, char *argv[])
     insert(table, &Rcmd, "READ");
     insert(table, &Wcmd, "WRITE");
     insert(table, &Icmd, "INFO");
+    insert(table, &DLcmd, "DOWNLOAD");
     // Server Side Commands
     insert(table, &LScmd, "LIST");
+    insert(table, &RScmd, "RESOLVE");
     // Indirect Connection Commands
     insert(table, &Dcmd, "DELETE");
     insert(table, &Ccmd, "CREATE");
@@ -251,8 +309,13 @@ int main(int argc, char *argv[])
     insert(table, &Mvcmd, "MOVE");
     insert(table, &Rncmd, "RENAME");
 
-    // Initialize the client log
-    Clientlog = fopen("Clientlog.log", "w");
+    // Initialize the client log (the console belongs to the prompt, records are echoed only if NFS_LOG_CONSOLE=1)
+    LOG_CONFIG_STRUCT LogConfig;
+    Log_Default_Config(&LogConfig, 0);
+    if (CheckError(Log_Init("Clientlog", &LogConfig), "[-]main: Error in opening the log file"))
+        return 1;
+    atexit(Log_Shutdown);
+    Trace_Init("Client");
     // Initialize the clock
     Clock = InitClock();
 
@@ -262,13 +325,13 @@ int main(int argc, char *argv[])
     sigaction(SIGINT, &act, NULL);
 
     printf(GRN "[+]Client Initialized\n" reset);
-    fprintf(Clientlog, "[+]Client Initialized [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Client Initialized");
 
     // Create a socket
     int iClientSocket = socket(AF_INET, SOCK_STREAM, 0);
     if (CheckError(iClientSocket, "[-]Error in creating socket"))
     {
-        fprintf(Clientlog, "[-]Error in creating socket [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Error in creating socket");
         exit(EXIT_FAILURE);
     }
 
@@ -287,7 +350,7 @@ int main(int argc, char *argv[])
     }
 
     printf("[+]Connected to the server\n");
-    fprintf(Clientlog, "[+]Connected to the server [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Connected to the server");
 
     // Connection established, receive identification ID (Client ID)
     int iRecvStatus = recv(iClientSocket, &iClientID, sizeof(unsigned long), 0);
@@ -295,18 +358,20 @@ int main(int argc, char *argv[])
 
     if (CheckError(iRecvStatus, "[-]recv: Error in receiving Client ID"))
     {
-        fprintf(Clientlog, "[-]recv: Error in receiving Client ID [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]recv: Error in receiving Client ID");
         exit(EXIT_FAILURE);
     }
     else if (iRecvStatus == 0)
     {
         printf(RED "[-]Client: Connection to server failed\n" reset);
-        fprintf(Clientlog, "[-]Client: Connection to server failed [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Client: Connection to server failed");
         exit(EXIT_FAILURE);
     }
 
+    iClientSocket = Negotiate_Wire_Version(iClientSocket, NS_IP, NS_CLIENT_PORT);
+
     printf(GRN "[+]Connected to the server. Connection ID: %lu\n" reset, iClientID);
-    fprintf(Clientlog, "[+]Connected to the server. Connection ID: %lu [Time Stamp: %f]\n", iClientID, GetCurrTime(Clock));
+    LOG_INFO("[+]Connected to the server. Connection ID: %lu", iClientID);
     printf(YEL "[+]Press enter to continue..." reset);
     getchar();
 
@@ -335,12 +400,19 @@ int main(int argc, char *argv[])
         char *Msg = ErrorMsg("Command not found", CMD_ERROR_INVALID_COMMAND);
         if (CheckNull(CMD, Msg))
         {
-            fprintf(Clientlog, "[-]Command not found [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Command not found");
             continue;
         }
 
+        // Every command is the root span of its trace (when NFS_TRACE=1 and the command is sampled)
+        TRACE_SPAN_STRUCT span;
+        Trace_Start();
+        Trace_Begin(&span, cCommand);
+        if (cArgs != NULL)
+            Trace_Detail(&span, "%s", cArgs);
         CMD(cArgs, iClientSocket);
-        fflush(Clientlog);
+        Trace_End(&span);
+        Trace_Clear();
     }
 
     return 0;
@@ -7,6 +7,7 @@
 
 // Custom Header Files
 #include "../Externals.h"
+#include "../Wire.h"
 #include "../colour.h"
 #include "Headers.h"
 #include "Hash.h"
@@ -25,7 +26,7 @@ void Ecmd(char* arg, int ServerSockfd)
     {
         char* Msg = ErrorMsg("Invalid Argument\nUSAGE: EXIT", CMD_ERROR_INVALID_ARGUMENTS_COUNT);
         printf(RED"%s"reset"\n", Msg);
-        fprintf(Clientlog, "[+]Ecmd: %s [Time Stamp: %f]\n", Msg, GetCurrTime(Clock));
+        LOG_INFO("[+]Ecmd: %s", Msg);
         free(Msg);
         return;
     }
@@ -36,24 +37,24 @@ void Ecmd(char* arg, int ServerSockfd)
     req.iRequestOperation = CLOSE_CONNECTION;
     req.iRequestClientID = iClientID;
 
-    int err = send(ServerSockfd, &req, sizeof(REQUEST_STRUCT), 0);
-    if(err < sizeof(REQUEST_STRUCT))
+    WIRE_CONTEXT_STRUCT ctx = {iWireVersion, 0};
+    int err = Send_Request(ServerSockfd, &ctx, &req);
+    if(err <= 0)
     {
         char* Msg = ErrorMsg("Error in sending request to the server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s"reset"\n", Msg);
-        fprintf(Clientlog, "[-]Ecmd: %s [Time Stamp: %f]\n", Msg, GetCurrTime(Clock));
+        LOG_ERROR("[-]Ecmd: %s", Msg);
         free(Msg);
         return;
     }
 
     
-    fprintf(Clientlog, "[+]Ecmd: Exiting Client [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Ecmd: Exiting Client");
     printf("[+]Exiting\n");
     clearScreen();
 
     printf("Thank you for using this Network File System\n");
 
-    fclose(Clientlog);
     close(ServerSockfd);
     destroyHashTable(table);
     exit(EXIT_SUCCESS);
@@ -70,17 +71,17 @@ void Hcmd(char* arg, int ServerSockfd)
     {
         char* Msg = ErrorMsg("Invalid Argument\nUSAGE: HELP", CMD_ERROR_INVALID_ARGUMENTS_COUNT);
         printf(RED"%s"reset"\n", Msg);
-        fprintf(Clientlog, "[+]Hcmd: %s [Time Stamp: %f]\n", Msg, GetCurrTime(Clock));
+        LOG_INFO("[+]Hcmd: %s", Msg);
         free(Msg);
         return;
     }
     
-    fprintf(Clientlog, "[+]Hcmd: Printing Help Menu [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Hcmd: Printing Help Menu");
     
     printf(GRNHB"=====================HELP MENU======================"reset"\n");
     printf(YELB"Avaliable Commands:\n"reset
             BGRN
-            "1. READ <Path>: Reads the file at the given path\n"
+            "1. READ <Path> [<Offset>] [<Length>]: Reads the file at the given path, or only length bytes from the given offset (a length of 0 reads to the end of the file)\n"
             "2. WRITE <Flag> <Path>: Writes to the file at the given path. Flag can set to either \'O\': Overwrite or to \'A\': Append\n"
             "3. COPY <Source Path> <Destination Path>: Copies the file(s) from the source path to the destination path (Note: If source path is a Directory, Everthing Under the source path is copied)\n"
             "4. MOVE <Source Path> <Destination Path>: Moves the file(s) from the source path to the destination path (Note: If source path is a Directory, Everthing Under the source path is moved)\n"   
@@ -88,10 +89,12 @@ void Hcmd(char* arg, int ServerSockfd)
             "6. CREATE <Flag> <Path> <Name>: Creates a file at the given path. Flag can set to either \'F\': File or to \'D\': Directory\n" 
             "7. RENAME <Source Path> <Target Name>: Renames the file/directory at the source path to the target name\n"
             "8. INFO <Path>: Prints the information about the file/directory at the given path\n"
-            "9. LIST <Path>: Lists the contents of the directory at the given path (Note: If no path is provided lists the entire mount directory\n"
-            "10. CLEAR: Clears the screen\n"
-            "11. HELP: Prints the help menu\n"
-            "12. EXIT: Exits the client\n"
+            "9. LIST <Path> [<Max Depth>] [<Max Entries>]: Lists the contents of the directory at the given path, down to the given depth and up to the given number of entries (Note: Use 'LIST mount' to list the entire mount directory)\n"
+            "10. RESOLVE <Path> [<Path> ...]: Prints the storage server of every given path in a single request\n"
+            "11. DOWNLOAD <Path> <Local Path> [<Connections>] [<Chunk Size>]: Downloads the file at the given path to a local file, fetching chunks of the given size (in bytes) over the given number of connections at once\n"
+            "12. CLEAR: Clears the screen\n"
+            "13. HELP: Prints the help menu\n"
+            "14. EXIT: Exits the client\n"
             reset);
     printf(GRNHB"=================================================="reset"\n");
 
@@ -113,13 +116,13 @@ void CScmd(char* arg, int ServerSockfd)
     {
         char* Msg = ErrorMsg("Invalid Argument\nUSAGE: HELP", CMD_ERROR_INVALID_ARGUMENTS_COUNT);
         printf(RED"%s"reset"\n", Msg);
-        fprintf(Clientlog, "[+]CScmd: %s [Time Stamp: %f]\n", Msg, GetCurrTime(Clock));
+        LOG_INFO("[+]CScmd: %s", Msg);
         free(Msg);
         return;
     }
     
 
-    fprintf(Clientlog, "[+]CScmd: clearing screen [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]CScmd: clearing screen");
     clearScreen();
     return;
 }
\ No newline at end of file
@@ -9,45 +9,123 @@
 
 // Custom Header Files
 #include "../Externals.h"
+#include "../Wire.h"
 #include "../colour.h"
 #include "./Headers.h"
 #include "./Hash.h"
 #include "./ErrorCodes.h"
 
+/**
+ * @brief Prints the file a v1 storage server sends between two stop sequences
+ * @param StorageSockfd: The socket connected to the storage server
+ * @param FileSize: Incremented by the number of bytes printed
+ * @return: 0 on success, -1 on failure
+ * @note: Legacy frames end at their first NUL, so a v1 read only carries text
+ */
+static int Recv_Legacy_Read(int StorageSockfd, long long int* FileSize)
+{
+    char stop[WIRE_LEGACY_FRAME];
+    char frame[WIRE_LEGACY_FRAME];
+    if(Recv_All(StorageSockfd, stop, WIRE_LEGACY_FRAME) <= 0)
+    {
+        return -1;
+    }
+
+    size_t iData;
+    int iFrame;
+    while((iFrame = Recv_Legacy_Frame(StorageSockfd, frame, stop, &iData)) > 0)
+    {
+        fwrite(frame, 1, iData, stdout);
+        *FileSize += iData;
+    }
+    return iFrame;
+}
+
+/**
+ * @brief Sends the user input to a v1 storage server as legacy frames, ended by its stop sequence
+ * @param StorageSockfd: The socket connected to the storage server
+ * @return: 0 on success, -1 on failure
+ * @note: A v1 stream has no status, so a failed read of stdin only ends the stream early
+ */
+static int Send_Legacy_Write(int StorageSockfd)
+{
+    // The server sends its stop sequence once the file is open for writing
+    char stop[WIRE_LEGACY_FRAME];
+    if(Recv_All(StorageSockfd, stop, WIRE_LEGACY_FRAME) <= 0)
+    {
+        return -1;
+    }
+
+    char frame[WIRE_LEGACY_FRAME];
+    size_t iRead;
+    while((iRead = fread(frame, 1, WIRE_LEGACY_FRAME, stdin)) > 0)
+    {
+        if(Send_Legacy_Frame(StorageSockfd, frame, iRead) < 0)
+        {
+            return -1;
+        }
+    }
+    if(ferror(stdin))
+    {
+        printf(RED"Error reading from stdin\n"reset);
+        LOG_ERROR("[-]Wcmd: Error reading from stdin");
+    }
+
+    return (Send_All(StorageSockfd, stop, WIRE_LEGACY_FRAME) < 0) ? -1 : 0;
+}
+
 void Rcmd(char* arg, int ServerSockfd)
 {
-    if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: READ <Path>", CMD_ERROR_INVALID_ARGUMENTS)))
+    if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: READ <Path> [<Offset>] [<Length>]", CMD_ERROR_INVALID_ARGUMENTS)))
     {
-        fprintf(Clientlog, "[-]Rcmd: Invalid Argument [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Invalid Argument");
         return;
     }
 
-    arg = strtok(arg, " \t\n");
-    if(strtok(NULL, " \t\n") != NULL)
+    // Offset and length are optional, a length of 0 reads to the end of the file
+    char* path = strtok(arg, " \t\n");
+    char* sOffset = strtok(NULL, " \t\n");
+    char* sLength = (sOffset != NULL) ? strtok(NULL, " \t\n") : NULL;
+    long long iOffset = (sOffset != NULL) ? atoll(sOffset) : 0;
+    long long iLength = (sLength != NULL) ? atoll(sLength) : 0;
+    if(path == NULL || strtok(NULL, " \t\n") != NULL || iOffset < 0 || iLength < 0)
     {
-        fprintf(Clientlog, "[-]Rcmd: Invalid Argument Count [Time Stamp: %f]\n", GetCurrTime(Clock));
+        char* Msg = ErrorMsg("Invalid Arguments\nUSAGE: READ <Path> [<Offset>] [<Length>]", CMD_ERROR_INVALID_ARGUMENTS);
+        printf(RED"%s\n"reset, Msg);
+        LOG_ERROR("[-]Rcmd: Invalid Argument Count");
+        free(Msg);
+        return;
+    }
+    if(sOffset != NULL && iWireVersion != WIRE_VERSION_2)
+    {
+        char* Msg = ErrorMsg("Byte ranges are not supported by the server", CMD_ERROR_INVALID_ARGUMENTS);
+        printf(RED"%s\n"reset, Msg);
+        LOG_ERROR("[-]Rcmd: Byte range asked on a v1 connection");
+        free(Msg);
         return;
     }
 
-    char* path = arg;
-    fprintf(Clientlog, "[+]Rcmd: Reading Path %s [Time Stamp: %f]\n", path, GetCurrTime(Clock));
+    LOG_INFO("[+]Rcmd: Reading Path %s", path);
 
     REQUEST_STRUCT req_struct;
     REQUEST_STRUCT* req = &req_struct;
     memset(req, 0, sizeof(REQUEST_STRUCT));
+    WIRE_CONTEXT_STRUCT ctx = {iWireVersion, NextRequestID()};
 
     req->iRequestOperation = CMD_READ;
     req->iRequestClientID = iClientID;
     strncpy(req->sRequestPath, path, MAX_BUFFER_SIZE);
     // req->iRequestFlags = 0;
 
-    int iBytesSent = send(ServerSockfd, req, sizeof(REQUEST_STRUCT), 0);
+    TRACE_SPAN_STRUCT span;
+    Trace_Begin(&span, "ns_resolve");
+    int iBytesSent = Send_Request(ServerSockfd, &ctx, req);
 
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+    if(iBytesSent <= 0)
     {
         char* Msg = ErrorMsg("Failed to send request to server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Rcmd: Failed to send request [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Failed to send request");
         free(Msg);
         return;
     }
@@ -56,12 +134,13 @@ void Rcmd(char* arg, int ServerSockfd)
     RESPONSE_STRUCT* res = &res_struct;
     memset(res, 0, sizeof(RESPONSE_STRUCT));
 
-    int iBytesRecv = recv(ServerSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    int iBytesRecv = Recv_Response_For(ServerSockfd, &ctx, res);
+    Trace_End(&span);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s"reset, Msg);
-        fprintf(Clientlog, "[-]Rcmd: Failed to receive response [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Failed to receive response");
         return;
     }
     
@@ -69,14 +148,14 @@ void Rcmd(char* arg, int ServerSockfd)
     {
         char* Msg = ErrorMsg("Failed to read file", res->iResponseErrorCode);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Rcmd: Failed to read file [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Failed to read file");
         free(Msg);
         return;
     }
     else if(res->iResponseFlags == BACKUP_RESPONSE)
     {
         printf(YEL"Corresponding Storage Server is down. Trying to read from backup server\n"reset);
-        fprintf(Clientlog, "[+]Rcmd: Corresponding Storage Server is down. Trying to read from backup server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_INFO("[+]Rcmd: Corresponding Storage Server is down. Trying to read from backup server");
 
         // Modify the path to the backup path
         memset(req->sRequestPath, 0, sizeof(req->sRequestPath));
@@ -89,20 +168,21 @@ void Rcmd(char* arg, int ServerSockfd)
     // Check if  IP and Port are valid
     if(CheckNull(ip, ErrorMsg("Invalid IP received from server", CMD_ERROR_INVALID_RECV_VALUE)))
     {
-        fprintf(Clientlog, "[-]Rcmd: Invalid IP received from server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Invalid IP received from server");
         return;
     }
     else if(CheckNull(port, ErrorMsg("Invalid Port received from server", CMD_ERROR_INVALID_RECV_VALUE)))
     {
-        fprintf(Clientlog, "[-]Rcmd: Invalid Port received from server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Invalid Port received from server");
         return;
     }
 
     // Connect to the storage server
+    Trace_Begin(&span, "connect");
     int StorageSockfd = socket(AF_INET, SOCK_STREAM, 0);
     if(CheckError(StorageSockfd, ErrorMsg("Failed to create socket", CMD_ERROR_SOCKET_FAILED)))
     {
-        fprintf(Clientlog, "[-]Rcmd: Failed to create socket [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Failed to create socket");
         return;
     }
 
@@ -114,69 +194,114 @@ void Rcmd(char* arg, int ServerSockfd)
     memset(StorageServer.sin_zero, '\0', sizeof(StorageServer.sin_zero));
 
     int iConnectStatus = connect(StorageSockfd, (struct sockaddr *)&StorageServer, sizeof(StorageServer));
+    Trace_End(&span);
     if(CheckError(iConnectStatus, ErrorMsg("Failed to connect to storage server", CMD_ERROR_CONNECT_FAILED)))
     {
-        fprintf(Clientlog, "[-]Rcmd: Failed to connect to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Failed to connect to storage server");
         return;
     }
 
-    // Send the request to the storage server
-    iBytesSent = send(StorageSockfd, req, sizeof(REQUEST_STRUCT), 0);
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+    // Send the request to the storage server (it continues the trace under the transfer span)
+    // The byte range only concerns the storage server
+    ctx.iRange = (sOffset != NULL);
+    ctx.iRangeOffset = iOffset;
+    ctx.iRangeLength = iLength;
+    Trace_Begin(&span, "ss_transfer");
+    iBytesSent = Send_Request(StorageSockfd, &ctx, req);
+    if(iBytesSent <= 0)
     {
         char* Msg = ErrorMsg("Failed to send request to storage server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Rcmd: Failed to send request to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Failed to send request to storage server");
         free(Msg);
         return;
     }
 
-    // Receive stop sequence from server
-    char stop[MAX_BUFFER_SIZE];
-    iBytesRecv = recv(StorageSockfd, stop, MAX_BUFFER_SIZE, 0);
-    if(CheckError(iBytesRecv, ErrorMsg("Failed to receive stop sequence from storage server", CMD_ERROR_RECV_FAILED)))
-    {
-        fprintf(Clientlog, "[-]Rcmd: Failed to receive stop sequence from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return;
-    }
-    // printf("Stop Sequence: %s\n", stop);
-
-    // Receive the File from the storage server in chunks of MAX_BUFFER_SIZE until the server sends a chunk of size less than MAX_BUFFER_SIZE
+    // Receive the file (or its range) as data frames until the end of the stream
     long long int FileSize = 0;
+    WIRE_HEADER_STRUCT header;
+    WIRE_DATA_END_STRUCT streamEnd = {0, 0, 0, WIRE_DATA_OK};
+    char buffer[MAX_BUFFER_SIZE];
+    TRACE_SPAN_STRUCT recvSpan;
+    Trace_Begin_Sum(&recvSpan, "net_recv");
     printf("File Contents:\n"MAG"----------------------------------------\n");
-    while(1)
+    if(ctx.iVersion == WIRE_VERSION_1)
     {
-        char buffer[MAX_BUFFER_SIZE];
-        memset(buffer, 0, MAX_BUFFER_SIZE);
-
-        iBytesRecv = recv(StorageSockfd, buffer, MAX_BUFFER_SIZE, 0);
+        // A v1 storage server sends the file between two stop sequences, with no count to check
+        Trace_Resume(&recvSpan);
+        iBytesRecv = Recv_Legacy_Read(StorageSockfd, &FileSize);
+        Trace_Pause(&recvSpan);
         if(CheckError(iBytesRecv, ErrorMsg("Failed to receive file from storage server", CMD_ERROR_RECV_FAILED)))
         {
-            fprintf(Clientlog, "[-]Rcmd: Failed to receive file from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Rcmd: Failed to receive file from storage server");
+            close(StorageSockfd);
             return;
         }
-
-        // Check if the server has sent the stop sequence
-        if(strncmp(buffer, stop, MAX_BUFFER_SIZE) == 0)
+        streamEnd.iStreamBytes = FileSize;
+    }
+    while(ctx.iVersion != WIRE_VERSION_1)
+    {
+        Trace_Resume(&recvSpan);
+        iBytesRecv = Recv_Data_Header(StorageSockfd, &header, &streamEnd);
+        Trace_Pause(&recvSpan);
+        if(CheckError(iBytesRecv - 1, ErrorMsg("Failed to receive file from storage server", CMD_ERROR_RECV_FAILED)))
+        {
+            LOG_ERROR("[-]Rcmd: Failed to receive file from storage server");
+            close(StorageSockfd);
+            return;
+        }
+        if(header.iFrameType == FRAME_DATA_END)
         {
             break;
         }
 
-        // print the recieved data
-        printf("%s", buffer);
-        FileSize += strlen(buffer);
-
+        // The payload of a frame can be larger than the buffer
+        size_t iLeft = header.iPayloadLength;
+        while(iLeft > 0)
+        {
+            size_t iChunk = (iLeft < MAX_BUFFER_SIZE) ? iLeft : MAX_BUFFER_SIZE;
+            Trace_Resume(&recvSpan);
+            iBytesRecv = Recv_All(StorageSockfd, buffer, iChunk);
+            Trace_Pause(&recvSpan);
+            if(CheckError(iBytesRecv - 1, ErrorMsg("Failed to receive file from storage server", CMD_ERROR_RECV_FAILED)))
+            {
+                LOG_ERROR("[-]Rcmd: Failed to receive file from storage server");
+                close(StorageSockfd);
+                return;
+            }
+
+            // print the recieved data (as is, it may hold any byte)
+            fwrite(buffer, 1, iChunk, stdout);
+            FileSize += iChunk;
+            iLeft -= iChunk;
+        }
     }
     
+    Trace_End(&recvSpan);
     printf("\n----------------------------------------\n"reset);
     printf("Read Bytes: %lld Bytes\n", FileSize);
+
+    // The end of the stream tells whether the server sent everything, and which bytes of the file they are
+    if(streamEnd.iStatus != WIRE_DATA_OK || streamEnd.iStreamBytes != (uint64_t)FileSize)
+    {
+        char* Msg = ErrorMsg("Failed to receive the whole file from storage server", streamEnd.iStatus != WIRE_DATA_OK ? streamEnd.iStatus : CMD_ERROR_INVALID_RECV_VALUE);
+        printf(RED"%s\n"reset, Msg);
+        LOG_ERROR("[-]Rcmd: Failed to receive the whole file from storage server (%lld of %llu bytes)", FileSize, (unsigned long long)streamEnd.iStreamBytes);
+        free(Msg);
+    }
+    else if(ctx.iRange)
+    {
+        printf("Range: %llu-%llu of %llu Bytes\n", (unsigned long long)streamEnd.iOffset,
+               (unsigned long long)(streamEnd.iOffset + streamEnd.iStreamBytes), (unsigned long long)streamEnd.iFileSize);
+    }
     // Receive the response from the storage server
-    iBytesRecv = recv(StorageSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    iBytesRecv = Recv_Response(StorageSockfd, &ctx, res);
+    Trace_End(&span);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive response from storage server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Rcmd: Failed to receive response from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Failed to receive response from storage server");
         free(Msg);
         return;
     }
@@ -185,24 +310,24 @@ void Rcmd(char* arg, int ServerSockfd)
     {
         char* Msg = ErrorMsg("Failed to read file from storage server", res->iResponseErrorCode);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Rcmd: Failed to read file from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Failed to read file from storage server");
         free(Msg);
         return;
     }
 
     // log the response
-    fprintf(Clientlog, "[+]Rcmd: Server Response: %s [Time Stamp: %f]\n", res->sResponseData, GetCurrTime(Clock));
+    LOG_INFO("[+]Rcmd: Server Response: %s", res->sResponseData);
 
     // Close the socket
     close(StorageSockfd);
-    fprintf(Clientlog, "[+]Rcmd: Successfully read file [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Rcmd: Successfully read file");
     return;
 }
 void Wcmd(char* arg, int ServerSockfd)
 {
     if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: WRITE <Flag> <Path>", CMD_ERROR_INVALID_ARGUMENTS)))
     {
-        fprintf(Clientlog, "[-]Wcmd: Invalid Argument [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Wcmd: Invalid Argument");
         return;
     }
 
@@ -227,7 +352,7 @@ void Wcmd(char* arg, int ServerSockfd)
         {
             char* Msg = ErrorMsg("Invalid Flag\nUSAGE: WRITE <Flag> <Path>\nFlag: a for append, o for overwrite", CMD_ERROR_INVALID_ARGUMENTS);
             printf(RED"%s\n"reset, Msg);
-            fprintf(Clientlog, "[-]Wcmd: Invalid Flag [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Wcmd: Invalid Flag");
             free(Msg);
             return;
         }
@@ -237,7 +362,7 @@ void Wcmd(char* arg, int ServerSockfd)
     // Check if the path is valid
     if(CheckNull(path, ErrorMsg("Invalid Path\nUSAGE: WRITE <Flag> <Path>", CMD_ERROR_INVALID_ARGUMENTS)))
     {
-        fprintf(Clientlog, "[-]Wcmd: Invalid Path [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Wcmd: Invalid Path");
         return;
     }
 
@@ -246,7 +371,7 @@ void Wcmd(char* arg, int ServerSockfd)
     {
         char* Msg = ErrorMsg("Invalid Argument Count\nUSAGE: WRITE <Flag> <Path>", CMD_ERROR_INVALID_ARGUMENTS_COUNT);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Wcmd: Invalid Argument Count [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Wcmd: Invalid Argument Count");
         free(Msg);
         return;
     }
@@ -255,6 +380,7 @@ void Wcmd(char* arg, int ServerSockfd)
     REQUEST_STRUCT req_struct;
     REQUEST_STRUCT* req = &req_struct;
     memset(req, 0, sizeof(REQUEST_STRUCT));
+    WIRE_CONTEXT_STRUCT ctx = {iWireVersion, NextRequestID()};
 
     req->iRequestOperation = CMD_WRITE;
     req->iRequestClientID = iClientID;
@@ -262,12 +388,14 @@ void Wcmd(char* arg, int ServerSockfd)
     strncpy(req->sRequestPath, path, MAX_BUFFER_SIZE);
     
     // Send the request to the server
-    int iBytesSent = send(ServerSockfd, req, sizeof(REQUEST_STRUCT), 0);
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+    TRACE_SPAN_STRUCT span;
+    Trace_Begin(&span, "ns_resolve");
+    int iBytesSent = Send_Request(ServerSockfd, &ctx, req);
+    if(iBytesSent <= 0)
     {
         char* Msg = ErrorMsg("Failed to send request to server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Wcmd: Failed to send request to server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Wcmd: Failed to send request to server");
         free(Msg);
         return;
     }
@@ -277,12 +405,13 @@ void Wcmd(char* arg, int ServerSockfd)
     RESPONSE_STRUCT* res = &res_struct;
     memset(res, 0, sizeof(RESPONSE_STRUCT));
 
-    int iBytesRecv = recv(ServerSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    int iBytesRecv = Recv_Response_For(ServerSockfd, &ctx, res);
+    Trace_End(&span);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Wcmd: Failed to receive response from server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Wcmd: Failed to receive response from server");
         return;
     }
 
@@ -290,18 +419,18 @@ void Wcmd(char* arg, int ServerSockfd)
     {
         char* Msg = ErrorMsg("Failed to write file", res->iResponseErrorCode);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Wcmd: Failed to write file [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Wcmd: Failed to write file");
         free(Msg);
         return;
     }
     else if(res->iResponseFlags == BACKUP_RESPONSE)
     {
         printf(YEL"Corresponding Storage Server is down.\n"reset);
-        fprintf(Clientlog, "[+]Wcmd: Corresponding Storage Server is down.[Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_INFO("[+]Wcmd: Corresponding Storage Server is down.[Time Stamp: %f]", GetCurrTime(Clock));
 
         char* Msg = ErrorMsg("Failed to write file", res->iResponseErrorCode);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Wcmd: Failed to write file [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Wcmd: Failed to write file");
         free(Msg);
         return;
     }
@@ -313,20 +442,21 @@ void Wcmd(char* arg, int ServerSockfd)
     // Check if  IP and Port are valid
     if(CheckNull(ip, ErrorMsg("Invalid IP received from server", CMD_ERROR_INVALID_RECV_VALUE)))
     {
-        fprintf(Clientlog, "[-]Rcmd: Invalid IP received from server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Invalid IP received from server");
         return;
     }
     else if(CheckNull(port, ErrorMsg("Invalid Port received from server", CMD_ERROR_INVALID_RECV_VALUE)))
     {
-        fprintf(Clientlog, "[-]Rcmd: Invalid Port received from server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Invalid Port received from server");
         return;
     }
 
     // Connect to the storage server
+    Trace_Begin(&span, "connect");
     int StorageSockfd = socket(AF_INET, SOCK_STREAM, 0);
     if(CheckError(StorageSockfd, ErrorMsg("Failed to create socket", CMD_ERROR_SOCKET_FAILED)))
     {
-        fprintf(Clientlog, "[-]Rcmd: Failed to create socket [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Failed to create socket");
         return;
     }
 
@@ -338,72 +468,133 @@ void Wcmd(char* arg, int ServerSockfd)
     memset(StorageServer.sin_zero, '\0', sizeof(StorageServer.sin_zero));
 
     int iConnectStatus = connect(StorageSockfd, (struct sockaddr *)&StorageServer, sizeof(StorageServer));
+    Trace_End(&span);
     if(CheckError(iConnectStatus, ErrorMsg("Failed to connect to storage server", CMD_ERROR_CONNECT_FAILED)))
     {
-        fprintf(Clientlog, "[-]Rcmd: Failed to connect to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rcmd: Failed to connect to storage server");
         return;
     }
 
-    // Send the request to the storage server
-    iBytesSent = send(StorageSockfd, req, sizeof(REQUEST_STRUCT), 0);
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+    // Send the request to the storage server (it continues the trace under the transfer span)
+    Trace_Begin(&span, "ss_transfer");
+    iBytesSent = Send_Request(StorageSockfd, &ctx, req);
+    if(iBytesSent <= 0)
     {
         char* Msg = ErrorMsg("Failed to send request to storage server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Wcmd: Failed to send request to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Wcmd: Failed to send request to storage server");
         free(Msg);
         return;
     }
 
-    // Receive stop sequence from server
-    char stop[MAX_BUFFER_SIZE];
-    iBytesRecv = recv(StorageSockfd, stop, MAX_BUFFER_SIZE, 0);
-    if(CheckError(iBytesRecv, ErrorMsg("Failed to receive stop sequence from storage server", CMD_ERROR_RECV_FAILED)))
+    if(ctx.iVersion == WIRE_VERSION_1)
     {
-        fprintf(Clientlog, "[-]Wcmd: Failed to receive stop sequence from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return;
-    }
-    // printf("Stop Sequence: %s\n", stop);
+        // A v1 storage server takes the data as frames of text between its stop sequence and ours
+        printf("\n"GRN"Enter the data to be written to the file. Press Ctrl+D to stop\n"reset);
+        int iStatus = Send_Legacy_Write(StorageSockfd);
 
-    // Take the input from the user and send it to the storage server
-    printf("\n"GRN"Enter the data to be written to the file. Press Ctrl+D to stop\n"reset);
-    char buffer[MAX_BUFFER_SIZE];
-    memset(buffer, 0, MAX_BUFFER_SIZE);
-    while(fgets(buffer, MAX_BUFFER_SIZE, stdin) != NULL)
+        // clear the EOF flag
+        clearerr(stdin);
+        if(CheckError(iStatus, ErrorMsg("Failed to send data to storage server", CMD_ERROR_SEND_FAILED)))
+        {
+            LOG_ERROR("[-]Wcmd: Failed to send data to storage server");
+            close(StorageSockfd);
+            return;
+        }
+    }
+    else
     {
-        int iBytesSent = send(StorageSockfd, buffer, MAX_BUFFER_SIZE, 0);
-        if(CheckError(iBytesSent, ErrorMsg("Failed to send data to storage server", CMD_ERROR_SEND_FAILED)))
+        // The server ends an empty stream of its own once the file is open for writing
+        WIRE_HEADER_STRUCT header;
+        WIRE_DATA_END_STRUCT streamEnd;
+        iBytesRecv = Recv_Data_Header(StorageSockfd, &header, &streamEnd);
+        if(CheckError(iBytesRecv - 1, ErrorMsg("Failed to receive data from storage server", CMD_ERROR_RECV_FAILED)) || header.iFrameType != FRAME_DATA_END)
         {
-            fprintf(Clientlog, "[-]Wcmd: Failed to send data to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Wcmd: Failed to receive data from storage server");
+            close(StorageSockfd);
             return;
         }
-        memset(buffer, 0, MAX_BUFFER_SIZE);
-        if(feof(stdin)) break;
-        else if(ferror(stdin)) {
-            printf(RED"Error reading from stdin\n"reset);
-            fprintf(Clientlog, "[-]Wcmd: Error reading from stdin [Time Stamp: %f]\n", GetCurrTime(Clock));
+
+        if(streamEnd.iStatus != WIRE_DATA_OK)
+        {
+            // The server could not open the file, its response follows
+            char* Msg = ErrorMsg("Failed to write file to storage server", streamEnd.iStatus);
+            printf(RED"%s\n"reset, Msg);
+            LOG_ERROR("[-]Wcmd: Storage server refused the data stream");
+            free(Msg);
+            Recv_Response(StorageSockfd, &ctx, res);
+            Trace_End(&span);
+            close(StorageSockfd);
             return;
         }
-    }
-    
-    // clear the EOF flag
-    clearerr(stdin);
 
-    // Send the stop sequence to the server
-    iBytesSent = send(StorageSockfd, stop, MAX_BUFFER_SIZE, 0);
-    if(CheckError(iBytesSent, ErrorMsg("Failed to send stop sequence to storage server", CMD_ERROR_SEND_FAILED)))
-    {
-        fprintf(Clientlog, "[-]Wcmd: Failed to send stop sequence to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return;
+        // Take the input from the user and send it to the storage server as is
+        // The input is read a whole buffer at a time and sent as frames of WIRE_DATA_CHUNK
+        size_t iBufferSize = Wire_Write_Buffer_Size();
+        char* buffer = (char*)malloc(iBufferSize);
+        if(CheckNull(buffer, "[-]Wcmd: Error in allocating memory"))
+        {
+            close(StorageSockfd);
+            return;
+        }
+        printf("\n"GRN"Enter the data to be written to the file. Press Ctrl+D to stop\n"reset);
+        uint64_t iSent = 0;
+        int iStatus = WIRE_DATA_OK;
+        size_t iRead;
+        TRACE_SPAN_STRUCT sendSpan;
+        Trace_Begin_Sum(&sendSpan, "net_send");
+        while((iRead = fread(buffer, 1, iBufferSize, stdin)) > 0)
+        {
+            for(size_t iFrameStart = 0; iFrameStart < iRead; iFrameStart += WIRE_DATA_CHUNK)
+            {
+                size_t iFrame = (iRead - iFrameStart < WIRE_DATA_CHUNK) ? iRead - iFrameStart : WIRE_DATA_CHUNK;
+                Trace_Resume(&sendSpan);
+                iBytesSent = Send_Data(StorageSockfd, &ctx, buffer + iFrameStart, iFrame);
+                Trace_Pause(&sendSpan);
+                if(CheckError(iBytesSent, ErrorMsg("Failed to send data to storage server", CMD_ERROR_SEND_FAILED)))
+                {
+                    LOG_ERROR("[-]Wcmd: Failed to send data to storage server");
+                    clearerr(stdin);
+                    free(buffer);
+                    close(StorageSockfd);
+                    return;
+                }
+            }
+            iSent += iRead;
+        }
+        free(buffer);
+        if(ferror(stdin))
+        {
+            // The end of the stream fails the write on the server
+            printf(RED"Error reading from stdin\n"reset);
+            LOG_ERROR("[-]Wcmd: Error reading from stdin");
+            iStatus = CMD_ERROR_INPUT_FAILED;
+        }
+
+        // clear the EOF flag
+        clearerr(stdin);
+
+        // End the stream with the number of bytes sent
+        Trace_Resume(&sendSpan);
+        WIRE_DATA_END_STRUCT dataEnd = {iSent, 0, 0, iStatus};
+        iBytesSent = Send_Data_End(StorageSockfd, &ctx, &dataEnd);
+        Trace_End(&sendSpan);
+        if(CheckError(iBytesSent, ErrorMsg("Failed to send data to storage server", CMD_ERROR_SEND_FAILED)))
+        {
+            LOG_ERROR("[-]Wcmd: Failed to end the data stream");
+            close(StorageSockfd);
+            return;
+        }
     }
 
     // Receive the response from the storage server
-    iBytesRecv = recv(StorageSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    iBytesRecv = Recv_Response(StorageSockfd, &ctx, res);
+    Trace_End(&span);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive response from storage server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Wcmd: Failed to receive response from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Wcmd: Failed to receive response from storage server");
         free(Msg);
         return;
     }
@@ -412,16 +603,16 @@ void Wcmd(char* arg, int ServerSockfd)
     {
         char* Msg = ErrorMsg("Failed to write file to storage server", res->iResponseErrorCode);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Wcmd: Failed to write file to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Wcmd: Failed to write file to storage server");
         free(Msg);
         return;
     }
 
     // log the response
-    fprintf(Clientlog, "[+]Wcmd: Server Response: %s [Time Stamp: %f]\n", res->sResponseData, GetCurrTime(Clock));
+    LOG_INFO("[+]Wcmd: Server Response: %s", res->sResponseData);
 
     close(StorageSockfd);
-    fprintf(Clientlog, "[+]Wcmd: Successfully wrote file [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Wcmd: Successfully wrote file");
     printf(GRN"File wrote to successfully\n"reset);
 
     return;
@@ -430,7 +621,7 @@ void Icmd(char* arg, int ServerSockfd)
 {
     if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: INFO <Path>", CMD_ERROR_INVALID_ARGUMENTS)))
     {
-        fprintf(Clientlog, "[-]Icmd: Invalid Argument [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Icmd: Invalid Argument");
         return;
     }
 
@@ -438,27 +629,30 @@ void Icmd(char* arg, int ServerSockfd)
     if(strtok(NULL, " \t\n") != NULL)
     {
         printf(RED"Invalid Argument Count\nUSAGE: INFO <Path>\n"reset);
-        fprintf(Clientlog, "[-]Icmd: Invalid Argument Count [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Icmd: Invalid Argument Count");
         return;
     }
 
     char* path = arg;
-    fprintf(Clientlog, "[+]Icmd: Describing Path %s [Time Stamp: %f]\n", path, GetCurrTime(Clock));
+    LOG_INFO("[+]Icmd: Describing Path %s", path);
 
     REQUEST_STRUCT req_struct;
     REQUEST_STRUCT* req = &req_struct;
     memset(req, 0, sizeof(REQUEST_STRUCT));
+    WIRE_CONTEXT_STRUCT ctx = {iWireVersion, NextRequestID()};
 
     req->iRequestOperation = CMD_INFO;
     req->iRequestClientID = iClientID;
     strncpy(req->sRequestPath, path, MAX_BUFFER_SIZE);
 
-    int iBytesSent = send(ServerSockfd, req, sizeof(REQUEST_STRUCT), 0);
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+    TRACE_SPAN_STRUCT span;
+    Trace_Begin(&span, "ns_resolve");
+    int iBytesSent = Send_Request(ServerSockfd, &ctx, req);
+    if(iBytesSent <= 0)
     {
         char* Msg = ErrorMsg("Failed to send request to server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Icmd: Failed to send request [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Icmd: Failed to send request");
         free(Msg);
         return;
     }
@@ -467,12 +661,13 @@ void Icmd(char* arg, int ServerSockfd)
     RESPONSE_STRUCT* res = &res_struct;
     memset(res, 0, sizeof(RESPONSE_STRUCT));
 
-    int iBytesRecv = recv(ServerSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    int iBytesRecv = Recv_Response_For(ServerSockfd, &ctx, res);
+    Trace_End(&span);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s"reset, Msg);
-        fprintf(Clientlog, "[-]Icmd: Failed to receive response [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Icmd: Failed to receive response");
         free(Msg);
         return;
     }
@@ -481,14 +676,14 @@ void Icmd(char* arg, int ServerSockfd)
     {
         char* Msg = ErrorMsg("Failed to get info of file", res->iResponseErrorCode);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Icmd: Failed to get info of file [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Icmd: Failed to get info of file");
         free(Msg);
         return;
     }
     else if(res->iResponseFlags == BACKUP_RESPONSE)
     {
         printf(YEL"Corresponding Storage Server is down. Trying to get info from backup server\n"reset);
-        fprintf(Clientlog, "[+]Icmd: Corresponding Storage Server is down. Trying to get info from backup server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_INFO("[+]Icmd: Corresponding Storage Server is down. Trying to get info from backup server");
 
         // Modify the path to the backup path
         memset(req->sRequestPath, 0, sizeof(req->sRequestPath));
@@ -502,20 +697,21 @@ void Icmd(char* arg, int ServerSockfd)
     // Check if  IP and Port are valid
     if(CheckNull(ip, ErrorMsg("Invalid IP received from server", CMD_ERROR_INVALID_RECV_VALUE)))
     {
-        fprintf(Clientlog, "[-]Icmd: Invalid IP received from server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Icmd: Invalid IP received from server");
         return;
     }
     else if(CheckNull(port, ErrorMsg("Invalid Port received from server", CMD_ERROR_INVALID_RECV_VALUE)))
     {
-        fprintf(Clientlog, "[-]Icmd: Invalid Port received from server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Icmd: Invalid Port received from server");
         return;
     }
 
     // Connect to the storage server
+    Trace_Begin(&span, "connect");
     int StorageSockfd = socket(AF_INET, SOCK_STREAM, 0);
     if(CheckError(StorageSockfd, ErrorMsg("Failed to create socket", CMD_ERROR_SOCKET_FAILED)))
     {
-        fprintf(Clientlog, "[-]Icmd: Failed to create socket [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Icmd: Failed to create socket");
         return;
     }
 
@@ -527,30 +723,32 @@ void Icmd(char* arg, int ServerSockfd)
     memset(StorageServer.sin_zero, '\0', sizeof(StorageServer.sin_zero));
 
     int iConnectStatus = connect(StorageSockfd, (struct sockaddr *)&StorageServer, sizeof(StorageServer));
+    Trace_End(&span);
     if(CheckError(iConnectStatus, ErrorMsg("Failed to connect to storage server", CMD_ERROR_CONNECT_FAILED)))
     {
-        fprintf(Clientlog, "[-]Icmd: Failed to connect to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Icmd: Failed to connect to storage server");
         return;
     }
 
-    // Send the request to the storage server
-    iBytesSent = send(StorageSockfd, req, sizeof(REQUEST_STRUCT), 0);
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+    // Send the request to the storage server (it continues the trace under the transfer span)
+    Trace_Begin(&span, "ss_transfer");
+    iBytesSent = Send_Request(StorageSockfd, &ctx, req);
+    if(iBytesSent <= 0)
     {
         char* Msg = ErrorMsg("Failed to send request to storage server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Icmd: Failed to send request to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Icmd: Failed to send request to storage server");
         free(Msg);
         return;
     }
 
     // Recieve the Confirmation from the server
-    iBytesRecv = recv(StorageSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    iBytesRecv = Recv_Response(StorageSockfd, &ctx, res);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive confirmation from storage server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Icmd: Failed to receive confirmation from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Icmd: Failed to receive confirmation from storage server");
         free(Msg);
         return;
     }
@@ -558,7 +756,7 @@ void Icmd(char* arg, int ServerSockfd)
     {
         char* Msg = ErrorMsg("Failed to get info of file", res->iResponseErrorCode);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Icmd: Failed to get info of file [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Icmd: Failed to get info of file");
         free(Msg);
         return;
     }
@@ -568,12 +766,13 @@ void Icmd(char* arg, int ServerSockfd)
     PATH_INFO_STRUCT* path_info = &path_info_struct;
     memset(path_info, 0, sizeof(PATH_INFO_STRUCT));
 
-    iBytesRecv = recv(StorageSockfd, path_info, sizeof(PATH_INFO_STRUCT), 0);
-    if(iBytesRecv != sizeof(PATH_INFO_STRUCT))
+    iBytesRecv = Recv_Path_Info(StorageSockfd, &ctx, path_info);
+    Trace_End(&span);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive path info from storage server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Icmd: Failed to receive path info from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Icmd: Failed to receive path info from storage server");
         free(Msg);
         return;
     }
@@ -640,7 +839,7 @@ void Icmd(char* arg, int ServerSockfd)
     printf("Number of Links: %d\n", path_info->iPathLinks);
     printf(reset"--------------------------------------------------\n");
 
-    fprintf(Clientlog, "[+]Icmd: Path Information:\nPath: %s\nType: %s\nSize: %d Bytes\nPermission: %d (%s)\nCreation Time: %s\nModification Time: %s [Time Stamp: %f]\n", path_info->sPath, path_info->iPathType == 0 ? "File" :path_info->iPathType == 1? "Folder": "Executable", path_info->iPathSize, path_info->iPathPermission, permission, ctime, mtime, GetCurrTime(Clock));
+    LOG_INFO("[+]Icmd: Path Information:\nPath: %s\nType: %s\nSize: %d Bytes\nPermission: %d (%s)\nCreation Time: %s\nModification Time: %s", path_info->sPath, path_info->iPathType == 0 ? "File" :path_info->iPathType == 1? "Folder": "Executable", path_info->iPathSize, path_info->iPathPermission, permission, ctime, mtime);
       
     return;
 }
\ No newline at end of file
@@ -0,0 +1,452 @@
+// Parallel download of a file: its byte ranges are fetched over several storage server connections at once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+
+// Custom Header Files
+#include "../Externals.h"
+#include "../Wire.h"
+#include "../colour.h"
+#include "./Headers.h"
+#include "./ErrorCodes.h"
+
+/*
+DOWNLOAD copies a file of the storage servers to a local file. The Naming Server resolves the path
+like a READ, a first range of one chunk gives the size of the file, and the rest of the chunks are
+fetched by up to K worker threads at once, each with a byte-range READ on a connection of its own,
+and written in place with pwrite. The chunks that fail (a server going down, a stalled connection)
+are fetched again in the next round after a new resolution, which gives a backup server
+(BACKUP_RESPONSE) once the Naming Server sees the primary as down. The chunks of a round all come
+from the server of that round: a backup is not guaranteed to hold the same version of the file, so
+the servers are never striped.
+*/
+
+typedef struct DOWNLOAD_STRUCT
+{
+    char sServerIP[IP_LENGTH];       // Server of the current round
+    int iServerPort;
+    char sPath[MAX_BUFFER_SIZE];     // Path asked to the server (under ./backup on a backup server)
+    int fd;                          // Local destination
+    uint64_t iFileSize;
+    uint64_t iChunkSize;
+    unsigned long *Pending;          // Chunks of the current round
+    unsigned long iPendingCount;
+    atomic_ulong iNextPending;       // Next entry of Pending handed out to a worker
+    unsigned char *ChunkDone;        // Set once a chunk is written
+    atomic_ullong iBytes;            // Bytes written
+    atomic_int iChanged;             // The size of the file changed during the download
+    uint64_t iTraceID;               // Trace the workers continue
+    uint64_t iSpanID;
+} DOWNLOAD_STRUCT;
+
+/**
+ * @brief Resolves the storage server of a path the way a READ does
+ * @param ServerSockfd: The socket to the naming server
+ * @param path: The path to be downloaded
+ * @param dl: Receives the server and the path to ask it for
+ * @return: 0 on success, -1 on failure (reported to the user)
+ */
+static int Resolve_Download(int ServerSockfd, char* path, DOWNLOAD_STRUCT* dl)
+{
+    REQUEST_STRUCT req;
+    memset(&req, 0, sizeof(REQUEST_STRUCT));
+    WIRE_CONTEXT_STRUCT ctx = {iWireVersion, NextRequestID()};
+    req.iRequestOperation = CMD_READ;
+    req.iRequestClientID = iClientID;
+    strncpy(req.sRequestPath, path, MAX_BUFFER_SIZE - 1);
+
+    RESPONSE_STRUCT res;
+    memset(&res, 0, sizeof(RESPONSE_STRUCT));
+    if(Send_Request(ServerSockfd, &ctx, &req) <= 0 || Recv_Response_For(ServerSockfd, &ctx, &res) <= 0)
+    {
+        char* Msg = ErrorMsg("Failed to resolve the path with the server", CMD_ERROR_RECV_FAILED);
+        printf(RED"%s\n"reset, Msg);
+        LOG_ERROR("[-]DLcmd: Failed to resolve path %s", path);
+        free(Msg);
+        return -1;
+    }
+    if(res.iResponseFlags == RESPONSE_FLAG_FAILURE)
+    {
+        char* Msg = ErrorMsg("Failed to read file", res.iResponseErrorCode);
+        printf(RED"%s\n"reset, Msg);
+        LOG_ERROR("[-]DLcmd: Failed to read file %s", path);
+        free(Msg);
+        return -1;
+    }
+
+    // The response data is the IP and Port of the storage server serving the file seperated by a space
+    char* ip = strtok(res.sResponseData, " ");
+    char* port = strtok(NULL, " ");
+    if(CheckNull(ip, ErrorMsg("Invalid IP received from server", CMD_ERROR_INVALID_RECV_VALUE)) ||
+       CheckNull(port, ErrorMsg("Invalid Port received from server", CMD_ERROR_INVALID_RECV_VALUE)))
+    {
+        LOG_ERROR("[-]DLcmd: Invalid server address received from server");
+        return -1;
+    }
+    strncpy(dl->sServerIP, ip, IP_LENGTH - 1);
+    dl->iServerPort = atoi(port);
+
+    if(res.iResponseFlags == BACKUP_RESPONSE)
+    {
+        printf(YEL"Corresponding Storage Server is down. Downloading from backup server\n"reset);
+        LOG_INFO("[+]DLcmd: Corresponding Storage Server is down. Downloading from backup server");
+        snprintf(dl->sPath, MAX_BUFFER_SIZE, "./backup%s", path);
+    }
+    else
+    {
+        strncpy(dl->sPath, path, MAX_BUFFER_SIZE - 1);
+    }
+    return 0;
+}
+
+/**
+ * @brief Connects to the storage server of the current round
+ * @return: The connected socket, -1 on failure
+ * @note: A connection that stalls for DOWNLOAD_IO_TIMEOUT fails its chunk instead of the download
+ */
+static int Connect_Download_Server(DOWNLOAD_STRUCT* dl)
+{
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if(sockfd < 0)
+        return -1;
+
+    struct timeval timeout = {DOWNLOAD_IO_TIMEOUT, 0};
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_in StorageServer;
+    memset(&StorageServer, 0, sizeof(StorageServer));
+    StorageServer.sin_family = AF_INET;
+    StorageServer.sin_addr.s_addr = inet_addr(dl->sServerIP);
+    StorageServer.sin_port = htons(dl->iServerPort);
+    if(connect(sockfd, (struct sockaddr *)&StorageServer, sizeof(StorageServer)) < 0)
+    {
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+/**
+ * @brief Writes a buffer at an offset of a file
+ * @return: 0 on success, -1 on failure
+ */
+static int Write_At(int fd, const char* buffer, size_t length, uint64_t iOffset)
+{
+    while(length > 0)
+    {
+        ssize_t iWritten = pwrite(fd, buffer, length, iOffset);
+        if(iWritten < 0 && errno == EINTR)
+            continue;
+        if(iWritten <= 0)
+            return -1;
+        buffer += iWritten;
+        length -= iWritten;
+        iOffset += iWritten;
+    }
+    return 0;
+}
+
+/**
+ * @brief Fetches a byte range of the file into the same range of the local file
+ * @param iRequestID: ID of the request (the connection only carries this one)
+ * @param buffer: DOWNLOAD_BUFFER_SIZE bytes
+ * @param end: Filled with the end of the stream (range sent and size of the file)
+ * @return: The number of bytes written (less than iLength at the end of the file), -1 on failure
+ */
+static long long Fetch_Range(DOWNLOAD_STRUCT* dl, uint32_t iRequestID, uint64_t iOffset, uint64_t iLength, char* buffer, WIRE_DATA_END_STRUCT* end)
+{
+    int sockfd = Connect_Download_Server(dl);
+    if(sockfd < 0)
+        return -1;
+
+    REQUEST_STRUCT req;
+    memset(&req, 0, sizeof(REQUEST_STRUCT));
+    req.iRequestOperation = CMD_READ;
+    req.iRequestClientID = iClientID;
+    strncpy(req.sRequestPath, dl->sPath, MAX_BUFFER_SIZE - 1);
+    WIRE_CONTEXT_STRUCT ctx = {WIRE_VERSION_2, iRequestID};
+    ctx.iRange = 1;
+    ctx.iRangeOffset = iOffset;
+    ctx.iRangeLength = iLength;
+
+    int err = (Send_Request(sockfd, &ctx, &req) <= 0);
+    uint64_t iReceived = 0;
+    WIRE_HEADER_STRUCT header;
+    while(!err)
+    {
+        err = (Recv_Data_Header(sockfd, &header, end) <= 0);
+        if(err || header.iFrameType == FRAME_DATA_END)
+            break;
+
+        size_t iLeft = header.iPayloadLength;
+        while(iLeft > 0 && !err)
+        {
+            size_t iChunk = (iLeft < DOWNLOAD_BUFFER_SIZE) ? iLeft : DOWNLOAD_BUFFER_SIZE;
+            err = (Recv_All(sockfd, buffer, iChunk) <= 0) || (Write_At(dl->fd, buffer, iChunk, iOffset + iReceived) < 0);
+            iLeft -= iChunk;
+            iReceived += iChunk;
+        }
+    }
+
+    // The stream must hold the range asked for (cut at the end of the file), the response only repeats its status
+    err = err || end->iStatus != WIRE_DATA_OK || end->iOffset != iOffset || end->iStreamBytes != iReceived || iReceived > iLength;
+    if(!err)
+    {
+        RESPONSE_STRUCT res;
+        Recv_Response(sockfd, &ctx, &res);
+    }
+    close(sockfd);
+    return err ? -1 : (long long)iReceived;
+}
+
+/**
+ * @brief Worker of a round: fetches pending chunks until there are none left
+ * @param arg: The download
+ * @return: NULL
+ */
+static void* Download_Worker(void* arg)
+{
+    DOWNLOAD_STRUCT* dl = (DOWNLOAD_STRUCT*)arg;
+    char* buffer = (char*)malloc(DOWNLOAD_BUFFER_SIZE);
+    if(CheckNull(buffer, "[-]Download_Worker: Error in allocating memory"))
+        return NULL;
+
+    // The ranges are children of the download span of the command
+    Trace_Set_Context(dl->iTraceID, dl->iSpanID);
+    unsigned long i;
+    while((i = atomic_fetch_add(&dl->iNextPending, 1)) < dl->iPendingCount)
+    {
+        unsigned long iChunk = dl->Pending[i];
+        uint64_t iOffset = (uint64_t)iChunk * dl->iChunkSize;
+        uint64_t iLength = (dl->iFileSize - iOffset < dl->iChunkSize) ? dl->iFileSize - iOffset : dl->iChunkSize;
+
+        TRACE_SPAN_STRUCT span;
+        Trace_Begin(&span, "range");
+        Trace_Detail(&span, "%llu bytes at %llu", (unsigned long long)iLength, (unsigned long long)iOffset);
+        WIRE_DATA_END_STRUCT end;
+        long long iWritten = Fetch_Range(dl, (uint32_t)iChunk + 1, iOffset, iLength, buffer, &end);
+        if(iWritten >= 0 && end.iFileSize != dl->iFileSize)
+        {
+            atomic_store(&dl->iChanged, 1);
+            iWritten = -1;
+        }
+
+        if(iWritten == (long long)iLength)
+        {
+            dl->ChunkDone[iChunk] = 1;
+            atomic_fetch_add(&dl->iBytes, iLength);
+        }
+        else
+        {
+            Trace_Error(&span, CMD_ERROR_RECV_FAILED);
+            LOG_ERROR("[-]Download_Worker: Failed to fetch %llu bytes at %llu from %s:%d", (unsigned long long)iLength, (unsigned long long)iOffset, dl->sServerIP, dl->iServerPort);
+        }
+        Trace_End(&span);
+    }
+    Trace_Clear();
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * @brief Runs a round: K workers fetch the pending chunks
+ * @param iConnections: The number of workers (at most DOWNLOAD_MAX_CONNECTIONS)
+ */
+static void Download_Round(DOWNLOAD_STRUCT* dl, int iConnections)
+{
+    pthread_t workers[DOWNLOAD_MAX_CONNECTIONS];
+    int iWorkers = 0;
+    atomic_store(&dl->iNextPending, 0);
+    if((unsigned long)iConnections > dl->iPendingCount)
+        iConnections = (int)dl->iPendingCount;
+
+    for(int i = 0; i < iConnections; i++)
+    {
+        if(pthread_create(&workers[iWorkers], NULL, Download_Worker, dl) != 0)
+        {
+            LOG_ERROR("[-]DLcmd: Error in creating download worker, continuing with %d", iWorkers);
+            break;
+        }
+        iWorkers++;
+    }
+
+    // Without any worker the calling thread fetches the chunks itself
+    if(iWorkers == 0)
+        Download_Worker(dl);
+    for(int i = 0; i < iWorkers; i++)
+        pthread_join(workers[i], NULL);
+}
+
+void DLcmd(char* arg, int ServerSockfd)
+{
+    if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: DOWNLOAD <Path> <Local Path> [<Connections>] [<Chunk>]", CMD_ERROR_INVALID_ARGUMENTS)))
+    {
+        LOG_ERROR("[-]DLcmd: Invalid Argument");
+        return;
+    }
+
+    // Connections and chunk size (in bytes) are optional
+    char* path = strtok(arg, " \t\n");
+    char* sLocalPath = strtok(NULL, " \t\n");
+    char* sConnections = strtok(NULL, " \t\n");
+    char* sChunkSize = (sConnections != NULL) ? strtok(NULL, " \t\n") : NULL;
+    int iConnections = (sConnections != NULL) ? atoi(sConnections) : DOWNLOAD_CONNECTIONS;
+    long long iChunkSize = (sChunkSize != NULL) ? atoll(sChunkSize) : DOWNLOAD_CHUNK_SIZE;
+    if(path == NULL || sLocalPath == NULL || strtok(NULL, " \t\n") != NULL ||
+       iConnections < 1 || iConnections > DOWNLOAD_MAX_CONNECTIONS || iChunkSize < DOWNLOAD_MIN_CHUNK_SIZE)
+    {
+        char* Msg = ErrorMsg("Invalid Arguments\nUSAGE: DOWNLOAD <Path> <Local Path> [<Connections>] [<Chunk>]", CMD_ERROR_INVALID_ARGUMENTS);
+        printf(RED"%s\n"reset, Msg);
+        printf("Connections: 1 to %d, Chunk: at least %d bytes\n", DOWNLOAD_MAX_CONNECTIONS, DOWNLOAD_MIN_CHUNK_SIZE);
+        LOG_ERROR("[-]DLcmd: Invalid Arguments");
+        free(Msg);
+        return;
+    }
+    if(iWireVersion != WIRE_VERSION_2)
+    {
+        char* Msg = ErrorMsg("Byte ranges are not supported by the server", CMD_ERROR_INVALID_ARGUMENTS);
+        printf(RED"%s\n"reset, Msg);
+        LOG_ERROR("[-]DLcmd: Download asked on a v1 connection");
+        free(Msg);
+        return;
+    }
+    LOG_INFO("[+]DLcmd: Downloading Path %s to %s (%d connections, %lld byte chunks)", path, sLocalPath, iConnections, iChunkSize);
+
+    DOWNLOAD_STRUCT* dl = (DOWNLOAD_STRUCT*)calloc(1, sizeof(DOWNLOAD_STRUCT));
+    char* buffer = (char*)malloc(DOWNLOAD_BUFFER_SIZE);
+    if(CheckNull(dl, "[-]DLcmd: Error in allocating memory") || CheckNull(buffer, "[-]DLcmd: Error in allocating memory"))
+    {
+        free(dl);
+        free(buffer);
+        return;
+    }
+    dl->iChunkSize = iChunkSize;
+    dl->fd = open(sLocalPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(CheckError(dl->fd, ErrorMsg("Failed to open the local file", CMD_ERROR_INVALID_ARGUMENTS)))
+    {
+        LOG_ERROR("[-]DLcmd: Failed to open the local file %s", sLocalPath);
+        free(dl);
+        free(buffer);
+        return;
+    }
+
+    TRACE_SPAN_STRUCT span, roundSpan;
+    Trace_Begin(&span, "download");
+    Trace_Detail(&span, "%s", path);
+    double fStart = GetCurrTime(Clock);
+    int err = 0, iReported = 0;
+
+    // The first chunk gives the size of the file (retried after a new resolution like the other chunks)
+    WIRE_DATA_END_STRUCT end;
+    long long iFirst = -1;
+    for(int iRound = 0; iRound < DOWNLOAD_ROUNDS && iFirst < 0 && err == 0; iRound++)
+    {
+        if(iRound > 0)
+            sleep(DOWNLOAD_RETRY_DELAY);
+        err = Resolve_Download(ServerSockfd, path, dl);
+        if(err == 0)
+            iFirst = Fetch_Range(dl, 1, 0, dl->iChunkSize, buffer, &end);
+    }
+    free(buffer);
+    if(iFirst < 0)
+    {
+        if(err == 0)
+        {
+            char* Msg = ErrorMsg("Failed to receive file from storage server", CMD_ERROR_RECV_FAILED);
+            printf(RED"%s\n"reset, Msg);
+            free(Msg);
+        }
+        LOG_ERROR("[-]DLcmd: Failed to receive the first chunk of %s", path);
+        err = -1;
+        iReported = 1;
+    }
+    else
+    {
+        dl->iFileSize = end.iFileSize;
+        err = (ftruncate(dl->fd, dl->iFileSize) < 0);
+        atomic_store(&dl->iBytes, iFirst);
+    }
+
+    // The remaining chunks, in rounds until they are all written
+    unsigned long iChunks = (err == 0) ? (unsigned long)((dl->iFileSize + dl->iChunkSize - 1) / dl->iChunkSize) : 0;
+    if(iChunks > 1)
+    {
+        dl->ChunkDone = (unsigned char*)calloc(iChunks, sizeof(unsigned char));
+        dl->Pending = (unsigned long*)malloc(iChunks * sizeof(unsigned long));
+        err = (CheckNull(dl->ChunkDone, "[-]DLcmd: Error in allocating memory") || CheckNull(dl->Pending, "[-]DLcmd: Error in allocating memory")) ? -1 : 0;
+        if(err == 0)
+            dl->ChunkDone[0] = 1;
+        Trace_Get_Context(&dl->iTraceID, &dl->iSpanID);
+
+        for(int iRound = 0; iRound < DOWNLOAD_ROUNDS && err == 0; iRound++)
+        {
+            dl->iPendingCount = 0;
+            for(unsigned long i = 0; i < iChunks; i++)
+                if(!dl->ChunkDone[i])
+                    dl->Pending[dl->iPendingCount++] = i;
+            if(dl->iPendingCount == 0)
+                break;
+
+            // A later round asks the naming server again, which may now send it to a backup
+            if(iRound > 0)
+            {
+                printf(YEL"%lu chunks failed, resolving the file again\n"reset, dl->iPendingCount);
+                LOG_INFO("[+]DLcmd: %lu chunks failed, resolving %s again", dl->iPendingCount, path);
+                sleep(DOWNLOAD_RETRY_DELAY);
+                if(Resolve_Download(ServerSockfd, path, dl) < 0)
+                {
+                    iReported = 1;
+                    break;
+                }
+            }
+            Trace_Begin(&roundSpan, "download_round");
+            Trace_Detail(&roundSpan, "%lu chunks from %s:%d", dl->iPendingCount, dl->sServerIP, dl->iServerPort);
+            Download_Round(dl, iConnections);
+            Trace_End(&roundSpan);
+            if(atomic_load(&dl->iChanged))
+                break;
+        }
+
+        for(unsigned long i = 0; i < iChunks && err == 0; i++)
+            err = dl->ChunkDone[i] ? 0 : -1;
+    }
+    double fSeconds = GetCurrTime(Clock) - fStart;
+    err |= (close(dl->fd) < 0);
+    Trace_End(&span);
+
+    if(err)
+    {
+        // A file with holes would pass for the real one
+        unlink(sLocalPath);
+        if(!iReported)
+        {
+            char* Msg = ErrorMsg(atomic_load(&dl->iChanged) ? "The file changed during the download" : "Failed to download the file", CMD_ERROR_RECV_FAILED);
+            printf(RED"%s\n"reset, Msg);
+            free(Msg);
+        }
+        LOG_ERROR("[-]DLcmd: Failed to download %s", path);
+    }
+    else
+    {
+        // A file of a single chunk only used the first connection
+        unsigned long long iBytes = atomic_load(&dl->iBytes);
+        if(iChunks <= 1 || (unsigned long)iConnections > iChunks - 1)
+            iConnections = (iChunks <= 1) ? 1 : (int)(iChunks - 1);
+        printf(GRN"Downloaded %llu Bytes to %s in %.3f s (%.1f MB/s over %d connections)\n"reset, iBytes, sLocalPath, fSeconds,
+               (fSeconds > 0) ? iBytes / fSeconds / (1024 * 1024) : 0.0, iConnections);
+        LOG_INFO("[+]DLcmd: Downloaded %s (%llu bytes) in %.3f s", path, iBytes, fSeconds);
+    }
+    free(dl->ChunkDone);
+    free(dl->Pending);
+    free(dl);
+}
@@ -10,6 +10,7 @@
 #define CMD_ERROR_SEND_FAILED 105
 #define CMD_ERROR_RECV_FAILED 106
 #define CMD_ERROR_INVALID_RECV_VALUE 107
+#define CMD_ERROR_INPUT_FAILED 108
 #define CMD_ERROR_SOCKET_FAILED 109
 #define CMD_ERROR_CONNECT_FAILED 110
 
@@ -7,12 +7,26 @@
 
 // Custom Libraries
 #include "./Hash.h"
+#include "../Wire.h"
+#include "../Log.h"
+#include "../Trace.h"
 
 #define POLL_TIMEOUT 2
 #define SLEEP_TIME 5
 #define FUNCTION_COUNT 127
 
 #define PROMPT_LEN 1024
+#define PIPELINE_STASH_SIZE 64   // Replies that can arrive ahead of the one being waited for
+
+// Parallel download (DOWNLOAD)
+#define DOWNLOAD_CONNECTIONS 4                   // Connections used when none are given
+#define DOWNLOAD_MAX_CONNECTIONS 64
+#define DOWNLOAD_CHUNK_SIZE (8 * 1024 * 1024)    // Bytes of a range request when no chunk size is given
+#define DOWNLOAD_MIN_CHUNK_SIZE (64 * 1024)
+#define DOWNLOAD_BUFFER_SIZE (256 * 1024)        // Receive buffer of a download worker
+#define DOWNLOAD_ROUNDS 3                        // Resolutions tried before the chunks that failed are given up
+#define DOWNLOAD_RETRY_DELAY 2                   // Seconds before a new resolution, for the naming server to see a server down
+#define DOWNLOAD_IO_TIMEOUT 30                   // Seconds a connection may stall before its chunk fails
 
 // structure for clock object
 typedef struct Clock
@@ -25,14 +39,22 @@ CLOCK* InitClock();
 double GetCurrTime(CLOCK* clock);
 
 // Constants
-extern FILE* Clientlog;
 extern HashTable *table;
 extern unsigned long iClientID;
+extern int iWireVersion;
 extern CLOCK* Clock;
 
 
 // Function Prototypes
 int pollServer(int sockfd, char* ip, int port);
+int Negotiate_Wire_Version(int sockfd, char* ip, int port);
+
+// Request pipelining on the Naming Server connection
+uint32_t NextRequestID();
+void ResetPipeline();
+int Recv_Response_For(int sockfd, WIRE_CONTEXT_STRUCT* ctx, RESPONSE_STRUCT* response);
+int Recv_Ack_For(int sockfd, WIRE_CONTEXT_STRUCT* ctx, ACK_STRUCT* ack);
+int Recv_Resolve_Results_For(int sockfd, WIRE_CONTEXT_STRUCT* ctx, RESOLVE_RESULT_STRUCT** results, uint32_t* iResultCount);
 void prompt();
 
 //Client Side Commands
@@ -44,10 +66,12 @@ void CScmd(char* arg, int ServerSockfd);
 void Rcmd(char* arg, int ServerSockfd);
 void Wcmd(char* arg, int ServerSockfd);
 void Icmd(char* arg, int ServerSockfd);
+void DLcmd(char* arg, int ServerSockfd);
 
 
 // Server Side Commands
 void LScmd(char* arg, int ServerSockfd);
+void RScmd(char* arg, int ServerSockfd);
 
 // Indirect Connection Commands
 void Cpycmd(char* arg, int ServerSockfd);
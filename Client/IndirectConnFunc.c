@@ -7,6 +7,7 @@
 
 // Custom Header Files
 #include "../Externals.h"
+#include "../Wire.h"
 #include "../colour.h"
 #include "./Headers.h"
 #include "./Hash.h"
@@ -14,69 +15,186 @@
 
 void LScmd(char* arg, int ServerSockfd)
 {
-    if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: LIST <Path>", CMD_ERROR_INVALID_ARGUMENTS)))
+    if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: LIST <Path> [<Max Depth>] [<Max Entries>]", CMD_ERROR_INVALID_ARGUMENTS)))
     {
         printf(BWHT"USE 'LIST mount' or 'LIST . to list entire directory tree\n"reset);
-        fprintf(Clientlog, "[-]LScmd: Invalid Argument [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]LScmd: Invalid Argument");
         return;
     }
 
-    arg = strtok(arg, " \t\n");
-    if(strtok(NULL, " \t\n") != NULL)
+    // Depth and entries are optional, 0 means no limit
+    char* path = strtok(arg, " \t\n");
+    char* sDepth = strtok(NULL, " \t\n");
+    char* sEntries = (sDepth != NULL) ? strtok(NULL, " \t\n") : NULL;
+    int iMaxDepth = (sDepth != NULL) ? atoi(sDepth) : 0;
+    int iMaxEntries = (sEntries != NULL) ? atoi(sEntries) : 0;
+    if(path == NULL || strtok(NULL, " \t\n") != NULL || iMaxDepth < 0 || iMaxEntries < 0)
     {
-        fprintf(Clientlog, "[-]LScmd: Invalid Argument Count [Time Stamp: %f]\n", GetCurrTime(Clock));
+        char* Msg = ErrorMsg("Invalid Arguments\nUSAGE: LIST <Path> [<Max Depth>] [<Max Entries>]", CMD_ERROR_INVALID_ARGUMENTS);
+        printf(RED"%s\n"reset, Msg);
+        LOG_ERROR("[-]LScmd: Invalid Argument Count");
+        free(Msg);
         return;
     }
+    LOG_INFO("[+]LScmd: Listing Path %s", path);
 
-    char* path = arg;
-    fprintf(Clientlog, "[+]LScmd: Listing Path %s [Time Stamp: %f]\n", path, GetCurrTime(Clock));
+    // The tree comes in pages, each request carries the cursor returned with the previous page
+    char sCursor[MAX_BUFFER_SIZE] = "";
+    int iListed = 0;
+    int iPages = 0;
+    while(1)
+    {
+        REQUEST_STRUCT req_struct;
+        REQUEST_STRUCT* req = &req_struct;
+        memset(req, 0, sizeof(REQUEST_STRUCT));
+        WIRE_CONTEXT_STRUCT ctx = {iWireVersion, NextRequestID()};
 
-    REQUEST_STRUCT req_struct;
-    REQUEST_STRUCT* req = &req_struct;
-    memset(req, 0, sizeof(REQUEST_STRUCT));
+        req->iRequestOperation = CMD_LIST;
+        req->iRequestClientID = iClientID;
+        snprintf(req->sRequestPath, MAX_BUFFER_SIZE, "%s %d %d %s", path, iMaxDepth, iMaxEntries ? iMaxEntries - iListed : 0, sCursor);
 
-    req->iRequestOperation = CMD_LIST;
-    req->iRequestClientID = iClientID;
-    strncpy(req->sRequestPath, path, MAX_BUFFER_SIZE);
-    // req->iRequestFlags = 0;
+        int iBytesSent = Send_Request(ServerSockfd, &ctx, req);
+
+        if(iBytesSent <= 0)
+        {
+            char* Msg = ErrorMsg("Failed to send request to server", CMD_ERROR_SEND_FAILED);
+            printf(RED"%s\n"reset, Msg);
+            LOG_ERROR("[-]LScmd: Failed to send request");
+            free(Msg);
+            return;
+        }
+
+        RESPONSE_STRUCT res_struct;
+        RESPONSE_STRUCT* res = &res_struct;
+        memset(res, 0, sizeof(RESPONSE_STRUCT));
+
+        int iBytesRecv = Recv_Response_For(ServerSockfd, &ctx, res);
+        if(iBytesRecv <= 0)
+        {
+            char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
+            printf(RED"%s\n"reset, Msg);
+            LOG_ERROR("[-]LScmd: Failed to receive response");
+            free(Msg);
+            return;
+        }
 
-    int iBytesSent = send(ServerSockfd, req, sizeof(REQUEST_STRUCT), 0);
+        if(res->iResponseFlags != RESPONSE_FLAG_SUCCESS && res->iResponseFlags != RESPONSE_FLAG_MORE)
+        {
+            char* Msg = ErrorMsg(res->sResponseData, res->iResponseErrorCode);
+            printf(RED"%s\n"reset, Msg);
 
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+            LOG_ERROR("[-]LScmd: %s", Msg);
+            free(Msg);
+            return;
+        }
+
+        // A page with more to come starts with the cursor of the next one
+        char* page = res->sResponseData;
+        if(res->iResponseFlags == RESPONSE_FLAG_MORE)
+        {
+            char* newline = strchr(page, '\n');
+            if(newline == NULL)
+            {
+                char* Msg = ErrorMsg("Invalid page received from server", CMD_ERROR_INVALID_RECV_VALUE);
+                printf(RED"%s\n"reset, Msg);
+                LOG_ERROR("[-]LScmd: Page without a cursor");
+                free(Msg);
+                return;
+            }
+            *newline = '\0';
+            strncpy(sCursor, page, MAX_BUFFER_SIZE - 1);
+            page = newline + 1;
+        }
+
+        printf(GRN"%s"reset, page);
+        iPages++;
+        for(char* c = page; *c != '\0'; c++)
+            iListed += (*c == '\n');
+
+        if(res->iResponseFlags != RESPONSE_FLAG_MORE || (iMaxEntries > 0 && iListed >= iMaxEntries))
+            break;
+    }
+
+    printf("\n");
+    LOG_INFO("[+]LScmd: Successfully listed directory (%d entries in %d pages)", iListed, iPages);
+    return;
+}
+void RScmd(char* arg, int ServerSockfd)
+{
+    if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: RESOLVE <Path> [<Path> ...]", CMD_ERROR_INVALID_ARGUMENTS)))
     {
-        char* Msg = ErrorMsg("Failed to send request to server", CMD_ERROR_SEND_FAILED);
+        LOG_ERROR("[-]RScmd: Invalid Argument");
+        return;
+    }
+
+    if(iWireVersion != WIRE_VERSION_2)
+    {
+        char* Msg = ErrorMsg("RESOLVE needs a Naming Server speaking wire protocol v2", CMD_ERROR_INVALID_COMMAND);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]LScmd: Failed to send request [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]RScmd: Naming Server does not support batched resolution");
         free(Msg);
         return;
     }
-    
-    RESPONSE_STRUCT res_struct;
-    RESPONSE_STRUCT* res = &res_struct;
-    memset(res, 0, sizeof(RESPONSE_STRUCT));
 
-    int iBytesRecv = recv(ServerSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    // Collect the paths
+    char* Paths[WIRE_MAX_BATCH_PATHS];
+    uint32_t iPathCount = 0;
+    for(char* path = strtok(arg, " \t\n"); path != NULL; path = strtok(NULL, " \t\n"))
     {
-        char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
+        if(iPathCount == WIRE_MAX_BATCH_PATHS)
+        {
+            char* Msg = ErrorMsg("Too many paths in a single RESOLVE", CMD_ERROR_INVALID_ARGUMENTS_COUNT);
+            printf(RED"%s\n"reset, Msg);
+            LOG_ERROR("[-]RScmd: Invalid Argument Count");
+            free(Msg);
+            return;
+        }
+        Paths[iPathCount++] = path;
+    }
+    if(iPathCount == 0)
+    {
+        LOG_ERROR("[-]RScmd: Invalid Argument Count");
+        return;
+    }
+    LOG_INFO("[+]RScmd: Resolving %u paths", iPathCount);
+
+    WIRE_CONTEXT_STRUCT ctx = {iWireVersion, NextRequestID()};
+    char* buffer = NULL;
+    int length = Wire_Encode_Resolve_Batch(&ctx, iClientID, Paths, iPathCount, &buffer);
+    int iBytesSent = (length < 0) ? -1 : Send_All(ServerSockfd, buffer, length);
+    free(buffer);
+
+    if(iBytesSent <= 0)
+    {
+        char* Msg = ErrorMsg("Failed to send request to server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]LScmd: Failed to receive response [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]RScmd: Failed to send request");
         free(Msg);
         return;
     }
 
-    if(res->iResponseFlags != RESPONSE_FLAG_SUCCESS)
+    RESOLVE_RESULT_STRUCT* results = NULL;
+    uint32_t iResultCount = 0;
+    int iBytesRecv = Recv_Resolve_Results_For(ServerSockfd, &ctx, &results, &iResultCount);
+    if(iBytesRecv <= 0 || iResultCount != iPathCount)
     {
-        char* Msg = ErrorMsg(res->sResponseData, res->iResponseErrorCode);
+        char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
-        
-        fprintf(Clientlog, "%s [Time Stamp: %f]\n", Msg, GetCurrTime(Clock));
+        LOG_ERROR("[-]RScmd: Failed to receive response");
         free(Msg);
+        free(results);
         return;
     }
 
-    printf(GRN"%s\n"reset, res->sResponseData);
-    fprintf(Clientlog, "[+]LScmd: Successfully listed directory [Time Stamp: %f]\n", GetCurrTime(Clock));
+    for(uint32_t i = 0; i < iResultCount; i++)
+    {
+        if(results[i].iFlags == RESPONSE_FLAG_FAILURE)
+            printf(RED"%s: Not resolved (Error Code: %d)\n"reset, Paths[i], results[i].iErrorCode);
+        else
+            printf(GRN"%s: Server %lu (%s:%d)%s\n"reset, Paths[i], results[i].iServerID, results[i].sServerIP, results[i].iServerPort, results[i].iFlags == BACKUP_RESPONSE ? " [Backup]" : "");
+    }
+    free(results);
+    LOG_INFO("[+]RScmd: Successfully resolved %u paths", iPathCount);
     return;
 }
 void Cpycmd(char* arg, int ServerSockfd)
@@ -101,7 +219,7 @@ void Rncmd(char* arg, int ServerSockfd)
     // Check if the argument is NULL
     if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: RENAME <Source Path> <Target Name>", CMD_ERROR_INVALID_ARGUMENTS)))
     {
-        fprintf(Clientlog, "[-]Rncmd: Invalid Argument [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rncmd: Invalid Argument");
         return;
     }
 
@@ -112,7 +230,7 @@ void Rncmd(char* arg, int ServerSockfd)
     // Check if the argument count is correct
     if(CheckNull(target, ErrorMsg("Invalid Argument Count\nUSAGE: RENAME <Source Path> <Target Name>", CMD_ERROR_INVALID_ARGUMENTS)))
     {
-        fprintf(Clientlog, "[-]Rncmd: Invalid Argument Count [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rncmd: Invalid Argument Count");
         return;
     }
 
@@ -120,18 +238,19 @@ void Rncmd(char* arg, int ServerSockfd)
     if(strtok(NULL, " \t\n") != NULL)
     {
         printf(RED"Invalid Argument Count\nUSAGE: RENAME <Source Path> <Target Name>\n"reset);
-        fprintf(Clientlog, "[-]Rncmd: Invalid Argument Count [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rncmd: Invalid Argument Count");
         return;
     }
 
 
     // Log the command
-    fprintf(Clientlog, "[+]Rncmd: Renaming %s to %s [Time Stamp: %f]\n", src, target, GetCurrTime(Clock));
+    LOG_INFO("[+]Rncmd: Renaming %s to %s", src, target);
 
     // Create a request struct
     REQUEST_STRUCT req_struct;
     REQUEST_STRUCT* req = &req_struct;
     memset(req, 0, sizeof(REQUEST_STRUCT));
+    WIRE_CONTEXT_STRUCT ctx = {iWireVersion, NextRequestID()};
 
     // Fill the request struct
     req->iRequestOperation = CMD_RENAME;
@@ -139,12 +258,12 @@ void Rncmd(char* arg, int ServerSockfd)
     snprintf(req->sRequestPath, MAX_BUFFER_SIZE, "%s %s", src, target);
 
     // Send the request to the server
-    int iBytesSent = send(ServerSockfd, req, sizeof(REQUEST_STRUCT), 0);
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+    int iBytesSent = Send_Request(ServerSockfd, &ctx, req);
+    if(iBytesSent <= 0)
     {
         char* Msg = ErrorMsg("Failed to send request to server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Rncmd: Failed to send request [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rncmd: Failed to send request");
         free(Msg);
         return;
     }
@@ -154,12 +273,12 @@ void Rncmd(char* arg, int ServerSockfd)
     RESPONSE_STRUCT* res = &res_struct;
     memset(res, 0, sizeof(RESPONSE_STRUCT));
 
-    int iBytesRecv = recv(ServerSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    int iBytesRecv = Recv_Response_For(ServerSockfd, &ctx, res);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Rncmd: Failed to receive response [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rncmd: Failed to receive response");
         free(Msg);
         return;
     }
@@ -169,7 +288,7 @@ void Rncmd(char* arg, int ServerSockfd)
     {
         char* Msg = ErrorMsg(res->sResponseData, res->iResponseErrorCode);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Rncmd: Failed to rename file [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rncmd: Failed to rename file");
         free(Msg);
         return;
     }
@@ -179,32 +298,36 @@ void Rncmd(char* arg, int ServerSockfd)
     ACK_STRUCT* ack = &ack_struct;
     memset(ack, 0, sizeof(ACK_STRUCT));
 
-    iBytesRecv = recv(ServerSockfd, ack, sizeof(ACK_STRUCT), 0);
-    if(iBytesRecv != sizeof(ACK_STRUCT))
+    // The storage server renames the file while the client waits for the ACK
+    TRACE_SPAN_STRUCT span;
+    Trace_Begin(&span, "ack_wait");
+    iBytesRecv = Recv_Ack_For(ServerSockfd, &ctx, ack);
+    Trace_End(&span);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Rncmd: Failed to receive response [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rncmd: Failed to receive response");
         free(Msg);
         return;
     }
 
     // Log the ACK
-    fprintf(Clientlog, "[+]Rncmd: Received ACK with data %s [Time Stamp: %f]\n", ack->sAckData, GetCurrTime(Clock));
+    LOG_INFO("[+]Rncmd: Received ACK with data %s", ack->sAckData);
 
     // Check if the operation was successful
-    if(ack->iAckFlags == ACK_FLAG_SUCCESS)
+    if(ack->iAckFlags != ACK_FLAG_SUCCESS)
     {
         char* Msg = ErrorMsg("Failed to rename file", ack->iAckErrorCode);
         printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Rncmd: Failed to rename file [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Rncmd: Failed to rename file");
         free(Msg);
         return;
     }
 
     // Print the success message
     printf(GRN"%s\n"reset, ack->sAckData);
-    fprintf(Clientlog, "[+]Rncmd: Successfully renamed file [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Rncmd: Successfully renamed file");
     
     return;
 }
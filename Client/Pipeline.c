@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// Custom Header Files
+#include "../Externals.h"
+#include "../Wire.h"
+#include "../colour.h"
+#include "./Headers.h"
+
+/*
+Requests on the Naming Server connection are tagged with an ID that the server echoes in the
+RESPONSE and in any later ACK. Several requests may be in flight and their replies may arrive in
+any order (and an ACK may arrive while waiting for another response), so frames that do not match
+the awaited ID are parked in a small stash until they are asked for.
+*/
+
+// A reply received before it was asked for
+typedef struct STASHED_FRAME_STRUCT
+{
+    WIRE_HEADER_STRUCT header;
+    char payload[sizeof(uint64_t) + MAX_BUFFER_SIZE];
+    int iInUse;
+} STASHED_FRAME_STRUCT;
+
+static STASHED_FRAME_STRUCT Stash[PIPELINE_STASH_SIZE];
+static int iStashOldest = 0;
+static uint32_t iNextRequestID = 1;
+
+/**
+ * @brief Returns a fresh request ID for the Naming Server connection
+ * @return a non zero request ID
+ */
+uint32_t NextRequestID()
+{
+    uint32_t iRequestID = iNextRequestID++;
+    if (iNextRequestID == 0)
+        iNextRequestID = 1;
+    return iRequestID;
+}
+
+/**
+ * @brief Drops all stashed replies (called when the connection is reopened)
+ */
+void ResetPipeline()
+{
+    memset(Stash, 0, sizeof(Stash));
+    iStashOldest = 0;
+}
+
+/**
+ * @brief Parks a reply until it is asked for
+ * @note When the stash is full the oldest reply is dropped
+ */
+static void StashFrame(WIRE_HEADER_STRUCT *header, char *payload)
+{
+    int slot = -1;
+    for (int i = 0; i < PIPELINE_STASH_SIZE; i++)
+    {
+        if (!Stash[i].iInUse)
+        {
+            slot = i;
+            break;
+        }
+    }
+
+    if (slot < 0)
+    {
+        slot = iStashOldest;
+        iStashOldest = (iStashOldest + 1) % PIPELINE_STASH_SIZE;
+        LOG_ERROR("[-]StashFrame: Stash full, dropped reply to request %u", Stash[slot].header.iRequestID);
+    }
+
+    Stash[slot].header = *header;
+    memcpy(Stash[slot].payload, payload, header->iPayloadLength);
+    Stash[slot].iInUse = 1;
+}
+
+/**
+ * @brief Waits for the reply of a given type to a given request
+ * @param sockfd The socket to the Naming Server
+ * @param iFrameType FRAME_RESPONSE or FRAME_ACK
+ * @param iRequestID The ID of the request
+ * @param header Filled with the header of the reply
+ * @param payload Filled with the payload of the reply
+ * @return number of bytes of the reply, 0 if the server closed the connection, -1 on failure
+ */
+static int RecvReplyFor(int sockfd, int iFrameType, uint32_t iRequestID, WIRE_HEADER_STRUCT *header, char *payload)
+{
+    // Check if the reply already arrived
+    for (int i = 0; i < PIPELINE_STASH_SIZE; i++)
+    {
+        if (Stash[i].iInUse && Stash[i].header.iFrameType == iFrameType && Stash[i].header.iRequestID == iRequestID)
+        {
+            *header = Stash[i].header;
+            memcpy(payload, Stash[i].payload, header->iPayloadLength);
+            Stash[i].iInUse = 0;
+            return WIRE_HEADER_SIZE + header->iPayloadLength;
+        }
+    }
+
+    // Read replies until the awaited one arrives, parking the others
+    while (1)
+    {
+        int iRecvStatus = Recv_Frame(sockfd, 0, header, payload, sizeof(uint64_t) + MAX_BUFFER_SIZE);
+        if (iRecvStatus <= 0)
+            return iRecvStatus;
+
+        if (header->iFrameType == iFrameType && header->iRequestID == iRequestID)
+            return iRecvStatus;
+
+        LOG_INFO("[+]RecvReplyFor: Parked reply (type %d) to request %u while waiting for request %u", header->iFrameType, header->iRequestID, iRequestID);
+        StashFrame(header, payload);
+    }
+}
+
+/**
+ * @brief Receives the response to the request whose ID is in ctx
+ * @param sockfd The socket to the Naming Server
+ * @param ctx The context the request was sent with
+ * @param response Filled with the response
+ * @return number of bytes of the response, 0 if the server closed the connection, -1 on failure
+ * @note A v1 server has no request IDs and answers in order
+ */
+int Recv_Response_For(int sockfd, WIRE_CONTEXT_STRUCT *ctx, RESPONSE_STRUCT *response)
+{
+    if (ctx->iVersion != WIRE_VERSION_2)
+        return Recv_Response(sockfd, ctx, response);
+
+    WIRE_HEADER_STRUCT header;
+    char payload[sizeof(uint64_t) + MAX_BUFFER_SIZE];
+    int iRecvStatus = RecvReplyFor(sockfd, FRAME_RESPONSE, ctx->iRequestID, &header, payload);
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+    if (Wire_Decode_Response(&header, payload, ctx, response) < 0)
+        return -1;
+    return iRecvStatus;
+}
+
+/**
+ * @brief Receives the ACK of the request whose ID is in ctx
+ * @param sockfd The socket to the Naming Server
+ * @param ctx The context the request was sent with
+ * @param ack Filled with the ACK
+ * @return number of bytes of the ACK, 0 if the server closed the connection, -1 on failure
+ */
+int Recv_Ack_For(int sockfd, WIRE_CONTEXT_STRUCT *ctx, ACK_STRUCT *ack)
+{
+    if (ctx->iVersion != WIRE_VERSION_2)
+        return Recv_Ack(sockfd, ctx, ack);
+
+    WIRE_HEADER_STRUCT header;
+    char payload[sizeof(uint64_t) + MAX_BUFFER_SIZE];
+    int iRecvStatus = RecvReplyFor(sockfd, FRAME_ACK, ctx->iRequestID, &header, payload);
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+    if (Wire_Decode_Ack(&header, payload, ctx, ack) < 0)
+        return -1;
+    return iRecvStatus;
+}
+
+/**
+ * @brief Receives the results of the CMD_RESOLVE_BATCH request whose ID is in ctx
+ * @param sockfd The socket to the Naming Server
+ * @param ctx The context the batch was sent with
+ * @param results Set to the allocated results (one per path, in request order), to be freed by the caller
+ * @param iResultCount Set to the number of results
+ * @return number of bytes of the results frame, 0 if the server closed the connection, -1 on failure
+ * @note The results frame is larger than the stash entries, so it is read into its own buffer
+ */
+int Recv_Resolve_Results_For(int sockfd, WIRE_CONTEXT_STRUCT *ctx, RESOLVE_RESULT_STRUCT **results, uint32_t *iResultCount)
+{
+    *results = NULL;
+    *iResultCount = 0;
+    if (ctx->iVersion != WIRE_VERSION_2)
+        return -1;
+
+    while (1)
+    {
+        WIRE_HEADER_STRUCT header;
+        char *payload;
+        int iRecvStatus = Recv_Frame_Alloc(sockfd, 0, &header, &payload, WIRE_MAX_BATCH_RESULTS_PAYLOAD);
+        if (iRecvStatus <= 0)
+            return iRecvStatus;
+
+        if (header.iFrameType == FRAME_RESOLVE_RESULTS && header.iRequestID == ctx->iRequestID)
+        {
+            int iDecodeStatus = Wire_Decode_Resolve_Results(&header, payload, ctx, results, iResultCount);
+            free(payload);
+            return (iDecodeStatus < 0) ? -1 : iRecvStatus;
+        }
+
+        if (header.iPayloadLength <= sizeof(uint64_t) + MAX_BUFFER_SIZE)
+        {
+            LOG_INFO("[+]Recv_Resolve_Results_For: Parked reply (type %d) to request %u while waiting for request %u", header.iFrameType, header.iRequestID, ctx->iRequestID);
+            StashFrame(&header, payload);
+        }
+        else
+            LOG_ERROR("[-]Recv_Resolve_Results_For: Dropped oversized reply (type %d) to request %u", header.iFrameType, header.iRequestID);
+        free(payload);
+    }
+}
@@ -72,4 +72,18 @@ char* ErrorMsg(char* msg, int ErrorCode)
     
     snprintf(ErrorMsg, ERROR_MSG_LEN, RED"ERROR: %d-%s"reset, ErrorCode, msg);
     return ErrorMsg;
-}
\ No newline at end of file
+}
+/**
+ * @brief Returns the name of a command code (e.g. "READ" for CMD_READ).
+ * @param iOperation The command code.
+ * @return The name of the command, "UNKNOWN" for unknown codes.
+ * @note Used to name the spans of traced requests.
+*/
+const char* CommandName(int iOperation)
+{
+    static const char* Names[] = {"UNKNOWN", "READ", "WRITE", "CREATE", "DELETE", "INFO", "LIST",
+                                  "MOVE", "COPY", "RENAME", "CLOSE", "RESOLVE_BATCH"};
+    if (iOperation < 0 || iOperation >= (int)(sizeof(Names) / sizeof(Names[0])))
+        return Names[0];
+    return Names[iOperation];
+}
@@ -29,11 +29,13 @@
 #define CMD_COPY 8
 #define CMD_RENAME 9
 #define CLOSE_CONNECTION 10
+#define CMD_RESOLVE_BATCH 11  // v2 only, carries many paths (see Wire.h)
 
 // Response Flags
 #define RESPONSE_FLAG_SUCCESS 0
 #define RESPONSE_FLAG_FAILURE -1
 #define BACKUP_RESPONSE 1
+#define RESPONSE_FLAG_MORE 2 // LIST page with more to come, the data starts with the cursor of the next page
 
 // Request Flags
 #define REQUEST_FLAG_SUCCESS -1
@@ -122,6 +124,7 @@ typedef struct PATH_INFO_STRUCT
 int CheckError(int iStatus, char *sErrorMsg);
 int CheckNull(void *ptr, char *sErrorMsg);
 char* ErrorMsg(char* msg, int ErrorCode);
+const char* CommandName(int iOperation);
 
 
 
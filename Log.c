@@ -0,0 +1,991 @@
+#include "./Log.h"
+#include "./colour.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <time.h>
+
+int iLogLevel = LOG_LEVEL_INFO;
+
+static LOG_CONFIG_STRUCT LogConfig;
+static FILE *LogStream = NULL;
+static FILE *TraceStream = NULL;
+static atomic_int iLogInitialized = 0;
+static atomic_int iWriterRunning = 0;
+static pthread_t WriterThread;
+static pthread_key_t RingKey;
+static _Atomic(LOG_RING_STRUCT *) RingList = NULL;
+static atomic_uint iNextThreadID = 1;
+static __thread LOG_RING_STRUCT *ThreadRing = NULL;
+
+static struct timespec BootTime;
+static _Atomic uint64_t iNowNs = 0;
+
+static const char *LevelColour[] = {RED, YEL, GRN, BLU};
+
+// Ids given to the formats and string arguments of a binary log (writer thread only)
+typedef struct LOG_EVENT_ID_STRUCT
+{
+    const char *sFormat; // NULL for an empty slot
+    uint32_t iID;
+} LOG_EVENT_ID_STRUCT;
+
+typedef struct LOG_STRING_ID_STRUCT
+{
+    char *sText; // NULL for an empty slot
+    uint32_t iLength;
+    uint32_t iID;
+    uint64_t iHash;
+} LOG_STRING_ID_STRUCT;
+
+static LOG_EVENT_ID_STRUCT *EventIDs = NULL;
+static size_t iEventCount = 0, iEventCapacity = 0;
+static LOG_STRING_ID_STRUCT *StringIDs = NULL;
+static size_t iStringCount = 0, iStringCapacity = 0;
+
+// Refreshes the cached clock (writer thread only)
+static void Update_Clock()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t ns = (uint64_t)(now.tv_sec - BootTime.tv_sec) * 1000000000ULL + now.tv_nsec - BootTime.tv_nsec;
+    atomic_store_explicit(&iNowNs, ns, memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the cached time
+ * @return: Seconds since Log_Init, refreshed every LOG_WRITER_TICK_US by the writer thread
+*/
+double Log_Clock()
+{
+    return atomic_load_explicit(&iNowNs, memory_order_relaxed) * 1e-9;
+}
+
+int Log_Console_Enabled()
+{
+    return LogConfig.iConsole;
+}
+
+/**
+ * @brief Writes a LEB128 varint
+ * @return: The number of bytes written (at most 10)
+*/
+size_t Log_Put_Varint(uint8_t *buffer, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80)
+    {
+        buffer[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[n++] = (uint8_t)value;
+    return n;
+}
+
+/**
+ * @brief Reads a LEB128 varint
+ * @return: The byte after the varint, NULL if it does not end before end
+*/
+const uint8_t *Log_Get_Varint(const uint8_t *buffer, const uint8_t *end, uint64_t *value)
+{
+    *value = 0;
+    for (int iShift = 0; buffer < end && iShift < 64; iShift += 7)
+    {
+        uint8_t byte = *buffer++;
+        *value |= (uint64_t)(byte & 0x7F) << iShift;
+        if (!(byte & 0x80))
+            return buffer;
+    }
+    return NULL;
+}
+
+static uint64_t ZigZag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t UnZigZag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/**
+ * @brief Finds the next conversion of a printf format
+ * @param sFormat: The format
+ * @param spec: Filled with the position, class and argument size of the conversion
+ * @return: The text after the conversion, NULL if there is none left
+ * @note: Unsupported conversions (%n) are classed LOG_ARG_NONE and take no argument
+*/
+const char *Log_Next_Spec(const char *sFormat, LOG_FORMAT_SPEC_STRUCT *spec)
+{
+    const char *p = strchr(sFormat, '%');
+    if (p == NULL)
+        return NULL;
+    spec->sStart = p++;
+    spec->iStars = 0;
+    spec->iClass = LOG_ARG_NONE;
+    spec->iSize = 4;
+
+    if (*p == '%')
+    {
+        spec->iLength = 2;
+        return p + 1;
+    }
+
+    // Flags, width and precision
+    while (*p != '\0' && strchr("-+ #0'", *p) != NULL)
+        p++;
+    if (*p == '*')
+    {
+        spec->iStars++;
+        p++;
+    }
+    while (isdigit((unsigned char)*p))
+        p++;
+    if (*p == '.')
+    {
+        p++;
+        if (*p == '*')
+        {
+            spec->iStars++;
+            p++;
+        }
+        while (isdigit((unsigned char)*p))
+            p++;
+    }
+
+    // Length modifiers
+    int iLong = 0, iLongDouble = 0;
+    while (*p != '\0' && strchr("hlLqjzt", *p) != NULL)
+    {
+        if (*p == 'L')
+            iLongDouble = 1;
+        else if (*p != 'h')
+            iLong = 1;
+        p++;
+    }
+    if (*p == '\0')
+        return NULL;
+
+    switch (*p)
+    {
+    case 'd':
+    case 'i':
+    case 'c':
+        spec->iClass = LOG_ARG_SIGNED;
+        spec->iSize = iLong && *p != 'c' ? 8 : 4;
+        break;
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        spec->iClass = LOG_ARG_UNSIGNED;
+        spec->iSize = iLong ? 8 : 4;
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        spec->iClass = LOG_ARG_DOUBLE;
+        spec->iSize = iLongDouble ? 16 : 8;
+        break;
+    case 's':
+        spec->iClass = LOG_ARG_STRING;
+        spec->iSize = 8;
+        break;
+    case 'p':
+        spec->iClass = LOG_ARG_POINTER;
+        spec->iSize = 8;
+        break;
+    }
+    spec->iLength = (int)(p + 1 - spec->sStart);
+    return p + 1;
+}
+
+// Encodes the arguments of a format as stored in a ring, returns their length
+static size_t Encode_Args(const char *sFormat, va_list args, uint8_t *buffer, size_t iSize)
+{
+    size_t n = 0;
+    LOG_FORMAT_SPEC_STRUCT spec;
+    const char *p = sFormat;
+    while ((p = Log_Next_Spec(p, &spec)) != NULL)
+    {
+        if (spec.iClass == LOG_ARG_NONE)
+            continue;
+        // Room for the stars and a number, arguments that do not fit are left out (rendered as is)
+        if (n + 11 * (spec.iStars + 1) > iSize)
+            break;
+        for (int i = 0; i < spec.iStars; i++)
+            n += Log_Put_Varint(buffer + n, ZigZag(va_arg(args, int)));
+
+        switch (spec.iClass)
+        {
+        case LOG_ARG_SIGNED:
+            n += Log_Put_Varint(buffer + n, ZigZag(spec.iSize == 8 ? va_arg(args, long long) : va_arg(args, int)));
+            break;
+        case LOG_ARG_UNSIGNED:
+            n += Log_Put_Varint(buffer + n, spec.iSize == 8 ? va_arg(args, unsigned long long) : va_arg(args, unsigned int));
+            break;
+        case LOG_ARG_DOUBLE:
+        {
+            double value = spec.iSize == 16 ? (double)va_arg(args, long double) : va_arg(args, double);
+            memcpy(buffer + n, &value, sizeof(double));
+            n += sizeof(double);
+            break;
+        }
+        case LOG_ARG_STRING:
+        {
+            const char *sText = va_arg(args, const char *);
+            if (sText == NULL)
+                sText = "(null)";
+            size_t iLength = strnlen(sText, iSize - n - 10);
+            n += Log_Put_Varint(buffer + n, iLength);
+            memcpy(buffer + n, sText, iLength);
+            n += iLength;
+            break;
+        }
+        case LOG_ARG_POINTER:
+            n += Log_Put_Varint(buffer + n, (uintptr_t)va_arg(args, void *));
+            break;
+        }
+    }
+    return n;
+}
+
+// Appends len bytes to a bounded output
+static void Append(char *sOut, size_t iOutSize, size_t *n, const char *sText, size_t iLength)
+{
+    if (*n + iLength >= iOutSize)
+        iLength = iOutSize - 1 - *n;
+    memcpy(sOut + *n, sText, iLength);
+    *n += iLength;
+}
+
+/**
+ * @brief Renders a format with the arguments of a binary record
+ * @param sFormat: The format of the event
+ * @param args: The arguments, encoded as in a ring (strings inline)
+ * @param iLength: Length of the arguments
+ * @param sOut: Filled with the message (always terminated, truncated to iOutSize)
+ * @return: The length of the message, -1 if the arguments are malformed
+ * @note: Conversions without an argument left are copied as is
+*/
+int Log_Render(const char *sFormat, const uint8_t *args, size_t iLength, char *sOut, size_t iOutSize)
+{
+    const uint8_t *end = args + iLength;
+    size_t n = 0;
+    LOG_FORMAT_SPEC_STRUCT spec;
+    const char *p = sFormat, *next;
+    while ((next = Log_Next_Spec(p, &spec)) != NULL)
+    {
+        Append(sOut, iOutSize, &n, p, spec.sStart - p);
+        p = next;
+        if (spec.iClass == LOG_ARG_NONE || args == end)
+        {
+            if (spec.iLength == 2 && spec.sStart[1] == '%')
+                Append(sOut, iOutSize, &n, "%", 1);
+            else
+                Append(sOut, iOutSize, &n, spec.sStart, spec.iLength);
+            continue;
+        }
+
+        // Rebuild the conversion with the star values and a 64 bit length modifier
+        char sConv[64];
+        size_t c = 0;
+        uint64_t value;
+        char cConv = spec.sStart[spec.iLength - 1];
+        for (const char *q = spec.sStart; q < spec.sStart + spec.iLength - 1 && c < 40; q++)
+        {
+            if (*q == '*')
+            {
+                if ((args = Log_Get_Varint(args, end, &value)) == NULL)
+                    return -1;
+                c += snprintf(sConv + c, sizeof(sConv) - c, "%d", (int)UnZigZag(value));
+            }
+            else if (strchr("hlLqjzt", *q) == NULL)
+            {
+                sConv[c++] = *q;
+            }
+        }
+        if ((spec.iClass == LOG_ARG_SIGNED && cConv != 'c') || spec.iClass == LOG_ARG_UNSIGNED)
+        {
+            sConv[c++] = 'l';
+            sConv[c++] = 'l';
+        }
+        sConv[c++] = cConv;
+        sConv[c] = '\0';
+
+        char sValue[LOG_MAX_MESSAGE + 1];
+        int iWritten = 0;
+        switch (spec.iClass)
+        {
+        case LOG_ARG_SIGNED:
+            if ((args = Log_Get_Varint(args, end, &value)) == NULL)
+                return -1;
+            if (cConv == 'c')
+                iWritten = snprintf(sValue, sizeof(sValue), sConv, (int)UnZigZag(value));
+            else
+                iWritten = snprintf(sValue, sizeof(sValue), sConv, (long long)UnZigZag(value));
+            break;
+        case LOG_ARG_UNSIGNED:
+            if ((args = Log_Get_Varint(args, end, &value)) == NULL)
+                return -1;
+            iWritten = snprintf(sValue, sizeof(sValue), sConv, (unsigned long long)value);
+            break;
+        case LOG_ARG_DOUBLE:
+        {
+            double fValue;
+            if (end - args < (long)sizeof(double))
+                return -1;
+            memcpy(&fValue, args, sizeof(double));
+            args += sizeof(double);
+            iWritten = snprintf(sValue, sizeof(sValue), sConv, fValue);
+            break;
+        }
+        case LOG_ARG_STRING:
+        {
+            char sText[LOG_MAX_MESSAGE + 1];
+            if ((args = Log_Get_Varint(args, end, &value)) == NULL || value > (uint64_t)(end - args) || value > LOG_MAX_MESSAGE)
+                return -1;
+            memcpy(sText, args, value);
+            sText[value] = '\0';
+            args += value;
+            iWritten = snprintf(sValue, sizeof(sValue), sConv, sText);
+            break;
+        }
+        case LOG_ARG_POINTER:
+            if ((args = Log_Get_Varint(args, end, &value)) == NULL)
+                return -1;
+            iWritten = snprintf(sValue, sizeof(sValue), sConv, (void *)(uintptr_t)value);
+            break;
+        }
+        if (iWritten > 0)
+            Append(sOut, iOutSize, &n, sValue, (size_t)iWritten < sizeof(sValue) ? (size_t)iWritten : sizeof(sValue) - 1);
+    }
+    Append(sOut, iOutSize, &n, p, strlen(p));
+    sOut[n] = '\0';
+    return (int)n;
+}
+
+// Marks the ring of an exiting thread, the writer frees it once drained
+static void Release_Ring(void *ring)
+{
+    atomic_store_explicit(&((LOG_RING_STRUCT *)ring)->iClosed, 1, memory_order_release);
+}
+
+// Returns the ring of the calling thread, allocated and registered on first use
+static LOG_RING_STRUCT *Get_Ring()
+{
+    if (ThreadRing != NULL)
+        return ThreadRing;
+
+    LOG_RING_STRUCT *ring = (LOG_RING_STRUCT *)aligned_alloc(64, sizeof(LOG_RING_STRUCT));
+    if (ring == NULL)
+        return NULL;
+    memset(ring, 0, sizeof(LOG_RING_STRUCT));
+    ring->iThreadID = atomic_fetch_add(&iNextThreadID, 1);
+
+    // Rings are only ever added at the head, the writer is the only one removing them
+    ring->next = atomic_load(&RingList);
+    while (!atomic_compare_exchange_weak(&RingList, &ring->next, ring))
+        ;
+    pthread_setspecific(RingKey, ring);
+    ThreadRing = ring;
+    return ring;
+}
+
+// Copies len bytes to the ring at the given position (wraps around)
+static void Ring_Copy_In(LOG_RING_STRUCT *ring, uint64_t pos, const void *src, size_t len)
+{
+    size_t offset = pos & (LOG_RING_SIZE - 1);
+    size_t first = len < LOG_RING_SIZE - offset ? len : LOG_RING_SIZE - offset;
+    memcpy(ring->data + offset, src, first);
+    memcpy(ring->data, (const char *)src + first, len - first);
+}
+
+// Copies len bytes out of the ring from the given position (wraps around)
+static void Ring_Copy_Out(LOG_RING_STRUCT *ring, uint64_t pos, void *dst, size_t len)
+{
+    size_t offset = pos & (LOG_RING_SIZE - 1);
+    size_t first = len < LOG_RING_SIZE - offset ? len : LOG_RING_SIZE - offset;
+    memcpy(dst, ring->data + offset, first);
+    memcpy((char *)dst + first, ring->data, len - first);
+}
+
+// Writes len bytes of the ring from the given position to a stream (wraps around)
+static void Ring_Write_Out(LOG_RING_STRUCT *ring, uint64_t pos, size_t len, FILE *stream)
+{
+    size_t offset = pos & (LOG_RING_SIZE - 1);
+    size_t first = len < LOG_RING_SIZE - offset ? len : LOG_RING_SIZE - offset;
+    fwrite(ring->data + offset, 1, first, stream);
+    fwrite(ring->data, 1, len - first, stream);
+}
+
+// Appends a record to the ring of the calling thread, drops it if the ring is full
+static void Ring_Push(LOG_RING_STRUCT *ring, int iLevel, int iKind, const char *sFormat, const void *data, size_t iLength)
+{
+    uint64_t head = atomic_load_explicit(&ring->iHead, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->iTail, memory_order_acquire);
+    size_t iNeeded = sizeof(LOG_RECORD_STRUCT) + iLength;
+    if (LOG_RING_SIZE - (head - tail) < iNeeded)
+    {
+        atomic_fetch_add_explicit(&ring->iDropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    LOG_RECORD_STRUCT record = {(uint32_t)iLength, (uint16_t)iLevel, (uint16_t)iKind, Log_Clock(), sFormat};
+    Ring_Copy_In(ring, head, &record, sizeof(record));
+    Ring_Copy_In(ring, head + sizeof(record), data, iLength);
+    atomic_store_explicit(&ring->iHead, head + iNeeded, memory_order_release);
+}
+
+/**
+ * @brief Queues a record in the ring of the calling thread
+ * @param iLevel: The level of the record
+ * @param sFormat: printf style format of the message (a trailing newline is optional)
+ * @note: Never blocks: the record is dropped if the ring is full, or skipped by sampling.
+ *        In binary mode the format must outlive the logger (a string literal): only its address is queued.
+*/
+void Log_Write(int iLevel, const char *sFormat, ...)
+{
+    if (!atomic_load_explicit(&iLogInitialized, memory_order_relaxed))
+        return;
+    LOG_RING_STRUCT *ring = Get_Ring();
+    if (ring == NULL)
+        return;
+    if (iLevel >= LOG_LEVEL_INFO && LogConfig.iSampleRate > 1 && (ring->iSampleCount++ % LogConfig.iSampleRate) != 0)
+        return;
+
+    va_list args;
+    va_start(args, sFormat);
+    if (LogConfig.iBinary)
+    {
+        uint8_t data[LOG_MAX_MESSAGE];
+        size_t iLength = Encode_Args(sFormat, args, data, sizeof(data));
+        va_end(args);
+        Ring_Push(ring, iLevel, LOG_RECORD_TEXT, sFormat, data, iLength);
+        return;
+    }
+
+    char sMessage[LOG_MAX_MESSAGE];
+    int iLength = vsnprintf(sMessage, sizeof(sMessage), sFormat, args);
+    va_end(args);
+    if (iLength < 0)
+        return;
+    if (iLength >= LOG_MAX_MESSAGE)
+        iLength = LOG_MAX_MESSAGE - 1;
+    while (iLength > 0 && sMessage[iLength - 1] == '\n')
+        iLength--;
+
+    Ring_Push(ring, iLevel, LOG_RECORD_TEXT, NULL, sMessage, iLength);
+}
+
+/**
+ * @brief Queues text that is written to the log file as is
+ * @param sText: The text (may span many lines)
+ * @note: Long text is split in LOG_MAX_MESSAGE chunks, it is never echoed to the console
+*/
+void Log_Raw(const char *sText)
+{
+    if (!atomic_load_explicit(&iLogInitialized, memory_order_relaxed))
+        return;
+    LOG_RING_STRUCT *ring = Get_Ring();
+    if (ring == NULL)
+        return;
+
+    size_t iLength = strlen(sText);
+    while (iLength > 0)
+    {
+        size_t iChunk = iLength < LOG_MAX_MESSAGE ? iLength : LOG_MAX_MESSAGE;
+        Ring_Push(ring, LOG_LEVEL_INFO, LOG_RECORD_RAW, NULL, sText, iChunk);
+        sText += iChunk;
+        iLength -= iChunk;
+    }
+}
+
+/**
+ * @brief Queues a trace event, written to the trace file as is
+ * @param sEvent: The event (a complete line)
+ * @param iLength: Length of the event (at most LOG_MAX_MESSAGE)
+ * @note: Dropped if the trace file is not open or the ring is full (never sampled)
+*/
+void Log_Trace_Event(const char *sEvent, size_t iLength)
+{
+    if (!atomic_load_explicit(&iLogInitialized, memory_order_relaxed) || TraceStream == NULL || iLength > LOG_MAX_MESSAGE)
+        return;
+    LOG_RING_STRUCT *ring = Get_Ring();
+    if (ring == NULL)
+        return;
+    Ring_Push(ring, LOG_LEVEL_INFO, LOG_RECORD_TRACE, NULL, sEvent, iLength);
+}
+
+int Log_Trace_Enabled()
+{
+    return TraceStream != NULL;
+}
+
+static uint64_t HashBytes(const uint8_t *data, size_t iLength)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < iLength; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Doubles a table of ids (writer thread only), returns -1 on failure
+static int Grow_Table(void **table, size_t *iCapacity, size_t iEntrySize, uint64_t (*hash)(const void *), int (*used)(const void *))
+{
+    size_t iNewCapacity = *iCapacity ? *iCapacity * 2 : 256;
+    char *newTable = (char *)calloc(iNewCapacity, iEntrySize);
+    if (newTable == NULL)
+        return -1;
+    for (size_t i = 0; i < *iCapacity; i++)
+    {
+        const char *entry = (const char *)*table + i * iEntrySize;
+        if (!used(entry))
+            continue;
+        size_t slot = hash(entry) & (iNewCapacity - 1);
+        while (used(newTable + slot * iEntrySize))
+            slot = (slot + 1) & (iNewCapacity - 1);
+        memcpy(newTable + slot * iEntrySize, entry, iEntrySize);
+    }
+    free(*table);
+    *table = newTable;
+    *iCapacity = iNewCapacity;
+    return 0;
+}
+
+static uint64_t HashEvent(const void *entry)
+{
+    uintptr_t key = (uintptr_t)((const LOG_EVENT_ID_STRUCT *)entry)->sFormat;
+    return HashBytes((const uint8_t *)&key, sizeof(key));
+}
+
+static int UsedEvent(const void *entry)
+{
+    return ((const LOG_EVENT_ID_STRUCT *)entry)->sFormat != NULL;
+}
+
+static uint64_t HashString(const void *entry)
+{
+    return ((const LOG_STRING_ID_STRUCT *)entry)->iHash;
+}
+
+static int UsedString(const void *entry)
+{
+    return ((const LOG_STRING_ID_STRUCT *)entry)->sText != NULL;
+}
+
+// Returns the id of an event, defining it in the log the first time (writer thread only)
+static uint32_t Event_ID(const char *sFormat, int iLevel)
+{
+    if (2 * (iEventCount + 1) > iEventCapacity &&
+        Grow_Table((void **)&EventIDs, &iEventCapacity, sizeof(LOG_EVENT_ID_STRUCT), HashEvent, UsedEvent) < 0)
+        return 0;
+
+    LOG_EVENT_ID_STRUCT key = {sFormat, 0};
+    size_t slot = HashEvent(&key) & (iEventCapacity - 1);
+    while (EventIDs[slot].sFormat != NULL)
+    {
+        if (EventIDs[slot].sFormat == sFormat)
+            return EventIDs[slot].iID;
+        slot = (slot + 1) & (iEventCapacity - 1);
+    }
+    EventIDs[slot].sFormat = sFormat;
+    EventIDs[slot].iID = (uint32_t)++iEventCount;
+
+    uint8_t header[32];
+    size_t iFormatLength = strlen(sFormat);
+    size_t n = 0;
+    header[n++] = LOG_BIN_EVENT_DEF;
+    n += Log_Put_Varint(header + n, EventIDs[slot].iID);
+    header[n++] = (uint8_t)iLevel;
+    n += Log_Put_Varint(header + n, iFormatLength);
+    fwrite(header, 1, n, LogStream);
+    fwrite(sFormat, 1, iFormatLength, LogStream);
+    return EventIDs[slot].iID;
+}
+
+// Returns the id of a string argument, defining it in the log the first time, 0 once the table is full (writer thread only)
+static uint32_t String_ID(const uint8_t *sText, size_t iLength)
+{
+    uint64_t hash = HashBytes(sText, iLength);
+    if (iStringCapacity > 0)
+    {
+        size_t slot = hash & (iStringCapacity - 1);
+        while (StringIDs[slot].sText != NULL)
+        {
+            if (StringIDs[slot].iHash == hash && StringIDs[slot].iLength == iLength && memcmp(StringIDs[slot].sText, sText, iLength) == 0)
+                return StringIDs[slot].iID;
+            slot = (slot + 1) & (iStringCapacity - 1);
+        }
+    }
+    if (iStringCount >= LOG_MAX_INTERNED_STRINGS)
+        return 0;
+    if (2 * (iStringCount + 1) > iStringCapacity &&
+        Grow_Table((void **)&StringIDs, &iStringCapacity, sizeof(LOG_STRING_ID_STRUCT), HashString, UsedString) < 0)
+        return 0;
+
+    char *sCopy = (char *)malloc(iLength + 1);
+    if (sCopy == NULL)
+        return 0;
+    memcpy(sCopy, sText, iLength);
+    size_t slot = hash & (iStringCapacity - 1);
+    while (StringIDs[slot].sText != NULL)
+        slot = (slot + 1) & (iStringCapacity - 1);
+    StringIDs[slot] = (LOG_STRING_ID_STRUCT){sCopy, (uint32_t)iLength, (uint32_t)++iStringCount, hash};
+
+    uint8_t header[32];
+    size_t n = 0;
+    header[n++] = LOG_BIN_STRING_DEF;
+    n += Log_Put_Varint(header + n, StringIDs[slot].iID);
+    n += Log_Put_Varint(header + n, iLength);
+    fwrite(header, 1, n, LogStream);
+    fwrite(sText, 1, iLength, LogStream);
+    return StringIDs[slot].iID;
+}
+
+// Writes a binary record (writer thread only)
+static void Write_Binary_Record(LOG_RING_STRUCT *ring, LOG_RECORD_STRUCT *record, const uint8_t *data)
+{
+    uint8_t header[64];
+    uint8_t out[2 * LOG_MAX_MESSAGE];
+    size_t n = 0;
+    if (record->iKind == LOG_RECORD_RAW)
+    {
+        header[n++] = LOG_BIN_RAW;
+        n += Log_Put_Varint(header + n, record->iLength);
+        fwrite(header, 1, n, LogStream);
+        fwrite(data, 1, record->iLength, LogStream);
+        return;
+    }
+
+    uint32_t iEventID = Event_ID(record->sFormat, record->iLevel);
+    if (iEventID == 0)
+        return;
+
+    // Same arguments, strings replaced by their id
+    const uint8_t *args = data, *end = data + record->iLength;
+    LOG_FORMAT_SPEC_STRUCT spec;
+    const char *p = record->sFormat;
+    uint64_t value;
+    while (args < end && (p = Log_Next_Spec(p, &spec)) != NULL)
+    {
+        if (spec.iClass == LOG_ARG_NONE)
+            continue;
+        for (int i = 0; i < spec.iStars && args != NULL; i++)
+        {
+            if ((args = Log_Get_Varint(args, end, &value)) != NULL)
+                n += Log_Put_Varint(out + n, value);
+        }
+        if (args == NULL)
+            break;
+
+        if (spec.iClass == LOG_ARG_DOUBLE)
+        {
+            memcpy(out + n, args, sizeof(double));
+            n += sizeof(double);
+            args += sizeof(double);
+        }
+        else if (spec.iClass == LOG_ARG_STRING)
+        {
+            if ((args = Log_Get_Varint(args, end, &value)) == NULL)
+                break;
+            uint32_t iStringID = String_ID(args, value);
+            n += Log_Put_Varint(out + n, iStringID);
+            if (iStringID == 0)
+            {
+                n += Log_Put_Varint(out + n, value);
+                memcpy(out + n, args, value);
+                n += value;
+            }
+            args += value;
+        }
+        else
+        {
+            if ((args = Log_Get_Varint(args, end, &value)) == NULL)
+                break;
+            n += Log_Put_Varint(out + n, value);
+        }
+    }
+
+    size_t h = 0;
+    header[h++] = LOG_BIN_EVENT;
+    h += Log_Put_Varint(header + h, iEventID);
+    h += Log_Put_Varint(header + h, ring->iThreadID);
+    h += Log_Put_Varint(header + h, (uint64_t)(record->fTime * 1e6));
+    h += Log_Put_Varint(header + h, n);
+    fwrite(header, 1, h, LogStream);
+    fwrite(out, 1, n, LogStream);
+}
+
+// Writes out the records of a ring (writer thread only), returns the number of records
+static int Drain_Ring(LOG_RING_STRUCT *ring)
+{
+    uint64_t tail = atomic_load_explicit(&ring->iTail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->iHead, memory_order_acquire);
+    int iCount = 0;
+
+    while (tail != head)
+    {
+        LOG_RECORD_STRUCT record;
+        Ring_Copy_Out(ring, tail, &record, sizeof(record));
+        uint64_t text = tail + sizeof(record);
+
+        if (record.iKind == LOG_RECORD_TRACE)
+        {
+            Ring_Write_Out(ring, text, record.iLength, TraceStream);
+        }
+        else if (LogConfig.iBinary)
+        {
+            uint8_t data[LOG_MAX_MESSAGE];
+            Ring_Copy_Out(ring, text, data, record.iLength);
+            Write_Binary_Record(ring, &record, data);
+            if (LogConfig.iConsole && record.iKind == LOG_RECORD_TEXT)
+            {
+                char sMessage[LOG_MAX_MESSAGE];
+                if (Log_Render(record.sFormat, data, record.iLength, sMessage, sizeof(sMessage)) >= 0)
+                    fprintf(stdout, "%s%s" reset "\n", LevelColour[record.iLevel], sMessage);
+            }
+        }
+        else
+        {
+            Ring_Write_Out(ring, text, record.iLength, LogStream);
+            if (record.iKind == LOG_RECORD_TEXT)
+            {
+                fprintf(LogStream, " [Time Stamp: %f]\n", record.fTime);
+                if (LogConfig.iConsole)
+                {
+                    fputs(LevelColour[record.iLevel], stdout);
+                    Ring_Write_Out(ring, text, record.iLength, stdout);
+                    fputs(reset "\n", stdout);
+                }
+            }
+        }
+
+        tail = text + record.iLength;
+        iCount++;
+    }
+    atomic_store_explicit(&ring->iTail, tail, memory_order_release);
+
+    unsigned long iDropped = atomic_exchange_explicit(&ring->iDropped, 0, memory_order_relaxed);
+    if (iDropped > 0 && LogConfig.iBinary)
+    {
+        uint8_t out[32];
+        size_t n = 0;
+        out[n++] = LOG_BIN_DROPPED;
+        n += Log_Put_Varint(out + n, ring->iThreadID);
+        n += Log_Put_Varint(out + n, (uint64_t)(Log_Clock() * 1e6));
+        n += Log_Put_Varint(out + n, iDropped);
+        fwrite(out, 1, n, LogStream);
+    }
+    else if (iDropped > 0)
+    {
+        fprintf(LogStream, "[-]Logger: %lu records dropped (thread log buffer full) [Time Stamp: %f]\n", iDropped, Log_Clock());
+    }
+    return iCount;
+}
+
+// Removes a drained ring of an exited thread from the list (writer thread only)
+static void Unlink_Ring(LOG_RING_STRUCT *ring, LOG_RING_STRUCT *prev)
+{
+    if (prev == NULL)
+    {
+        LOG_RING_STRUCT *expected = ring;
+        if (atomic_compare_exchange_strong(&RingList, &expected, ring->next))
+            return;
+        // A new ring was added in front of it
+        prev = atomic_load(&RingList);
+        while (prev->next != ring)
+            prev = prev->next;
+    }
+    prev->next = ring->next;
+}
+
+// Drains every ring, returns the number of records written
+static int Drain_All()
+{
+    int iCount = 0;
+    LOG_RING_STRUCT *prev = NULL;
+    LOG_RING_STRUCT *ring = atomic_load(&RingList);
+    while (ring != NULL)
+    {
+        // Closed before draining: nothing can be added to the ring after the drain
+        int iClosed = atomic_load_explicit(&ring->iClosed, memory_order_acquire);
+        iCount += Drain_Ring(ring);
+
+        LOG_RING_STRUCT *next = ring->next;
+        if (iClosed)
+        {
+            Unlink_Ring(ring, prev);
+            free(ring);
+        }
+        else
+        {
+            prev = ring;
+        }
+        ring = next;
+    }
+    return iCount;
+}
+
+/**
+ * @brief Thread writing the records of every ring to the log file (and the console)
+ * @note: Sleeps LOG_WRITER_TICK_US when there is nothing to write, streams are flushed whenever it catches up
+*/
+static void *Log_Writer_Thread()
+{
+    struct timespec pause = {0, LOG_WRITER_TICK_US * 1000};
+    while (1)
+    {
+        int iRunning = atomic_load(&iWriterRunning);
+        Update_Clock();
+        if (Drain_All() > 0)
+            continue;
+
+        fflush(LogStream);
+        if (TraceStream != NULL)
+            fflush(TraceStream);
+        if (LogConfig.iConsole)
+            fflush(stdout);
+        if (!iRunning)
+            break;
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Parses a log level
+ * @param sLevel: error, warn, info, debug or the level number
+ * @return: The level, -1 if invalid
+*/
+int Log_Parse_Level(const char *sLevel)
+{
+    static const char *Names[] = {"error", "warn", "info", "debug"};
+    for (int i = LOG_LEVEL_ERROR; i <= LOG_LEVEL_DEBUG; i++)
+    {
+        if (strcmp(sLevel, Names[i]) == 0)
+            return i;
+    }
+    char *end;
+    long iLevel = strtol(sLevel, &end, 10);
+    if (*sLevel == '\0' || *end != '\0' || iLevel < LOG_LEVEL_ERROR || iLevel > LOG_LEVEL_DEBUG)
+        return -1;
+    return (int)iLevel;
+}
+
+/**
+ * @brief Fills a config with the defaults
+ * @param config: The config to fill
+ * @param iConsole: Whether the records are echoed to stdout by default
+ * @note: NFS_LOG_LEVEL, NFS_LOG_SAMPLE, NFS_LOG_CONSOLE, NFS_LOG_FORMAT and NFS_TRACE override the defaults (invalid values are ignored)
+*/
+void Log_Default_Config(LOG_CONFIG_STRUCT *config, int iConsole)
+{
+    config->iLevel = LOG_LEVEL_INFO;
+    config->iSampleRate = 1;
+    config->iConsole = iConsole;
+    config->iBinary = 0;
+    config->iTrace = 0;
+
+    char *sValue = getenv(LOG_ENV_LEVEL);
+    if (sValue != NULL && Log_Parse_Level(sValue) >= 0)
+        config->iLevel = Log_Parse_Level(sValue);
+    sValue = getenv(LOG_ENV_SAMPLE);
+    if (sValue != NULL && atoi(sValue) > 0)
+        config->iSampleRate = atoi(sValue);
+    sValue = getenv(LOG_ENV_CONSOLE);
+    if (sValue != NULL)
+        config->iConsole = atoi(sValue) != 0;
+    sValue = getenv(LOG_ENV_FORMAT);
+    if (sValue != NULL)
+        config->iBinary = strcmp(sValue, "binary") == 0;
+    sValue = getenv(LOG_ENV_TRACE);
+    if (sValue != NULL)
+        config->iTrace = atoi(sValue) != 0;
+}
+
+/**
+ * @brief Opens the log file and starts the writer thread
+ * @param sName: Name of the log file without extension (.log is added, .bin in binary mode), truncated
+ * @param config: Level, sampling, console echo, format and tracing (spans go to sName.trace.json)
+ * @return: 0 on success, -1 on failure
+*/
+int Log_Init(const char *sName, LOG_CONFIG_STRUCT *config)
+{
+    char sPath[LOG_MAX_PATH];
+    snprintf(sPath, sizeof(sPath), "%s%s", sName, config->iBinary ? ".bin" : ".log");
+    LogStream = fopen(sPath, "w");
+    if (LogStream == NULL)
+        return -1;
+    setvbuf(LogStream, NULL, _IOFBF, LOG_RING_SIZE);
+    if (config->iBinary)
+        fwrite(LOG_BINARY_MAGIC, 1, LOG_BINARY_MAGIC_LEN, LogStream);
+
+    // A Chrome trace in the JSON array format: "[" then one event per line (the closing "]" is optional)
+    if (config->iTrace)
+    {
+        snprintf(sPath, sizeof(sPath), "%s.trace.json", sName);
+        TraceStream = fopen(sPath, "w");
+        if (TraceStream == NULL)
+        {
+            fclose(LogStream);
+            return -1;
+        }
+        fputs("[\n", TraceStream);
+    }
+
+    LogConfig = *config;
+    if (LogConfig.iSampleRate < 1)
+        LogConfig.iSampleRate = 1;
+    iLogLevel = LogConfig.iLevel;
+
+    clock_gettime(CLOCK_MONOTONIC, &BootTime);
+    Update_Clock();
+    if (pthread_key_create(&RingKey, Release_Ring) != 0)
+    {
+        fclose(LogStream);
+        return -1;
+    }
+
+    atomic_store(&iWriterRunning, 1);
+    if (pthread_create(&WriterThread, NULL, Log_Writer_Thread, NULL) != 0)
+    {
+        fclose(LogStream);
+        return -1;
+    }
+    atomic_store(&iLogInitialized, 1);
+    return 0;
+}
+
+/**
+ * @brief Writes out the buffered records and stops the writer thread
+ * @note: Records queued afterwards are discarded
+*/
+void Log_Shutdown()
+{
+    if (!atomic_exchange(&iLogInitialized, 0))
+        return;
+    atomic_store(&iWriterRunning, 0);
+    pthread_join(WriterThread, NULL);
+    fclose(LogStream);
+    if (TraceStream != NULL)
+        fclose(TraceStream);
+
+    for (size_t i = 0; i < iStringCapacity; i++)
+        free(StringIDs[i].sText);
+    free(StringIDs);
+    free(EventIDs);
+}
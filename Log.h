@@ -0,0 +1,150 @@
+// Asynchronous logging shared by the Naming Server, the Storage Server and the Client
+
+#ifndef _LOG_H_
+#define _LOG_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Log levels (a record is kept if its level is at most the configured one)
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+
+#define LOG_RING_SIZE (64 * 1024)   // Bytes buffered per thread (power of 2)
+#define LOG_MAX_MESSAGE 2048        // Longest message, longer ones are truncated
+#define LOG_WRITER_TICK_US 1000     // Microseconds the writer sleeps when every ring is empty (clock resolution)
+#define LOG_ENV_LEVEL "NFS_LOG_LEVEL"      // error|warn|info|debug
+#define LOG_ENV_SAMPLE "NFS_LOG_SAMPLE"    // keep 1 in N info and debug records
+#define LOG_ENV_CONSOLE "NFS_LOG_CONSOLE"  // 0|1, echo the records to stdout
+#define LOG_ENV_FORMAT "NFS_LOG_FORMAT"    // text|binary
+#define LOG_ENV_TRACE "NFS_TRACE"          // 0|1, write the spans of traced requests (see Trace.h)
+#define LOG_MAX_INTERNED_STRINGS 65536     // Distinct string arguments given an id in a binary log
+#define LOG_MAX_PATH 256
+
+// Binary log file: LOG_BINARY_MAGIC followed by records, each starting with its type byte.
+// Numbers are LEB128 varints (signed arguments zigzag encoded), doubles are 8 raw bytes.
+#define LOG_BINARY_MAGIC "NFSLOGB1"
+#define LOG_BINARY_MAGIC_LEN 8
+#define LOG_BIN_EVENT_DEF 1   // id, level, format length, format (sent before the first event using it)
+#define LOG_BIN_STRING_DEF 2  // id, length, bytes (sent before the first argument using it)
+#define LOG_BIN_EVENT 3       // event id, thread id, microseconds since start, arguments length, arguments
+#define LOG_BIN_RAW 4         // length, text
+#define LOG_BIN_DROPPED 5     // thread id, microseconds since start, number of records lost
+
+// Kinds of ring records
+#define LOG_RECORD_TEXT 0     // A message (timestamped, echoed to the console)
+#define LOG_RECORD_RAW 1      // Written to the log file as is
+#define LOG_RECORD_TRACE 2    // A trace event, written to the trace file as is
+
+// Classes of printf arguments
+#define LOG_ARG_NONE 0        // %% (no argument)
+#define LOG_ARG_SIGNED 1
+#define LOG_ARG_UNSIGNED 2
+#define LOG_ARG_DOUBLE 3
+#define LOG_ARG_STRING 4      // in a ring: length and bytes, in a file: string id (0 is followed by length and bytes)
+#define LOG_ARG_POINTER 5
+
+/*
+Request threads never touch the log file or stdout. A record is formatted by the calling thread
+into a ring buffer owned by that thread (single producer, single consumer, no lock), and a
+background writer thread drains every ring into the log file and, when console echo is on, to
+stdout. A full ring drops the record instead of waiting; the writer reports how many were lost.
+Timestamps come from a clock cached by the writer on every pass (LOG_WRITER_TICK_US resolution),
+so logging does not read the system clock either.
+Errors and warnings are always kept, info and debug records can be sampled (1 in iSampleRate per
+thread) to keep busy servers from spending their time on logs.
+In binary mode the calling thread does not format the message at all: the record holds the
+address of the format string and the raw arguments. The writer gives every format (event) and
+every distinct string argument an id the first time it is seen and writes only ids and varints,
+logdecode renders the file back to the text format.
+*/
+
+typedef struct LOG_CONFIG_STRUCT
+{
+    int iLevel;      // Highest level kept
+    int iSampleRate; // 1 in iSampleRate info and debug records is kept
+    int iConsole;    // Echo the records to stdout
+    int iBinary;     // Write structured binary records instead of text
+    int iTrace;      // Open the trace file (sName.trace.json) for the spans of Trace.h
+} LOG_CONFIG_STRUCT;
+
+// A conversion of a printf format
+typedef struct LOG_FORMAT_SPEC_STRUCT
+{
+    const char *sStart; // The '%' of the conversion
+    int iLength;        // Length of the conversion
+    int iStars;         // '*' width and precision arguments taken before the value
+    int iClass;         // LOG_ARG_*
+    int iSize;          // Size of the promoted argument (4 or 8)
+} LOG_FORMAT_SPEC_STRUCT;
+
+// Header of a record in a ring, followed by iLength bytes of text (or encoded arguments)
+typedef struct LOG_RECORD_STRUCT
+{
+    uint32_t iLength;
+    uint16_t iLevel;
+    uint16_t iKind;  // LOG_RECORD_*
+    double fTime;    // Seconds since Log_Init
+    const char *sFormat; // Binary mode: format of the event, the record holds its arguments
+} LOG_RECORD_STRUCT;
+
+// Ring buffer of a thread, iHead is only written by the thread and iTail by the writer
+typedef struct LOG_RING_STRUCT
+{
+    _Atomic uint64_t iHead __attribute__((aligned(64)));
+    _Atomic uint64_t iTail __attribute__((aligned(64)));
+    atomic_int iClosed;              // Set when the thread exits, the writer frees the ring once drained
+    atomic_ulong iDropped;           // Records lost to a full ring
+    unsigned long iSampleCount;      // Sampled records seen by the thread
+    uint32_t iThreadID;              // Thread id of the binary records
+    struct LOG_RING_STRUCT *next;
+    char data[LOG_RING_SIZE];
+} LOG_RING_STRUCT;
+
+extern int iLogLevel;
+
+// Fills the config with the defaults, overridden by the NFS_LOG_* environment variables
+void Log_Default_Config(LOG_CONFIG_STRUCT *config, int iConsole);
+// Parses a level name (error, warn, info, debug) or number, returns -1 if invalid
+int Log_Parse_Level(const char *sLevel);
+// Opens the log file (sName.log, or sName.bin in binary mode) and starts the writer thread
+int Log_Init(const char *sName, LOG_CONFIG_STRUCT *config);
+// Writes out every buffered record, stops the writer and closes the log file
+void Log_Shutdown();
+
+// Queues a record (use the LOG_* macros)
+void Log_Write(int iLevel, const char *sFormat, ...) __attribute__((format(printf, 2, 3)));
+// Queues text written to the log file as is (multi-line dumps)
+void Log_Raw(const char *sText);
+// Queues an event written to the trace file as is
+void Log_Trace_Event(const char *sEvent, size_t iLength);
+int Log_Trace_Enabled();
+// Cached time in seconds since Log_Init
+double Log_Clock();
+int Log_Console_Enabled();
+
+// Binary format helpers (shared with logdecode)
+size_t Log_Put_Varint(uint8_t *buffer, uint64_t value);
+const uint8_t *Log_Get_Varint(const uint8_t *buffer, const uint8_t *end, uint64_t *value);
+// Finds the next conversion of a format, returns the text after it or NULL if there is none
+const char *Log_Next_Spec(const char *sFormat, LOG_FORMAT_SPEC_STRUCT *spec);
+// Renders a format with arguments encoded as in a ring, returns the length or -1 if they are malformed
+int Log_Render(const char *sFormat, const uint8_t *args, size_t iLength, char *sOut, size_t iOutSize);
+
+#define LOG_ENABLED(level) ((level) <= iLogLevel)
+#define LOG_AT(level, ...)                   \
+    do                                       \
+    {                                        \
+        if (LOG_ENABLED(level))              \
+            Log_Write((level), __VA_ARGS__); \
+    } while (0)
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#endif // _LOG_H_
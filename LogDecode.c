@@ -0,0 +1,395 @@
+// logdecode: renders a binary log (NSlog.bin, SSlog.bin, Clientlog.bin) in the text log format
+
+#include "./Log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#define DECODE_NO_FILTER (-1)
+
+// Event defined in the log, with the arguments that hold a client or server id
+typedef struct DECODE_EVENT_STRUCT
+{
+    char *sFormat;
+    int iLevel;
+    int iClientArg; // Index of the client id argument, -1 if none
+    int iServerArg; // Index of the server id argument, -1 if none
+} DECODE_EVENT_STRUCT;
+
+typedef struct DECODE_STRING_STRUCT
+{
+    char *sText;
+    size_t iLength;
+} DECODE_STRING_STRUCT;
+
+typedef struct DECODE_FILTER_STRUCT
+{
+    long long iClientID;
+    long long iServerID;
+    const char *sOperation;
+    int iLevel;
+    int iShowThreads;
+} DECODE_FILTER_STRUCT;
+
+static DECODE_EVENT_STRUCT *Events = NULL;
+static size_t iEventCapacity = 0;
+static DECODE_STRING_STRUCT *Strings = NULL;
+static size_t iStringCapacity = 0;
+
+// Grows a table indexed by id so that it holds the given id, returns -1 on failure
+static int Reserve(void **table, size_t *iCapacity, size_t iEntrySize, uint64_t iID)
+{
+    if (iID < *iCapacity)
+        return 0;
+    size_t iNewCapacity = *iCapacity ? *iCapacity : 256;
+    while (iNewCapacity <= iID)
+        iNewCapacity *= 2;
+    char *newTable = (char *)realloc(*table, iNewCapacity * iEntrySize);
+    if (newTable == NULL)
+        return -1;
+    memset(newTable + *iCapacity * iEntrySize, 0, (iNewCapacity - *iCapacity) * iEntrySize);
+    *table = newTable;
+    *iCapacity = iNewCapacity;
+    return 0;
+}
+
+/**
+ * @brief Checks if a conversion of a format holds a client or server id
+ * @param sFormat: The format
+ * @param spec: The conversion
+ * @param sName: "client" or "server"
+ * @return: 1 if the text before the conversion ends with the name (as in "Client %lu", "server-%lu", "Client ID: %lu")
+*/
+static int IsIDArgument(const char *sFormat, LOG_FORMAT_SPEC_STRUCT *spec, const char *sName)
+{
+    if (spec->iClass != LOG_ARG_UNSIGNED && spec->iClass != LOG_ARG_SIGNED)
+        return 0;
+    const char *p = spec->sStart;
+    while (p > sFormat && strchr(" -:", p[-1]) != NULL)
+        p--;
+    if (p - sFormat >= 2 && tolower((unsigned char)p[-1]) == 'd' && tolower((unsigned char)p[-2]) == 'i')
+    {
+        p -= 2;
+        while (p > sFormat && strchr(" -:", p[-1]) != NULL)
+            p--;
+    }
+    size_t iNameLength = strlen(sName);
+    return (size_t)(p - sFormat) >= iNameLength && strncasecmp(p - iNameLength, sName, iNameLength) == 0;
+}
+
+// Finds the argument indexes holding client and server ids in an event format
+static void Find_ID_Arguments(DECODE_EVENT_STRUCT *event)
+{
+    event->iClientArg = -1;
+    event->iServerArg = -1;
+    LOG_FORMAT_SPEC_STRUCT spec;
+    const char *p = event->sFormat;
+    int iArg = 0;
+    while ((p = Log_Next_Spec(p, &spec)) != NULL)
+    {
+        if (spec.iClass == LOG_ARG_NONE)
+            continue;
+        iArg += spec.iStars;
+        if (event->iClientArg < 0 && IsIDArgument(event->sFormat, &spec, "client"))
+            event->iClientArg = iArg;
+        if (event->iServerArg < 0 && IsIDArgument(event->sFormat, &spec, "server"))
+            event->iServerArg = iArg;
+        iArg++;
+    }
+}
+
+/**
+ * @brief Checks if a message mentions an operation
+ * @return: 1 if a word of the message starts with the operation name (case insensitive)
+*/
+static int MentionsOperation(const char *sMessage, const char *sOperation)
+{
+    size_t iLength = strlen(sOperation);
+    for (const char *p = sMessage; *p != '\0'; p++)
+    {
+        if ((p == sMessage || !isalpha((unsigned char)p[-1])) && strncasecmp(p, sOperation, iLength) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Converts the arguments of an event from the file encoding to the ring encoding
+ * @param event: The event
+ * @param args: The arguments in the file
+ * @param end: End of the arguments
+ * @param out: Filled with the arguments, strings inline
+ * @param iClientID, iServerID: Filled with the client and server ids of the event (-1 if none)
+ * @return: The length of out, -1 if the record is truncated or malformed
+*/
+static long Convert_Args(DECODE_EVENT_STRUCT *event, const uint8_t *args, const uint8_t *end, uint8_t *out, size_t iOutSize,
+                         long long *iClientID, long long *iServerID)
+{
+    const uint8_t *p = args;
+    size_t n = 0;
+    uint64_t value;
+    int iArg = 0;
+    LOG_FORMAT_SPEC_STRUCT spec;
+    const char *sFormat = event->sFormat;
+    *iClientID = -1;
+    *iServerID = -1;
+
+    // Arguments that did not fit in the record were left out by the logger
+    while (p < end && (sFormat = Log_Next_Spec(sFormat, &spec)) != NULL)
+    {
+        if (spec.iClass == LOG_ARG_NONE)
+            continue;
+        if (n + 11 * (spec.iStars + 1) > iOutSize)
+            return -1;
+        for (int i = 0; i < spec.iStars; i++, iArg++)
+        {
+            if ((p = Log_Get_Varint(p, end, &value)) == NULL)
+                return -1;
+            n += Log_Put_Varint(out + n, value);
+        }
+
+        if (spec.iClass == LOG_ARG_DOUBLE)
+        {
+            if (end - p < (long)sizeof(double))
+                return -1;
+            memcpy(out + n, p, sizeof(double));
+            n += sizeof(double);
+            p += sizeof(double);
+        }
+        else if (spec.iClass == LOG_ARG_STRING)
+        {
+            if ((p = Log_Get_Varint(p, end, &value)) == NULL)
+                return -1;
+            const uint8_t *sText;
+            uint64_t iLength;
+            if (value == 0)
+            {
+                if ((p = Log_Get_Varint(p, end, &iLength)) == NULL || iLength > (uint64_t)(end - p))
+                    return -1;
+                sText = p;
+                p += iLength;
+            }
+            else
+            {
+                if (value >= iStringCapacity || Strings[value].sText == NULL)
+                    return -1;
+                sText = (const uint8_t *)Strings[value].sText;
+                iLength = Strings[value].iLength;
+            }
+            if (n + 10 + iLength > iOutSize)
+                return -1;
+            n += Log_Put_Varint(out + n, iLength);
+            memcpy(out + n, sText, iLength);
+            n += iLength;
+        }
+        else
+        {
+            if ((p = Log_Get_Varint(p, end, &value)) == NULL)
+                return -1;
+            n += Log_Put_Varint(out + n, value);
+            // Signed ids are zigzag encoded, but ids are never negative
+            long long iID = spec.iClass == LOG_ARG_SIGNED ? (long long)(value >> 1) : (long long)value;
+            if (iArg == event->iClientArg)
+                *iClientID = iID;
+            if (iArg == event->iServerArg)
+                *iServerID = iID;
+        }
+        iArg++;
+    }
+    return (long)n;
+}
+
+/**
+ * @brief Decodes a binary log and prints the records that pass the filter
+ * @param data: The content of the log file
+ * @param iSize: Size of the content
+ * @param filter: The filter
+ * @return: 0 on success, -1 if the log is malformed (the records before the error are printed)
+*/
+static int Decode_Log(const uint8_t *data, size_t iSize, DECODE_FILTER_STRUCT *filter)
+{
+    if (iSize < LOG_BINARY_MAGIC_LEN || memcmp(data, LOG_BINARY_MAGIC, LOG_BINARY_MAGIC_LEN) != 0)
+    {
+        fprintf(stderr, "[-]logdecode: Not a binary log\n");
+        return -1;
+    }
+    int iFiltered = filter->iClientID != DECODE_NO_FILTER || filter->iServerID != DECODE_NO_FILTER || filter->sOperation != NULL;
+
+    const uint8_t *p = data + LOG_BINARY_MAGIC_LEN, *end = data + iSize;
+    uint64_t iID, iLength, iThread, iTime, iCount;
+    static uint8_t args[2 * LOG_MAX_MESSAGE];
+    static char sMessage[2 * LOG_MAX_MESSAGE];
+    while (p < end)
+    {
+        uint8_t type = *p++;
+        switch (type)
+        {
+        case LOG_BIN_EVENT_DEF:
+        {
+            if ((p = Log_Get_Varint(p, end, &iID)) == NULL || p == end)
+                return -1;
+            int iLevel = *p++;
+            if ((p = Log_Get_Varint(p, end, &iLength)) == NULL || iLength > (uint64_t)(end - p))
+                return -1;
+            if (Reserve((void **)&Events, &iEventCapacity, sizeof(DECODE_EVENT_STRUCT), iID) < 0)
+                return -1;
+            DECODE_EVENT_STRUCT *event = &Events[iID];
+            free(event->sFormat);
+            event->sFormat = strndup((const char *)p, iLength);
+            if (event->sFormat == NULL)
+                return -1;
+            event->iLevel = iLevel;
+            Find_ID_Arguments(event);
+            p += iLength;
+            break;
+        }
+        case LOG_BIN_STRING_DEF:
+        {
+            if ((p = Log_Get_Varint(p, end, &iID)) == NULL)
+                return -1;
+            if ((p = Log_Get_Varint(p, end, &iLength)) == NULL || iLength > (uint64_t)(end - p))
+                return -1;
+            if (Reserve((void **)&Strings, &iStringCapacity, sizeof(DECODE_STRING_STRUCT), iID) < 0)
+                return -1;
+            free(Strings[iID].sText);
+            Strings[iID].sText = (char *)malloc(iLength + 1);
+            if (Strings[iID].sText == NULL)
+                return -1;
+            memcpy(Strings[iID].sText, p, iLength);
+            Strings[iID].sText[iLength] = '\0';
+            Strings[iID].iLength = iLength;
+            p += iLength;
+            break;
+        }
+        case LOG_BIN_EVENT:
+        {
+            if ((p = Log_Get_Varint(p, end, &iID)) == NULL || iID >= iEventCapacity || Events[iID].sFormat == NULL)
+                return -1;
+            if ((p = Log_Get_Varint(p, end, &iThread)) == NULL || (p = Log_Get_Varint(p, end, &iTime)) == NULL ||
+                (p = Log_Get_Varint(p, end, &iLength)) == NULL || iLength > (uint64_t)(end - p))
+                return -1;
+            DECODE_EVENT_STRUCT *event = &Events[iID];
+            long long iClientID, iServerID;
+            long iArgsLength = Convert_Args(event, p, p + iLength, args, sizeof(args), &iClientID, &iServerID);
+            if (iArgsLength < 0)
+                return -1;
+            p += iLength;
+
+            if (event->iLevel > filter->iLevel)
+                break;
+            if (filter->iClientID != DECODE_NO_FILTER && iClientID != filter->iClientID)
+                break;
+            if (filter->iServerID != DECODE_NO_FILTER && iServerID != filter->iServerID)
+                break;
+            if (Log_Render(event->sFormat, args, iArgsLength, sMessage, sizeof(sMessage)) < 0)
+                return -1;
+            if (filter->sOperation != NULL && !MentionsOperation(sMessage, filter->sOperation))
+                break;
+
+            if (filter->iShowThreads)
+                printf("[Thread %lu] ", (unsigned long)iThread);
+            // Same layout as a text log
+            size_t iMessageLength = strlen(sMessage);
+            while (iMessageLength > 0 && sMessage[iMessageLength - 1] == '\n')
+                sMessage[--iMessageLength] = '\0';
+            printf("%s [Time Stamp: %f]\n", sMessage, iTime * 1e-6);
+            break;
+        }
+        case LOG_BIN_RAW:
+            if ((p = Log_Get_Varint(p, end, &iLength)) == NULL || iLength > (uint64_t)(end - p))
+                return -1;
+            if (!iFiltered)
+                fwrite(p, 1, iLength, stdout);
+            p += iLength;
+            break;
+        case LOG_BIN_DROPPED:
+            if ((p = Log_Get_Varint(p, end, &iThread)) == NULL || (p = Log_Get_Varint(p, end, &iTime)) == NULL ||
+                (p = Log_Get_Varint(p, end, &iCount)) == NULL)
+                return -1;
+            if (!iFiltered)
+                printf("[-]Logger: %lu records dropped (thread log buffer full) [Time Stamp: %f]\n", (unsigned long)iCount, iTime * 1e-6);
+            break;
+        default:
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void Usage(char *sProgram)
+{
+    fprintf(stderr, "Usage: %s [-c client_id] [-s server_id] [-o operation] [-l log_level] [-t] log_file\n", sProgram);
+}
+
+int main(int argc, char *argv[])
+{
+    // Parse the command line options
+    // -c <id>     : only the records of a client
+    // -s <id>     : only the records of a storage server
+    // -o <name>   : only the records mentioning an operation (read, write, create, delete, info, list, copy, move, rename)
+    // -l <level>  : highest level printed (error, warn, info or debug)
+    // -t          : prefix every record with the id of the thread that logged it
+    DECODE_FILTER_STRUCT filter = {DECODE_NO_FILTER, DECODE_NO_FILTER, NULL, LOG_LEVEL_DEBUG, 0};
+    int opt;
+    while ((opt = getopt(argc, argv, "c:s:o:l:t")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            filter.iClientID = strtoll(optarg, NULL, 10);
+            break;
+        case 's':
+            filter.iServerID = strtoll(optarg, NULL, 10);
+            break;
+        case 'o':
+            filter.sOperation = optarg;
+            break;
+        case 'l':
+            filter.iLevel = Log_Parse_Level(optarg);
+            if (filter.iLevel < 0)
+            {
+                fprintf(stderr, "[-]Log level must be error, warn, info or debug\n");
+                return 1;
+            }
+            break;
+        case 't':
+            filter.iShowThreads = 1;
+            break;
+        default:
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[optind], "rb");
+    if (file == NULL)
+    {
+        perror("[-]logdecode: fopen");
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    long iSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = (uint8_t *)malloc(iSize > 0 ? iSize : 1);
+    if (data == NULL || fread(data, 1, iSize, file) != (size_t)iSize)
+    {
+        fprintf(stderr, "[-]logdecode: Error in reading %s\n", argv[optind]);
+        fclose(file);
+        free(data);
+        return 1;
+    }
+    fclose(file);
+
+    int err = Decode_Log(data, iSize, &filter);
+    if (err < 0)
+        fprintf(stderr, "[-]logdecode: Log is truncated or malformed\n");
+    free(data);
+    return err < 0 ? 1 : 0;
+}
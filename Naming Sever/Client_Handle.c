@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
+#include <unistd.h>
 #include <arpa/inet.h>
 #include "Headers.h"
 #include "Client_Handle.h"
@@ -24,11 +25,123 @@ unsigned long GetClientID(CLIENT_HANDLE_STRUCT *clientHandle)
     return clientID;    
 }
 
+/*
+The registry is a hash table keyed by ClientID, split into CLIENT_SHARD_COUNT shards that each
+have their own lock and grow independently. Entries are never freed: a removed entry goes to the
+free list of its shard and is reused by a later client, so the send lock of a client stays valid
+memory for a thread that still holds the client's handle after it was removed (the same way the
+slots of the old fixed array were reused).
+*/
+
+/**
+ * @brief Mixes the bits of a ClientID (splitmix64 finalizer)
+ * @note ClientIDs are IP << 16 | port, the low bits alone hash badly
+ */
+static uint64_t HashClientID(unsigned long ClientID)
+{
+    uint64_t hash = (uint64_t)ClientID;
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+static CLIENT_SHARD_STRUCT *GetShard(unsigned long ClientID, CLIENT_HANDLE_LIST_STRUCT *clientHandleList)
+{
+    return &clientHandleList->shards[HashClientID(ClientID) & (CLIENT_SHARD_COUNT - 1)];
+}
+
+static size_t GetBucket(unsigned long ClientID, size_t iBucketCount)
+{
+    // The low bits chose the shard, use the next ones for the bucket
+    return (HashClientID(ClientID) / CLIENT_SHARD_COUNT) & (iBucketCount - 1);
+}
+
+/**
+ * @brief Finds the entry of a client in a shard (called with the shard lock held)
+ * @return The entry, NULL if the client is not registered
+ */
+static CLIENT_ENTRY_STRUCT *FindEntry(CLIENT_SHARD_STRUCT *shard, unsigned long ClientID)
+{
+    CLIENT_ENTRY_STRUCT *entry = shard->buckets[GetBucket(ClientID, shard->iBucketCount)];
+    while (entry != NULL && entry->client.ClientID != ClientID)
+        entry = entry->next;
+    return entry;
+}
+
+/**
+ * @brief Doubles the buckets of a shard and rehashes its entries (called with the shard lock held)
+ * @return 0 on success, -1 on failure (the shard keeps working with its old buckets)
+ */
+static int GrowShard(CLIENT_SHARD_STRUCT *shard)
+{
+    size_t iBucketCount = shard->iBucketCount * 2;
+    CLIENT_ENTRY_STRUCT **buckets = (CLIENT_ENTRY_STRUCT **)calloc(iBucketCount, sizeof(CLIENT_ENTRY_STRUCT *));
+    if (buckets == NULL)
+        return -1;
+
+    for (size_t i = 0; i < shard->iBucketCount; i++)
+    {
+        CLIENT_ENTRY_STRUCT *entry = shard->buckets[i];
+        while (entry != NULL)
+        {
+            CLIENT_ENTRY_STRUCT *next = entry->next;
+            size_t bucket = GetBucket(entry->client.ClientID, iBucketCount);
+            entry->next = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+
+    free(shard->buckets);
+    shard->buckets = buckets;
+    shard->iBucketCount = iBucketCount;
+    return 0;
+}
+
+/**
+ * @brief Takes an entry from the free list of a shard, refilling it with a new slab if empty
+ * @return The entry, NULL if out of memory (called with the shard lock held)
+ */
+static CLIENT_ENTRY_STRUCT *AllocateEntry(CLIENT_SHARD_STRUCT *shard)
+{
+    if (shard->freeList == NULL)
+    {
+        CLIENT_ENTRY_STRUCT *slab = (CLIENT_ENTRY_STRUCT *)calloc(CLIENT_ENTRY_SLAB_SIZE, sizeof(CLIENT_ENTRY_STRUCT));
+        if (slab == NULL)
+            return NULL;
+        for (int i = 0; i < CLIENT_ENTRY_SLAB_SIZE; i++)
+        {
+            pthread_mutex_init(&slab[i].sendMutex, NULL);
+            slab[i].next = shard->freeList;
+            shard->freeList = &slab[i];
+        }
+    }
+
+    CLIENT_ENTRY_STRUCT *entry = shard->freeList;
+    shard->freeList = entry->next;
+    entry->next = NULL;
+    return entry;
+}
+
 CLIENT_HANDLE_LIST_STRUCT* InitializeClientHandleList()
 {
-    CLIENT_HANDLE_LIST_STRUCT *clientHandleList = (CLIENT_HANDLE_LIST_STRUCT *) malloc(sizeof(CLIENT_HANDLE_LIST_STRUCT));
-    memset(clientHandleList, 0, sizeof(clientHandleList));
-    pthread_mutex_init(&clientHandleList->clientListMutex, NULL);
+    CLIENT_HANDLE_LIST_STRUCT *clientHandleList = (CLIENT_HANDLE_LIST_STRUCT *) calloc(1, sizeof(CLIENT_HANDLE_LIST_STRUCT));
+    if (CheckNull(clientHandleList, "[-]InitializeClientHandleList: Error in allocating memory"))
+        return NULL;
+
+    for(int i = 0; i < CLIENT_SHARD_COUNT; i++)
+    {
+        CLIENT_SHARD_STRUCT *shard = &clientHandleList->shards[i];
+        shard->iBucketCount = CLIENT_SHARD_INITIAL_BUCKETS;
+        shard->buckets = (CLIENT_ENTRY_STRUCT **)calloc(shard->iBucketCount, sizeof(CLIENT_ENTRY_STRUCT *));
+        if (CheckNull(shard->buckets, "[-]InitializeClientHandleList: Error in allocating buckets"))
+            return NULL;
+        pthread_mutex_init(&shard->shardMutex, NULL);
+    }
+    atomic_init(&clientHandleList->iClientCount, 0);
     return clientHandleList;
 }
 
@@ -36,120 +149,189 @@ CLIENT_HANDLE_LIST_STRUCT* InitializeClientHandleList()
  * Adds a client to the client list.
  *
  * @param clientHandle The client handle of the client to be added.
- * @return -1 if the maximum number of clients have been reached, otherwise 0.
- * @note The client handle is modified to include the client ID.
+ * @return -1 if the client is already registered or out of memory, otherwise 0.
+ * @note The client handle is modified to include the client ID and its send lock.
  */
 int AddClient(CLIENT_HANDLE_STRUCT *clientHandle, CLIENT_HANDLE_LIST_STRUCT *clientHandleList)
 {
-    clientHandle->ClientID = -1;
-    pthread_mutex_lock(&clientHandleList->clientListMutex);
-    if(clientHandleList->iClientCount == MAX_CLIENTS)
+    clientHandle->ClientID = GetClientID(clientHandle);
+    CLIENT_SHARD_STRUCT *shard = GetShard(clientHandle->ClientID, clientHandleList);
+
+    pthread_mutex_lock(&shard->shardMutex);
+    if(FindEntry(shard, clientHandle->ClientID) != NULL)
     {
-        pthread_mutex_unlock(&clientHandleList->clientListMutex);
-        printf(RED"[-]AddClient: Maximum number of clients reached\n"reset);
-        fprintf(logs, "[-]AddClient: Maximum number of clients reache [Time Stamp: %f]\n", GetCurrTime(Clock));
+        pthread_mutex_unlock(&shard->shardMutex);
+        LOG_ERROR("[-]AddClient: Client-%lu (%s:%d) is already registered", clientHandle->ClientID, clientHandle->sClientIP, clientHandle->sClientPort);
         return -1;
     }
-    
-    // Find First Empty Slot
-    for(int i = 0; i < MAX_CLIENTS; i++)
+
+    // Keep the chains short
+    if(shard->iClientCount >= shard->iBucketCount * CLIENT_SHARD_MAX_LOAD)
+        GrowShard(shard);
+
+    CLIENT_ENTRY_STRUCT *entry = AllocateEntry(shard);
+    if(entry == NULL)
     {
-        if(clientHandleList->InUseList[i] == 0)
-        {
-            clientHandle->ClientID = GetClientID(clientHandle);
-            clientHandleList->InUseList[i] = 1;
-            clientHandleList->clientList[i] = *clientHandle;
-            clientHandleList->iClientCount++;
-            pthread_mutex_unlock(&clientHandleList->clientListMutex);
-            printf(GRN"[+]AddClient: Client-%lu (%s:%d) added to client list\n"reset, clientHandle->ClientID, clientHandle->sClientIP, clientHandle->sClientPort);
-            fprintf(logs, "[+]AddClient: Client-%lu (%s:%d) added to client list [Time Stamp: %f]\n", clientHandle->ClientID, clientHandle->sClientIP, clientHandle->sClientPort, GetCurrTime(Clock));
-            return 0;
-        }
+        pthread_mutex_unlock(&shard->shardMutex);
+        LOG_ERROR("[-]AddClient: Error adding client-%lu (%s:%d)", clientHandle->ClientID, clientHandle->sClientIP, clientHandle->sClientPort);
+        return -1;
     }
 
-    pthread_mutex_unlock(&clientHandleList->clientListMutex);
-    printf(RED"[-]AddClient: Error adding client-%lu (%s:%d)\n"reset, clientHandle->ClientID, clientHandle->sClientIP, clientHandle->sClientPort);
-    fprintf(logs, "[-]AddClient: Error adding client-%lu (%s:%d) [Time Stamp: %f]\n", clientHandle->ClientID, clientHandle->sClientIP, clientHandle->sClientPort, GetCurrTime(Clock));
-    return -1;    
+    clientHandle->sendLock = &entry->sendMutex;
+    entry->client = *clientHandle;
+    size_t bucket = GetBucket(clientHandle->ClientID, shard->iBucketCount);
+    entry->next = shard->buckets[bucket];
+    shard->buckets[bucket] = entry;
+    shard->iClientCount++;
+    pthread_mutex_unlock(&shard->shardMutex);
+    atomic_fetch_add(&clientHandleList->iClientCount, 1);
+
+    LOG_INFO("[+]AddClient: Client-%lu (%s:%d) added to client list", clientHandle->ClientID, clientHandle->sClientIP, clientHandle->sClientPort);
+    return 0;
 }
 /**
  * Removes a client from the client list.
  *
  * @param ClientID The ID of the client to be removed.
- * @return -1 if there are no clients in the list or the client is not found, otherwise 0.
+ * @return -1 if the client is not found, otherwise 0.
+ * @note The entry (and its send lock) is kept for reuse, see the note at the top of this file.
  */
 int RemoveClient(unsigned long ClientID, CLIENT_HANDLE_LIST_STRUCT *clientHandleList)
 {
-    pthread_mutex_lock(&clientHandleList->clientListMutex);
-    if(clientHandleList->iClientCount == 0)
-    {
-        pthread_mutex_unlock(&clientHandleList->clientListMutex);
-        printf(RED"[-]RemoveClient: No clients to remove\n"reset);
-        fprintf(logs, "[-]RemoveClient: No clients to remove [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return -1;
-    }    
+    CLIENT_SHARD_STRUCT *shard = GetShard(ClientID, clientHandleList);
 
-    // Find the client
-    CLIENT_HANDLE_STRUCT *clientHandle = NULL;
-    for(int i = 0; i < MAX_CLIENTS; i++)
-    {
-        if(clientHandleList->clientList[i].ClientID == ClientID)
-        {
-            clientHandle = &clientHandleList->clientList[i];
-            clientHandleList->InUseList[i] = 0;
-            break;
-        }
-    }
+    pthread_mutex_lock(&shard->shardMutex);
+    CLIENT_ENTRY_STRUCT **link = &shard->buckets[GetBucket(ClientID, shard->iBucketCount)];
+    while(*link != NULL && (*link)->client.ClientID != ClientID)
+        link = &(*link)->next;
 
-    if(CheckNull(clientHandle, "[-]RemoveClient: Client not found"))
+    if(*link == NULL)
     {
-        pthread_mutex_unlock(&clientHandleList->clientListMutex);
-        fprintf(logs, "[-]RemoveClient: Client not found [Time Stamp: %f]\n", GetCurrTime(Clock));
+        pthread_mutex_unlock(&shard->shardMutex);
+        LOG_ERROR("[-]RemoveClient: Client %lu not found", ClientID);
         return -1;
     }
 
-    // Remove the client
-    clientHandleList->iClientCount--;
-    pthread_mutex_unlock(&clientHandleList->clientListMutex);
+    // Unlink the client and park its entry on the free list
+    CLIENT_ENTRY_STRUCT *entry = *link;
+    CLIENT_HANDLE_STRUCT clientHandle = entry->client;
+    *link = entry->next;
+    entry->client.ClientID = 0;
+    entry->next = shard->freeList;
+    shard->freeList = entry;
+    shard->iClientCount--;
+    pthread_mutex_unlock(&shard->shardMutex);
+    atomic_fetch_sub(&clientHandleList->iClientCount, 1);
 
-    printf(GRN"[+]RemoveClient: Client-%lu (%s:%d) removed from client list\n"reset, clientHandle->ClientID, clientHandle->sClientIP, clientHandle->sClientPort);
-    fprintf(logs, "[+]RemoveClient: Client-%lu (%s:%d) removed from client list [Time Stamp: %f]\n", clientHandle->ClientID, clientHandle->sClientIP, clientHandle->sClientPort, GetCurrTime(Clock));
+    LOG_INFO("[+]RemoveClient: Client-%lu (%s:%d) removed from client list", clientHandle.ClientID, clientHandle.sClientIP, clientHandle.sClientPort);
+    return 0;
 }
 /**
  * @brief Gets the client handle of the client.
  * @param ClientID The ID of the client.
+ * @param clientHandle Filled with a copy of the client handle.
  * @param clientHandleList The list of client handles.
- * @return The client handle of the client if found, otherwise NULL.
+ * @return 0 if found, otherwise -1.
  */
-CLIENT_HANDLE_STRUCT* GetClient(unsigned long ClientID, CLIENT_HANDLE_LIST_STRUCT *clientHandleList)
+int GetClient(unsigned long ClientID, CLIENT_HANDLE_STRUCT *clientHandle, CLIENT_HANDLE_LIST_STRUCT *clientHandleList)
 {
-    pthread_mutex_lock(&clientHandleList->clientListMutex);
-    if(clientHandleList->iClientCount == 0)
+    CLIENT_SHARD_STRUCT *shard = GetShard(ClientID, clientHandleList);
+
+    pthread_mutex_lock(&shard->shardMutex);
+    CLIENT_ENTRY_STRUCT *entry = FindEntry(shard, ClientID);
+    if(entry == NULL)
     {
-        pthread_mutex_unlock(&clientHandleList->clientListMutex);
-        printf(RED"[-]GetClient: No clients to get\n"reset);
-        fprintf(logs, "[-]GetClient: No clients to get [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return NULL;
+        pthread_mutex_unlock(&shard->shardMutex);
+        LOG_ERROR("[-]GetClient: Client %lu not found", ClientID);
+        return -1;
     }
 
-    // Find the client
-    CLIENT_HANDLE_STRUCT *clientHandle = NULL;
-    for(int i = 0; i < MAX_CLIENTS; i++)
+    *clientHandle = entry->client;
+    pthread_mutex_unlock(&shard->shardMutex);
+    return 0;
+}
+
+/**
+ * @brief Gets the number of registered clients.
+ */
+int GetClientCount(CLIENT_HANDLE_LIST_STRUCT *clientHandleList)
+{
+    return atomic_load(&clientHandleList->iClientCount);
+}
+
+/**
+ * @brief Records the wire protocol version negotiated with a client.
+ * @param ClientID The ID of the client.
+ * @param iWireVersion The negotiated version (WIRE_VERSION_*).
+ * @param clientHandleList The list of client handles.
+ * @return 0 on success, -1 if the client is not found.
+ */
+int SetClientWireVersion(unsigned long ClientID, int iWireVersion, CLIENT_HANDLE_LIST_STRUCT *clientHandleList)
+{
+    CLIENT_SHARD_STRUCT *shard = GetShard(ClientID, clientHandleList);
+
+    pthread_mutex_lock(&shard->shardMutex);
+    CLIENT_ENTRY_STRUCT *entry = FindEntry(shard, ClientID);
+    if(entry != NULL)
+        entry->client.iWireVersion = iWireVersion;
+    pthread_mutex_unlock(&shard->shardMutex);
+    return (entry != NULL) ? 0 : -1;
+}
+
+/**
+ * @brief Closes the sockets of all registered clients (on server exit).
+ */
+void CloseClientSockets(CLIENT_HANDLE_LIST_STRUCT *clientHandleList)
+{
+    for(int i = 0; i < CLIENT_SHARD_COUNT; i++)
     {
-        if(clientHandleList->clientList[i].ClientID == ClientID)
+        CLIENT_SHARD_STRUCT *shard = &clientHandleList->shards[i];
+        pthread_mutex_lock(&shard->shardMutex);
+        for(size_t j = 0; j < shard->iBucketCount; j++)
         {
-            clientHandle = &clientHandleList->clientList[i];
-            break;
+            for(CLIENT_ENTRY_STRUCT *entry = shard->buckets[j]; entry != NULL; entry = entry->next)
+                close(entry->client.iClientSocket);
         }
+        pthread_mutex_unlock(&shard->shardMutex);
     }
+}
 
-    if(CheckNull(clientHandle, "[-]GetClient: Client not found"))
+/**
+ * @brief Gets the lock serializing writes on the socket of a client.
+ * @param clientHandle The client handle (as filled in by AddClient).
+ * @return The send lock of the client.
+ * @note Responses and asynchronous ACKs are written by different threads, every complete
+ *       message must be written while holding this lock so frames never interleave.
+ */
+pthread_mutex_t *GetClientSendLock(CLIENT_HANDLE_STRUCT *clientHandle)
+{
+    return clientHandle->sendLock;
+}
+
+/**
+ * @brief Looks up a client and takes its send lock.
+ * @param ClientID The ID of the client.
+ * @param clientHandle Filled with a copy of the client handle.
+ * @param clientHandleList The list of client handles.
+ * @return 0 with the send lock held, -1 if the client is not found.
+ * @note The caller releases the lock with pthread_mutex_unlock(GetClientSendLock(...)).
+ *       The send lock is taken before the shard lock is dropped, so an owner that removes the
+ *       client and then closes its socket under the send lock waits for the ACK to be written.
+ */
+int AcquireClientForSend(unsigned long ClientID, CLIENT_HANDLE_STRUCT *clientHandle, CLIENT_HANDLE_LIST_STRUCT *clientHandleList)
+{
+    CLIENT_SHARD_STRUCT *shard = GetShard(ClientID, clientHandleList);
+
+    pthread_mutex_lock(&shard->shardMutex);
+    CLIENT_ENTRY_STRUCT *entry = FindEntry(shard, ClientID);
+    if(entry == NULL)
     {
-        pthread_mutex_unlock(&clientHandleList->clientListMutex);
-        fprintf(logs, "[-]GetClient: Client not found [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return NULL;
+        pthread_mutex_unlock(&shard->shardMutex);
+        return -1;
     }
 
-    pthread_mutex_unlock(&clientHandleList->clientListMutex);
-    return clientHandle;
+    *clientHandle = entry->client;
+    pthread_mutex_lock(&entry->sendMutex);
+    pthread_mutex_unlock(&shard->shardMutex);
+    return 0;
 }
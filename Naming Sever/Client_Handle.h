@@ -3,9 +3,14 @@
 
 #include "../Externals.h"
 #include <stdio.h>
+#include <stdint.h>
 #include <pthread.h>
+#include <stdatomic.h>
 
-#define MAX_CLIENTS 5
+#define CLIENT_SHARD_COUNT 64             // Independent locks of the client registry (power of 2)
+#define CLIENT_SHARD_INITIAL_BUCKETS 64   // Buckets of a shard before it grows (power of 2)
+#define CLIENT_SHARD_MAX_LOAD 2           // Clients per bucket at which a shard doubles its buckets
+#define CLIENT_ENTRY_SLAB_SIZE 256        // Entries allocated at once when a shard runs out
 
 typedef struct CLIENT_HANDLE_STRUCT
 {
@@ -13,14 +18,33 @@ typedef struct CLIENT_HANDLE_STRUCT
     char sClientIP[IP_LENGTH];
     int sClientPort;
     int iClientSocket;
+    int iWireVersion;            // Wire protocol version negotiated on the connection
+    pthread_mutex_t *sendLock;   // Send lock of the client's registry entry (set by AddClient)
 } CLIENT_HANDLE_STRUCT;
 
-typedef struct CLIENT_HANDLE_LIST_STRUCT
+// A registered client
+typedef struct CLIENT_ENTRY_STRUCT
+{
+    CLIENT_HANDLE_STRUCT client;
+    pthread_mutex_t sendMutex;                // Serializes writes on the client socket (responses and ACKs)
+    struct CLIENT_ENTRY_STRUCT *next;         // Next entry of the bucket, or of the free list
+} CLIENT_ENTRY_STRUCT;
+
+// A slice of the registry with its own lock
+typedef struct CLIENT_SHARD_STRUCT
 {
-    CLIENT_HANDLE_STRUCT clientList[MAX_CLIENTS];
-    short InUseList[MAX_CLIENTS];
+    CLIENT_ENTRY_STRUCT **buckets;            // Chained hash buckets
+    size_t iBucketCount;
     int iClientCount;
-    pthread_mutex_t clientListMutex;
+    CLIENT_ENTRY_STRUCT *freeList;            // Removed entries waiting to be reused
+    pthread_mutex_t shardMutex;
+} CLIENT_SHARD_STRUCT;
+
+// Registry of the connected clients, a hash table keyed by ClientID split into shards
+typedef struct CLIENT_HANDLE_LIST_STRUCT
+{
+    CLIENT_SHARD_STRUCT shards[CLIENT_SHARD_COUNT];
+    atomic_int iClientCount;
 } CLIENT_HANDLE_LIST_STRUCT;
 
 // Function Prototypes
@@ -29,6 +53,12 @@ int AddClient(CLIENT_HANDLE_STRUCT *clientHandle, CLIENT_HANDLE_LIST_STRUCT *cli
 int RemoveClient(unsigned long clientID, CLIENT_HANDLE_LIST_STRUCT *clientHandleList);
 
 unsigned long GetClientID(CLIENT_HANDLE_STRUCT *clientHandle);
-CLIENT_HANDLE_STRUCT *GetClient(unsigned long ClientID, CLIENT_HANDLE_LIST_STRUCT *clientHandleList);
+int GetClient(unsigned long ClientID, CLIENT_HANDLE_STRUCT *clientHandle, CLIENT_HANDLE_LIST_STRUCT *clientHandleList);
+int GetClientCount(CLIENT_HANDLE_LIST_STRUCT *clientHandleList);
+int SetClientWireVersion(unsigned long ClientID, int iWireVersion, CLIENT_HANDLE_LIST_STRUCT *clientHandleList);
+void CloseClientSockets(CLIENT_HANDLE_LIST_STRUCT *clientHandleList);
+
+pthread_mutex_t *GetClientSendLock(CLIENT_HANDLE_STRUCT *clientHandle);
+int AcquireClientForSend(unsigned long ClientID, CLIENT_HANDLE_STRUCT *clientHandle, CLIENT_HANDLE_LIST_STRUCT *clientHandleList);
 
-#endif
\ No newline at end of file
+#endif
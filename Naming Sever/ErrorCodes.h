@@ -8,5 +8,7 @@
 #define CMD_ERROR_BACKUP_UNAVAILABLE 204 // Backup unavailable
 #define ERROR_GETTING_MOUNT_PATHS 205    // Error getting mount paths
 #define CMD_ERROR_FWD_FAILED 206         // Forwarding request failed
+#define CMD_ERROR_INVALID_CURSOR 207     // Malformed or stale LIST continuation cursor
+#define CMD_ERROR_INVALID_ARGUMENTS 208  // Malformed request arguments
 
 #endif // __ERRORCODES_H
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Headers.h"
+#include "Forward_Table.h"
+#include "../colour.h"
+
+FORWARD_TABLE_STRUCT *forwardTable;
+
+FORWARD_TABLE_STRUCT *InitializeForwardTable()
+{
+    FORWARD_TABLE_STRUCT *table = (FORWARD_TABLE_STRUCT *)calloc(1, sizeof(FORWARD_TABLE_STRUCT));
+    if (CheckNull(table, "[-]InitializeForwardTable: Error in allocating memory"))
+        return NULL;
+
+    table->iNextForwardID = 1;
+    pthread_mutex_init(&table->forwardTableMutex, NULL);
+    return table;
+}
+
+/**
+ * @brief Records a client request that was forwarded to a storage server.
+ * @param ClientID The client waiting for the ACK.
+ * @param iClientRequestID The request ID the client used.
+ * @param table The forward table.
+ * @return The forward ID to send to the storage server, 0 if the table is full.
+ * @note Forward IDs are never 0 and the entry lives at iForwardID % MAX_PENDING_FORWARDS,
+ *       IDs whose slot is still in use are skipped.
+ */
+uint32_t AddPendingForward(unsigned long ClientID, uint32_t iClientRequestID, FORWARD_TABLE_STRUCT *table)
+{
+    pthread_mutex_lock(&table->forwardTableMutex);
+    if (table->iPendingCount == MAX_PENDING_FORWARDS)
+    {
+        pthread_mutex_unlock(&table->forwardTableMutex);
+        LOG_ERROR("[-]AddPendingForward: Maximum number of pending forwards reached");
+        return 0;
+    }
+
+    uint32_t iForwardID;
+    do
+    {
+        iForwardID = table->iNextForwardID++;
+        if (table->iNextForwardID == 0)
+            table->iNextForwardID = 1;
+    } while (iForwardID == 0 || table->InUseList[iForwardID % MAX_PENDING_FORWARDS]);
+
+    int slot = iForwardID % MAX_PENDING_FORWARDS;
+    table->InUseList[slot] = 1;
+    table->entries[slot].iForwardID = iForwardID;
+    table->entries[slot].ClientID = ClientID;
+    table->entries[slot].iClientRequestID = iClientRequestID;
+    table->entries[slot].fForwardTime = GetCurrTime(Clock);
+    table->iPendingCount++;
+    pthread_mutex_unlock(&table->forwardTableMutex);
+    return iForwardID;
+}
+
+/**
+ * @brief Removes a pending forward once the storage server replied (or the forward failed).
+ * @param iForwardID The forward ID echoed by the storage server.
+ * @param entry Filled with the removed entry (may be NULL).
+ * @param table The forward table.
+ * @return 0 on success, -1 if no request is pending under that ID.
+ */
+int TakePendingForward(uint32_t iForwardID, FORWARD_ENTRY_STRUCT *entry, FORWARD_TABLE_STRUCT *table)
+{
+    int slot = iForwardID % MAX_PENDING_FORWARDS;
+
+    pthread_mutex_lock(&table->forwardTableMutex);
+    if (iForwardID == 0 || table->InUseList[slot] == 0 || table->entries[slot].iForwardID != iForwardID)
+    {
+        pthread_mutex_unlock(&table->forwardTableMutex);
+        LOG_ERROR("[-]TakePendingForward: No request pending under forward ID %u", iForwardID);
+        return -1;
+    }
+
+    if (entry != NULL)
+        *entry = table->entries[slot];
+    table->InUseList[slot] = 0;
+    table->iPendingCount--;
+    pthread_mutex_unlock(&table->forwardTableMutex);
+    return 0;
+}
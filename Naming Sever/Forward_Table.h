@@ -0,0 +1,35 @@
+#ifndef __FORWARD_TABLE_H__
+#define __FORWARD_TABLE_H__
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define MAX_PENDING_FORWARDS 4096   // Requests forwarded to storage servers awaiting their reply
+
+// A client request forwarded to a storage server, waiting for the reply that triggers the ACK
+typedef struct FORWARD_ENTRY_STRUCT
+{
+    uint32_t iForwardID;            // Request ID used on the storage server connection
+    unsigned long ClientID;         // Client the ACK is sent to
+    uint32_t iClientRequestID;      // Request ID the client used (echoed in the ACK)
+    double fForwardTime;            // Time at which the request was forwarded
+} FORWARD_ENTRY_STRUCT;
+
+typedef struct FORWARD_TABLE_STRUCT
+{
+    FORWARD_ENTRY_STRUCT entries[MAX_PENDING_FORWARDS];
+    short InUseList[MAX_PENDING_FORWARDS];
+    int iPendingCount;
+    uint32_t iNextForwardID;
+    pthread_mutex_t forwardTableMutex;
+} FORWARD_TABLE_STRUCT;
+
+extern FORWARD_TABLE_STRUCT *forwardTable;
+
+FORWARD_TABLE_STRUCT *InitializeForwardTable();
+// Records a forwarded request, returns its forward ID (0 if the table is full)
+uint32_t AddPendingForward(unsigned long ClientID, uint32_t iClientRequestID, FORWARD_TABLE_STRUCT *table);
+// Removes the entry of a forward ID, copying it out
+int TakePendingForward(uint32_t iForwardID, FORWARD_ENTRY_STRUCT *entry, FORWARD_TABLE_STRUCT *table);
+
+#endif
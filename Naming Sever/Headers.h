@@ -4,6 +4,10 @@
 #include <stdio.h>
 #include <sys/time.h>
 #include "./Server_Handle.h"
+#include "./Client_Handle.h"
+#include "../Wire.h"
+#include "../Log.h"
+#include "../Trace.h"
 
 
 #define MAX_QUEUE_SIZE 5
@@ -26,20 +30,23 @@ CLOCK* InitClock();
 double GetCurrTime(CLOCK* clock);
 
 // global variables
-extern FILE *logs;
 extern CLOCK* Clock;
 
 // Thread to Asynchronously accept client connections
 void* Client_Acceptor_Thread();
 // Thread to handle a client
 void* Client_Handler_Thread(void* clientHandle);
+// Function to handle a single client request (shared by the client threads and the reactor)
+int Handle_Client_Request(CLIENT_HANDLE_STRUCT *client, WIRE_CONTEXT_STRUCT *ctx, REQUEST_STRUCT *request, RESPONSE_STRUCT *response);
+// Function to resolve every path of a CMD_RESOLVE_BATCH request
+int Handle_Resolve_Batch(CLIENT_HANDLE_STRUCT *client, RESOLVE_BATCH_STRUCT *batch, RESOLVE_RESULT_STRUCT *results);
 
 // Thread to Asynchronously accept Storage Server connections
 void* Storage_Server_Acceptor_Thread();
 // Thread to handle a Storage Server
 void* Storage_Server_Handler_Thread(void* storageServerHandle);
 
-// Thread to Asynchronously flush the logs periodically
+// Thread to periodically log the state of the server
 void* Log_Flusher_Thread();
 
 // Function to handle server exit
@@ -50,5 +57,7 @@ int IsSocketConnected(int sockfd);
 
 // Function for path resolution
 SERVER_HANDLE_STRUCT* ResolvePath(char* path);
+// Function for resolving many paths with a single trie walk
+int ResolvePathBatch(char** paths, int count, SERVER_HANDLE_STRUCT** servers);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+
+// Local Header Files
+#include "./Headers.h"
+#include "./Journal.h"
+
+// Global Header Files
+#include "../Externals.h"
+
+static const char *RecordNames[JOURNAL_RECORD_TYPES] = {"START", "INSERT", "DELETE", "RENAME", "SERVER", "CHECKPOINT"};
+
+static pthread_mutex_t JournalLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t JournalWritten = PTHREAD_COND_INITIALIZER;
+static int iJournalFd = -1;
+static int iWriting = 0;                 // A committer writes (and syncs) outside the lock
+static char *Buffer = NULL;              // Records being buffered
+static char *Spare = NULL;               // Records being written by the committer
+static size_t iBufferUsed = 0;
+static JOURNAL_STATS_STRUCT Stats;
+
+/**
+ * @brief Reads the sequence number of the last record of an existing journal
+ * @param fd: The journal (opened for reading)
+ * @param iEnd: Set to the end of the last complete record
+ * @return: The last sequence number, 0 for an empty journal
+ */
+static uint64_t Last_Sequence(int fd, off_t *iEnd)
+{
+    off_t iSize = lseek(fd, 0, SEEK_END);
+    *iEnd = 0;
+    if (iSize <= 0)
+        return 0;
+    char sTail[JOURNAL_TAIL_SIZE + 1];
+    off_t iOffset = iSize > JOURNAL_TAIL_SIZE ? iSize - JOURNAL_TAIL_SIZE : 0;
+    ssize_t n = pread(fd, sTail, iSize - iOffset, iOffset);
+    if (n <= 0)
+        return 0;
+    sTail[n] = '\0';
+
+    // The last complete line (a torn last line from a crash is skipped)
+    while (n > 0 && sTail[n - 1] != '\n')
+        sTail[--n] = '\0';
+    *iEnd = iOffset + n;
+    if (n > 0)
+        sTail[--n] = '\0';
+    char *line = strrchr(sTail, '\n');
+    line = (line == NULL) ? sTail : line + 1;
+    return strtoull(line, NULL, 10);
+}
+
+// Writes a block to the journal, returns -1 on failure
+static int Write_All(const char *data, size_t length)
+{
+    size_t iDone = 0;
+    while (iDone < length)
+    {
+        ssize_t n = write(iJournalFd, data + iDone, length - iDone);
+        if (n < 0)
+            return -1;
+        iDone += n;
+    }
+    return 0;
+}
+
+// Accounts for a write of the journal (JournalLock held)
+static void Written_Locked(size_t length, int err)
+{
+    if (err < 0 && !Stats.iFailed)
+    {
+        LOG_ERROR("[-]Journal: Error in writing the journal, no more changes are recorded");
+        Stats.iFailed = 1;
+    }
+    if (err == 0 && length > 0)
+    {
+        Stats.iCommits++;
+        Stats.iBytes += length;
+        Stats.iFileBytes += length;
+    }
+}
+
+// Writes the buffered records without syncing them, when the buffer is full (JournalLock held)
+static void Flush_Locked()
+{
+    // The records of a committer writing outside the lock go first
+    while (iWriting)
+        pthread_cond_wait(&JournalWritten, &JournalLock);
+    if (iBufferUsed > 0 && !Stats.iFailed)
+        Written_Locked(iBufferUsed, Write_All(Buffer, iBufferUsed));
+    iBufferUsed = 0;
+}
+
+int Journal_Format(char *buffer, size_t size, uint64_t iSequence, int iType, unsigned long ServerID, const char *sPath, const char *sNewName)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return snprintf(buffer, size, "%lu %ld.%03ld %s %lu %s%s%s\n", (unsigned long)iSequence, (long)now.tv_sec, now.tv_nsec / 1000000,
+                    RecordNames[iType], ServerID, sPath, sNewName ? " " : "", sNewName ? sNewName : "");
+}
+
+/**
+ * @brief Opens the journal and records the start of the Naming Server
+ * @param sPath: Path of the journal
+ * @param iSequence: Last sequence number already used (by the checkpoint), the journal goes on from
+ *                   the larger of it and its own last record
+ * @return: 0 on success, -1 on failure
+ * @note: The records of earlier runs are kept until the next checkpoint
+ */
+int Journal_Open(const char *sPath, uint64_t iSequence)
+{
+    int fd = open(sPath, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (CheckError(fd, "[-]Journal_Open: Error in opening the journal"))
+        return -1;
+    Buffer = (char *)malloc(JOURNAL_BUFFER_SIZE);
+    Spare = (char *)malloc(JOURNAL_BUFFER_SIZE);
+    if (CheckNull(Buffer, "[-]Journal_Open: Error in allocating memory") || CheckNull(Spare, "[-]Journal_Open: Error in allocating memory"))
+    {
+        free(Buffer);
+        free(Spare);
+        close(fd);
+        return -1;
+    }
+
+    pthread_mutex_lock(&JournalLock);
+    memset(&Stats, 0, sizeof(Stats));
+    off_t iEnd;
+    uint64_t iLast = Last_Sequence(fd, &iEnd);
+    // New records must not be glued to a torn last line
+    if (iEnd < lseek(fd, 0, SEEK_END) && ftruncate(fd, iEnd) == 0)
+        LOG_WARN("[-]Journal_Open: Cut the incomplete last record of %s", sPath);
+    Stats.iSequence = (iLast > iSequence) ? iLast : iSequence;
+    Stats.iDurable = Stats.iSequence;
+    Stats.iFileBytes = lseek(fd, 0, SEEK_END);
+    iJournalFd = fd;
+    pthread_mutex_unlock(&JournalLock);
+
+    Journal_Record(JOURNAL_START, 0, "Mount", NULL);
+    LOG_INFO("[+]Journal: Recording the mount table changes in %s (start at record %lu)", sPath, (unsigned long)Stats.iSequence);
+    return Journal_Commit();
+}
+
+void Journal_Close()
+{
+    Journal_Commit();
+    pthread_mutex_lock(&JournalLock);
+    while (iWriting)
+        pthread_cond_wait(&JournalWritten, &JournalLock);
+    if (iJournalFd >= 0)
+    {
+        close(iJournalFd);
+        iJournalFd = -1;
+    }
+    free(Buffer);
+    free(Spare);
+    Buffer = Spare = NULL;
+    pthread_mutex_unlock(&JournalLock);
+}
+
+/**
+ * @brief Buffers a change of the mount table
+ * @param iType: One of the JOURNAL_* record types
+ * @param ServerID: The server the path belongs to
+ * @param sPath: The path (as the storage server sent it)
+ * @param sNewName: The new last token of a JOURNAL_RENAME, NULL otherwise
+ * @return: The sequence number of the record, 0 if the journal is closed or failed
+ * @note: The record reaches the file with the next Journal_Commit (or when the buffer is full)
+ */
+uint64_t Journal_Record(int iType, unsigned long ServerID, const char *sPath, const char *sNewName)
+{
+    pthread_mutex_lock(&JournalLock);
+    if (iJournalFd < 0 || Stats.iFailed)
+    {
+        pthread_mutex_unlock(&JournalLock);
+        return 0;
+    }
+    uint64_t iSequence = ++Stats.iSequence;
+    for (int iAttempt = 0; iAttempt < 2; iAttempt++)
+    {
+        int length = Journal_Format(Buffer + iBufferUsed, JOURNAL_BUFFER_SIZE - iBufferUsed, iSequence, iType, ServerID, sPath, sNewName);
+        if (length >= 0 && (size_t)length < JOURNAL_BUFFER_SIZE - iBufferUsed)
+        {
+            iBufferUsed += length;
+            break;
+        }
+        // Make room (a record always fits in an empty buffer, paths are shorter than MAX_PATH_LEN)
+        Flush_Locked();
+    }
+    Stats.iRecords[iType]++;
+    pthread_mutex_unlock(&JournalLock);
+    return iSequence;
+}
+
+/**
+ * @brief Writes and syncs the buffered records to the journal
+ * @return: 0 once every record buffered before the call is on disk, -1 on failure
+ * @note: Called when a write section of the mount trie ends. The first committer takes the buffer
+ *        and writes it outside the lock, the ones arriving meanwhile wait and the next write carries
+ *        all of their records with a single sync.
+ */
+int Journal_Commit()
+{
+    pthread_mutex_lock(&JournalLock);
+    if (iJournalFd < 0)
+    {
+        pthread_mutex_unlock(&JournalLock);
+        return -1;
+    }
+    uint64_t iTarget = Stats.iSequence;
+    while (Stats.iDurable < iTarget && !Stats.iFailed)
+    {
+        if (iWriting)
+        {
+            pthread_cond_wait(&JournalWritten, &JournalLock);
+            continue;
+        }
+
+        // Write every buffered record, recording goes on in the other buffer meanwhile
+        char *data = Buffer;
+        size_t length = iBufferUsed;
+        uint64_t iLast = Stats.iSequence;
+        Buffer = Spare;
+        iBufferUsed = 0;
+        iWriting = 1;
+        pthread_mutex_unlock(&JournalLock);
+
+        int err = Write_All(data, length);
+        if (err == 0 && JOURNAL_SYNC)
+            err = fdatasync(iJournalFd);
+
+        pthread_mutex_lock(&JournalLock);
+        Spare = data;
+        iWriting = 0;
+        Written_Locked(length, err);
+        if (err == 0)
+        {
+            Stats.iSyncs++;
+            if (iLast > Stats.iDurable)
+                Stats.iDurable = iLast;
+        }
+        pthread_cond_broadcast(&JournalWritten);
+    }
+    int err = Stats.iFailed ? -1 : 0;
+    pthread_mutex_unlock(&JournalLock);
+    return err;
+}
+
+/**
+ * @brief Cuts the journal down to a CHECKPOINT record
+ * @param iSequence: Sequence number of the last record held by the checkpoint
+ * @return: 0 on success, -1 on failure
+ * @note: Called with the mount trie write section open, so no record past iSequence exists: the
+ *        buffered records are in the checkpoint too and are dropped
+ */
+int Journal_Truncate(uint64_t iSequence)
+{
+    char sRecord[JOURNAL_MAX_RECORD];
+    pthread_mutex_lock(&JournalLock);
+    while (iWriting)
+        pthread_cond_wait(&JournalWritten, &JournalLock);
+    if (iJournalFd < 0 || Stats.iFailed || iSequence != Stats.iSequence)
+    {
+        pthread_mutex_unlock(&JournalLock);
+        return -1;
+    }
+
+    iBufferUsed = 0;
+    int length = Journal_Format(sRecord, sizeof(sRecord), iSequence, JOURNAL_CHECKPOINT, 0, "Mount", NULL);
+    int err = ftruncate(iJournalFd, 0);
+    if (err == 0)
+    {
+        Stats.iFileBytes = 0;
+        err = Write_All(sRecord, length);
+        Written_Locked(length, err);
+    }
+    if (err == 0 && JOURNAL_SYNC)
+        err = fdatasync(iJournalFd);
+    if (err == 0)
+    {
+        Stats.iCheckpoints++;
+        Stats.iDurable = iSequence;
+        Stats.iRecords[JOURNAL_CHECKPOINT]++;
+    }
+    else
+        Written_Locked(0, -1);
+    pthread_cond_broadcast(&JournalWritten);
+    pthread_mutex_unlock(&JournalLock);
+    return err;
+}
+
+// Splits a record line in place, returns -1 if it is not a record
+static int Parse_Record(char *line, JOURNAL_RECORD_STRUCT *record)
+{
+    char *save_ptr = NULL;
+    char *sSequence = strtok_r(line, " ", &save_ptr);
+    char *sTime = strtok_r(NULL, " ", &save_ptr);
+    char *sType = strtok_r(NULL, " ", &save_ptr);
+    char *sServer = strtok_r(NULL, " ", &save_ptr);
+    if (sSequence == NULL || sTime == NULL || sType == NULL || sServer == NULL || save_ptr == NULL || *save_ptr == '\0')
+        return -1;
+
+    record->iSequence = strtoull(sSequence, NULL, 10);
+    record->ServerID = strtoul(sServer, NULL, 10);
+    record->sPath = save_ptr;
+    record->sNewName = NULL;
+    record->iType = -1;
+    for (int i = 0; i < JOURNAL_RECORD_TYPES; i++)
+    {
+        if (strcmp(sType, RecordNames[i]) == 0)
+            record->iType = i;
+    }
+    if (record->iType == JOURNAL_RENAME)
+    {
+        // The new name is a single token, the path may hold spaces
+        char *sep = strrchr(record->sPath, ' ');
+        if (sep == NULL)
+            return -1;
+        *sep = '\0';
+        record->sNewName = sep + 1;
+    }
+    return (record->iType < 0) ? -1 : 0;
+}
+
+/**
+ * @brief Reads a journal (or a checkpoint) back
+ * @param sPath: The file to read
+ * @param iAfter: Records up to this sequence number are skipped (they are in the checkpoint)
+ * @param apply: Called for every record read
+ * @param arg: Passed to apply
+ * @param iLastSequence: Set to the largest sequence number read (left as is if none is larger)
+ * @return: The number of records applied, 0 if the file does not exist, -1 on failure
+ * @note: A torn last line (crash during a write) ends the replay, as does a failure of apply
+ */
+long Journal_Replay(const char *sPath, uint64_t iAfter, JOURNAL_APPLY_FUNC apply, void *arg, uint64_t *iLastSequence)
+{
+    FILE *file = fopen(sPath, "r");
+    if (file == NULL)
+        return 0;
+    setvbuf(file, NULL, _IOFBF, 1024 * 1024);
+
+    char line[JOURNAL_MAX_RECORD];
+    long iApplied = 0;
+    long iLine = 0;
+    JOURNAL_RECORD_STRUCT record;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        iLine++;
+        size_t length = strlen(line);
+        if (length == 0 || line[length - 1] != '\n')
+        {
+            LOG_WARN("[-]Journal_Replay: %s ends with an incomplete record (line %ld), ignored", sPath, iLine);
+            break;
+        }
+        line[length - 1] = '\0';
+        if (Parse_Record(line, &record) < 0)
+        {
+            LOG_WARN("[-]Journal_Replay: Invalid record on line %ld of %s, ignored", iLine, sPath);
+            continue;
+        }
+        if (record.iSequence > *iLastSequence)
+            *iLastSequence = record.iSequence;
+        if (record.iSequence <= iAfter)
+            continue;
+        if (apply(arg, &record) < 0)
+        {
+            fclose(file);
+            return -1;
+        }
+        iApplied++;
+    }
+    fclose(file);
+    return iApplied;
+}
+
+void Journal_Get_Stats(JOURNAL_STATS_STRUCT *stats)
+{
+    pthread_mutex_lock(&JournalLock);
+    *stats = Stats;
+    pthread_mutex_unlock(&JournalLock);
+}
@@ -0,0 +1,79 @@
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define JOURNAL_FILE "NSjournal.log"     // Journal of the mount table changes (in the working directory)
+#define JOURNAL_BUFFER_SIZE (64 * 1024)  // Records kept in memory before they are written
+#define JOURNAL_TAIL_SIZE 4096           // Bytes read back at startup to find the last sequence number
+#define JOURNAL_MAX_RECORD (MAX_PATH_LEN + 128) // Longest record line
+#define JOURNAL_SYNC 1                   // fdatasync the journal before a commit returns (0 leaves it to the kernel)
+
+// Record types
+#define JOURNAL_START 0                  // The Naming Server started (after reloading the mount table)
+#define JOURNAL_INSERT 1                 // A path was mounted on a server
+#define JOURNAL_DELETE 2                 // A path and everything under it was removed
+#define JOURNAL_RENAME 3                 // The last token of a path was renamed
+#define JOURNAL_SERVER 4                 // Address of a server ("<ip>:<client port>:<naming server port>" as the path)
+#define JOURNAL_CHECKPOINT 5             // Every record up to this sequence number is in the checkpoint
+#define JOURNAL_RECORD_TYPES 6
+
+/*
+The journal is the write-ahead log of the mount table, an append-only text file with one line per change:
+    <sequence> <unix time> <type> <server id> <path> [<new name>]
+Sequence numbers keep growing across restarts. A checkpoint (Mount_Table.c) holds the whole table as
+records of the same format, all carrying the sequence number of the last change it contains, and the
+journal is cut down to a CHECKPOINT record once the checkpoint is safely on disk. At startup the
+table is rebuilt from the checkpoint and the journal records after it.
+Changes are recorded by the writer of the mount trie while its write section is open. Journal_Commit
+writes and syncs them once the section ends: a committer that finds a write in progress waits for it
+and the next write carries the records of every waiting committer (group commit), so registering a
+storage server with many paths, or several servers at once, costs a few system calls.
+*/
+
+typedef struct JOURNAL_STATS_STRUCT
+{
+    uint64_t iSequence;                  // Sequence number of the last record
+    uint64_t iDurable;                   // Sequence number of the last record synced to disk
+    unsigned long iRecords[JOURNAL_RECORD_TYPES]; // Records since startup, by type
+    unsigned long iCommits;              // Writes of the buffered records
+    unsigned long iSyncs;                // fdatasync calls (group commits)
+    unsigned long iCheckpoints;          // Checkpoints that cut the journal down
+    unsigned long long iBytes;           // Bytes written since startup
+    unsigned long long iFileBytes;       // Size of the journal (records since the last checkpoint)
+    int iFailed;                         // Set once a write failed (records are dropped from then on)
+} JOURNAL_STATS_STRUCT;
+
+// A record read back from a journal or a checkpoint
+typedef struct JOURNAL_RECORD_STRUCT
+{
+    uint64_t iSequence;
+    int iType;
+    unsigned long ServerID;
+    char *sPath;                         // Points into the line buffer of Journal_Replay
+    char *sNewName;                      // JOURNAL_RENAME only, NULL otherwise
+} JOURNAL_RECORD_STRUCT;
+
+// Called for every record replayed, a negative return stops the replay
+typedef int (*JOURNAL_APPLY_FUNC)(void *arg, JOURNAL_RECORD_STRUCT *record);
+
+// Opens the journal (creating it) and appends a START record, returns -1 on failure
+int Journal_Open(const char *sPath, uint64_t iSequence);
+// Writes the buffered records and closes the journal
+void Journal_Close();
+// Buffers a record (sNewName only for JOURNAL_RENAME), returns its sequence number (0 if the journal is closed)
+uint64_t Journal_Record(int iType, unsigned long ServerID, const char *sPath, const char *sNewName);
+// Writes and syncs the buffered records, returns -1 on failure
+int Journal_Commit();
+// Cuts the journal down once a checkpoint holds every record up to iSequence
+int Journal_Truncate(uint64_t iSequence);
+// Formats a record line (the checkpoint writes the journal format), returns its length
+int Journal_Format(char *buffer, size_t size, uint64_t iSequence, int iType, unsigned long ServerID, const char *sPath, const char *sNewName);
+// Calls apply for every complete record with a sequence number above iAfter, returns the number applied or -1
+long Journal_Replay(const char *sPath, uint64_t iAfter, JOURNAL_APPLY_FUNC apply, void *arg, uint64_t *iLastSequence);
+// Copies the counters of the journal
+void Journal_Get_Stats(JOURNAL_STATS_STRUCT *stats);
+
+#endif
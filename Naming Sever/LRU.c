@@ -3,48 +3,73 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+/*
+The cache is split into CACHE_SHARD_COUNT shards picked by the hash of the path, every shard has
+its own mutex, LRU list and chained hash table sized for its share of the capacity. Handler
+threads resolving different paths therefore rarely wait for each other, and a lookup only
+compares the keys of one bucket.
+*/
 
-int cacheSize(LRUCache *cache)
-{
-    int size = 0;
-    Node *current = cache->head;
-    while (current != NULL)
-    {
-        size++;
-        current = current->next;
-    }
-    return size;
-}
-
-int hashFunction(const char *key)
+uint64_t hashFunction(const char *key)
 {
-    // Simple hash function for illustration purposes
-    // jenkins_hash
-    unsigned long long hash = 0;
+    // jenkins_hash (one at a time)
+    uint64_t hash = 0;
     while (*key)
     {
-        hash += (unsigned long long)(*key++);
+        hash += (unsigned char)(*key++);
         hash += (hash << 10);
         hash ^= (hash >> 6);
     }
     hash += (hash << 3);
     hash ^= (hash >> 11);
     hash += (hash << 15);
-    return hash % CACHE_SIZE;
+    return hash;
+}
+
+static CacheShard *getShard(LRUCache *cache, uint64_t hash)
+{
+    return &cache->shards[hash & (CACHE_SHARD_COUNT - 1)];
+}
+
+static Node **getBucket(CacheShard *shard, uint64_t hash)
+{
+    // The low bits already picked the shard
+    return &shard->buckets[(hash / CACHE_SHARD_COUNT) & (shard->iBucketCount - 1)];
 }
 
 /**
  * @brief Initializes the Cache
- * @return: The cache object 
+ * @param capacity: The maximum number of paths held by the cache
+ * @return: The cache object, NULL on failure
 */
-LRUCache *createCache()
+LRUCache *createCache(int capacity)
 {
-    LRUCache *cache = (LRUCache *)malloc(sizeof(LRUCache));
-    cache->head = NULL;
-    cache->tail = NULL;
-    for (int i = 0; i < CACHE_SIZE; i++)
+    if (capacity < CACHE_SHARD_COUNT)
+        capacity = CACHE_SHARD_COUNT;
+
+    LRUCache *cache = (LRUCache *)aligned_alloc(64, sizeof(LRUCache));
+    if (cache == NULL)
+        return NULL;
+    memset(cache, 0, sizeof(LRUCache));
+    // Every shard gets the same share, the capacity is rounded up to a multiple of the shard count
+    cache->iCapacity = ((capacity + CACHE_SHARD_COUNT - 1) / CACHE_SHARD_COUNT) * CACHE_SHARD_COUNT;
+
+    for (int i = 0; i < CACHE_SHARD_COUNT; i++)
     {
-        cache->hashmap[i] = NULL;
+        CacheShard *shard = &cache->shards[i];
+        shard->iCapacity = cache->iCapacity / CACHE_SHARD_COUNT;
+        shard->iBucketCount = 1;
+        while (shard->iBucketCount < (size_t)shard->iCapacity)
+            shard->iBucketCount *= 2;
+        shard->buckets = (Node **)calloc(shard->iBucketCount, sizeof(Node *));
+        if (shard->buckets == NULL)
+        {
+            for (int j = 0; j < i; j++)
+                free(cache->shards[j].buckets);
+            free(cache);
+            return NULL;
+        }
+        pthread_mutex_init(&shard->shardMutex, NULL);
     }
     return cache;
 }
@@ -52,14 +77,17 @@ LRUCache *createCache()
 Node *createNode(const char *key, void *value)
 {
     Node *newNode = (Node *)malloc(sizeof(Node));
+    if (newNode == NULL)
+        return NULL;
     strcpy(newNode->key, key);
     newNode->value = value;
     newNode->next = NULL;
     newNode->prev = NULL;
+    newNode->chain = NULL;
     return newNode;
 }
 
-void removeFromList(LRUCache *cache, Node *node)
+void removeFromList(CacheShard *shard, Node *node)
 {
     if (node->prev != NULL)
     {
@@ -67,7 +95,7 @@ void removeFromList(LRUCache *cache, Node *node)
     }
     else
     {
-        cache->head = node->next;
+        shard->head = node->next;
     }
 
     if (node->next != NULL)
@@ -76,30 +104,52 @@ void removeFromList(LRUCache *cache, Node *node)
     }
     else
     {
-        cache->tail = node->prev;
+        shard->tail = node->prev;
     }
 }
 
-void moveToHead(LRUCache *cache, Node *node)
+static void pushHead(CacheShard *shard, Node *node)
 {
-    removeFromList(cache, node);
-
-    node->next = cache->head;
+    node->next = shard->head;
     node->prev = NULL;
 
-    if (cache->head != NULL)
+    if (shard->head != NULL)
     {
-        cache->head->prev = node;
+        shard->head->prev = node;
     }
 
-    cache->head = node;
+    shard->head = node;
 
-    if (cache->tail == NULL)
+    if (shard->tail == NULL)
     {
-        cache->tail = node;
+        shard->tail = node;
     }
 }
 
+void moveToHead(CacheShard *shard, Node *node)
+{
+    removeFromList(shard, node);
+    pushHead(shard, node);
+}
+
+// Finds the node of a key in its shard (shard lock held)
+static Node *findNode(CacheShard *shard, const char *key, uint64_t hash)
+{
+    Node *node = *getBucket(shard, hash);
+    while (node != NULL && (node->hash != hash || strcmp(node->key, key) != 0))
+        node = node->chain;
+    return node;
+}
+
+// Unlinks a node from its hash bucket (shard lock held)
+static void removeFromBucket(CacheShard *shard, Node *node)
+{
+    Node **link = getBucket(shard, node->hash);
+    while (*link != node)
+        link = &(*link)->chain;
+    *link = node->chain;
+}
+
 /**
  * @brief Adds a key-value pair to the cache
  * @param cache: The cache object
@@ -107,47 +157,57 @@ void moveToHead(LRUCache *cache, Node *node)
  * @param value: The value
  * @return: void
  * @note: If the key already exists, the value is updated and the node is moved to the head
+ * @note: When the shard is full its least recently used node is evicted and reused
 */
 void put(LRUCache *cache, const char *key, void *value)
 {
-    int index = hashFunction(key) % CACHE_SIZE;
+    // Paths longer than a key are not cached
+    if (strlen(key) >= MAX_PATH_LEN)
+        return;
+
+    uint64_t hash = hashFunction(key);
+    CacheShard *shard = getShard(cache, hash);
+    pthread_mutex_lock(&shard->shardMutex);
 
-    if (cache->hashmap[index] != NULL)
+    Node *node = findNode(shard, key, hash);
+    if (node != NULL)
     {
         // Key already exists, update value and move to the head
-        Node *node = cache->hashmap[index];
         node->value = value;
-        moveToHead(cache, node);
+        moveToHead(shard, node);
+        pthread_mutex_unlock(&shard->shardMutex);
+        return;
+    }
+
+    if (shard->iSize >= shard->iCapacity)
+    {
+        // Evict the least recently used node and reuse it for the new key
+        node = shard->tail;
+        removeFromList(shard, node);
+        removeFromBucket(shard, node);
+        shard->iSize--;
+        shard->iEvictions++;
+        strcpy(node->key, key);
+        node->value = value;
     }
     else
     {
-        // Key doesn't exist, create a new node and add to the head
-        Node *newNode = createNode(key, value);
-        cache->hashmap[index] = newNode;
-
-        if (cache->head == NULL)
-        {
-            cache->head = newNode;
-            cache->tail = newNode;
-        }
-        else
+        node = createNode(key, value);
+        if (node == NULL)
         {
-            newNode->next = cache->head;
-            cache->head->prev = newNode;
-            cache->head = newNode;
-        }
-
-        // If the cache size exceeds the limit, remove the least recently used node
-        if (cacheSize(cache) > CACHE_SIZE)
-        {
-            Node *tail = cache->tail;
-            cache->tail = tail->prev;
-            removeFromList(cache, tail);
-            int removeIndex = hashFunction(tail->key) % CACHE_SIZE;
-            cache->hashmap[removeIndex] = NULL;
-            free(tail);
+            pthread_mutex_unlock(&shard->shardMutex);
+            return;
         }
     }
+
+    // Add the node to the head and to its bucket
+    node->hash = hash;
+    Node **bucket = getBucket(shard, hash);
+    node->chain = *bucket;
+    *bucket = node;
+    pushHead(shard, node);
+    shard->iSize++;
+    pthread_mutex_unlock(&shard->shardMutex);
 }
 
 /**
@@ -159,19 +219,25 @@ void put(LRUCache *cache, const char *key, void *value)
 */
 void *get(LRUCache *cache, const char *key)
 {
-    int index = hashFunction(key) % CACHE_SIZE;
-    Node *node = cache->hashmap[index];
+    uint64_t hash = hashFunction(key);
+    CacheShard *shard = getShard(cache, hash);
+    pthread_mutex_lock(&shard->shardMutex);
 
+    void *value = NULL;
+    Node *node = findNode(shard, key, hash);
     if (node != NULL)
     {
         // Move the accessed node to the head
-        moveToHead(cache, node);
-        return node->value;
+        moveToHead(shard, node);
+        value = node->value;
+        shard->iHits++;
     }
     else
     {
-        return NULL; // Key not found
+        shard->iMisses++; // Key not found
     }
+    pthread_mutex_unlock(&shard->shardMutex);
+    return value;
 }
 
 /**
@@ -180,13 +246,35 @@ void *get(LRUCache *cache, const char *key)
 */
 void printCache(LRUCache *cache)
 {
-    Node *current = cache->head;
+    for (int i = 0; i < CACHE_SHARD_COUNT; i++)
+    {
+        CacheShard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->shardMutex);
+        Node *current = shard->head;
+        while (current != NULL)
+        {
+            printf("(%s, %p) ", current->key, current->value);
+            current = current->next;
+        }
+        pthread_mutex_unlock(&shard->shardMutex);
+    }
+    printf("\n");
+}
+
+// Frees the nodes of a shard (shard lock held)
+static void freeNodes(CacheShard *shard)
+{
+    Node *current = shard->head;
     while (current != NULL)
     {
-        printf("(%s, %p) ", current->key, current->value);
+        Node *temp = current;
         current = current->next;
+        free(temp);
     }
-    printf("\n");
+    shard->head = NULL;
+    shard->tail = NULL;
+    shard->iSize = 0;
+    memset(shard->buckets, 0, shard->iBucketCount * sizeof(Node *));
 }
 
 /**
@@ -196,12 +284,11 @@ void printCache(LRUCache *cache)
 */
 void freeCache(LRUCache *cache)
 {
-    Node *current = cache->head;
-    while (current != NULL)
+    for (int i = 0; i < CACHE_SHARD_COUNT; i++)
     {
-        Node *temp = current;
-        current = current->next;
-        free(temp);
+        freeNodes(&cache->shards[i]);
+        free(cache->shards[i].buckets);
+        pthread_mutex_destroy(&cache->shards[i].shardMutex);
     }
     free(cache);
 }
@@ -209,9 +296,49 @@ void freeCache(LRUCache *cache)
 /**
  * @brief Flushes the cache
  * @param cache: The cache object
- * @note: Removes all the nodes from the cache
+ * @note: Removes all the nodes from the cache, the counters are kept
 */
 void flushCache(LRUCache* cache)
 {
-    memset(cache, 0, sizeof(LRUCache));
-}
\ No newline at end of file
+    for (int i = 0; i < CACHE_SHARD_COUNT; i++)
+    {
+        CacheShard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->shardMutex);
+        freeNodes(shard);
+        pthread_mutex_unlock(&shard->shardMutex);
+    }
+}
+
+/**
+ * @brief Sums the counters of all the shards
+ * @param cache: The cache object
+ * @param stats: Filled with the size, capacity, hits, misses and evictions of the cache
+*/
+void getCacheStats(LRUCache *cache, CACHE_STATS_STRUCT *stats)
+{
+    memset(stats, 0, sizeof(CACHE_STATS_STRUCT));
+    stats->iCapacity = cache->iCapacity;
+    for (int i = 0; i < CACHE_SHARD_COUNT; i++)
+    {
+        CacheShard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->shardMutex);
+        stats->iSize += shard->iSize;
+        stats->iHits += shard->iHits;
+        stats->iMisses += shard->iMisses;
+        stats->iEvictions += shard->iEvictions;
+        pthread_mutex_unlock(&shard->shardMutex);
+    }
+}
+
+/**
+ * @brief Writes the cache counters to a stream (used by the log flusher)
+*/
+void printCacheStats(LRUCache *cache, FILE *stream)
+{
+    CACHE_STATS_STRUCT stats;
+    getCacheStats(cache, &stats);
+    unsigned long lookups = stats.iHits + stats.iMisses;
+    fprintf(stream, "Mount Cache: %d/%d paths, %lu hits, %lu misses (%.1f%% hit rate), %lu evictions\n",
+            stats.iSize, stats.iCapacity, stats.iHits, stats.iMisses,
+            lookups ? 100.0 * stats.iHits / lookups : 0.0, stats.iEvictions);
+}
@@ -2,39 +2,69 @@
 #define LRU_CACHE_H
 
 #include "Headers.h"
+#include <stdint.h>
+#include <pthread.h>
 
-// Define the maximum size of the cache
-#define CACHE_SIZE 19
+// Define the default and maximum number of paths held by the cache
+#define DEFAULT_CACHE_CAPACITY 4096
+#define MAX_CACHE_CAPACITY 1048576
+// Independent locks of the cache (power of 2), a path always lives in the same shard
+#define CACHE_SHARD_COUNT 16
 
 typedef struct Node {
     char key[MAX_PATH_LEN];
     void* value;
-    struct Node* next;
+    uint64_t hash;
+    struct Node* next;          // LRU order (head is the most recently used)
     struct Node* prev;
+    struct Node* chain;         // Next node of the same hash bucket
 } Node;
 
-typedef struct LRUCache {
+// A slice of the cache with its own lock, LRU list and hash table
+typedef struct CacheShard {
     Node* head;
     Node* tail;
-    Node* hashmap[CACHE_SIZE];
+    Node** buckets;             // Chained hash buckets
+    size_t iBucketCount;        // Power of 2
+    int iSize;
+    int iCapacity;
+    unsigned long iHits;
+    unsigned long iMisses;
+    unsigned long iEvictions;
+    pthread_mutex_t shardMutex;
+} __attribute__((aligned(64))) CacheShard;
+
+typedef struct LRUCache {
+    CacheShard shards[CACHE_SHARD_COUNT];
+    int iCapacity;
 } LRUCache;
 
+// Counters summed over all the shards
+typedef struct CACHE_STATS_STRUCT {
+    int iSize;
+    int iCapacity;
+    unsigned long iHits;
+    unsigned long iMisses;
+    unsigned long iEvictions;
+} CACHE_STATS_STRUCT;
+
 //Global
-LRUCache* createCache(); 
-void put(LRUCache* cache, const char* key, void* value); 
-void* get(LRUCache* cache, const char* key); 
+LRUCache* createCache(int capacity);
+void put(LRUCache* cache, const char* key, void* value);
+void* get(LRUCache* cache, const char* key);
 void freeCache(LRUCache* cache);
-void printCache(LRUCache* cache); 
+void printCache(LRUCache* cache);
 void flushCache(LRUCache* cache);
+void getCacheStats(LRUCache* cache, CACHE_STATS_STRUCT* stats);
+void printCacheStats(LRUCache* cache, FILE* stream);
 
 
 //Local Helpers
 /*
 Node* createNode(const char* key, void* value);
-void removeFromList(LRUCache* cache, Node* node);
-void moveToHead(LRUCache* cache, Node* node);
-int cacheSize(LRUCache* cache);
-int hashFunction(const char* key);
+void removeFromList(CacheShard* shard, Node* node);
+void moveToHead(CacheShard* shard, Node* node);
+uint64_t hashFunction(const char* key);
 */
 
 #endif /* LRU_CACHE_H */
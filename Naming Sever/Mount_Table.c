@@ -0,0 +1,414 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+// Local Header Files
+#include "./Headers.h"
+#include "./Mount_Table.h"
+#include "./Journal.h"
+#include "./Trie.h"
+#include "./LRU.h"
+
+// Global Header Files
+#include "../Externals.h"
+
+extern SERVER_HANDLE_LIST_STRUCT *serverHandleList;
+extern MOUNT_TRIE_STRUCT *MountTrie;
+extern LRUCache *MountCache;
+
+// A server met while replaying, its handle is restored with its first path
+typedef struct MOUNT_REPLAY_SERVER
+{
+    unsigned long ServerID;
+    char sAddress[64];
+    SERVER_HANDLE_STRUCT *server;
+} MOUNT_REPLAY_SERVER;
+
+typedef struct MOUNT_REPLAY_STRUCT
+{
+    MOUNT_REPLAY_SERVER *servers;
+    int iServerCount;
+    int iServerCapacity;
+    int iLast;                            // Server of the previous record (paths come grouped by server)
+    long iPaths;                          // INSERT records applied
+    long iSkipped;                        // Records that could not be applied
+} MOUNT_REPLAY_STRUCT;
+
+// Servers already written to a checkpoint
+typedef struct MOUNT_CHECKPOINT_STRUCT
+{
+    FILE *file;
+    uint64_t iSequence;
+    SERVER_HANDLE_STRUCT **servers;
+    int iServerCount;
+    int iServerCapacity;
+    SERVER_HANDLE_STRUCT *last;
+} MOUNT_CHECKPOINT_STRUCT;
+
+// Paths of a stale handle, collected before they are deleted
+typedef struct MOUNT_STALE_STRUCT
+{
+    SERVER_HANDLE_STRUCT *server;
+    char **paths;
+    long iCount;
+    long iCapacity;
+} MOUNT_STALE_STRUCT;
+
+static MOUNT_REPLAY_SERVER *Replay_Server(MOUNT_REPLAY_STRUCT *replay, unsigned long ServerID, int iCreate) // finds (or adds) a server of the replay
+{
+    if (replay->iLast >= 0 && replay->servers[replay->iLast].ServerID == ServerID)
+        return &replay->servers[replay->iLast];
+    for (int i = 0; i < replay->iServerCount; i++)
+    {
+        if (replay->servers[i].ServerID == ServerID)
+        {
+            replay->iLast = i;
+            return &replay->servers[i];
+        }
+    }
+    if (!iCreate)
+        return NULL;
+
+    if (replay->iServerCount == replay->iServerCapacity)
+    {
+        int iCapacity = replay->iServerCapacity ? 2 * replay->iServerCapacity : 16;
+        MOUNT_REPLAY_SERVER *servers = (MOUNT_REPLAY_SERVER *)realloc(replay->servers, iCapacity * sizeof(MOUNT_REPLAY_SERVER));
+        if (CheckNull(servers, "[-]Replay_Server: Error in allocating memory"))
+            return NULL;
+        replay->servers = servers;
+        replay->iServerCapacity = iCapacity;
+    }
+    MOUNT_REPLAY_SERVER *entry = &replay->servers[replay->iServerCount];
+    memset(entry, 0, sizeof(MOUNT_REPLAY_SERVER));
+    entry->ServerID = ServerID;
+    replay->iLast = replay->iServerCount++;
+    return entry;
+}
+
+/**
+ * @brief Applies a record of the checkpoint or of the journal to the mount trie
+ * @return: 0 on success (records that cannot be applied are counted and skipped), -1 on failure
+ * @note: Called with the write section of the trie open
+ */
+static int Replay_Record(void *arg, JOURNAL_RECORD_STRUCT *record)
+{
+    MOUNT_REPLAY_STRUCT *replay = (MOUNT_REPLAY_STRUCT *)arg;
+    char path[MAX_PATH_LEN];
+
+    switch (record->iType)
+    {
+    case JOURNAL_SERVER:
+    {
+        MOUNT_REPLAY_SERVER *entry = Replay_Server(replay, record->ServerID, 1);
+        if (entry == NULL)
+            return -1;
+        snprintf(entry->sAddress, sizeof(entry->sAddress), "%s", record->sPath);
+        return 0;
+    }
+    case JOURNAL_INSERT:
+    {
+        MOUNT_REPLAY_SERVER *entry = Replay_Server(replay, record->ServerID, 0);
+        if (entry == NULL || entry->sAddress[0] == '\0')
+        {
+            // Written before the journal recorded the servers
+            replay->iSkipped++;
+            return 0;
+        }
+        if (entry->server == NULL)
+        {
+            entry->server = RestoreServer(entry->ServerID, entry->sAddress, serverHandleList);
+            if (entry->server == NULL)
+                return -1;
+        }
+        snprintf(path, sizeof(path), "%s", record->sPath);
+        if (Insert_Path(MountTrie, path, entry->server) < 0)
+            replay->iSkipped++;
+        else
+            replay->iPaths++;
+        return 0;
+    }
+    case JOURNAL_DELETE:
+    {
+        snprintf(path, sizeof(path), "%s", record->sPath);
+        if (Delete_Path(MountTrie, path) < 0)
+            replay->iSkipped++;
+        return 0;
+    }
+    case JOURNAL_RENAME:
+        // The trie has no rename, the server registers the new name again
+        replay->iSkipped++;
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Rebuilds the mount trie from the checkpoint and the journal
+ * @param iSequence: Set to the last sequence number used (the journal goes on from it)
+ * @return: The number of paths applied, -1 on failure
+ * @note: Called before the acceptor threads start, the whole replay is a single write section
+ */
+long Mount_Table_Load(uint64_t *iSequence)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    MOUNT_REPLAY_STRUCT replay;
+    memset(&replay, 0, sizeof(replay));
+    replay.iLast = -1;
+    uint64_t iCheckpoint = 0;
+    *iSequence = 0;
+
+    Trie_Write_Begin(MountTrie);
+    long iCheckpointRecords = Journal_Replay(MOUNT_CHECKPOINT_FILE, 0, Replay_Record, &replay, &iCheckpoint);
+    *iSequence = iCheckpoint;
+    long iJournalRecords = (iCheckpointRecords < 0) ? -1 : Journal_Replay(JOURNAL_FILE, iCheckpoint, Replay_Record, &replay, iSequence);
+    Trie_Write_End(MountTrie);
+    free(replay.servers);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double fSeconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    if (iCheckpointRecords < 0 || iJournalRecords < 0)
+    {
+        LOG_ERROR("[-]Mount_Table_Load: Error in reloading the mount table");
+        return -1;
+    }
+    LOG_INFO("[+]Mount_Table_Load: Reloaded %ld paths of %d servers (checkpoint at record %lu, %ld journal records, %ld skipped) in %.3fs",
+             replay.iPaths, replay.iServerCount, (unsigned long)iCheckpoint, iJournalRecords, replay.iSkipped, fSeconds);
+    return replay.iPaths;
+}
+
+static int Collect_Stale_Path(void *arg, void *Server_Handle, const char *path) // keeps the paths of the stale handle
+{
+    MOUNT_STALE_STRUCT *stale = (MOUNT_STALE_STRUCT *)arg;
+    if (Server_Handle != stale->server)
+        return 0;
+    if (stale->iCount == stale->iCapacity)
+    {
+        long iCapacity = stale->iCapacity ? 2 * stale->iCapacity : 64;
+        char **paths = (char **)realloc(stale->paths, iCapacity * sizeof(char *));
+        if (paths == NULL)
+            return -1;
+        stale->paths = paths;
+        stale->iCapacity = iCapacity;
+    }
+    // Prefixed with the token Insert_Path and Delete_Path skip
+    size_t length = strlen(path) + 3;
+    stale->paths[stale->iCount] = (char *)malloc(length);
+    if (stale->paths[stale->iCount] == NULL)
+        return -1;
+    snprintf(stale->paths[stale->iCount++], length, "./%s", path);
+    return 0;
+}
+
+/**
+ * @brief Moves the paths of a stale handle to the registering server
+ * @param server: The registering server
+ * @param stale: The restored (or disconnected) handle with the same address
+ * @return: 0 on success, -1 on failure
+ * @note: Called with the write section open, after the paths the server sent are inserted: the
+ *        paths still on the stale handle are the ones the server no longer has. They are deleted
+ *        deepest first, a directory that still holds paths of the server is moved to it instead.
+ *        The stale handle stays registered until the caller has published the trie.
+ */
+static int Reconcile_Server(SERVER_HANDLE_STRUCT *server, SERVER_HANDLE_STRUCT *stale)
+{
+    MOUNT_STALE_STRUCT paths;
+    memset(&paths, 0, sizeof(paths));
+    paths.server = stale;
+    int err = (Walk_Trie(MountTrie->draft, Collect_Stale_Path, &paths) < 0) ? -1 : 0;
+
+    long iDeleted = 0, iMoved = 0;
+    for (long i = paths.iCount - 1; i >= 0 && err == 0; i--)
+    {
+        char path[MAX_PATH_LEN];
+        snprintf(path, sizeof(path), "%s", paths.paths[i]);
+        if (Has_Entries(MountTrie->draft, path) > 0)
+        {
+            err = Insert_Path(MountTrie, path, server);
+            Journal_Record(JOURNAL_INSERT, server->ServerID, paths.paths[i], NULL);
+            iMoved++;
+        }
+        else if (Delete_Path(MountTrie, path) == 0)
+        {
+            Journal_Record(JOURNAL_DELETE, stale->ServerID, paths.paths[i], NULL);
+            iDeleted++;
+        }
+    }
+    for (long i = 0; i < paths.iCount; i++)
+        free(paths.paths[i]);
+    free(paths.paths);
+    if (err < 0)
+        return -1;
+
+    LOG_INFO("[+]Mount_Table_Register: Server %lu replaces server %lu (%s:%d), %ld stale paths deleted, %ld moved",
+             server->ServerID, stale->ServerID, stale->sServerIP, stale->sServerPort_Client, iDeleted, iMoved);
+    return 0;
+}
+
+/**
+ * @brief Inserts the paths of a registering server in the mount trie
+ * @param server: The registered handle (ports filled from the init packet)
+ * @param MountPaths: The \n separated paths the server sent (tokenized in place)
+ * @return: The number of paths inserted, -1 on failure
+ * @note: All the paths are published at once, readers keep using the previous trie meanwhile. Every
+ *        change is journaled and the journal is synced before returning, so the server is only
+ *        acknowledged once its paths survive a restart of the Naming Server
+ */
+long Mount_Table_Register(SERVER_HANDLE_STRUCT *server, char *MountPaths)
+{
+    char sAddress[64];
+    char sJournalPath[MAX_PATH_LEN];
+    long iInserted = 0;
+    int err = 0;
+
+    Trie_Write_Begin(MountTrie);
+    snprintf(sAddress, sizeof(sAddress), "%s:%d:%d", server->sServerIP, server->sServerPort_Client, server->sServerPort_NServer);
+    Journal_Record(JOURNAL_SERVER, server->ServerID, sAddress, NULL);
+
+    // Extract indivisual path from the mount paths string (tokenize on \n) and Insert into the mount trie
+    char *token = MountPaths;
+    while (token != NULL && strlen(token) && err == 0)
+    {
+        char *path_tok = __strtok_r(token, "\n", &token);
+        // Insert_Path tokenizes the path in place, the journal keeps it as the server sent it
+        snprintf(sJournalPath, MAX_PATH_LEN, "%s", path_tok);
+        // Removing the the first token in the path [e.g. (server name/~) , (./~) , (mount/~) , etc.]
+        // Is handled by the Insert_Path function
+        err = Insert_Path(MountTrie, path_tok, server);
+        if (err == 0)
+        {
+            Journal_Record(JOURNAL_INSERT, server->ServerID, sJournalPath, NULL);
+            iInserted++;
+        }
+    }
+
+    // The handles the server had before (restored from the table, or from an earlier connection)
+    SERVER_HANDLE_STRUCT *stale[MOUNT_MAX_STALE];
+    int iStaleCount = (err == 0) ? FindStaleServers(server, stale, MOUNT_MAX_STALE, serverHandleList) : 0;
+    int iReconciled = 0;
+    while (iReconciled < iStaleCount && err == 0)
+    {
+        err = Reconcile_Server(server, stale[iReconciled]);
+        if (err == 0)
+            iReconciled++;
+    }
+    atomic_store(&server->iRestored, 0);
+    Trie_Write_End(MountTrie);
+
+    // The published trie no longer points to the stale handles and its grace period is over, so no reader
+    // still holds one (readers fill the cache inside their read section): remove them, then the cache entries
+    for (int i = 0; i < iReconciled; i++)
+        RemoveServer(stale[i]->ServerID, serverHandleList);
+    if (iReconciled > 0)
+        flushCache(MountCache);
+
+    if (Journal_Commit() < 0)
+        LOG_WARN("[-]Mount_Table_Register: Paths of server %lu were not journaled", server->ServerID);
+    return (err < 0) ? -1 : iInserted;
+}
+
+static int Checkpoint_Path(void *arg, void *Server_Handle, const char *path) // writes a path (and its server the first time) to the checkpoint
+{
+    MOUNT_CHECKPOINT_STRUCT *checkpoint = (MOUNT_CHECKPOINT_STRUCT *)arg;
+    SERVER_HANDLE_STRUCT *server = (SERVER_HANDLE_STRUCT *)Server_Handle;
+    char sRecord[JOURNAL_MAX_RECORD];
+    char sPath[MAX_PATH_LEN + 2];
+
+    int iKnown = (server == checkpoint->last);
+    for (int i = 0; i < checkpoint->iServerCount && !iKnown; i++)
+        iKnown = (checkpoint->servers[i] == server);
+    if (!iKnown)
+    {
+        if (checkpoint->iServerCount == checkpoint->iServerCapacity)
+        {
+            int iCapacity = checkpoint->iServerCapacity ? 2 * checkpoint->iServerCapacity : 16;
+            SERVER_HANDLE_STRUCT **servers = (SERVER_HANDLE_STRUCT **)realloc(checkpoint->servers, iCapacity * sizeof(SERVER_HANDLE_STRUCT *));
+            if (servers == NULL)
+                return -1;
+            checkpoint->servers = servers;
+            checkpoint->iServerCapacity = iCapacity;
+        }
+        checkpoint->servers[checkpoint->iServerCount++] = server;
+        snprintf(sPath, sizeof(sPath), "%s:%d:%d", server->sServerIP, server->sServerPort_Client, server->sServerPort_NServer);
+        Journal_Format(sRecord, sizeof(sRecord), checkpoint->iSequence, JOURNAL_SERVER, server->ServerID, sPath, NULL);
+        fputs(sRecord, checkpoint->file);
+    }
+    checkpoint->last = server;
+
+    snprintf(sPath, sizeof(sPath), "./%s", path);
+    Journal_Format(sRecord, sizeof(sRecord), checkpoint->iSequence, JOURNAL_INSERT, server->ServerID, sPath, NULL);
+    return (fputs(sRecord, checkpoint->file) < 0) ? -1 : 0;
+}
+
+/**
+ * @brief Writes a checkpoint of the mount table and cuts the journal down
+ * @return: 0 on success, -1 on failure
+ * @note: Writers are held off while the table is written (every record up to the sequence number of
+ *        the checkpoint is in it). The checkpoint replaces the previous one only once it is synced,
+ *        a crash at any point leaves a checkpoint and a journal that rebuild the table.
+ */
+int Mount_Table_Checkpoint()
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    MOUNT_CHECKPOINT_STRUCT checkpoint;
+    memset(&checkpoint, 0, sizeof(checkpoint));
+    checkpoint.file = fopen(MOUNT_CHECKPOINT_TEMP, "w");
+    if (CheckNull(checkpoint.file, "[-]Mount_Table_Checkpoint: Error in opening the checkpoint"))
+        return -1;
+    setvbuf(checkpoint.file, NULL, _IOFBF, MOUNT_CHECKPOINT_BUFFER);
+
+    Trie_Write_Begin(MountTrie);
+    JOURNAL_STATS_STRUCT journalStats;
+    Journal_Get_Stats(&journalStats);
+    checkpoint.iSequence = journalStats.iSequence;
+
+    char sRecord[JOURNAL_MAX_RECORD];
+    Journal_Format(sRecord, sizeof(sRecord), checkpoint.iSequence, JOURNAL_CHECKPOINT, 0, "Mount", NULL);
+    fputs(sRecord, checkpoint.file);
+    long iPaths = Walk_Trie(MountTrie->draft, Checkpoint_Path, &checkpoint);
+
+    int err = (iPaths < 0 || fflush(checkpoint.file) != 0 || fsync(fileno(checkpoint.file)) != 0) ? -1 : 0;
+    err |= fclose(checkpoint.file);
+    if (err == 0)
+        err = rename(MOUNT_CHECKPOINT_TEMP, MOUNT_CHECKPOINT_FILE);
+    if (err == 0)
+    {
+        // The rename itself is durable once the directory is synced
+        int dirfd = open(".", O_RDONLY);
+        if (dirfd >= 0)
+        {
+            fsync(dirfd);
+            close(dirfd);
+        }
+        err = Journal_Truncate(checkpoint.iSequence);
+    }
+    Trie_Write_End(MountTrie);
+    free(checkpoint.servers);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double fSeconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    if (CheckError(err, "[-]Mount_Table_Checkpoint: Error in writing the checkpoint"))
+    {
+        LOG_ERROR("[-]Mount_Table_Checkpoint: Error in writing the checkpoint at record %lu", (unsigned long)checkpoint.iSequence);
+        unlink(MOUNT_CHECKPOINT_TEMP);
+        return -1;
+    }
+    LOG_INFO("[+]Mount_Table_Checkpoint: Wrote %ld paths of %d servers at record %lu in %.3fs", iPaths, checkpoint.iServerCount, (unsigned long)checkpoint.iSequence, fSeconds);
+    return 0;
+}
+
+int Mount_Table_Maintain()
+{
+    JOURNAL_STATS_STRUCT journalStats;
+    Journal_Get_Stats(&journalStats);
+    if (journalStats.iFailed || journalStats.iFileBytes < MOUNT_CHECKPOINT_BYTES)
+        return 0;
+    return Mount_Table_Checkpoint();
+}
@@ -0,0 +1,31 @@
+#ifndef __MOUNT_TABLE_H__
+#define __MOUNT_TABLE_H__
+
+#include <stdint.h>
+#include "./Server_Handle.h"
+
+#define MOUNT_CHECKPOINT_FILE "NSmount.ckpt"          // Checkpoint of the mount table (in the working directory)
+#define MOUNT_CHECKPOINT_TEMP "NSmount.ckpt.tmp"      // Checkpoint being written, renamed over the previous one
+#define MOUNT_CHECKPOINT_BYTES (64 * 1024 * 1024)     // Size of the journal that triggers a checkpoint
+#define MOUNT_CHECKPOINT_BUFFER (1024 * 1024)         // stdio buffer of the checkpoint and replay files
+#define MOUNT_MAX_STALE 16                            // Stale handles a registering server replaces at once
+
+/*
+The mount table survives a restart of the Naming Server: the checkpoint holds the whole table and the
+journal (Journal.h) every change since. Mount_Table_Load rebuilds the trie from both before any client
+is accepted; the servers of the reloaded paths are restored from their SERVER records and clients are
+sent to them right away. When a storage server registers again, its paths replace the ones of the
+restored (or disconnected) handle with the same address, the paths it no longer has are deleted and
+the old handle is removed once the new paths are published.
+*/
+
+// Rebuilds the mount trie from the checkpoint and the journal, returns the number of paths or -1
+long Mount_Table_Load(uint64_t *iSequence);
+// Inserts the paths of a registering server (reconciling a restored handle), returns the number inserted or -1
+long Mount_Table_Register(SERVER_HANDLE_STRUCT *server, char *MountPaths);
+// Writes a checkpoint of the mount table and cuts the journal down, returns -1 on failure
+int Mount_Table_Checkpoint();
+// Writes a checkpoint once the journal has grown past MOUNT_CHECKPOINT_BYTES
+int Mount_Table_Maintain();
+
+#endif
@@ -14,49 +14,126 @@
 #include "./Server_Handle.h"
 #include "./Trie.h"
 #include "./LRU.h"
+#include "./Reactor.h"
+#include "./ThreadPool.h"
+#include "./Forward_Table.h"
+#include "./Stats.h"
+#include "./Journal.h"
+#include "./Mount_Table.h"
 #include "./ErrorCodes.h"
 
 // Global Header Files
 #include "../Externals.h"
+#include "../Wire.h"
 #include "../colour.h"
 
 // Global Variables
 CLIENT_HANDLE_LIST_STRUCT *clientHandleList;
 SERVER_HANDLE_LIST_STRUCT *serverHandleList;
-FILE *logs;
 CLOCK *Clock;
-TrieNode *MountTrie;
-pthread_mutex_t MountTrieLock;
+MOUNT_TRIE_STRUCT *MountTrie;
+pthread_mutex_t ServerForwardLock;
 LRUCache *MountCache;
 sem_t serverStartSem;
 
 SERVER_HANDLE_STRUCT *ResolvePath(char *path)
 {
-    // Check if the path is in the cache
+    // Check if the path is in the cache (the cache has its own locks)
+    TRACE_SPAN_STRUCT span;
+    Trace_Begin(&span, "cache_lookup");
     SERVER_HANDLE_STRUCT *server = get(MountCache, path);
+    Trace_Detail(&span, "%s", server != NULL ? "hit" : "miss");
+    Trace_End(&span);
     if (server != NULL)
     {
-        fprintf(logs, "[+]ResolvePath: Path %s found in cache [Time Stamp: %f]\n", path, GetCurrTime(Clock));
+        LOG_INFO("[+]ResolvePath: Path %s found in cache", path);
         return server;
     }
 
-    // Resolve the path
-    server = Get_Server(MountTrie, path);
+    // Resolve the path, readers of the trie never wait for a storage server registering paths
+    Trace_Begin(&span, "trie_resolve");
+    // The path is cached before the read section ends: a registration that retires the handle flushes
+    // the cache after its grace period, so it cannot miss an entry made from the trie it replaced
+    atomic_long *token;
+    server = Get_Server(Trie_Read_Lock(MountTrie, &token), path);
+    if (server != NULL)
+        put(MountCache, path, server);
+    Trie_Read_Unlock(token);
+    Trace_End(&span);
 
     if (server == NULL)
     {
-        fprintf(logs, "[-]ResolvePath: Path %s not found in mount trie [Time Stamp: %f]\n", path, GetCurrTime(Clock));
+        LOG_ERROR("[-]ResolvePath: Path %s not found in mount trie", path);
     }
     else
     {
-        fprintf(logs, "[+]ResolvePath: Path %s found in mount trie [Time Stamp: %f]\n", path, GetCurrTime(Clock));
-        // Add the path to the cache
-        put(MountCache, path, server);
+        LOG_INFO("[+]ResolvePath: Path %s found in mount trie", path);
     }
 
     return server;
 }
 
+/**
+ * @brief Resolves many paths in a single read section of the trie
+ * @param paths: The paths to be resolved
+ * @param count: The number of paths
+ * @param servers: Filled with the server of every path (NULL if not found)
+ * @return: The number of paths found, -1 on failure
+ * @note: Cached paths are answered from the cache, the others share a single walk of the trie
+ */
+int ResolvePathBatch(char **paths, int count, SERVER_HANDLE_STRUCT **servers)
+{
+    char **missPaths = (char **)malloc((count ? count : 1) * sizeof(char *));
+    int *missIndex = (int *)malloc((count ? count : 1) * sizeof(int));
+    SERVER_HANDLE_STRUCT **missServers = (SERVER_HANDLE_STRUCT **)malloc((count ? count : 1) * sizeof(SERVER_HANDLE_STRUCT *));
+    if (missPaths == NULL || missIndex == NULL || missServers == NULL)
+    {
+        free(missPaths);
+        free(missIndex);
+        free(missServers);
+        return -1;
+    }
+
+    int iMissCount = 0, iFoundCount = 0;
+
+    // Answer what we can from the cache
+    for (int i = 0; i < count; i++)
+    {
+        servers[i] = get(MountCache, paths[i]);
+        if (servers[i] != NULL)
+        {
+            iFoundCount++;
+            continue;
+        }
+        missPaths[iMissCount] = paths[i];
+        missIndex[iMissCount++] = i;
+    }
+
+    // Walk the trie once for the rest
+    if (iMissCount > 0)
+    {
+        atomic_long *token;
+        // Cached inside the read section like ResolvePath
+        int iBatchStatus = Get_Servers_Batch(Trie_Read_Lock(MountTrie, &token), missPaths, iMissCount, (void **)missServers);
+        for (int i = 0; iBatchStatus >= 0 && i < iMissCount; i++)
+        {
+            servers[missIndex[i]] = missServers[i];
+            if (missServers[i] != NULL)
+            {
+                put(MountCache, missPaths[i], missServers[i]);
+                iFoundCount++;
+            }
+        }
+        Trie_Read_Unlock(token);
+    }
+
+    LOG_INFO("[+]ResolvePathBatch: Resolved %d of %d paths (%d from cache)", iFoundCount, count, count - iMissCount);
+    free(missPaths);
+    free(missIndex);
+    free(missServers);
+    return iFoundCount;
+}
+
 /**
  * @brief Checks if the given socket is connected( Readable )
  * @param sockfd: The socket to check
@@ -83,7 +160,7 @@ CLOCK *InitClock()
     CLOCK *C = (CLOCK *)malloc(sizeof(CLOCK));
     if (CheckNull(C, "[-]InitClock: Error in allocating memory"))
     {
-        fprintf(logs, "[-]InitClock: Error in allocating memory\n");
+        LOG_ERROR("[-]InitClock: Error in allocating memory");
         exit(EXIT_FAILURE);
     }
 
@@ -91,7 +168,7 @@ CLOCK *InitClock()
     C->bootTime = GetCurrTime(C);
     if (CheckError(C->bootTime, "[-]InitClock: Error in getting current time"))
     {
-        fprintf(logs, "[-]InitClock: Error in getting current time\n");
+        LOG_ERROR("[-]InitClock: Error in getting current time");
         free(C);
         exit(EXIT_FAILURE);
     }
@@ -99,7 +176,7 @@ CLOCK *InitClock()
     int err = clock_gettime(CLOCK_MONOTONIC_RAW, &C->Btime);
     if (CheckError(err, "[-]InitClock: Error in getting current time"))
     {
-        fprintf(logs, "[-]InitClock: Error in getting current time\n");
+        LOG_ERROR("[-]InitClock: Error in getting current time");
         free(C);
         exit(EXIT_FAILURE);
     }
@@ -116,28 +193,388 @@ double GetCurrTime(CLOCK *Clock)
 {
     if (CheckNull(Clock, "[-]GetCurrTime: Invalid clock object"))
     {
-        fprintf(logs, "[-]GetCurrTime: Invalid clock object\n");
+        LOG_ERROR("[-]GetCurrTime: Invalid clock object");
         return -1;
     }
     struct timespec time;
     int err = clock_gettime(CLOCK_MONOTONIC_RAW, &time);
     if (CheckError(err, "[-]GetCurrTime: Error in getting current time"))
     {
-        fprintf(logs, "[-]GetCurrTime: Error in getting current time\n");
+        LOG_ERROR("[-]GetCurrTime: Error in getting current time");
         return -1;
     }
     return (time.tv_sec + time.tv_nsec * 1e-9) - (Clock->bootTime);
 }
 
+/**
+ * @brief Handles a single client request and populates the response
+ * @param client: The client handle of the requesting client
+ * @param ctx: The wire context of the request (its request ID is echoed in a later ACK)
+ * @param request: The request received from the client
+ * @param response: The response to be populated
+ * @return: 0 on success, -1 if the request failed (error code is set in the response)
+ * @note: Shared by the threaded client handler and the epoll reactor
+ */
+int Handle_Client_Request(CLIENT_HANDLE_STRUCT *client, WIRE_CONTEXT_STRUCT *ctx, REQUEST_STRUCT *request, RESPONSE_STRUCT *response)
+{
+    uint64_t iStartNs = Stats_Now();
+    // Continue the trace of the client (if the request carries one)
+    Trace_Set_Context(ctx->iTraceID, ctx->iParentSpanID);
+    TRACE_SPAN_STRUCT span;
+    Trace_Begin(&span, CommandName(request->iRequestOperation));
+    Trace_Detail(&span, "%s", request->sRequestPath);
+    memset(response, 0, sizeof(RESPONSE_STRUCT));
+    response->iResponseOperation = request->iRequestOperation;
+    response->iResponseErrorCode = CMD_ERROR_SUCCESS;
+
+    switch (request->iRequestOperation)
+    {
+    case CMD_READ:
+    {
+        LOG_INFO("[+]Client Handler Thread: Client %lu requested to read file %s", client->ClientID, request->sRequestPath);
+        // Do a path resolution
+        SERVER_HANDLE_STRUCT *server = ResolvePath(request->sRequestPath);
+
+        if (server == NULL)
+        {
+            LOG_ERROR("[-]Client Handler Thread: Error in resolving path for client %lu", client->ClientID);
+            response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response->iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
+            break;
+        }
+
+        response->iResponseFlags = RESPONSE_FLAG_SUCCESS;
+        // Check if the server is active
+        if (IsActive(server->ServerID, serverHandleList) == 0)
+        {
+            // Switch to backup server
+            server = GetActiveBackUp(serverHandleList, server->backupServers);
+            if (server == NULL)
+            {
+                LOG_ERROR("[-]Client Handler Thread: Error in getting active backup server for client %lu", client->ClientID);
+                response->iResponseErrorCode = CMD_ERROR_BACKUP_UNAVAILABLE;
+                response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+                break;
+            }
+            response->iResponseFlags = BACKUP_RESPONSE;
+            LOG_INFO("[+]Client Handler Thread: Switched to backup server %lu (%s:%d) for client %lu", server->ServerID, server->sServerIP, server->sServerPort_Client, client->ClientID);
+        }
+
+        LOG_INFO("[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)", request->sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+        // Populate the response struct with Server IP and Port
+        snprintf(response->sResponseData, MAX_BUFFER_SIZE, "%s %d", server->sServerIP, server->sServerPort_Client);
+        response->iResponseServerID = server->ServerID;
+        break;
+    }
+    case CMD_WRITE:
+    {
+        LOG_INFO("[+]Client Handler Thread: Client %lu requested to write file %s", client->ClientID, request->sRequestPath);
+        // Do a path resolution
+        SERVER_HANDLE_STRUCT *server = ResolvePath(request->sRequestPath);
+
+        if (server == NULL)
+        {
+            LOG_ERROR("[-]Client Handler Thread: Error in resolving path for client %lu", client->ClientID);
+            response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response->iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
+            break;
+        }
+
+        response->iResponseFlags = RESPONSE_FLAG_SUCCESS;
+        // Check if the server is active
+        if (IsActive(server->ServerID, serverHandleList) == 0)
+        {
+            response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response->iResponseErrorCode = CMD_ERROR_SERVER_UNAVAILABLE;
+            break;
+        }
+
+        LOG_INFO("[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)", request->sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+        // Populate the response struct with Server IP and Port
+        snprintf(response->sResponseData, MAX_BUFFER_SIZE, "%s %d", server->sServerIP, server->sServerPort_Client);
+        response->iResponseServerID = server->ServerID;
+        break;
+    }
+    case CMD_INFO:
+    {
+        LOG_INFO("[+]Client Handler Thread: Client %lu requested info for file %s", client->ClientID, request->sRequestPath);
+
+        // Do a path resolution
+        SERVER_HANDLE_STRUCT *server = ResolvePath(request->sRequestPath);
+
+        if (server == NULL)
+        {
+            LOG_ERROR("[-]Client Handler Thread: Error in resolving path for client %lu", client->ClientID);
+            response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response->iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
+            break;
+        }
+
+        response->iResponseFlags = RESPONSE_FLAG_SUCCESS;
+
+        // Check if the server is active
+        if (IsActive(server->ServerID, serverHandleList) == 0)
+        {
+            // Switch to backup server
+            server = GetActiveBackUp(serverHandleList, server->backupServers);
+            if (server == NULL)
+            {
+                LOG_ERROR("[-]Client Handler Thread: Error in getting active backup server for client %lu", client->ClientID);
+                response->iResponseErrorCode = CMD_ERROR_BACKUP_UNAVAILABLE;
+                response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+                break;
+            }
+            response->iResponseFlags = BACKUP_RESPONSE;
+            LOG_INFO("[+]Client Handler Thread: Switched to backup server %lu (%s:%d) for client %lu", server->ServerID, server->sServerIP, server->sServerPort_Client, client->ClientID);
+        }
+
+        LOG_INFO("[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)", request->sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+
+        // Populate the response struct with Server IP and Port
+        snprintf(response->sResponseData, MAX_BUFFER_SIZE, "%s %d", server->sServerIP, server->sServerPort_Client);
+        response->iResponseServerID = server->ServerID;
+
+        break;
+    }
+    case CMD_LIST:
+    {
+        LOG_INFO("[+]Client Handler Thread: Client %lu requested to list directory %s", client->ClientID, request->sRequestPath);
+
+        // The request path is "<Path> [<Max Depth> [<Max Entries> [<Cursor>]]]", the response holds a page
+        // of the tree under the path, preceded by the cursor of the next page if there is one
+        char path[MAX_BUFFER_SIZE];
+        TRIE_LIST_STRUCT list;
+        memset(&list, 0, sizeof(TRIE_LIST_STRUCT));
+        int iArgs = sscanf(request->sRequestPath, "%1023s %d %d %511s", path, &list.iMaxDepth, &list.iMaxEntries, list.sCursor);
+        if (iArgs < 1 || list.iMaxDepth < 0 || list.iMaxEntries < 0)
+        {
+            LOG_ERROR("[-]Client Handler Thread: Invalid list arguments %s for client %lu", request->sRequestPath, client->ClientID);
+            strcpy(response->sResponseData, "Invalid Arguments");
+            response->iResponseErrorCode = CMD_ERROR_INVALID_ARGUMENTS;
+            response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            break;
+        }
+
+        char page[MAX_BUFFER_SIZE];
+        atomic_long *token;
+        int err = Get_Directory_Page(Trie_Read_Lock(MountTrie, &token), path, &list, page, sizeof(page));
+        Trie_Read_Unlock(token);
+        if (err == -3)
+        {
+            LOG_ERROR("[-]Client Handler Thread: Invalid list cursor in %s for client %lu", request->sRequestPath, client->ClientID);
+            strcpy(response->sResponseData, "Invalid Cursor");
+            response->iResponseErrorCode = CMD_ERROR_INVALID_CURSOR;
+            response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            break;
+        }
+        else if (err == -2)
+        {
+            LOG_ERROR("[-]Client Handler Thread: Error in getting directory tree for client %lu", client->ClientID);
+            strcpy(response->sResponseData, "Error in getting subtree directory");
+            response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response->iResponseErrorCode = ERROR_GETTING_MOUNT_PATHS;
+            break;
+        }
+        else if (err == -1)
+        {
+            LOG_ERROR("[-]Client Handler Thread: Invalid Path %s for client %lu", request->sRequestPath, client->ClientID);
+            strcpy(response->sResponseData, "Invalid Path");
+            response->iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
+            response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            break;
+        }
+
+        // The page leaves room for the cursor
+        if (list.sCursor[0] != '\0')
+        {
+            if (snprintf(response->sResponseData, MAX_BUFFER_SIZE, "%s\n%s", list.sCursor, page) >= MAX_BUFFER_SIZE)
+            {
+                LOG_ERROR("[-]Client Handler Thread: Page and cursor too long for client %lu", client->ClientID);
+                strcpy(response->sResponseData, "Error in getting subtree directory");
+                response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+                response->iResponseErrorCode = ERROR_GETTING_MOUNT_PATHS;
+                break;
+            }
+            response->iResponseFlags = RESPONSE_FLAG_MORE;
+        }
+        else
+        {
+            memcpy(response->sResponseData, page, strlen(page) + 1);
+            response->iResponseFlags = RESPONSE_FLAG_SUCCESS;
+        }
+        response->iResponseErrorCode = CMD_ERROR_SUCCESS;
+
+        break;
+    }
+
+    case CMD_RENAME:
+    {
+        LOG_INFO("[+]Client Handler Thread: Client %lu requested to rename file %s", client->ClientID, request->sRequestPath);
+
+        // The request path is "<Source Path> <Target Name>", only the source is resolved
+        char path[MAX_BUFFER_SIZE];
+        char *target = NULL;
+        strncpy(path, request->sRequestPath, MAX_BUFFER_SIZE);
+        __strtok_r(path, " ", &target);
+
+        // Do a path resolution
+        SERVER_HANDLE_STRUCT *server = ResolvePath(path);
+
+        if (server == NULL)
+        {
+            LOG_ERROR("[-]Client Handler Thread: Error in resolving path for client %lu", client->ClientID);
+            response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response->iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
+            break;
+        }
+
+        response->iResponseFlags = RESPONSE_FLAG_SUCCESS;
+
+        // Check if the server is active (a server restored from the mount table has no connection yet)
+        if (IsActive(server->ServerID, serverHandleList) == 0 || atomic_load(&server->iRestored))
+        {
+            response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response->iResponseErrorCode = CMD_ERROR_SERVER_UNAVAILABLE;
+            break;
+        }
+
+        // Populate the response struct with Server ID
+        response->iResponseServerID = server->ServerID;
+
+        LOG_INFO("[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)", request->sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+
+        // Forward the request on the connection the server listens on (in the wire version it speaks)
+        // A v2 server echoes the forward ID, which routes its reply back to this request as an ACK
+        WIRE_CONTEXT_STRUCT serverContext = {server->iWireVersion, 0};
+        if (server->iWireVersion == WIRE_VERSION_2)
+        {
+            serverContext.iRequestID = AddPendingForward(client->ClientID, ctx->iRequestID, forwardTable);
+            if (serverContext.iRequestID == 0)
+            {
+                response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+                response->iResponseErrorCode = CMD_ERROR_FWD_FAILED;
+                break;
+            }
+        }
+
+        // The forwarded request carries the trace, the server continues it under the forward span
+        TRACE_SPAN_STRUCT forwardSpan, lockSpan;
+        Trace_Begin(&forwardSpan, "forward");
+        Trace_Detail(&forwardSpan, "server %lu", server->ServerID);
+        Trace_Begin(&lockSpan, "lock_wait");
+        pthread_mutex_lock(&ServerForwardLock);
+        Trace_End(&lockSpan);
+        int iSendStatus = Send_Request(server->sSocket_Read, &serverContext, request);
+        pthread_mutex_unlock(&ServerForwardLock);
+        Trace_End(&forwardSpan);
+        if (CheckError(iSendStatus, "[-]Client Handler Thread: Error in sending request to server"))
+        {
+            if (serverContext.iRequestID)
+                TakePendingForward(serverContext.iRequestID, NULL, forwardTable);
+            LOG_ERROR("[-]Client Handler Thread: Error in sending request to server for client %lu", client->ClientID);
+            response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response->iResponseErrorCode = CMD_ERROR_FWD_FAILED;
+            break;
+        }
+
+        strncpy(response->sResponseData, "Request forwarded to server", MAX_BUFFER_SIZE);
+        break;
+    }
+
+    default:
+    {
+        response->iResponseErrorCode = CMD_ERROR_INVALID_OPERATION;
+        response->iResponseFlags = RESPONSE_FLAG_FAILURE;
+        break;
+    }
+    }
+
+    int iFailed = (response->iResponseFlags == RESPONSE_FLAG_FAILURE);
+    Stats_Record(request->iRequestOperation, iStartNs, iFailed);
+    if (iFailed)
+        Trace_Error(&span, response->iResponseErrorCode);
+    Trace_End(&span);
+    Trace_Clear();
+    return iFailed ? -1 : 0;
+}
+
+/**
+ * @brief Resolves every path of a CMD_RESOLVE_BATCH request
+ * @param client: The requesting client
+ * @param batch: The decoded batch
+ * @param results: Filled with one result per path (batch->iPathCount entries)
+ * @return: The number of paths resolved, -1 on failure
+ * @note: Every path gets the answer a READ request would get (backup server included)
+ */
+int Handle_Resolve_Batch(CLIENT_HANDLE_STRUCT *client, RESOLVE_BATCH_STRUCT *batch, RESOLVE_RESULT_STRUCT *results)
+{
+    uint64_t iStartNs = Stats_Now();
+    LOG_INFO("[+]Client Handler Thread: Client %lu requested to resolve %u paths", client->ClientID, batch->iPathCount);
+
+    SERVER_HANDLE_STRUCT **servers = (SERVER_HANDLE_STRUCT **)malloc(batch->iPathCount * sizeof(SERVER_HANDLE_STRUCT *));
+    if (CheckNull(servers, "[-]Handle_Resolve_Batch: Error in allocating memory"))
+    {
+        Stats_Record(CMD_RESOLVE_BATCH, iStartNs, 1);
+        return -1;
+    }
+    if (ResolvePathBatch(batch->Paths, batch->iPathCount, servers) < 0)
+    {
+        free(servers);
+        Stats_Record(CMD_RESOLVE_BATCH, iStartNs, 1);
+        return -1;
+    }
+
+    int iResolvedCount = 0;
+    memset(results, 0, batch->iPathCount * sizeof(RESOLVE_RESULT_STRUCT));
+    for (uint32_t i = 0; i < batch->iPathCount; i++)
+    {
+        SERVER_HANDLE_STRUCT *server = servers[i];
+        results[i].iFlags = RESPONSE_FLAG_FAILURE;
+        if (server == NULL)
+        {
+            results[i].iErrorCode = CMD_ERROR_PATH_NOT_FOUND;
+            continue;
+        }
+
+        results[i].iFlags = RESPONSE_FLAG_SUCCESS;
+        // Check if the server is active
+        if (IsActive(server->ServerID, serverHandleList) == 0)
+        {
+            // Switch to backup server
+            server = GetActiveBackUp(serverHandleList, server->backupServers);
+            if (server == NULL)
+            {
+                results[i].iFlags = RESPONSE_FLAG_FAILURE;
+                results[i].iErrorCode = CMD_ERROR_BACKUP_UNAVAILABLE;
+                continue;
+            }
+            results[i].iFlags = BACKUP_RESPONSE;
+        }
+
+        results[i].iErrorCode = CMD_ERROR_SUCCESS;
+        results[i].iServerID = server->ServerID;
+        strncpy(results[i].sServerIP, server->sServerIP, IP_LENGTH - 1);
+        results[i].iServerPort = server->sServerPort_Client;
+        iResolvedCount++;
+    }
+    free(servers);
+
+    LOG_INFO("[+]Client Handler Thread: Resolved %d of %u paths for client %lu", iResolvedCount, batch->iPathCount, client->ClientID);
+    Stats_Record(CMD_RESOLVE_BATCH, iStartNs, 0);
+    return iResolvedCount;
+}
+
 void *Client_Acceptor_Thread()
 {
-    printf(UGRN "[+]Client Acceptor Thread Initialized\n" reset);
-    fprintf(logs, "[+]Client Acceptor Thread Initialized [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Client Acceptor Thread Initialized");
 
     // Create a socket
     int iServerSocket = socket(AF_INET, SOCK_STREAM, 0);
     if (CheckError(iServerSocket, "[-]Client Acceptor Thread: Error in creating socket"))
         exit(EXIT_FAILURE);
+    // A restarted naming server binds again while the connections of the previous one are in TIME_WAIT
+    int iReuse = 1;
+    setsockopt(iServerSocket, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof(iReuse));
 
     // Specify an address for the socket
     struct sockaddr_in server_address;
@@ -156,8 +593,7 @@ void *Client_Acceptor_Thread()
     if (CheckError(iListenStatus, "[-]Client Acceptor Thread: Error in listening for connections"))
         exit(EXIT_FAILURE);
 
-    printf(GRN "[+]Client Acceptor Thread: Listening for connections\n" reset);
-    fprintf(logs, "[+]Client Acceptor Thread: Listening for connections [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Client Acceptor Thread: Listening for connections");
 
     struct sockaddr_in client_address;
     socklen_t iClientSize = sizeof(client_address);
@@ -167,7 +603,7 @@ void *Client_Acceptor_Thread()
     {
         if (CheckError(iClientSocket, "[-]Client Acceptor Thread: Error in accepting connection"))
         {
-            fprintf(logs, "[-]Client Acceptor Thread: Error in accepting connection [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Client Acceptor Thread: Error in accepting connection");
             continue;
         }
 
@@ -176,34 +612,102 @@ void *Client_Acceptor_Thread()
         strncpy(clientHandle.sClientIP, inet_ntoa(client_address.sin_addr), IP_LENGTH);
         clientHandle.sClientPort = ntohs(client_address.sin_port);
         clientHandle.iClientSocket = iClientSocket;
+        clientHandle.iWireVersion = WIRE_VERSION_UNKNOWN;
 
         // Add the client to the client list
         if (CheckError(AddClient(&clientHandle, clientHandleList), "[-]Client Acceptor Thread: Error in adding client to client list"))
         {
-            fprintf(logs, "[-]Client Acceptor Thread: Error in adding client to client list [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Client Acceptor Thread: Error in adding client to client list");
             close(iClientSocket);
             continue;
         }
 
-        // Create a thread to handle the client
+        // Create a thread to handle the client (it owns a copy of the handle, the next accept reuses ours)
+        CLIENT_HANDLE_STRUCT *threadHandle = (CLIENT_HANDLE_STRUCT *)malloc(sizeof(CLIENT_HANDLE_STRUCT));
         pthread_t tClientHandlerThread;
-        int iThreadStatus = pthread_create(&tClientHandlerThread, NULL, Client_Handler_Thread, (void *)&clientHandle);
+        int iThreadStatus = -1;
+        if (!CheckNull(threadHandle, "[-]Client Acceptor Thread: Error in allocating client handle"))
+        {
+            *threadHandle = clientHandle;
+            iThreadStatus = pthread_create(&tClientHandlerThread, NULL, Client_Handler_Thread, (void *)threadHandle);
+        }
         if (CheckError(iThreadStatus, "[-]Client Acceptor Thread: Error in creating thread"))
         {
-            fprintf(logs, "[-]Client Acceptor Thread: Error in creating thread [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Client Acceptor Thread: Error in creating thread");
+            free(threadHandle);
+            RemoveClient(clientHandle.ClientID, clientHandleList);
             close(iClientSocket);
             continue;
         }
+        pthread_detach(tClientHandlerThread);
     }
 
     return NULL;
 }
 
+/**
+ * @brief Receives the next message of a threaded client
+ * @param sockfd: The client socket
+ * @param ctx: The wire context of the connection (receives the request ID)
+ * @param request: Filled with the request
+ * @param batch: Filled with the paths if the message is a CMD_RESOLVE_BATCH (batch->Paths is NULL otherwise)
+ * @return: Number of bytes received, 0 if the client closed the connection, -1 on failure
+ */
+int Recv_Client_Message(int sockfd, WIRE_CONTEXT_STRUCT *ctx, REQUEST_STRUCT *request, RESOLVE_BATCH_STRUCT *batch)
+{
+    memset(batch, 0, sizeof(RESOLVE_BATCH_STRUCT));
+    if (ctx->iVersion != WIRE_VERSION_2)
+        return Recv_Request(sockfd, ctx, request);
+
+    WIRE_HEADER_STRUCT header;
+    char *payload;
+    int iRecvStatus = Recv_Frame_Alloc(sockfd, 0, &header, &payload, WIRE_MAX_BATCH_PAYLOAD);
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+
+    int iDecodeStatus;
+    if (header.iFrameType == FRAME_RESOLVE_BATCH)
+        iDecodeStatus = Wire_Decode_Resolve_Batch(&header, payload, ctx, batch);
+    else
+        iDecodeStatus = Wire_Decode_Request(&header, payload, ctx, request);
+    free(payload);
+    return (iDecodeStatus < 0) ? -1 : iRecvStatus;
+}
+
+/**
+ * @brief Resolves a batch and sends the results to a threaded client
+ * @param client: The requesting client
+ * @param ctx: The wire context of the batch
+ * @param batch: The decoded batch
+ * @return: 0 on success, -1 on failure
+ */
+int Send_Resolve_Batch_Results(CLIENT_HANDLE_STRUCT *client, WIRE_CONTEXT_STRUCT *ctx, RESOLVE_BATCH_STRUCT *batch)
+{
+    RESOLVE_RESULT_STRUCT *results = (RESOLVE_RESULT_STRUCT *)malloc(batch->iPathCount * sizeof(RESOLVE_RESULT_STRUCT));
+    if (CheckNull(results, "[-]Send_Resolve_Batch_Results: Error in allocating memory"))
+        return -1;
+
+    char *buffer = NULL;
+    int length = -1;
+    if (Handle_Resolve_Batch(client, batch, results) >= 0)
+        length = Wire_Encode_Resolve_Results(ctx, results, batch->iPathCount, &buffer);
+    free(results);
+    if (length < 0)
+        return -1;
+
+    pthread_mutex_lock(GetClientSendLock(client));
+    int iSendStatus = Send_All(client->iClientSocket, buffer, length);
+    pthread_mutex_unlock(GetClientSendLock(client));
+    free(buffer);
+    return (iSendStatus < 0) ? -1 : 0;
+}
+
 void *Client_Handler_Thread(void *clientHandle)
 {
-    CLIENT_HANDLE_STRUCT *client = (CLIENT_HANDLE_STRUCT *)clientHandle;
-    printf(UGRN "[+]Client Handler Thread Initialized for Client %lu (%s:%d)\n" reset, client->ClientID, client->sClientIP, client->sClientPort);
-    fprintf(logs, "[+]Client Handler Thread Initialized for Client %lu (%s:%d) [Time Stamp: %f]\n", client->ClientID, client->sClientIP, client->sClientPort, GetCurrTime(Clock));
+    CLIENT_HANDLE_STRUCT clientCopy = *(CLIENT_HANDLE_STRUCT *)clientHandle;
+    CLIENT_HANDLE_STRUCT *client = &clientCopy;
+    free(clientHandle);
+    LOG_INFO("[+]Client Handler Thread Initialized for Client %lu (%s:%d)", client->ClientID, client->sClientIP, client->sClientPort);
 
     /*
     // Send data to the client
@@ -217,8 +721,7 @@ void *Client_Handler_Thread(void *clientHandle)
     int iRecvStatus = recv(client->iClientSocket, &sClientRequest, sizeof(sClientRequest), 0);
     if(CheckError(iRecvStatus, "[-]Client Handler Thread: Error in receiving data from client")) return NULL;
 
-    printf(GRN"[+]Client Handler Thread: Client %lu sent: %s\n"reset, client->ClientID, sClientRequest);
-    fprintf(logs, "[+]Client Handler Thread: Client %lu sent: %s\n", client->ClientID, sClientRequest);
+    LOG_INFO("[+]Client Handler Thread: Client %lu sent: %s", client->ClientID, sClientRequest);
     */
 
     // Send The Client It alloted ID
@@ -226,295 +729,115 @@ void *Client_Handler_Thread(void *clientHandle)
     int iSendStatus = send(client->iClientSocket, &ClientID, sizeof(unsigned long), 0);
     if (CheckError(iSendStatus, "[-]Client Handler Thread: Error in sending data to client"))
     {
-        fprintf(logs, "[-]Client Handler Thread: Error in sending data to client [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Client Handler Thread: Error in sending data to client");
         RemoveClient(ClientID, clientHandleList);
         close(client->iClientSocket);
         return NULL;
     }
 
+    // Negotiate the wire protocol (a v2 client starts with a HELLO frame)
+    WIRE_CONTEXT_STRUCT ctx = {WIRE_VERSION_UNKNOWN, 0};
+    ctx.iVersion = Wire_Detect_Version(client->iClientSocket);
+    if (ctx.iVersion == WIRE_VERSION_2)
+        ctx.iVersion = Wire_Server_Hello(client->iClientSocket);
+    if (ctx.iVersion <= 0)
+    {
+        LOG_ERROR("[-]Client Handler Thread: Client %lu (%s:%d) disconnected during protocol negotiation", client->ClientID, client->sClientIP, client->sClientPort);
+        RemoveClient(ClientID, clientHandleList);
+        close(client->iClientSocket);
+        return NULL;
+    }
+    client->iWireVersion = ctx.iVersion;
+    SetClientWireVersion(ClientID, ctx.iVersion, clientHandleList);
+    LOG_INFO("[+]Client Handler Thread: Client %lu speaks wire protocol v%d", ClientID, ctx.iVersion);
+
     // Set Up request listener for the client
     int ConnStatus, CloseRequest = 0;
     while (ConnStatus = IsSocketConnected(client->iClientSocket))
     {
         // Receive the request from the client
         REQUEST_STRUCT request;
+        RESOLVE_BATCH_STRUCT batch = {0};
 
-        int iRecvStatus = recv(client->iClientSocket, &request, sizeof(request), 0);
+        int iRecvStatus = Recv_Client_Message(client->iClientSocket, &ctx, &request, &batch);
         if (CheckError(iRecvStatus, "[-]Client Handler Thread: Error in receiving data from client"))
         {
-            fprintf(logs, "[-]Client Handler Thread: Error in receiving data from client [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Client Handler Thread: Error in receiving data from client");
             RemoveClient(ClientID, clientHandleList);
             close(client->iClientSocket);
             return NULL;
         }
         else if (iRecvStatus == 0)
             break;
-        // Check if the client requested to close the connection
-        if (request.iRequestOperation == CLOSE_CONNECTION)
-        {
-            printf(UGRN "[+]Client Handler Thread: Client %lu requested to close connection\n" reset, client->ClientID);
-            fprintf(logs, "[+]Client Handler Thread: Client %lu requested to close connection\n", client->ClientID);
-            CloseRequest = 1;
-            break;
-        }
-        // Handle the request (Generate a response)
-        RESPONSE_STRUCT response;
-        memset(&response, 0, sizeof(response));
-        response.iResponseOperation = request.iRequestOperation;
-        response.iResponseErrorCode = CMD_ERROR_SUCCESS;
-
-        switch (request.iRequestOperation)
-        {
-        case CMD_READ:
-        {
-            printf(GRN "[+]Client Handler Thread: Client %lu requested to read file %s\n" reset, client->ClientID, request.sRequestPath);
-            fprintf(logs, "[+]Client Handler Thread: Client %lu requested to read file %s [Time Stamp: %f]\n", client->ClientID, request.sRequestPath, GetCurrTime(Clock));
-            // Do a path resolution
-            SERVER_HANDLE_STRUCT *server = ResolvePath(request.sRequestPath);
-
-            if (server == NULL)
-            {
-                printf(RED "[-]Client Handler Thread: Error in resolving path for client %lu\n" reset, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Error in resolving path for client %lu [Time Stamp: %f]\n", client->ClientID, GetCurrTime(Clock));
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
-                break;
-            }
-
-            response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
-            // Check if the server is active
-            if (IsActive(server->ServerID, serverHandleList) == 0)
-            {
-                // Switch to backup server
-                server = GetActiveBackUp(serverHandleList, server->backupServers);
-                if (server == NULL)
-                {
-                    fprintf(logs, "[-]Client Handler Thread: Error in getting active backup server for client %lu\n", client->ClientID);
-                    response.iResponseErrorCode = CMD_ERROR_BACKUP_UNAVAILABLE;
-                    response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                    break;
-                }
-                response.iResponseFlags = BACKUP_RESPONSE;
-                fprintf(logs, "[+]Client Handler Thread: Switched to backup server %lu (%s:%d) for client %lu\n", server->ServerID, server->sServerIP, server->sServerPort_Client, client->ClientID);
-            }
 
-            printf(GRN "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n" reset, request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-            fprintf(logs, "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n", request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-            // Populate the response struct with Server IP and Port
-            snprintf(response.sResponseData, MAX_BUFFER_SIZE, "%s %d", server->sServerIP, server->sServerPort_Client);
-            response.iResponseServerID = server->ServerID;
-            break;
-        }
-        case CMD_WRITE:
+        // A batch is answered with a single results frame
+        if (batch.Paths != NULL)
         {
-            printf(GRN "[+]Client Handler Thread: Client %lu requested to write file %s\n" reset, client->ClientID, request.sRequestPath);
-            fprintf(logs, "[+]Client Handler Thread: Client %lu requested to write file %s\n", client->ClientID, request.sRequestPath);
-            // Do a path resolution
-            SERVER_HANDLE_STRUCT *server = ResolvePath(request.sRequestPath);
-
-            if (server == NULL)
-            {
-                printf(RED "[-]Client Handler Thread: Error in resolving path for client %lu\n" reset, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Error in resolving path for client %lu\n", client->ClientID);
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
-                break;
-            }
-
-            response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
-            // Check if the server is active
-            if (IsActive(server->ServerID, serverHandleList) == 0)
+            int iSendStatus = Send_Resolve_Batch_Results(client, &ctx, &batch);
+            Free_Resolve_Batch(&batch);
+            if (iSendStatus < 0)
             {
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_SERVER_UNAVAILABLE;
+                LOG_ERROR("[-]Client Handler Thread: Error in sending resolve results to client %lu", client->ClientID);
                 break;
             }
-
-            printf(GRN "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n" reset, request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-            fprintf(logs, "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n", request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-            // Populate the response struct with Server IP and Port
-            snprintf(response.sResponseData, MAX_BUFFER_SIZE, "%s %d", server->sServerIP, server->sServerPort_Client);
-            response.iResponseServerID = server->ServerID;
-            break;
-        }
-        case CMD_INFO:
-        {
-            printf(GRN "[+]Client Handler Thread: Client %lu requested info for file %s\n" reset, client->ClientID, request.sRequestPath);
-            fprintf(logs, "[+]Client Handler Thread: Client %lu requested info for file %s\n", client->ClientID, request.sRequestPath);
-
-            // Do a path resolution
-            SERVER_HANDLE_STRUCT *server = ResolvePath(request.sRequestPath);
-
-            if (server == NULL)
-            {
-                printf(RED "[-]Client Handler Thread: Error in resolving path for client %lu\n" reset, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Error in resolving path for client %lu\n", client->ClientID);
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
-                break;
-            }
-
-            response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
-
-            // Check if the server is active
-            if (IsActive(server->ServerID, serverHandleList) == 0)
-            {
-                // Switch to backup server
-                server = GetActiveBackUp(serverHandleList, server->backupServers);
-                if (server == NULL)
-                {
-                    fprintf(logs, "[-]Client Handler Thread: Error in getting active backup server for client %lu\n", client->ClientID);
-                    response.iResponseErrorCode = CMD_ERROR_BACKUP_UNAVAILABLE;
-                    response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                    break;
-                }
-                response.iResponseFlags = BACKUP_RESPONSE;
-                fprintf(logs, "[+]Client Handler Thread: Switched to backup server %lu (%s:%d) for client %lu\n", server->ServerID, server->sServerIP, server->sServerPort_Client, client->ClientID);
-            }
-
-            printf(GRN "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n" reset, request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-            fprintf(logs, "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n", request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-
-            // Populate the response struct with Server IP and Port
-            snprintf(response.sResponseData, MAX_BUFFER_SIZE, "%s %d", server->sServerIP, server->sServerPort_Client);
-            response.iResponseServerID = server->ServerID;
-
-            break;
-        }
-        case CMD_LIST:
-        {
-            printf(GRN "[+]Client Handler Thread: Client %lu requested to list directory %s\n" reset, client->ClientID, request.sRequestPath);
-            fprintf(logs, "[+]Client Handler Thread: Client %lu requested to list directory %s\n", client->ClientID, request.sRequestPath);
-
-            // Populate the response struct with paths under requested path
-            int err = Get_Directory_Tree(MountTrie, request.sRequestPath, response.sResponseData);
-            if (err == -2)
-            {
-                printf(RED "[-]Client Handler Thread: Error in getting directory tree for client %lu\n" reset, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Error in getting directory tree for client %lu\n", client->ClientID);
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = ERROR_GETTING_MOUNT_PATHS;
-                break;
-            }
-            else if (err == -1)
-            {
-                printf(RED "[-]Client Handler Thread: Invalid Path %s for client %lu\n" reset, request.sRequestPath, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Invalid Path %s for client %lu\n", request.sRequestPath, client->ClientID);
-                response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                break;
-            }
-
-            response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
-            response.iResponseErrorCode = CMD_ERROR_SUCCESS;
-
-            break;
-        }
-
-        case CMD_RENAME:
-        {
-            printf(GRN "[+]Client Handler Thread: Client %lu requested to rename file %s\n" reset, client->ClientID, request.sRequestPath);
-            fprintf(logs, "[+]Client Handler Thread: Client %lu requested to rename file %s\n", client->ClientID, request.sRequestPath);
-
-            char path[MAX_BUFFER_SIZE];
-            strncpy(path, request.sRequestPath, MAX_BUFFER_SIZE);
-            strtok(path, " ");
-
-            // Do a path resolution
-            SERVER_HANDLE_STRUCT *server = ResolvePath(request.sRequestPath);
-
-            if (server == NULL)
-            {
-                printf(RED "[-]Client Handler Thread: Error in resolving path for client %lu\n" reset, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Error in resolving path for client %lu\n", client->ClientID);
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
-                break;
-            }
-
-            response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
-
-            // Check if the server is active
-            if (IsActive(server->ServerID, serverHandleList) == 0)
-            {
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_SERVER_UNAVAILABLE;
-                break;
-            }
-
-            // Populate the response struct with Server ID
-            response.iResponseServerID = server->ServerID;
-
-            printf(GRN "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n" reset, request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-            fprintf(logs, "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n", request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-
-            // Forward the request to the server
-            int iSendStatus = send(server->sSocket_Write, &request, sizeof(request), 0);
-            if (CheckError(iSendStatus, "[-]Client Handler Thread: Error in sending request to server"))
-            {
-                printf(RED "[-]Client Handler Thread: Error in sending request to server for client %lu\n" reset, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Error in sending request to server for client %lu\n", client->ClientID);
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_FWD_FAILED;
-                break;
-            }
-
-            strncpy(response.sResponseData, "Request forwarded to server", MAX_BUFFER_SIZE);
-            break;
+            continue;
         }
-
-        default:
+        // Check if the client requested to close the connection
+        if (request.iRequestOperation == CLOSE_CONNECTION)
         {
-            response.iResponseErrorCode = CMD_ERROR_INVALID_OPERATION;
-            response.iResponseFlags = RESPONSE_FLAG_FAILURE;
+            LOG_INFO("[+]Client Handler Thread: Client %lu requested to close connection", client->ClientID);
+            CloseRequest = 1;
             break;
         }
-        }
+        // Handle the request (Generate a response)
+        RESPONSE_STRUCT response;
+        Handle_Client_Request(client, &ctx, &request, &response);
 
-        // Send the response to the client
-        int iSendStatus = send(client->iClientSocket, &response, sizeof(response), 0);
-        if (iSendStatus != sizeof(response))
+        // Send the response to the client (ACKs for earlier requests may be written concurrently)
+        pthread_mutex_lock(GetClientSendLock(client));
+        int iSendStatus = Send_Response(client->iClientSocket, &ctx, &response);
+        pthread_mutex_unlock(GetClientSendLock(client));
+        if (iSendStatus < 0)
         {
-            printf(RED "[-]Client Handler Thread: Error in sending response to client %lu\n" reset, client->ClientID);
-            fprintf(logs, "[-]Client Handler Thread: Error in sending response to client %lu\n", client->ClientID);
+            LOG_ERROR("[-]Client Handler Thread: Error in sending response to client %lu", client->ClientID);
             break;
         }
 
-        printf(GRN "[+]Client Handler Thread: Sent response to client %lu\n" reset, client->ClientID);
-        fprintf(logs, "[+]Client Handler Thread: Sent response {%s} to client %lu\n", response.sResponseData, client->ClientID);
+        LOG_INFO("[+]Client Handler Thread: Sent response {%s} to client %lu", response.sResponseData, client->ClientID);
     }
     if (CheckError(ConnStatus, "[-]Client Handler Thread: Error in checking if socket is connected"))
     {
-        printf(RED "[-]Client Handler Thread: Error in checking if socket is connected for client %lu\n" reset, client->ClientID);
-        fprintf(logs, "[-]Client Handler Thread: Error in checking if socket is connected for client %lu\n", client->ClientID);
+        LOG_ERROR("[-]Client Handler Thread: Error in checking if socket is connected for client %lu", client->ClientID);
     }
     else if (CloseRequest)
     {
-        printf(BHGRN "[+]Client Handler Thread: Client %lu (%s:%d) disconnected(GRACEFULLY)\n" reset, client->ClientID, client->sClientIP, client->sClientPort);
-        fprintf(logs, "[+]Client Handler Thread: Client %lu (%s:%d) disconnected(GRACEFULLY)\n", client->ClientID, client->sClientIP, client->sClientPort);
+        LOG_INFO("[+]Client Handler Thread: Client %lu (%s:%d) disconnected(GRACEFULLY)", client->ClientID, client->sClientIP, client->sClientPort);
     }
     else
     {
-        printf(BHRED "[-]Client Handler Thread: Client %lu (%s:%d) disconnected(UNGRACEFULLY)\n" reset, client->ClientID, client->sClientIP, client->sClientPort);
-        fprintf(logs, "[-]Client Handler Thread: Client %lu (%s:%d) disconnected(UNGRACEFULLY)\n", client->ClientID, client->sClientIP, client->sClientPort);
+        LOG_ERROR("[-]Client Handler Thread: Client %lu (%s:%d) disconnected(UNGRACEFULLY)", client->ClientID, client->sClientIP, client->sClientPort);
     }
 
-    // Close the socket
+    // Close the socket (under the send lock so that an ACK writer never sees the descriptor reused)
     RemoveClient(ClientID, clientHandleList);
+    pthread_mutex_lock(GetClientSendLock(client));
     close(client->iClientSocket);
+    pthread_mutex_unlock(GetClientSendLock(client));
 
     return NULL;
 }
 
 void *Storage_Server_Acceptor_Thread()
 {
-    printf(UGRN "[+]Storage Server Acceptor Thread Initialized\n" reset);
-    fprintf(logs, "[+]Storage Server Acceptor Thread Initialized [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Storage Server Acceptor Thread Initialized");
 
     // Create a socket
     int iServerSocket = socket(AF_INET, SOCK_STREAM, 0);
     if (CheckError(iServerSocket, "[-]Storage Server Acceptor Thread: Error in creating socket"))
         exit(EXIT_FAILURE);
+    // A restarted naming server binds again while the connections of the previous one are in TIME_WAIT
+    int iReuse = 1;
+    setsockopt(iServerSocket, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof(iReuse));
 
     // Specify an address for the socket
     struct sockaddr_in server_address;
@@ -533,8 +856,7 @@ void *Storage_Server_Acceptor_Thread()
     if (CheckError(iListenStatus, "[-]Storage Server Acceptor Thread: Error in listening for connections"))
         exit(EXIT_FAILURE);
 
-    printf(GRN "[+]Storage Server Acceptor Thread: Listening for connections\n" reset);
-    fprintf(logs, "[+]Storage Server Acceptor Thread: Listening for connections [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Storage Server Acceptor Thread: Listening for connections");
 
     struct sockaddr_in client_address;
     socklen_t iClientSize = sizeof(client_address);
@@ -547,12 +869,14 @@ void *Storage_Server_Acceptor_Thread()
 
         // Store the server IP and Port in Server Handle Struct
         SERVER_HANDLE_STRUCT serverHandle;
+        memset(&serverHandle, 0, sizeof(serverHandle));
         strncpy(serverHandle.sServerIP, inet_ntoa(client_address.sin_addr), IP_LENGTH);
         serverHandle.sServerPort = ntohs(client_address.sin_port);
         serverHandle.sSocket_Write = iClientSocket;
 
-        // Add the server to the server list
-        if (CheckError(AddServer(&serverHandle, serverHandleList), "[-]Storage Server Acceptor Thread: Error in adding server to server list"))
+        // Add the server to the server list, the handler works on the registered handle
+        SERVER_HANDLE_STRUCT *server = AddServer(&serverHandle, serverHandleList);
+        if (CheckNull(server, "[-]Storage Server Acceptor Thread: Error in adding server to server list"))
         {
             close(iClientSocket);
             continue;
@@ -560,37 +884,61 @@ void *Storage_Server_Acceptor_Thread()
 
         // Create a thread to handle the server
         pthread_t tServerHandlerThread;
-        int iThreadStatus = pthread_create(&tServerHandlerThread, NULL, Storage_Server_Handler_Thread, (void *)&serverHandle);
+        int iThreadStatus = pthread_create(&tServerHandlerThread, NULL, Storage_Server_Handler_Thread, (void *)server);
         if (CheckError(iThreadStatus, "[-]Storage Server Acceptor Thread: Error in creating thread"))
             continue;
+        pthread_detach(tServerHandlerThread);
     }
 }
 
+/**
+ * @brief Drops a storage server whose connection failed once its paths were registered
+ * @param server: The server handle
+ * @note: The trie and the journal map the server's paths to the handle, so it is only set inactive
+ *        (lookups fall back to its backups) and the next registration from its address reconciles it
+ */
+static void Drop_Registered_Server(SERVER_HANDLE_STRUCT *server)
+{
+    close(server->sSocket_Write);
+    SetInactive(server->ServerID, serverHandleList);
+}
+
 void *Storage_Server_Handler_Thread(void *storageServerHandle)
 {
     SERVER_HANDLE_STRUCT *server = (SERVER_HANDLE_STRUCT *)storageServerHandle;
-    printf(UGRN "[+]Storage Server Handler Thread Initialized for Server (%s:%d)\n" reset, server->sServerIP, server->sServerPort);
-    fprintf(logs, "[+]Storage Server Handler Thread Initialized for Server (%s:%d) [Time Stamp: %f]\n", server->sServerIP, server->sServerPort, GetCurrTime(Clock));
+    LOG_INFO("[+]Storage Server Handler Thread Initialized for Server (%s:%d)", server->sServerIP, server->sServerPort);
+
+    // Negotiate the wire protocol right away, the server only waits WIRE_HELLO_TIMEOUT for the answer
+    WIRE_CONTEXT_STRUCT ctx = {WIRE_VERSION_UNKNOWN, 0};
+    ctx.iVersion = Wire_Detect_Version(server->sSocket_Write);
+    if (ctx.iVersion == WIRE_VERSION_2)
+        ctx.iVersion = Wire_Server_Hello(server->sSocket_Write);
+    if (CheckError(ctx.iVersion - 1, "[-]Storage Server Handler Thread: Error in negotiating wire protocol"))
+    {
+        LOG_ERROR("[-]Storage Server Handler Thread: Error in negotiating wire protocol");
+        RemoveServer(GetServerID(server), serverHandleList);
+        close(server->sSocket_Write);
+        return NULL;
+    }
+    server->iWireVersion = ctx.iVersion;
 
     // Post the semaphore to indicate that a server is online
     sem_post(&serverStartSem);
 
     // Check if enough servers are running for backups
-    if (serverHandleList->iServerCount < (BACKUP_SERVERS + 1))
+    if (GetServerCount(serverHandleList) < (BACKUP_SERVERS + 1))
     {
-        printf(YELHB "[+]Storage Server Handler Thread: Waiting for enough servers to be online\n" reset);
-        fprintf(logs, "[+]Storage Server Handler Thread: Waiting for other servers to start [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_INFO("[+]Storage Server Handler Thread: Waiting for other servers to start");
 
         sem_wait(&serverStartSem);
 
-        printf(GRN "[+]Storage Server Handler Thread: servers online\n" reset);
-        fprintf(logs, "[+]Storage Server Handler Thread: servers online [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_INFO("[+]Storage Server Handler Thread: servers online");
     }
 
     // Recieve the Server Init Packet
-    STORAGE_SERVER_INIT_STRUCT serverInitPacket;
-    int iRecvStatus = recv(server->sSocket_Write, &serverInitPacket, sizeof(serverInitPacket), 0);
-    if (CheckError(iRecvStatus, "[-]Storage Server Handler Thread: Error in receiving data from server"))
+    SERVER_INIT_INFO_STRUCT serverInitPacket;
+    int iRecvStatus = Recv_Server_Init(server->sSocket_Write, &ctx, &serverInitPacket);
+    if (CheckError(iRecvStatus - 1, "[-]Storage Server Handler Thread: Error in receiving data from server"))
     {
         RemoveServer(GetServerID(server), serverHandleList);
         close(server->sSocket_Write);
@@ -601,35 +949,26 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
     server->sServerPort_Client = serverInitPacket.sServerPort_Client;
     server->sServerPort_NServer = serverInitPacket.sServerPort_NServer;
 
-    // Extract indivisual path from the mount paths string (tokenize on \n) and Insert into the mount trie
-    char *token = serverInitPacket.MountPaths;
-    while (strlen(token))
+    // Insert the paths into the mount trie (journaled, replacing the handle the server had before a restart)
+    long iInserted = Mount_Table_Register(server, serverInitPacket.MountPaths);
+    free(serverInitPacket.MountPaths);
+    if (CheckError(iInserted, "[-]Storage Server Handler Thread: Error in inserting path into mount trie"))
     {
-        char *path_tok = __strtok_r(token, "\n", &token);
-        // Removing the the first token in the path [e.g. (server name/~) , (./~) , (mount/~) , etc.]
-        // Is handled by the Insert_Path function
-        int err_code = Insert_Path(MountTrie, path_tok, server);
-        if (CheckError(err_code, "[-]Storage Server Handler Thread: Error in inserting path into mount trie"))
-        {
-            fprintf(logs, "[-]Storage Server Handler Thread: Error in inserting path into mount trie\n");
-            RemoveServer(GetServerID(server), serverHandleList);
-            close(server->sSocket_Write);
-            return NULL;
-        }
+        LOG_ERROR("[-]Storage Server Handler Thread: Error in inserting path into mount trie");
+        Drop_Registered_Server(server);
+        return NULL;
     }
 
-    printf(GRN "[+]Storage Server Handler Thread: Server %lu (%s:%d) Paths Inserted\n" reset, server->ServerID, server->sServerIP, server->sServerPort);
-    fprintf(logs, "[+]Storage Server Handler Thread: Server %lu (%s:%d) Paths Inserted [Time Stamp: %f]\n", server->ServerID, server->sServerIP, server->sServerPort, GetCurrTime(Clock));
-
-    printf(BHWHT "{Current Mount Trie}\n" reset);
-    Print_Trie(MountTrie, 0);
+    // The table itself is only dumped on demand (snapshot on the admin port)
+    JOURNAL_STATS_STRUCT journalStats;
+    Journal_Get_Stats(&journalStats);
+    LOG_INFO("[+]Storage Server Handler Thread: Server %lu (%s:%d) %ld Paths Inserted (journal at record %lu)", server->ServerID, server->sServerIP, server->sServerPort, iInserted, (unsigned long)journalStats.iSequence);
 
     // Set Up the Backup Servers for the server
     int err_code = AssignBackupServer(serverHandleList, server->ServerID);
     if (CheckError(err_code, "[-]Storage Server Handler Thread: Error in assigning backup servers"))
     {
-        RemoveServer(server->ServerID, serverHandleList);
-        close(server->sSocket_Write);
+        Drop_Registered_Server(server);
         return NULL;
     }
 
@@ -640,9 +979,8 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
     int iSendStatus = send(server->sSocket_Write, &ServerID, sizeof(unsigned long), 0);
     if (CheckError(iSendStatus, "[-]Storage Server Handler Thread: Error in sending ID to server"))
     {
-        fprintf(logs, "[-]Storage Server Handler Thread: Error in sending data to server [Time Stamp: %f]\n", GetCurrTime(Clock));
-        RemoveServer(GetServerID(server), serverHandleList);
-        close(server->sSocket_Write);
+        LOG_ERROR("[-]Storage Server Handler Thread: Error in sending data to server");
+        Drop_Registered_Server(server);
         return NULL;
     }
 
@@ -650,8 +988,7 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
     int iServerSocket = socket(AF_INET, SOCK_STREAM, 0);
     if (CheckError(iServerSocket, "[-]Storage Server Handler Thread: Error in creating socket"))
     {
-        RemoveServer(GetServerID(server), serverHandleList);
-        close(server->sSocket_Write);
+        Drop_Registered_Server(server);
         return NULL;
     }
 
@@ -670,21 +1007,18 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
         {
             if (tries > MAX_CONN_REQ)
             {
-                printf(RED "[-]Storage Server Handler Thread: Error in connecting to server. Max tries reached\n" reset);
-                fprintf(logs, "[-]Storage Server Handler Thread: Error in connecting to server. Max tries reached [Time Stamp: %f]\n", GetCurrTime(Clock));
-                RemoveServer(GetServerID(server), serverHandleList);
-                close(server->sSocket_Write);
+                LOG_ERROR("[-]Storage Server Handler Thread: Error in connecting to server. Max tries reached");
+                close(iServerSocket);
+                Drop_Registered_Server(server);
                 return NULL;
             }
-            printf("Trying Again...\n");
-            fprintf(logs, "[-]Storage Server Handler Thread: Error in connecting to server.Trying Again... [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Storage Server Handler Thread: Error in connecting to server.Trying Again...");
             tries++;
             sleep(CONN_TIMEOUT);
         }
     }
 
-    printf(GRN "[+]Storage Server Handler Thread: Connected to server %lu (%s:%d) for listening\n" reset, server->ServerID, server->sServerIP, server->sServerPort_NServer);
-    fprintf(logs, "[+]Storage Server Handler Thread: Connected to server %lu (%s:%d) for listening [Time Stamp: %f]\n", server->ServerID, server->sServerIP, server->sServerPort_NServer, GetCurrTime(Clock));
+    LOG_INFO("[+]Storage Server Handler Thread: Connected to server %lu (%s:%d) for listening", server->ServerID, server->sServerIP, server->sServerPort_NServer);
 
     server->sSocket_Read = iServerSocket;
 
@@ -693,17 +1027,16 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
         // Receive the response from the server
         RESPONSE_STRUCT response_struct;
         RESPONSE_STRUCT *response = &response_struct;
-        int iRecvStatus = recv(server->sSocket_Write, response, sizeof(response_struct), 0);
+        int iRecvStatus = Recv_Response(server->sSocket_Read, &ctx, response);
         if (CheckError(iRecvStatus, "[-]Storage Server Handler Thread: Error in receiving data from server"))
         {
-            RemoveServer(GetServerID(server), serverHandleList);
-            close(server->sSocket_Write);
+            close(server->sSocket_Read);
+            Drop_Registered_Server(server);
             return NULL;
         }
         else if (iRecvStatus == 0)
         {
-            printf(RED "[-]Storage Server Handler Thread: Server %lu (%s:%d) disconnected(UNGRACEFULLY)\n" reset, server->ServerID, server->sServerIP, server->sServerPort);
-            fprintf(logs, "[-]Storage Server Handler Thread: Server %lu (%s:%d) disconnected(UNGRACEFULLY) [Time Stamp: %f]\n", server->ServerID, server->sServerIP, server->sServerPort, GetCurrTime(Clock));
+            LOG_ERROR("[-]Storage Server Handler Thread: Server %lu (%s:%d) disconnected(UNGRACEFULLY)", server->ServerID, server->sServerIP, server->sServerPort);
 
             close(server->sSocket_Write);
             close(server->sSocket_Read);
@@ -718,8 +1051,9 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
         }
 
         // Handle the request (Forward the response to respective client/server)
-        printf(GRN "[+]Storage Server Handler Thread: Request received from server %lu\n" reset, server->ServerID);
-        fprintf(logs, "[+]Storage Server Handler Thread: Request received from server %lu [Time Stamp: %f]\n", server->ServerID, GetCurrTime(Clock));
+        LOG_INFO("[+]Storage Server Handler Thread: Request received from server %lu", server->ServerID);
+        uint64_t iStartNs = Stats_Now();
+        int iFailed = 1;
 
         switch (response->iResponseOperation)
         {
@@ -727,117 +1061,236 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
         {
             ACK_STRUCT ack_struct;
             ACK_STRUCT *ack = &ack_struct;
-
-            unsigned long clientID;
-
-            char data[MAX_BUFFER_SIZE];
-            char *token;
-            strncpy(data, response->sResponseData, MAX_BUFFER_SIZE);
-            __strtok_r(data, " ", &token);
-
-            clientID = (unsigned long)(atoll(token));
-
+            memset(ack, 0, sizeof(ACK_STRUCT));
+            strncpy(ack->sAckData, response->sResponseData, MAX_BUFFER_SIZE);
             ack->iAckErrorCode = response->iResponseErrorCode;
-            strncpy(ack->sAckData, data, MAX_BUFFER_SIZE);
             ack->iAckFlags = response->iResponseFlags;
 
+            // Find the request the reply belongs to
+            unsigned long clientID;
+            uint32_t iClientRequestID = 0;
+            if (ctx.iVersion == WIRE_VERSION_2)
+            {
+                FORWARD_ENTRY_STRUCT forward;
+                if (CheckError(TakePendingForward(ctx.iRequestID, &forward, forwardTable), "[-]Storage Server Handler Thread: Reply to an unknown request"))
+                    break;
+                clientID = forward.ClientID;
+                iClientRequestID = forward.iClientRequestID;
+            }
+            else
+            {
+                // A v1 server appends the client ID to the reply data
+                char *sep = strrchr(ack->sAckData, ' ');
+                if (CheckNull(sep, "[-]Storage Server Handler Thread: Reply without a client ID"))
+                    break;
+                *sep = '\0';
+                clientID = strtoul(sep + 1, NULL, 10);
+            }
+
             if (response->iResponseErrorCode)
             {
-                printf(RED "[-]Storage Server Handler Thread: Error in renaming file\n" reset);
-                fprintf(logs, "[-]Storage Server Handler Thread: Error in renaming file [Time Stamp: %f]\n", GetCurrTime(Clock));
+                LOG_ERROR("[-]Storage Server Handler Thread: Error in renaming file");
             }
             else
             {
-                printf(GRN "[+]Storage Server Handler Thread: File renamed successfully\n" reset);
-                fprintf(logs, "[+]Storage Server Handler Thread: File renamed successfully [Time Stamp: %f]\n", GetCurrTime(Clock));
+                LOG_INFO("[+]Storage Server Handler Thread: File renamed successfully");
             }
 
             // forward to corresponding client
-            // find the client
-            CLIENT_HANDLE_STRUCT *client = GetClient(clientID, clientHandleList);
-            if (client == NULL)
+            CLIENT_HANDLE_STRUCT client;
+            if (AcquireClientForSend(clientID, &client, clientHandleList) < 0)
             {
-                printf(RED "[-]Storage Server Handler Thread: Error in finding client\n" reset);
-                fprintf(logs, "[-]Storage Server Handler Thread: Error in finding client [Time Stamp: %f]\n", GetCurrTime(Clock));
+                LOG_ERROR("[-]Storage Server Handler Thread: Error in finding client");
                 break;
             }
 
-            int iSendStatus = send(client->iClientSocket, ack, sizeof(ack_struct), 0);
-            if (CheckError(iSendStatus, "[-]Storage Server Handler Thread: Error in sending data to client"))
+            char buffer[WIRE_HEADER_SIZE + sizeof(ACK_STRUCT)];
+            WIRE_CONTEXT_STRUCT clientContext = {client.iWireVersion, iClientRequestID};
+            int length = Wire_Encode_Ack(&clientContext, ack, buffer, sizeof(buffer));
+            int iSendStatus = Reactor_Send(client.iClientSocket, buffer, length);
+            pthread_mutex_unlock(GetClientSendLock(&client));
+            if (length < 0 || iSendStatus != length)
             {
-                fprintf(logs, "[-]Storage Server Handler Thread: Error in sending data to client [Time Stamp: %f]\n", GetCurrTime(Clock));
-                RemoveClient(clientID, clientHandleList);
-                close(client->iClientSocket);
+                // The owner of the connection notices the failure and closes it
+                LOG_ERROR("[-]Storage Server Handler Thread: Error in sending ack to client %lu", clientID);
+                shutdown(client.iClientSocket, SHUT_RDWR);
                 break;
             }
 
-            printf(GRN "[+]Storage Server Handler Thread: Sent ack to client %lu\n" reset, clientID);
-            fprintf(logs, "[+]Storage Server Handler Thread: Sent ack to client %lu [Time Stamp: %f]\n", clientID, GetCurrTime(Clock));
+            LOG_INFO("[+]Storage Server Handler Thread: Sent ack for request %u to client %lu", iClientRequestID, clientID);
+            iFailed = (response->iResponseErrorCode != 0);
             break;
         }
         }
+        Stats_Record(STATS_OP_SERVER_REPLY, iStartNs, iFailed);
     }
 
     // Disconnect gracefully
-    printf(URED "[-]Storage Server Handler Thread: Server %lu (%s:%d) disconnected(GRACEFULLY)\n" reset, server->ServerID, server->sServerIP, server->sServerPort);
-    fprintf(logs, "[-]Storage Server Handler Thread: Server %lu (%s:%d) disconnected(GRACEFULLY) [Time Stamp: %f]\n", server->ServerID, server->sServerIP, server->sServerPort, GetCurrTime(Clock));
+    LOG_ERROR("[-]Storage Server Handler Thread: Server %lu (%s:%d) disconnected(GRACEFULLY)", server->ServerID, server->sServerIP, server->sServerPort);
     close(server->sSocket_Write);
     close(server->sSocket_Read);
     RemoveServer(GetServerID(server), serverHandleList);
     return NULL;
 }
 
+/**
+ * @brief Thread to periodically write the state of the server to the logs
+ * @note: The stats report (the one served on the admin port) is written every LOG_FLUSH_INTERVAL
+ *        seconds, as a single raw block so that it is not interleaved with the records of other
+ *        threads (the log writer thread does the I/O)
+ * @note: A checkpoint of the mount table is written once its journal has grown past MOUNT_CHECKPOINT_BYTES
+ */
 void *Log_Flusher_Thread()
 {
     while (1)
     {
         sleep(LOG_FLUSH_INTERVAL);
-        printf(BBLK "[+]Log Flusher Thread: Flushing logs\n" reset);
+        LOG_INFO("[+]Log Flusher Thread: Logging server state");
 
-        fprintf(logs, "[+]Log Flusher Thread: Flushing logs [Time Stamp: %f]\n", GetCurrTime(Clock));
-        fprintf(logs, "------------------------------------------------------------\n");
-        fprintf(logs, "Current Mount Trie:\n");
-        char buffer[MAX_BUFFER_SIZE];
-        memset(buffer, 0, MAX_BUFFER_SIZE);
-        int err = Get_Directory_Tree(MountTrie, "/", buffer);
-        if (CheckError(err, "[-]Log_Flusher_Thread: Error in getting directory tree"))
-        {
-            fprintf(logs, "[-]Log_Flusher_Thread: Error in getting directory tree\n");
-            exit(EXIT_FAILURE);
-        }
-        fprintf(logs, "%s\n", buffer);
-        fprintf(logs, "Number of Current Clients: %d\n", clientHandleList->iClientCount);
-        fprintf(logs, "Number of Current Servers: %d\n", serverHandleList->iServerCount);
-        fprintf(logs, "------------------------------------------------------------\n");
+        char *state = NULL;
+        size_t iStateSize = 0;
+        FILE *stream = open_memstream(&state, &iStateSize);
+        if (CheckNull(stream, "[-]Log_Flusher_Thread: Error in opening memory stream"))
+            continue;
+        Stats_Report(stream, 0);
+        fclose(stream);
+
+        Log_Raw(state);
+        free(state);
 
-        fflush(logs);
+        // Keep the journal (and the next restart) short
+        Mount_Table_Maintain();
     }
     return NULL;
 }
 
 void exit_handler()
 {
-    printf(BRED "[-]Server Exiting\n" reset);
-    fprintf(logs, "[-]Server Exiting [Time Stamp: %f]\n", GetCurrTime(Clock));
-    for (int i = 0; i < clientHandleList->iClientCount; i++)
-    {
-        close(clientHandleList->clientList[i].iClientSocket);
-    }
-    for (int i = 0; i < serverHandleList->iServerCount; i++)
-    {
-        close(serverHandleList->serverList[i].sSocket_Read);
-        close(serverHandleList->serverList[i].sSocket_Write);
-    }
+    LOG_ERROR("[-]Server Exiting");
+    CloseClientSockets(clientHandleList);
+    CloseServerSockets(serverHandleList);
+    Journal_Close();
     Delete_Trie(MountTrie);
-    pthread_mutex_destroy(&MountTrieLock);
     freeCache(MountCache);
-    fclose(logs);
+    Log_Shutdown();
 }
 
 int main(int argc, char *argv[])
 {
-    // Open the logs file
-    logs = fopen("NSlog.log", "w");
+    // Parse the command line options
+    // -m thread|epoll : serve clients with a thread per connection (default) or with epoll reactors
+    // -e <count>      : number of reactor threads in epoll mode
+    // -w <count>      : number of worker threads in epoll mode (0 serves requests on the reactor threads)
+    // -q <depth>      : number of requests that can wait for a worker
+    // -c <capacity>   : number of resolved paths kept in the mount cache
+    // -l <level>      : highest log level kept (error, warn, info or debug)
+    // -s <rate>       : keep 1 in rate info and debug records
+    // -n              : do not echo the logs to the console
+    // -b              : write a binary log (NSlog.bin, rendered by logdecode)
+    // -a <port>       : port serving the stats report (0 disables it)
+    // -t              : write the spans of traced requests to NSlog.trace.json (as NFS_TRACE=1)
+    int iUseReactor = 0;
+    int iReactorThreads = DEFAULT_REACTOR_THREADS;
+    int iPoolWorkers = DEFAULT_POOL_WORKERS;
+    int iPoolQueueDepth = DEFAULT_POOL_QUEUE_DEPTH;
+    int iCacheCapacity = DEFAULT_CACHE_CAPACITY;
+    int iAdminPort = DEFAULT_ADMIN_PORT;
+    LOG_CONFIG_STRUCT LogConfig;
+    Log_Default_Config(&LogConfig, 1);
+    int opt;
+    while ((opt = getopt(argc, argv, "m:e:w:q:c:l:s:nba:t")) != -1)
+    {
+        switch (opt)
+        {
+        case 'm':
+            if (strcmp(optarg, "epoll") == 0)
+                iUseReactor = 1;
+            else if (strcmp(optarg, "thread") == 0)
+                iUseReactor = 0;
+            else
+            {
+                fprintf(stderr, "Usage: %s [-m thread|epoll] [-e reactor_threads] [-w workers] [-q queue_depth] [-c cache_capacity] [-l log_level] [-s log_sample_rate] [-n] [-b] [-a admin_port] [-t]\n", argv[0]);
+                return 1;
+            }
+            break;
+        case 'e':
+            iReactorThreads = atoi(optarg);
+            if (iReactorThreads < 1 || iReactorThreads > MAX_REACTOR_THREADS)
+            {
+                fprintf(stderr, "[-]Reactor thread count must be between 1 and %d\n", MAX_REACTOR_THREADS);
+                return 1;
+            }
+            break;
+        case 'w':
+            iPoolWorkers = atoi(optarg);
+            if (iPoolWorkers < 0 || iPoolWorkers > MAX_POOL_WORKERS)
+            {
+                fprintf(stderr, "[-]Worker count must be between 0 and %d\n", MAX_POOL_WORKERS);
+                return 1;
+            }
+            break;
+        case 'q':
+            iPoolQueueDepth = atoi(optarg);
+            if (iPoolQueueDepth < 1 || iPoolQueueDepth > MAX_POOL_QUEUE_DEPTH)
+            {
+                fprintf(stderr, "[-]Queue depth must be between 1 and %d\n", MAX_POOL_QUEUE_DEPTH);
+                return 1;
+            }
+            break;
+        case 'c':
+            iCacheCapacity = atoi(optarg);
+            if (iCacheCapacity < 1 || iCacheCapacity > MAX_CACHE_CAPACITY)
+            {
+                fprintf(stderr, "[-]Cache capacity must be between 1 and %d\n", MAX_CACHE_CAPACITY);
+                return 1;
+            }
+            break;
+        case 'l':
+            LogConfig.iLevel = Log_Parse_Level(optarg);
+            if (LogConfig.iLevel < 0)
+            {
+                fprintf(stderr, "[-]Log level must be error, warn, info or debug\n");
+                return 1;
+            }
+            break;
+        case 's':
+            LogConfig.iSampleRate = atoi(optarg);
+            if (LogConfig.iSampleRate < 1)
+            {
+                fprintf(stderr, "[-]Log sample rate must be at least 1\n");
+                return 1;
+            }
+            break;
+        case 'n':
+            LogConfig.iConsole = 0;
+            break;
+        case 'b':
+            LogConfig.iBinary = 1;
+            break;
+        case 'a':
+            iAdminPort = atoi(optarg);
+            if (iAdminPort < 0 || iAdminPort > 65535)
+            {
+                fprintf(stderr, "[-]Admin port must be between 0 and 65535\n");
+                return 1;
+            }
+            break;
+        case 't':
+            LogConfig.iTrace = 1;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-m thread|epoll] [-e reactor_threads] [-w workers] [-q queue_depth] [-c cache_capacity] [-l log_level] [-s log_sample_rate] [-n] [-b] [-a admin_port] [-t]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // Open the logs file and start the log writer
+    if (Log_Init("NSlog", &LogConfig) < 0)
+    {
+        fprintf(stderr, "[-]Error in opening the log file\n");
+        return 1;
+    }
+    Trace_Init("Naming Server");
 
     // Register the exit handler
     atexit(exit_handler);
@@ -845,32 +1298,56 @@ int main(int argc, char *argv[])
     // Initialize the Naming Server Global Variables
     clientHandleList = InitializeClientHandleList();
     serverHandleList = InitializeServerHandleList();
+    forwardTable = InitializeForwardTable();
     sem_init(&serverStartSem, 0, -BACKUP_SERVERS);
 
     // Initialize the Mount Paths Trie
-    MountTrie = Init_Trie();
-    pthread_mutex_init(&MountTrieLock, NULL);
-    strcpy(MountTrie->path_token, "Mount");
-    MountTrie->Server_Handle = NULL;
+    MountTrie = Init_Trie("Mount");
+    if (CheckNull(MountTrie, "[-]Error in creating the mount trie"))
+        return 1;
+
+    // Reload the mount table persisted by the previous run, then journal its changes from there on
+    uint64_t iJournalSequence = 0;
+    if (CheckError(Mount_Table_Load(&iJournalSequence), "[-]Error in reloading the mount table"))
+        return 1;
+    if (CheckError(Journal_Open(JOURNAL_FILE, iJournalSequence), "[-]Error in opening the mount journal"))
+        return 1;
+    pthread_mutex_init(&ServerForwardLock, NULL);
 
     // Initialize the LRU Cache
-    MountCache = createCache();
+    MountCache = createCache(iCacheCapacity);
+    if (CheckNull(MountCache, "[-]Error in creating the mount cache"))
+        return 1;
 
     // Initialize the clock object
     Clock = InitClock();
 
+    // Start counting the requests and serve the stats on the admin port
+    if (CheckError(Stats_Init(iAdminPort), "[-]Error in initializing the stats"))
+        return 1;
+
     // Create a thread to flush the logs periodically
     pthread_t tLogFlusherThread;
     int iThreadStatus = pthread_create(&tLogFlusherThread, NULL, Log_Flusher_Thread, NULL);
     if (CheckError(iThreadStatus, "[-]Error in creating thread"))
         return 1;
 
-    printf(BGRN "[+]Naming Server Initialized\n" reset);
-    fprintf(logs, "[+]Naming Server Initialized [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Naming Server Initialized");
+
+    // Start the worker pool serving the requests read by the reactors
+    if (iUseReactor && iPoolWorkers > 0)
+    {
+        ClientWorkerPool = InitializeThreadPool(iPoolWorkers, iPoolQueueDepth);
+        if (ClientWorkerPool == NULL)
+            return 1;
+    }
 
     // Create a thread to accept client connections
     pthread_t tClientAcceptorThread;
-    iThreadStatus = pthread_create(&tClientAcceptorThread, NULL, Client_Acceptor_Thread, NULL);
+    if (iUseReactor)
+        iThreadStatus = pthread_create(&tClientAcceptorThread, NULL, Client_Reactor_Acceptor_Thread, (void *)&iReactorThreads);
+    else
+        iThreadStatus = pthread_create(&tClientAcceptorThread, NULL, Client_Acceptor_Thread, NULL);
     if (CheckError(iThreadStatus, "[-]Error in creating thread"))
         return 1;
 
@@ -0,0 +1,78 @@
+#include <string.h>
+#include <time.h>
+
+#include "./RCU.h"
+
+static atomic_int iNextStripe = 0;
+static __thread int iStripe = -1;
+
+/**
+ * @brief Initializes a read-copy-update domain
+ * @param domain: The domain object
+*/
+void RCU_Init(RCU_DOMAIN_STRUCT *domain)
+{
+    memset(domain, 0, sizeof(RCU_DOMAIN_STRUCT));
+    atomic_init(&domain->iReadPhase, 0);
+    for (int i = 0; i < RCU_READER_STRIPES; i++)
+    {
+        atomic_init(&domain->readers[i].iReaders[0], 0);
+        atomic_init(&domain->readers[i].iReaders[1], 0);
+    }
+}
+
+/**
+ * @brief Enters a read side critical section
+ * @param domain: The domain object
+ * @return: The token to pass to RCU_Read_Unlock
+ * @note: Never blocks, pointers loaded inside the section stay valid until RCU_Read_Unlock
+*/
+atomic_long *RCU_Read_Lock(RCU_DOMAIN_STRUCT *domain)
+{
+    if (iStripe < 0)
+        iStripe = atomic_fetch_add(&iNextStripe, 1) % RCU_READER_STRIPES;
+
+    int iPhase = atomic_load(&domain->iReadPhase);
+    atomic_long *token = &domain->readers[iStripe].iReaders[iPhase];
+    atomic_fetch_add(token, 1);
+    return token;
+}
+
+/**
+ * @brief Leaves a read side critical section
+ * @param token: The token returned by RCU_Read_Lock
+*/
+void RCU_Read_Unlock(atomic_long *token)
+{
+    atomic_fetch_sub(token, 1);
+}
+
+/**
+ * @brief Waits until no reader is left in the given phase
+*/
+static void WaitForReaders(RCU_DOMAIN_STRUCT *domain, int iPhase)
+{
+    struct timespec pause = {0, RCU_GRACE_POLL_US * 1000};
+    for (int i = 0; i < RCU_READER_STRIPES; i++)
+    {
+        while (atomic_load(&domain->readers[i].iReaders[iPhase]) != 0)
+            nanosleep(&pause, NULL);
+    }
+}
+
+/**
+ * @brief Waits for a grace period
+ * @param domain: The domain object
+ * @note: Writers must be serialized by the caller.
+ *        New readers are steered to the other phase before each wait so that both counters drain,
+ *        after both waits no reader can still use what was unpublished before the call.
+*/
+void RCU_Synchronize(RCU_DOMAIN_STRUCT *domain)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        int iPhase = atomic_load(&domain->iReadPhase);
+        atomic_store(&domain->iReadPhase, iPhase ^ 1);
+        WaitForReaders(domain, iPhase);
+    }
+}
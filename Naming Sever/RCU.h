@@ -0,0 +1,37 @@
+#ifndef __RCU_H__
+#define __RCU_H__
+
+#include <stdatomic.h>
+
+#define RCU_READER_STRIPES 64     // Reader counters of a domain (spread over cache lines)
+#define RCU_GRACE_POLL_US 50      // Microseconds a writer sleeps while waiting for readers to drain
+
+/*
+Read-copy-update for structures that are read on every request and rarely changed.
+Readers announce themselves in a counter of the current read phase (one counter per stripe, a
+thread always uses the same stripe) and never wait. A writer replaces what it changes with a
+new copy, publishes it, and calls RCU_Synchronize before freeing the old copy: the read phase is
+flipped twice and each time the writer waits for the counters of the previous phase to drain,
+after which no reader can still hold a pointer loaded before the publication.
+*/
+
+// Number of readers currently inside a read section, per read phase
+typedef struct RCU_STRIPE_STRUCT
+{
+    atomic_long iReaders[2];
+} __attribute__((aligned(64))) RCU_STRIPE_STRUCT;
+
+typedef struct RCU_DOMAIN_STRUCT
+{
+    atomic_int iReadPhase;
+    RCU_STRIPE_STRUCT readers[RCU_READER_STRIPES];
+} RCU_DOMAIN_STRUCT;
+
+void RCU_Init(RCU_DOMAIN_STRUCT *domain);
+// Enters a read section, the returned token is passed to RCU_Read_Unlock
+atomic_long *RCU_Read_Lock(RCU_DOMAIN_STRUCT *domain);
+void RCU_Read_Unlock(atomic_long *token);
+// Waits until every read section that started before the call has ended (writers only)
+void RCU_Synchronize(RCU_DOMAIN_STRUCT *domain);
+
+#endif
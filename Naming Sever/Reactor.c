@@ -0,0 +1,607 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <arpa/inet.h>
+
+// Local Header Files
+#include "./Headers.h"
+#include "./Reactor.h"
+#include "./Client_Handle.h"
+#include "./ThreadPool.h"
+
+// Global Header Files
+#include "../Externals.h"
+#include "../Wire.h"
+#include "../colour.h"
+
+extern CLIENT_HANDLE_LIST_STRUCT *clientHandleList;
+
+REACTOR_STRUCT Reactors[MAX_REACTOR_THREADS];
+
+/**
+ * @brief Sets the O_NONBLOCK flag on a socket
+ * @param sockfd: The socket to modify
+ * @return: 0 on success, -1 on failure
+ */
+int SetNonBlocking(int sockfd)
+{
+    int flags = fcntl(sockfd, F_GETFL, 0);
+    if (flags < 0)
+        return -1;
+    return fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/**
+ * @brief Raises the soft limit on open file descriptors to the hard limit
+ * @note: Every idle client holds a socket, so the default soft limit (1024) caps the reactor
+ */
+void RaiseFileLimit()
+{
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) < 0 || limit.rlim_cur >= limit.rlim_max)
+        return;
+
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        LOG_INFO("[+]Client Reactor: Raised open file limit to %lu", (unsigned long)limit.rlim_cur);
+    }
+}
+
+/**
+ * @brief Sends the complete buffer on a (possibly non-blocking) socket
+ * @param sockfd: The socket to send on
+ * @param buffer: The data to be sent
+ * @param length: The number of bytes to be sent
+ * @return: Number of bytes sent on success, -1 on failure
+ * @note: Waits at most REACTOR_SEND_TIMEOUT ms each time the socket buffer is full
+ */
+int Reactor_Send(int sockfd, const void *buffer, size_t length)
+{
+    const char *data = (const char *)buffer;
+    size_t sent = 0;
+    while (sent < length)
+    {
+        ssize_t iSendStatus = send(sockfd, data + sent, length - sent, MSG_NOSIGNAL);
+        if (iSendStatus > 0)
+        {
+            sent += iSendStatus;
+            continue;
+        }
+        if (iSendStatus < 0 && errno == EINTR)
+            continue;
+        if (iSendStatus < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            struct pollfd pfd;
+            pfd.fd = sockfd;
+            pfd.events = POLLOUT;
+            if (poll(&pfd, 1, REACTOR_SEND_TIMEOUT) > 0)
+                continue;
+        }
+        return -1;
+    }
+    return (int)sent;
+}
+
+/**
+ * @brief Takes a reference on a client connection
+ * @param connection: The connection to be retained
+ */
+void Retain_Client_Connection(CLIENT_CONNECTION_STRUCT *connection)
+{
+    atomic_fetch_add(&connection->iRefCount, 1);
+}
+
+/**
+ * @brief Drops a reference on a client connection
+ * @param connection: The connection to be released
+ * @note: The socket is closed only with the last reference so that a queued response
+ *        can never be written to a descriptor that was reused by a new client
+ */
+void Release_Client_Connection(CLIENT_CONNECTION_STRUCT *connection)
+{
+    if (atomic_fetch_sub(&connection->iRefCount, 1) != 1)
+        return;
+
+    // Close under the send lock so that an ACK writer never sees the descriptor reused
+    pthread_mutex_t *sendLock = GetClientSendLock(&connection->client);
+    pthread_mutex_lock(sendLock);
+    close(connection->client.iClientSocket);
+    pthread_mutex_unlock(sendLock);
+    free(connection->sRecvBuffer);
+    free(connection);
+}
+
+/**
+ * @brief Unregisters a client connection from its reactor and drops the reactor's reference
+ * @param reactor: The reactor owning the connection
+ * @param connection: The connection to be closed
+ * @param graceful: 1 if the client requested the close, 0 otherwise
+ */
+void Close_Client_Connection(REACTOR_STRUCT *reactor, CLIENT_CONNECTION_STRUCT *connection, int graceful)
+{
+    CLIENT_HANDLE_STRUCT *client = &connection->client;
+    epoll_ctl(reactor->iEpollFD, EPOLL_CTL_DEL, client->iClientSocket, NULL);
+
+    if (graceful)
+    {
+        LOG_INFO("[+]Client Reactor Thread %d: Client %lu (%s:%d) disconnected(GRACEFULLY)", reactor->iReactorIndex, client->ClientID, client->sClientIP, client->sClientPort);
+    }
+    else
+    {
+        LOG_ERROR("[-]Client Reactor Thread %d: Client %lu (%s:%d) disconnected(UNGRACEFULLY)", reactor->iReactorIndex, client->ClientID, client->sClientIP, client->sClientPort);
+    }
+
+    RemoveClient(client->ClientID, clientHandleList);
+    Release_Client_Connection(connection);
+}
+
+/**
+ * @brief Handles one request of a client connection and sends the response
+ * @param connection: The connection the request was received on
+ * @param ctx: The wire context of the request (version and request ID)
+ * @param request: The request to be handled
+ * @return: 0 on success, -1 if the response could not be sent
+ * @note: Called by the workers, or inline by the reactor when no worker pool is configured.
+ *        On a send failure the socket is shut down so that its reactor closes the connection.
+ */
+int Serve_Client_Request(CLIENT_CONNECTION_STRUCT *connection, WIRE_CONTEXT_STRUCT *ctx, REQUEST_STRUCT *request)
+{
+    CLIENT_HANDLE_STRUCT *client = &connection->client;
+
+    // Handle the request (Generate a response)
+    RESPONSE_STRUCT response;
+    Handle_Client_Request(client, ctx, request, &response);
+
+    // Encode the response in the client's wire version
+    char buffer[sizeof(RESPONSE_STRUCT) + WIRE_HEADER_SIZE];
+    int length = Wire_Encode_Response(ctx, &response, buffer, sizeof(buffer));
+
+    // Send the response to the client (a response that could not be encoded is never sent)
+    int iSendStatus = -1;
+    if (length >= 0)
+    {
+        pthread_mutex_lock(GetClientSendLock(client));
+        iSendStatus = Reactor_Send(client->iClientSocket, buffer, length);
+        pthread_mutex_unlock(GetClientSendLock(client));
+    }
+    if (length < 0 || iSendStatus != length)
+    {
+        LOG_ERROR("[-]Serve_Client_Request: Error in sending response to client %lu", client->ClientID);
+        shutdown(client->iClientSocket, SHUT_RDWR);
+        return -1;
+    }
+
+    LOG_INFO("[+]Serve_Client_Request: Sent response {%s} to client %lu", response.sResponseData, client->ClientID);
+    return 0;
+}
+
+/**
+ * @brief Resolves a CMD_RESOLVE_BATCH request of a connection and sends the results
+ * @param connection: The connection the batch was received on
+ * @param ctx: The wire context of the batch
+ * @param batch: The decoded batch (left for the caller to free)
+ * @return: 0 on success, -1 if the results could not be sent
+ * @note: Like Serve_Client_Request the socket is shut down on a send failure
+ */
+int Serve_Resolve_Batch(CLIENT_CONNECTION_STRUCT *connection, WIRE_CONTEXT_STRUCT *ctx, RESOLVE_BATCH_STRUCT *batch)
+{
+    CLIENT_HANDLE_STRUCT *client = &connection->client;
+
+    RESOLVE_RESULT_STRUCT *results = (RESOLVE_RESULT_STRUCT *)malloc(batch->iPathCount * sizeof(RESOLVE_RESULT_STRUCT));
+    char *buffer = NULL;
+    int length = -1;
+    if (results != NULL && Handle_Resolve_Batch(client, batch, results) >= 0)
+        length = Wire_Encode_Resolve_Results(ctx, results, batch->iPathCount, &buffer);
+    free(results);
+
+    int iSendStatus = -1;
+    if (length >= 0)
+    {
+        pthread_mutex_lock(GetClientSendLock(client));
+        iSendStatus = Reactor_Send(client->iClientSocket, buffer, length);
+        pthread_mutex_unlock(GetClientSendLock(client));
+    }
+    free(buffer);
+    if (length < 0 || iSendStatus != length)
+    {
+        LOG_ERROR("[-]Serve_Resolve_Batch: Error in sending resolve results to client %lu", client->ClientID);
+        shutdown(client->iClientSocket, SHUT_RDWR);
+        return -1;
+    }
+
+    LOG_INFO("[+]Serve_Resolve_Batch: Sent %u resolve results to client %lu", batch->iPathCount, client->ClientID);
+    return 0;
+}
+
+/**
+ * @brief Number of bytes the connection buffer must hold before the next parsing step
+ * @param connection: The connection being read
+ * @return: The expected byte count, -1 if the buffered v2 header is invalid
+ * @note: Until the version is known only the first 4 bytes (the v2 magic) are read.
+ *        Only CMD_RESOLVE_BATCH frames may be larger than REACTOR_RECV_BUFFER_SIZE.
+ */
+ssize_t Expected_Bytes(CLIENT_CONNECTION_STRUCT *connection)
+{
+    if (connection->iWireVersion == WIRE_VERSION_UNKNOWN)
+        return sizeof(uint32_t);
+    if (connection->iWireVersion == WIRE_VERSION_1)
+        return sizeof(REQUEST_STRUCT);
+    if (connection->iRecvBytes < WIRE_HEADER_SIZE)
+        return WIRE_HEADER_SIZE;
+
+    WIRE_HEADER_STRUCT header;
+    if (Wire_Decode_Header(connection->sRecvBuffer, &header) < 0)
+        return -1;
+    if (WIRE_HEADER_SIZE + header.iPayloadLength > REACTOR_RECV_BUFFER_SIZE && (header.iFrameType != FRAME_RESOLVE_BATCH || header.iPayloadLength > WIRE_MAX_BATCH_PAYLOAD))
+        return -1;
+    return WIRE_HEADER_SIZE + header.iPayloadLength;
+}
+
+/**
+ * @brief Handles a complete message sitting in the connection buffer
+ * @param reactor: The reactor owning the connection
+ * @param connection: The connection with a complete message
+ * @return: 1 if the connection is still open, 0 if it was closed
+ */
+int Dispatch_Client_Message(REACTOR_STRUCT *reactor, CLIENT_CONNECTION_STRUCT *connection)
+{
+    CLIENT_HANDLE_STRUCT *client = &connection->client;
+    WIRE_CONTEXT_STRUCT ctx = {connection->iWireVersion, 0};
+    REQUEST_STRUCT request;
+
+    if (connection->iWireVersion == WIRE_VERSION_1)
+        memcpy(&request, connection->sRecvBuffer, sizeof(REQUEST_STRUCT));
+    else
+    {
+        WIRE_HEADER_STRUCT header;
+        Wire_Decode_Header(connection->sRecvBuffer, &header);
+
+        // Answer the version negotiation
+        if (header.iFrameType == FRAME_HELLO)
+        {
+            char buffer[WIRE_HEADER_SIZE];
+            int iVersion = (header.iOperation >= WIRE_VERSION_2) ? WIRE_VERSION_2 : WIRE_VERSION_1;
+            Wire_Encode_Hello(iVersion, buffer, sizeof(buffer));
+
+            pthread_mutex_lock(GetClientSendLock(client));
+            int iSendStatus = Reactor_Send(client->iClientSocket, buffer, WIRE_HEADER_SIZE);
+            pthread_mutex_unlock(GetClientSendLock(client));
+            if (iSendStatus != WIRE_HEADER_SIZE)
+            {
+                Close_Client_Connection(reactor, connection, 0);
+                return 0;
+            }
+
+            connection->iWireVersion = iVersion;
+            client->iWireVersion = iVersion;
+            SetClientWireVersion(client->ClientID, iVersion, clientHandleList);
+            LOG_INFO("[+]Client Reactor Thread %d: Client %lu speaks wire protocol v%d", reactor->iReactorIndex, client->ClientID, iVersion);
+            return 1;
+        }
+
+        // Hand a batch to the workers, or serve it right here without a pool
+        if (header.iFrameType == FRAME_RESOLVE_BATCH)
+        {
+            RESOLVE_BATCH_STRUCT batch;
+            if (Wire_Decode_Resolve_Batch(&header, connection->sRecvBuffer + WIRE_HEADER_SIZE, &ctx, &batch) < 0)
+            {
+                LOG_ERROR("[-]Client Reactor Thread %d: Invalid resolve batch from client %lu", reactor->iReactorIndex, client->ClientID);
+                Close_Client_Connection(reactor, connection, 0);
+                return 0;
+            }
+
+            if (ClientWorkerPool != NULL)
+            {
+                ThreadPool_Submit_Batch(ClientWorkerPool, connection, &ctx, &batch);
+                return 1;
+            }
+
+            int iServeStatus = Serve_Resolve_Batch(connection, &ctx, &batch);
+            Free_Resolve_Batch(&batch);
+            if (iServeStatus < 0)
+            {
+                Close_Client_Connection(reactor, connection, 0);
+                return 0;
+            }
+            return 1;
+        }
+
+        if (Wire_Decode_Request(&header, connection->sRecvBuffer + WIRE_HEADER_SIZE, &ctx, &request) < 0)
+        {
+            LOG_ERROR("[-]Client Reactor Thread %d: Invalid frame from client %lu", reactor->iReactorIndex, client->ClientID);
+            Close_Client_Connection(reactor, connection, 0);
+            return 0;
+        }
+    }
+
+    // Check if the client requested to close the connection
+    if (request.iRequestOperation == CLOSE_CONNECTION)
+    {
+        LOG_INFO("[+]Client Reactor Thread %d: Client %lu requested to close connection", reactor->iReactorIndex, client->ClientID);
+        Close_Client_Connection(reactor, connection, 1);
+        return 0;
+    }
+
+    // Hand the request to the workers, or serve it right here without a pool
+    if (ClientWorkerPool != NULL)
+        ThreadPool_Submit(ClientWorkerPool, connection, &ctx, &request);
+    else if (Serve_Client_Request(connection, &ctx, &request) < 0)
+    {
+        Close_Client_Connection(reactor, connection, 0);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Drains a readable client socket and serves every complete request in it
+ * @param reactor: The reactor owning the connection
+ * @param connection: The readable connection
+ * @return: 1 if the connection is still open, 0 if it was closed
+ * @note: The sockets are edge-triggered, so the socket is read until it would block.
+ *        Messages are reassembled in the connection buffer: v1 structs by size, v2 frames
+ *        by the payload length of their header.
+ */
+int Serve_Client_Connection(REACTOR_STRUCT *reactor, CLIENT_CONNECTION_STRUCT *connection)
+{
+    CLIENT_HANDLE_STRUCT *client = &connection->client;
+    while (1)
+    {
+        ssize_t iExpectedBytes = Expected_Bytes(connection);
+        if (iExpectedBytes < 0)
+        {
+            LOG_ERROR("[-]Client Reactor Thread %d: Invalid frame header from client %lu", reactor->iReactorIndex, client->ClientID);
+            Close_Client_Connection(reactor, connection, 0);
+            return 0;
+        }
+
+        if (connection->iRecvBytes < (size_t)iExpectedBytes)
+        {
+            // Make room for a batch
+            if ((size_t)iExpectedBytes > connection->iRecvBufferSize)
+            {
+                char *buffer = (char *)realloc(connection->sRecvBuffer, iExpectedBytes);
+                if (CheckNull(buffer, "[-]Client Reactor Thread: Error in growing receive buffer"))
+                {
+                    Close_Client_Connection(reactor, connection, 0);
+                    return 0;
+                }
+                connection->sRecvBuffer = buffer;
+                connection->iRecvBufferSize = iExpectedBytes;
+            }
+
+            ssize_t iRecvStatus = recv(client->iClientSocket, connection->sRecvBuffer + connection->iRecvBytes, iExpectedBytes - connection->iRecvBytes, 0);
+            if (iRecvStatus == 0)
+            {
+                Close_Client_Connection(reactor, connection, 0);
+                return 0;
+            }
+            else if (iRecvStatus < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return 1;
+
+                LOG_ERROR("[-]Client Reactor Thread %d: Error in receiving data from client %lu", reactor->iReactorIndex, client->ClientID);
+                Close_Client_Connection(reactor, connection, 0);
+                return 0;
+            }
+
+            // Wait for the rest of the message
+            connection->iRecvBytes += iRecvStatus;
+            if (connection->iRecvBytes < (size_t)iExpectedBytes)
+                continue;
+        }
+
+        // The first bytes of the connection tell the wire version
+        if (connection->iWireVersion == WIRE_VERSION_UNKNOWN)
+        {
+            uint32_t magic;
+            memcpy(&magic, connection->sRecvBuffer, sizeof(magic));
+            connection->iWireVersion = (ntohl(magic) == WIRE_MAGIC) ? WIRE_VERSION_2 : WIRE_VERSION_1;
+            if (connection->iWireVersion == WIRE_VERSION_1)
+            {
+                client->iWireVersion = WIRE_VERSION_1;
+                SetClientWireVersion(client->ClientID, WIRE_VERSION_1, clientHandleList);
+            }
+            continue;
+        }
+
+        // A v2 header was completed, the payload (if any) follows
+        if (connection->iWireVersion == WIRE_VERSION_2 && connection->iRecvBytes == WIRE_HEADER_SIZE && Expected_Bytes(connection) > WIRE_HEADER_SIZE)
+            continue;
+
+        if (Dispatch_Client_Message(reactor, connection) == 0)
+            return 0;
+        connection->iRecvBytes = 0;
+
+        // Give back the memory of a batch, idle connections keep only the default buffer
+        if (connection->iRecvBufferSize > REACTOR_RECV_BUFFER_SIZE)
+        {
+            char *buffer = (char *)realloc(connection->sRecvBuffer, REACTOR_RECV_BUFFER_SIZE);
+            if (buffer != NULL)
+            {
+                connection->sRecvBuffer = buffer;
+                connection->iRecvBufferSize = REACTOR_RECV_BUFFER_SIZE;
+            }
+        }
+    }
+}
+
+void *Client_Reactor_Thread(void *reactorHandle)
+{
+    REACTOR_STRUCT *reactor = (REACTOR_STRUCT *)reactorHandle;
+    LOG_INFO("[+]Client Reactor Thread %d Initialized", reactor->iReactorIndex);
+
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    while (1)
+    {
+        int iEventCount = epoll_wait(reactor->iEpollFD, events, REACTOR_MAX_EVENTS, -1);
+        if (iEventCount < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            LOG_ERROR("[-]Client Reactor Thread %d: Error in waiting for events", reactor->iReactorIndex);
+            break;
+        }
+
+        for (int i = 0; i < iEventCount; i++)
+        {
+            CLIENT_CONNECTION_STRUCT *connection = (CLIENT_CONNECTION_STRUCT *)events[i].data.ptr;
+
+            // Serve pending requests first, the peer may have sent a request before hanging up
+            if (events[i].events & EPOLLIN)
+            {
+                if (Serve_Client_Connection(reactor, connection) == 0)
+                    continue;
+            }
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+                Close_Client_Connection(reactor, connection, 0);
+        }
+    }
+
+    return NULL;
+}
+
+void *Client_Reactor_Acceptor_Thread(void *reactorCount)
+{
+    int iReactorCount = *(int *)reactorCount;
+    if (iReactorCount < 1)
+        iReactorCount = 1;
+    else if (iReactorCount > MAX_REACTOR_THREADS)
+        iReactorCount = MAX_REACTOR_THREADS;
+
+    LOG_INFO("[+]Client Reactor Acceptor Thread Initialized (%d reactor threads)", iReactorCount);
+
+    RaiseFileLimit();
+
+    // Create an epoll instance and a thread for every reactor
+    for (int i = 0; i < iReactorCount; i++)
+    {
+        Reactors[i].iReactorIndex = i;
+        Reactors[i].iEpollFD = epoll_create1(0);
+        if (CheckError(Reactors[i].iEpollFD, "[-]Client Reactor Acceptor Thread: Error in creating epoll instance"))
+            exit(EXIT_FAILURE);
+
+        int iThreadStatus = pthread_create(&Reactors[i].tReactorThread, NULL, Client_Reactor_Thread, (void *)&Reactors[i]);
+        if (CheckError(iThreadStatus, "[-]Client Reactor Acceptor Thread: Error in creating reactor thread"))
+            exit(EXIT_FAILURE);
+    }
+
+    // Create a socket
+    int iServerSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (CheckError(iServerSocket, "[-]Client Reactor Acceptor Thread: Error in creating socket"))
+        exit(EXIT_FAILURE);
+    // A restarted naming server binds again while the connections of the previous one are in TIME_WAIT
+    int iReuse = 1;
+    setsockopt(iServerSocket, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof(iReuse));
+
+    // Specify an address for the socket
+    struct sockaddr_in server_address;
+    server_address.sin_family = AF_INET;
+    server_address.sin_port = htons(NS_CLIENT_PORT);
+    server_address.sin_addr.s_addr = INADDR_ANY;
+    memset(server_address.sin_zero, '\0', sizeof(server_address.sin_zero));
+
+    // Bind the socket to our specified IP and port
+    int iBindStatus = bind(iServerSocket, (struct sockaddr *)&server_address, sizeof(server_address));
+    if (CheckError(iBindStatus, "[-]Client Reactor Acceptor Thread: Error in binding socket to specified IP and port"))
+        exit(EXIT_FAILURE);
+
+    // Listen for connections (a large backlog absorbs reconnect storms)
+    int iListenStatus = listen(iServerSocket, SOMAXCONN);
+    if (CheckError(iListenStatus, "[-]Client Reactor Acceptor Thread: Error in listening for connections"))
+        exit(EXIT_FAILURE);
+
+    LOG_INFO("[+]Client Reactor Acceptor Thread: Listening for connections");
+
+    struct sockaddr_in client_address;
+    socklen_t iClientSize = sizeof(client_address);
+    int iClientSocket;
+    int iNextReactor = 0;
+    while (1)
+    {
+        iClientSize = sizeof(client_address);
+        iClientSocket = accept(iServerSocket, (struct sockaddr *)&client_address, &iClientSize);
+        if (iClientSocket < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            LOG_ERROR("[-]Client Reactor Acceptor Thread: Error in accepting connection");
+            continue;
+        }
+
+        CLIENT_CONNECTION_STRUCT *connection = (CLIENT_CONNECTION_STRUCT *)calloc(1, sizeof(CLIENT_CONNECTION_STRUCT));
+        if (CheckNull(connection, "[-]Client Reactor Acceptor Thread: Error in allocating connection"))
+        {
+            close(iClientSocket);
+            continue;
+        }
+        connection->sRecvBuffer = (char *)malloc(REACTOR_RECV_BUFFER_SIZE);
+        connection->iRecvBufferSize = REACTOR_RECV_BUFFER_SIZE;
+        if (CheckNull(connection->sRecvBuffer, "[-]Client Reactor Acceptor Thread: Error in allocating receive buffer"))
+        {
+            free(connection);
+            close(iClientSocket);
+            continue;
+        }
+
+        // Store the client IP and Port in Client Handle Struct
+        atomic_init(&connection->iRefCount, 1);
+        CLIENT_HANDLE_STRUCT *client = &connection->client;
+        strncpy(client->sClientIP, inet_ntoa(client_address.sin_addr), IP_LENGTH);
+        client->sClientPort = ntohs(client_address.sin_port);
+        client->iClientSocket = iClientSocket;
+        client->iWireVersion = WIRE_VERSION_UNKNOWN;
+        connection->iWireVersion = WIRE_VERSION_UNKNOWN;
+
+        // Add the client to the client list
+        if (CheckError(AddClient(client, clientHandleList), "[-]Client Reactor Acceptor Thread: Error in adding client to client list"))
+        {
+            LOG_ERROR("[-]Client Reactor Acceptor Thread: Error in adding client to client list");
+            Release_Client_Connection(connection);
+            continue;
+        }
+
+        // Send The Client It alloted ID (the socket is still blocking here)
+        unsigned long ClientID = client->ClientID;
+        int iSendStatus = send(iClientSocket, &ClientID, sizeof(unsigned long), MSG_NOSIGNAL);
+        if (iSendStatus != sizeof(unsigned long) || SetNonBlocking(iClientSocket) < 0)
+        {
+            LOG_ERROR("[-]Client Reactor Acceptor Thread: Error in setting up client %lu", ClientID);
+            RemoveClient(ClientID, clientHandleList);
+            Release_Client_Connection(connection);
+            continue;
+        }
+
+        // Hand the connection over to the next reactor (round robin)
+        REACTOR_STRUCT *reactor = &Reactors[iNextReactor];
+        iNextReactor = (iNextReactor + 1) % iReactorCount;
+
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
+        event.data.ptr = connection;
+        if (CheckError(epoll_ctl(reactor->iEpollFD, EPOLL_CTL_ADD, iClientSocket, &event), "[-]Client Reactor Acceptor Thread: Error in registering client socket"))
+        {
+            LOG_ERROR("[-]Client Reactor Acceptor Thread: Error in registering client %lu", ClientID);
+            RemoveClient(ClientID, clientHandleList);
+            Release_Client_Connection(connection);
+            continue;
+        }
+
+        LOG_INFO("[+]Client Reactor Acceptor Thread: Client %lu (%s:%d) assigned to reactor %d", ClientID, client->sClientIP, client->sClientPort, reactor->iReactorIndex);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,53 @@
+#ifndef __REACTOR_H__
+#define __REACTOR_H__
+
+#include "../Externals.h"
+#include "../Wire.h"
+#include "./Client_Handle.h"
+#include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define DEFAULT_REACTOR_THREADS 2  // Number of epoll threads multiplexing client sockets
+#define MAX_REACTOR_THREADS 64
+#define REACTOR_MAX_EVENTS 256     // Events fetched per epoll_wait call
+#define REACTOR_SEND_TIMEOUT 1000  // Milliseconds to wait for a full socket buffer to drain
+#define REACTOR_RECV_BUFFER_SIZE (sizeof(REQUEST_STRUCT) > WIRE_MAX_REQUEST_FRAME ? sizeof(REQUEST_STRUCT) : WIRE_MAX_REQUEST_FRAME)
+
+// State of a single client connection owned by a reactor thread
+typedef struct CLIENT_CONNECTION_STRUCT
+{
+    CLIENT_HANDLE_STRUCT client;                   // Handle of the connected client
+    char* sRecvBuffer;                             // Partially received message
+    size_t iRecvBufferSize;                        // REACTOR_RECV_BUFFER_SIZE, grown while a batch is received
+    size_t iRecvBytes;                             // Number of valid bytes in sRecvBuffer
+    int iWireVersion;                              // WIRE_VERSION_UNKNOWN until the first bytes arrive
+    atomic_int iRefCount;                          // Owning reactor + requests queued for the workers
+} CLIENT_CONNECTION_STRUCT;
+
+// A reactor thread and the epoll instance it waits on
+typedef struct REACTOR_STRUCT
+{
+    int iReactorIndex;
+    int iEpollFD;
+    pthread_t tReactorThread;
+} REACTOR_STRUCT;
+
+// Thread to accept client connections and distribute them over the reactor threads
+void* Client_Reactor_Acceptor_Thread(void* reactorCount);
+// Thread to multiplex the client sockets registered on one epoll instance
+void* Client_Reactor_Thread(void* reactor);
+
+// Takes a reference on a connection
+void Retain_Client_Connection(CLIENT_CONNECTION_STRUCT* connection);
+// Drops a reference on a connection, closing and freeing it with the last one
+void Release_Client_Connection(CLIENT_CONNECTION_STRUCT* connection);
+// Handles one request of a connection and sends the response
+int Serve_Client_Request(CLIENT_CONNECTION_STRUCT* connection, WIRE_CONTEXT_STRUCT* ctx, REQUEST_STRUCT* request);
+// Resolves a CMD_RESOLVE_BATCH request of a connection and sends the results
+int Serve_Resolve_Batch(CLIENT_CONNECTION_STRUCT* connection, WIRE_CONTEXT_STRUCT* ctx, RESOLVE_BATCH_STRUCT* batch);
+
+// Sends the complete buffer on a (possibly non-blocking) socket
+int Reactor_Send(int sockfd, const void* buffer, size_t length);
+
+#endif
@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <arpa/inet.h>
 #include <limits.h>
+#include <unistd.h>
 
 /**
  * @brief Gets the server ID
@@ -25,14 +26,112 @@ unsigned long GetServerID(SERVER_HANDLE_STRUCT *serverHandle)
     return serverID;    
 }
 
+/**
+ * @brief Mixes the bits of a ServerID (splitmix64 finalizer)
+*/
+static uint64_t HashServerID(unsigned long serverID)
+{
+    uint64_t hash = (uint64_t)serverID;
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+/**
+ * @brief Builds a snapshot holding the given servers
+ * @param servers: The servers of the snapshot (copied)
+ * @param iServerCount: The number of servers
+ * @return: The snapshot, NULL on failure
+ * @note: The snapshot is a single allocation and is released with free()
+*/
+static SERVER_SNAPSHOT_STRUCT* BuildSnapshot(SERVER_HANDLE_STRUCT **servers, int iServerCount)
+{
+    size_t iTableSize = 16;
+    while (iTableSize < 2 * (size_t)iServerCount)
+        iTableSize *= 2;
+
+    size_t size = sizeof(SERVER_SNAPSHOT_STRUCT) + (iServerCount + iTableSize) * sizeof(SERVER_HANDLE_STRUCT *);
+    SERVER_SNAPSHOT_STRUCT *snapshot = (SERVER_SNAPSHOT_STRUCT *)calloc(1, size);
+    if (snapshot == NULL)
+        return NULL;
+
+    snapshot->iServerCount = iServerCount;
+    snapshot->servers = (SERVER_HANDLE_STRUCT **)(snapshot + 1);
+    snapshot->iTableSize = iTableSize;
+    snapshot->table = snapshot->servers + iServerCount;
+    for (int i = 0; i < iServerCount; i++)
+    {
+        snapshot->servers[i] = servers[i];
+        size_t slot = HashServerID(servers[i]->ServerID) & (iTableSize - 1);
+        while (snapshot->table[slot] != NULL)
+            slot = (slot + 1) & (iTableSize - 1);
+        snapshot->table[slot] = servers[i];
+    }
+    return snapshot;
+}
+
+/**
+ * @brief Finds a server in a snapshot
+ * @return: The server handle, NULL if not registered
+*/
+static SERVER_HANDLE_STRUCT* FindServer(SERVER_SNAPSHOT_STRUCT *snapshot, unsigned long serverID)
+{
+    size_t slot = HashServerID(serverID) & (snapshot->iTableSize - 1);
+    while (snapshot->table[slot] != NULL)
+    {
+        if (snapshot->table[slot]->ServerID == serverID)
+            return snapshot->table[slot];
+        slot = (slot + 1) & (snapshot->iTableSize - 1);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Enters a read side critical section and returns the current snapshot
+ * @param token: Filled with what ReadUnlock needs to leave the section
+ * @note: The snapshot stays valid until ReadUnlock, the reader never blocks
+*/
+static SERVER_SNAPSHOT_STRUCT* ReadLock(SERVER_HANDLE_LIST_STRUCT *serverHandleList, atomic_long **token)
+{
+    *token = RCU_Read_Lock(&serverHandleList->rcu);
+    return atomic_load(&serverHandleList->snapshot);
+}
+
+static void ReadUnlock(atomic_long *token)
+{
+    RCU_Read_Unlock(token);
+}
+
+/**
+ * @brief Publishes a new snapshot and frees the old one after a grace period
+ * @note: Called with severListMutex held
+*/
+static void PublishSnapshot(SERVER_HANDLE_LIST_STRUCT *serverHandleList, SERVER_SNAPSHOT_STRUCT *snapshot)
+{
+    SERVER_SNAPSHOT_STRUCT *old = atomic_exchange(&serverHandleList->snapshot, snapshot);
+    RCU_Synchronize(&serverHandleList->rcu);
+    free(old);
+}
+
 /**
  * @brief Initializes the Server Handle List
  * @return: The Server Handle List object
 */
 SERVER_HANDLE_LIST_STRUCT* InitializeServerHandleList()
 {
-    SERVER_HANDLE_LIST_STRUCT *serverHandleList = (SERVER_HANDLE_LIST_STRUCT *)malloc(sizeof(SERVER_HANDLE_LIST_STRUCT));
-    memset(serverHandleList, 0, sizeof(serverHandleList));
+    SERVER_HANDLE_LIST_STRUCT *serverHandleList = (SERVER_HANDLE_LIST_STRUCT *)aligned_alloc(64, sizeof(SERVER_HANDLE_LIST_STRUCT));
+    if (CheckNull(serverHandleList, "[-]InitializeServerHandleList: Error in allocating memory"))
+        return NULL;
+    memset(serverHandleList, 0, sizeof(SERVER_HANDLE_LIST_STRUCT));
+
+    SERVER_SNAPSHOT_STRUCT *snapshot = BuildSnapshot(NULL, 0);
+    if (CheckNull(snapshot, "[-]InitializeServerHandleList: Error in allocating snapshot"))
+        return NULL;
+    atomic_init(&serverHandleList->snapshot, snapshot);
+    RCU_Init(&serverHandleList->rcu);
     pthread_mutex_init(&serverHandleList->severListMutex, NULL);
     return serverHandleList;
 }
@@ -40,82 +139,114 @@ SERVER_HANDLE_LIST_STRUCT* InitializeServerHandleList()
  * @brief Adds a server to the Server Handle List
  * @param serverHandle: The server handle object
  * @param serverHandleList: The server handle list object
- * @return: 0 on success, -1 on failure
- * @note: The server handle object is modified to include the server ID
+ * @return: The registered handle on success, NULL on failure
+ * @note: The server handle object is modified to include the server ID, the registered
+ *        handle is a copy that lives as long as the naming server
  * @note: If a previous server with the same ID is present, it is set to active
 */
-int AddServer(SERVER_HANDLE_STRUCT *serverHandle, SERVER_HANDLE_LIST_STRUCT *serverHandleList)
+SERVER_HANDLE_STRUCT* AddServer(SERVER_HANDLE_STRUCT *serverHandle, SERVER_HANDLE_LIST_STRUCT *serverHandleList)
 {
+    serverHandle->ServerID = GetServerID(serverHandle);
+
     pthread_mutex_lock(&serverHandleList->severListMutex);
-    if (serverHandleList->iServerCount >= MAX_SERVERS)
+    SERVER_SNAPSHOT_STRUCT *snapshot = atomic_load(&serverHandleList->snapshot);
+
+    // If a server with the same ID is present, set it to active
+    SERVER_HANDLE_STRUCT *server = FindServer(snapshot, serverHandle->ServerID);
+    if (server != NULL)
     {
-        printf(RED "[-]AddServer: Server Handle List is full\n" reset);
-        fprintf(logs, "[-]AddServer: Server Handle List is full\n");
+        server->sSocket_Write = serverHandle->sSocket_Write;
+        atomic_store(&server->iRunning, 1);
         pthread_mutex_unlock(&serverHandleList->severListMutex);
-        return -1;
+        LOG_INFO("[+]AddServer: Server %ld (%s:%d) reconnected, set to active", serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
+        return server;
     }
 
-    // Find the first empty slot
-    for(int i = 0; i < MAX_SERVERS; i++)
+    server = (SERVER_HANDLE_STRUCT *)malloc(sizeof(SERVER_HANDLE_STRUCT));
+    SERVER_HANDLE_STRUCT **servers = (SERVER_HANDLE_STRUCT **)malloc((snapshot->iServerCount + 1) * sizeof(SERVER_HANDLE_STRUCT *));
+    SERVER_SNAPSHOT_STRUCT *next = NULL;
+    if (server != NULL && servers != NULL)
     {
-        if (serverHandleList->Active[i] == 0)
-        {
-            serverHandle->ServerID = GetServerID(serverHandle);
-            serverHandleList->serverList[i] = *serverHandle;
-            serverHandleList->Active[i] = 1;
-            serverHandleList->Running[i] = 1;
-            serverHandleList->iServerCount++;
-            printf(GRN "[+]AddServer: Added server %lu (%s:%d)\n" reset, serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
-            fprintf(logs, "[+]AddServer: Added server %lu (%s:%d)\n", serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
-            pthread_mutex_unlock(&serverHandleList->severListMutex);
-            return 0;
-        }
-        else
-        {
-            // If a server with the same ID is present, set it to active
-            if(serverHandleList->serverList[i].ServerID == serverHandle->ServerID)
-            {
-                serverHandleList->Active[i] = 1;
-                serverHandleList->Running[i] = 1;
-                printf(GRN "[+]AddServer: Server %ld (%s:%d) reconnected, set to active\n" reset, serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
-                fprintf(logs, "[+]AddServer: Server %ld (%s:%d) reconnected, set to active\n", serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
-                pthread_mutex_unlock(&serverHandleList->severListMutex);
-                return 0;
-            }
-        }
+        *server = *serverHandle;
+        atomic_init(&server->iRunning, 1);
+        server->iBackupCount = 0;
+        memcpy(servers, snapshot->servers, snapshot->iServerCount * sizeof(SERVER_HANDLE_STRUCT *));
+        servers[snapshot->iServerCount] = server;
+        next = BuildSnapshot(servers, snapshot->iServerCount + 1);
+    }
+    free(servers);
+
+    if (next == NULL)
+    {
+        pthread_mutex_unlock(&serverHandleList->severListMutex);
+        free(server);
+        LOG_ERROR("[-]AddServer: Error adding server %lu (%s:%d)", serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
+        return NULL;
     }
+
+    PublishSnapshot(serverHandleList, next);
     pthread_mutex_unlock(&serverHandleList->severListMutex);
-    printf(RED "[-]AddServer: Error adding server %lu (%s:%d)\n" reset, serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
-    fprintf(logs, "[-]AddServer: Error adding server %lu (%s:%d)\n", serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
-    return -1;
+    LOG_INFO("[+]AddServer: Added server %lu (%s:%d)", serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
+    return server;
 }
-/**'
+/**
  * @brief Removes a server from the Server Handle List
  * @param serverID: The server ID
  * @param serverHandleList: The server handle list object
  * @return: 0 on success, -1 on failure
+ * @note: The handle itself is kept (paths in the mount trie may still point to it)
 */
 int RemoveServer(unsigned long serverID, SERVER_HANDLE_LIST_STRUCT *serverHandleList)
 {
     pthread_mutex_lock(&serverHandleList->severListMutex);
-    // Find the server
-    for(int i = 0; i < MAX_SERVERS; i++)
+    SERVER_SNAPSHOT_STRUCT *snapshot = atomic_load(&serverHandleList->snapshot);
+    SERVER_HANDLE_STRUCT *server = FindServer(snapshot, serverID);
+    if (server == NULL)
     {
-        if(serverHandleList->Running[i] == 1 && serverHandleList->serverList[i].ServerID == serverID)
+        pthread_mutex_unlock(&serverHandleList->severListMutex);
+        LOG_ERROR("[-]RemoveServer: Server-%lu not in ServerHandleList ", serverID);
+        return -1;
+    }
+
+    // Build the list without the server
+    SERVER_SNAPSHOT_STRUCT *next = NULL;
+    SERVER_HANDLE_STRUCT **servers = (SERVER_HANDLE_STRUCT **)malloc((snapshot->iServerCount ? snapshot->iServerCount : 1) * sizeof(SERVER_HANDLE_STRUCT *));
+    if (servers != NULL)
+    {
+        int iServerCount = 0;
+        for (int i = 0; i < snapshot->iServerCount; i++)
         {
-            serverHandleList->Active[i] = 0;
-            serverHandleList->Running[i] = 0;
-            serverHandleList->iServerCount--;
-            pthread_mutex_unlock(&serverHandleList->severListMutex);
-            printf(GRN "[+]RemoveServer: Removed server %lu (%s:%d) from ServerHandleList\n" reset, serverHandleList->serverList[i].ServerID, serverHandleList->serverList[i].sServerIP, serverHandleList->serverList[i].sServerPort);
-            fprintf(logs, "[+]RemoveServer: Removed server %lu (%s:%d) from ServerHandleList\n", serverHandleList->serverList[i].ServerID, serverHandleList->serverList[i].sServerIP, serverHandleList->serverList[i].sServerPort);
-            return 0;
+            if (snapshot->servers[i] != server)
+                servers[iServerCount++] = snapshot->servers[i];
         }
+        next = BuildSnapshot(servers, iServerCount);
+        free(servers);
     }
+    if (next == NULL)
+    {
+        pthread_mutex_unlock(&serverHandleList->severListMutex);
+        LOG_ERROR("[-]RemoveServer: Error removing server %lu", serverID);
+        return -1;
+    }
+
+    atomic_store(&server->iRunning, 0);
+    PublishSnapshot(serverHandleList, next);
     pthread_mutex_unlock(&serverHandleList->severListMutex);
-    printf(RED "[-]RemoveServer: Server-%lu not in ServerHandleList \n" reset, serverID);
-    fprintf(logs, "[-]RemoveServer: Server-%lu not in ServerHandleList \n", serverID);
-    return -1;
+    LOG_INFO("[+]RemoveServer: Removed server %lu (%s:%d) from ServerHandleList", server->ServerID, server->sServerIP, server->sServerPort);
+    return 0;
+}
+/**
+ * @brief Sets the running state of a registered server
+ * @return: The server handle, NULL if the server is not registered
+*/
+static SERVER_HANDLE_STRUCT* SetRunning(unsigned long serverID, int iRunning, SERVER_HANDLE_LIST_STRUCT *serverHandleList)
+{
+    atomic_long *token;
+    SERVER_HANDLE_STRUCT *server = FindServer(ReadLock(serverHandleList, &token), serverID);
+    if (server != NULL)
+        atomic_store(&server->iRunning, iRunning);
+    ReadUnlock(token);
+    return server;
 }
 /**
  * @brief Sets a server to inactive
@@ -126,19 +257,14 @@ int RemoveServer(unsigned long serverID, SERVER_HANDLE_LIST_STRUCT *serverHandle
 int SetInactive(unsigned long serverID, SERVER_HANDLE_LIST_STRUCT *serverHandleList)
 {
     // Find the server and set it to inactive
-    for(int i = 0; i < MAX_SERVERS; i++)
+    SERVER_HANDLE_STRUCT *server = SetRunning(serverID, 0, serverHandleList);
+    if (server == NULL)
     {
-        if(serverHandleList->Active[i] == 1 && serverHandleList->serverList[i].ServerID == serverID)
-        {
-            serverHandleList->Running[i] = 0;
-            printf(GRN "[+]SetInactive: Set server %lu (%s:%d) to inactive\n" reset, serverHandleList->serverList[i].ServerID, serverHandleList->serverList[i].sServerIP, serverHandleList->serverList[i].sServerPort);
-            fprintf(logs, "[+]SetInactive: Set server %lu (%s:%d) to inactive\n", serverHandleList->serverList[i].ServerID, serverHandleList->serverList[i].sServerIP, serverHandleList->serverList[i].sServerPort);
-            return 0;
-        }
+        LOG_ERROR("[-]SetInactive: Server-%lu not in ServerHandleList ", serverID);
+        return -1;
     }
-    printf(RED "[-]SetInactive: Server-%lu not in ServerHandleList \n" reset, serverID);
-    fprintf(logs, "[-]SetInactive: Server-%lu not in ServerHandleList \n", serverID);
-    return -1;
+    LOG_INFO("[+]SetInactive: Set server %lu (%s:%d) to inactive", server->ServerID, server->sServerIP, server->sServerPort);
+    return 0;
 }
 /**
  * @brief Sets a server to active
@@ -150,22 +276,14 @@ int SetInactive(unsigned long serverID, SERVER_HANDLE_LIST_STRUCT *serverHandleL
 int SetActive(unsigned long serverID, SERVER_HANDLE_LIST_STRUCT *serverHandleList)
 {
     // Find the server and set it to active
-    pthread_mutex_lock(&serverHandleList->severListMutex);
-    for(int i = 0; i < MAX_SERVERS; i++)
+    SERVER_HANDLE_STRUCT *server = SetRunning(serverID, 1, serverHandleList);
+    if (server == NULL)
     {
-        if(serverHandleList->Active[i] == 1 && serverHandleList->serverList[i].ServerID == serverID)
-        {
-            serverHandleList->Running[i] = 1;
-            pthread_mutex_unlock(&serverHandleList->severListMutex);
-            printf(GRN "[+]SetActive: Set server %lu (%s:%d) to active\n" reset, serverHandleList->serverList[i].ServerID, serverHandleList->serverList[i].sServerIP, serverHandleList->serverList[i].sServerPort);
-            fprintf(logs, "[+]SetActive: Set server %lu (%s:%d) to active\n", serverHandleList->serverList[i].ServerID, serverHandleList->serverList[i].sServerIP, serverHandleList->serverList[i].sServerPort);
-            return 0;
-        }
+        LOG_ERROR("[-]SetActive: Server-%lu not in ServerHandleList ", serverID);
+        return -1;
     }
-    pthread_mutex_unlock(&serverHandleList->severListMutex);
-    printf(RED "[-]SetActive: Server-%lu not in ServerHandleList \n" reset, serverID);
-    fprintf(logs, "[-]SetActive: Server-%lu not in ServerHandleList \n", serverID);
-    return -1;
+    LOG_INFO("[+]SetActive: Set server %lu (%s:%d) to active", server->ServerID, server->sServerIP, server->sServerPort);
+    return 0;
 }
 /**
  * @brief Assigns backup servers to a server with given ID
@@ -177,92 +295,66 @@ int SetActive(unsigned long serverID, SERVER_HANDLE_LIST_STRUCT *serverHandleLis
 */
 int AssignBackupServer(SERVER_HANDLE_LIST_STRUCT *serverHandleList, unsigned long serverID)
 {
+    // Backup counts are only changed here, under the writer lock
+    pthread_mutex_lock(&serverHandleList->severListMutex);
+    SERVER_SNAPSHOT_STRUCT *snapshot = atomic_load(&serverHandleList->snapshot);
+
     // find the server
-    SERVER_HANDLE_STRUCT *serverHandle = NULL;
-    for(int i = 0; i < MAX_SERVERS; i++)
-    {
-        if( (serverHandleList->Active[i] == 1) && (serverHandleList->serverList[i].ServerID == serverID) )
-        {
-            serverHandle = &serverHandleList->serverList[i];
-            break;
-        }
-    }
+    SERVER_HANDLE_STRUCT *serverHandle = FindServer(snapshot, serverID);
     if(serverHandle == NULL)
     {
-        printf(RED "[-]AssignBackupServer: Server-%lu not in ServerHandleList \n" reset, serverID);
-        fprintf(logs, "[-]AssignBackupServer: Server-%lu not in ServerHandleList \n", serverID);
+        pthread_mutex_unlock(&serverHandleList->severListMutex);
+        LOG_ERROR("[-]AssignBackupServer: Server-%lu not in ServerHandleList ", serverID);
         return -1;
     }
-    else if(serverHandle->backupServers[0] != NULL)
+    else if(BACKUP_SERVERS > 0 && serverHandle->backupServers[0] != NULL)
     {
-        printf(GRN "[+]AssignBackupServer: Server %lu (%s:%d) already has backup servers\n" reset, serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
-        fprintf(logs, "[+]AssignBackupServer: Server %lu (%s:%d) already has backup servers\n", serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
+        pthread_mutex_unlock(&serverHandleList->severListMutex);
+        LOG_INFO("[+]AssignBackupServer: Server %lu (%s:%d) already has backup servers", serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
         return 0;
     }
 
     int BackUpCount = 0;
-    int itt = 0;
-    while(BackUpCount < BACKUP_SERVERS && itt < MAX_SERVERS)
+    while(BackUpCount < BACKUP_SERVERS)
     {
-        // assign the backup server with the least number of active backups
+        // assign the running server with the least number of backups that is
+        // neither the server itself nor one of its previous backups
         SERVER_HANDLE_STRUCT *backupServer = NULL;
         int minBackups = INT_MAX;
-        for(int i = 0; i < MAX_SERVERS; i++)
+        for(int i = 0; i < snapshot->iServerCount; i++)
         {
-            // dont assign the server as its own backup            
-            // assign a unique backup server (not in previous backups)            
-            // find the backup server with the least number of active backups
-            
-            int flag = 0;
-
-            flag = flag || (serverHandleList->Running[i] == 0);
-            flag = flag || (serverHandleList->Active[i] == 0);
-            flag = flag || (serverHandleList->serverList[i].ServerID != serverHandle->ServerID);
-
+            SERVER_HANDLE_STRUCT *candidate = snapshot->servers[i];
+            int flag = (atomic_load(&candidate->iRunning) == 1) && (candidate != serverHandle) && (candidate->iBackupCount < minBackups);
             for(int j = 0; j < BackUpCount; j++)
-            {
-                flag = flag || (serverHandle->backupServers[j]->ServerID != serverHandleList->serverList[i].ServerID);
-            }
-
-            flag = flag || (serverHandleList->backupServerCount[i] <= minBackups);
+                flag = flag && (serverHandle->backupServers[j] != candidate);
 
             if(flag)
             {
-                // assign the backup server
-                backupServer = &serverHandleList->serverList[i];
-
-                serverHandle->backupServers[BackUpCount] = backupServer;
-                serverHandleList->backupServerCount[i]++;
-                BackUpCount++;
+                backupServer = candidate;
+                minBackups = candidate->iBackupCount;
             }
-
         }
 
-        itt++;
+        if(backupServer == NULL)
+            break;
+        serverHandle->backupServers[BackUpCount++] = backupServer;
+        backupServer->iBackupCount++;
     }
+    pthread_mutex_unlock(&serverHandleList->severListMutex);
 
     if(BackUpCount != BACKUP_SERVERS)
     {
-        printf(RED "[-]AssignBackupServer: Error assigning backup servers for server %lu\n" reset, serverID);
-        fprintf(logs, "[-]AssignBackupServer: Error assigning backup servers for server %lu\n", serverID);
+        LOG_ERROR("[-]AssignBackupServer: Error assigning backup servers for server %lu", serverID);
         return -1;
     }
 
-    printf(GRN "[+]AssignBackupServer: Assigned backup servers for server-%lu (%s:%d)" reset, serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
-    printf("\nBackups { ");
-    for(int i = 0; i < BackUpCount; i++)
-    {
-        printf("%d:(%lu), ", i+1, serverHandle->backupServers[i]->ServerID);
-    }
-    printf(" }\n");
-
-    fprintf(logs, "[+]AssignBackupServer: Assigned backup servers for server-%lu (%s:%d)", serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort);
-    fprintf(logs, "\nBackups { ");
+    char sBackups[MAX_BUFFER_SIZE] = "";
+    int iOffset = 0;
     for(int i = 0; i < BackUpCount; i++)
     {
-        fprintf(logs, "%d:(%lu), ", i+1, serverHandle->backupServers[i]->ServerID);
+        iOffset += snprintf(sBackups + iOffset, sizeof(sBackups) - iOffset, "%d:(%lu), ", i+1, serverHandle->backupServers[i]->ServerID);
     }
-    fprintf(logs, " }\n"); 
+    LOG_INFO("[+]AssignBackupServer: Assigned backup servers for server-%lu (%s:%d) Backups { %s }", serverHandle->ServerID, serverHandle->sServerIP, serverHandle->sServerPort, sBackups);
     
     return 0;
 }
@@ -273,21 +365,15 @@ int AssignBackupServer(SERVER_HANDLE_LIST_STRUCT *serverHandleList, unsigned lon
  * @param serverHandleList: The server handle list object
  * @return: 1 if active, 0 if inactive, -1 on failure
  * @note: if server is not present in the server handle list, return with failure
+ * @note: Lock free, safe to call on the request path
 */
 int IsActive(unsigned long serverID, SERVER_HANDLE_LIST_STRUCT *serverHandleList)
 {
-    pthread_mutex_lock(&serverHandleList->severListMutex);
-    // Find the server and return if it is active
-    for(int i = 0; i < MAX_SERVERS; i++)
-    {
-        if(serverHandleList->Active[i] == 1 && serverHandleList->serverList[i].ServerID == serverID)
-        {
-            pthread_mutex_unlock(&serverHandleList->severListMutex);
-            return serverHandleList->Running[i];
-        }
-    }
-    pthread_mutex_unlock(&serverHandleList->severListMutex);
-    return -1;
+    atomic_long *token;
+    SERVER_HANDLE_STRUCT *server = FindServer(ReadLock(serverHandleList, &token), serverID);
+    int iActive = (server != NULL) ? atomic_load(&server->iRunning) : -1;
+    ReadUnlock(token);
+    return iActive;
 }
 
 /**
@@ -301,10 +387,95 @@ SERVER_HANDLE_STRUCT* GetActiveBackUp(SERVER_HANDLE_LIST_STRUCT *serverHandleLis
 {
     for(int i = 0; i < BACKUP_SERVERS; i++)
     {
-        if(IsActive(BackUpList[i]->ServerID, serverHandleList))
+        if(BackUpList[i] != NULL && IsActive(BackUpList[i]->ServerID, serverHandleList) == 1)
         {
             return BackUpList[i];
         }
     }
     return NULL;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Gets the number of registered servers
+*/
+int GetServerCount(SERVER_HANDLE_LIST_STRUCT *serverHandleList)
+{
+    atomic_long *token;
+    int iServerCount = ReadLock(serverHandleList, &token)->iServerCount;
+    ReadUnlock(token);
+    return iServerCount;
+}
+
+/**
+ * @brief Registers a server known from the persisted mount table
+ * @param serverID: The ID the server had when its paths were recorded
+ * @param sAddress: "<ip>:<client port>:<naming server port>" (a SERVER record of the journal)
+ * @param serverHandleList: The server handle list object
+ * @return: The registered handle, NULL on failure
+ * @note: The handle has no connection. It is running for the requests clients send to the storage
+ *        server themselves (the storage server usually outlived the naming server), requests the
+ *        naming server forwards fail until the storage server registers again (FindStaleServers)
+*/
+SERVER_HANDLE_STRUCT* RestoreServer(unsigned long serverID, const char *sAddress, SERVER_HANDLE_LIST_STRUCT *serverHandleList)
+{
+    SERVER_HANDLE_STRUCT serverHandle;
+    memset(&serverHandle, 0, sizeof(serverHandle));
+    if (sscanf(sAddress, "%15[^:]:%d:%d", serverHandle.sServerIP, &serverHandle.sServerPort_Client, &serverHandle.sServerPort_NServer) != 3)
+    {
+        LOG_ERROR("[-]RestoreServer: Invalid address %s of server %lu", sAddress, serverID);
+        return NULL;
+    }
+    // The ID holds the port the server connected from, so GetServerID gives the same ID back
+    serverHandle.sServerPort = serverID & ((1UL << IP_LENGTH) - 1);
+    serverHandle.sSocket_Write = -1;
+    serverHandle.sSocket_Read = -1;
+    serverHandle.iWireVersion = WIRE_VERSION_2;
+    atomic_init(&serverHandle.iRestored, 1);
+
+    SERVER_HANDLE_STRUCT *server = AddServer(&serverHandle, serverHandleList);
+    if (server != NULL)
+        LOG_INFO("[+]RestoreServer: Restored server %lu (%s, clients on port %d)", server->ServerID, server->sServerIP, server->sServerPort_Client);
+    return server;
+}
+
+/**
+ * @brief Finds the handles a registering server replaces
+ * @param serverHandle: The registering server (its ports are known from the init packet)
+ * @param stale: Filled with the restored or disconnected handles with the same address
+ * @param iMaxStale: The size of stale
+ * @param serverHandleList: The server handle list object
+ * @return: The number of handles found
+ * @note: The ID of a server changes with every connection (it holds the port it connected from),
+ *        the address clients and the naming server reach it at does not
+*/
+int FindStaleServers(SERVER_HANDLE_STRUCT *serverHandle, SERVER_HANDLE_STRUCT **stale, int iMaxStale, SERVER_HANDLE_LIST_STRUCT *serverHandleList)
+{
+    atomic_long *token;
+    int iStaleCount = 0;
+    SERVER_SNAPSHOT_STRUCT *snapshot = ReadLock(serverHandleList, &token);
+    for (int i = 0; i < snapshot->iServerCount && iStaleCount < iMaxStale; i++)
+    {
+        SERVER_HANDLE_STRUCT *candidate = snapshot->servers[i];
+        if (candidate != serverHandle && strcmp(candidate->sServerIP, serverHandle->sServerIP) == 0 &&
+            candidate->sServerPort_Client == serverHandle->sServerPort_Client && candidate->sServerPort_NServer == serverHandle->sServerPort_NServer &&
+            (atomic_load(&candidate->iRestored) || !atomic_load(&candidate->iRunning)))
+            stale[iStaleCount++] = candidate;
+    }
+    ReadUnlock(token);
+    return iStaleCount;
+}
+
+/**
+ * @brief Closes the sockets of all registered servers (on server exit)
+*/
+void CloseServerSockets(SERVER_HANDLE_LIST_STRUCT *serverHandleList)
+{
+    atomic_long *token;
+    SERVER_SNAPSHOT_STRUCT *snapshot = ReadLock(serverHandleList, &token);
+    for(int i = 0; i < snapshot->iServerCount; i++)
+    {
+        close(snapshot->servers[i]->sSocket_Read);
+        close(snapshot->servers[i]->sSocket_Write);
+    }
+    ReadUnlock(token);
+}
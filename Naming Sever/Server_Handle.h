@@ -4,38 +4,56 @@
 #include "../Externals.h"
 #include <stdio.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include "./RCU.h"
 
-#define MAX_SERVERS 5
 #define BACKUP_SERVERS 0
 
 typedef struct SERVER_HANDLE_STRUCT
 {
     unsigned long ServerID;
     char sServerIP[IP_LENGTH];                            // IP of the storage server
-    int sServerPort;                                      // Port used by the storage server to connect to the naming server                    
+    int sServerPort;                                      // Port used by the storage server to connect to the naming server
     int sServerPort_NServer;                              // Port on which the storage server will listen for NServer
     int sServerPort_Client;                               // Port on which the storage server will listen for client
     int sSocket_Write;                                    // Socket to write to the server
     int sSocket_Read;                                     // Socket to read from the server
+    int iWireVersion;                                     // Wire protocol version spoken by the server
+    atomic_int iRunning;                                  // 1 while the server is connected
+    atomic_int iRestored;                                 // 1 while the handle only comes from the persisted mount table (no connection yet)
+    int iBackupCount;                                     // Number of servers this server is a backup of
     struct SERVER_HANDLE_STRUCT* backupServers[BACKUP_SERVERS];  // Array of backup servers
     // char MountPaths[MAX_BUFFER_SIZE];                  // \n separated list of mount paths
 
 } SERVER_HANDLE_STRUCT;
 
-typedef struct SERVER_HANDLE_LIST_STRUCT
+// Immutable view of the registered servers, replaced as a whole on every join/leave
+typedef struct SERVER_SNAPSHOT_STRUCT
 {
-    SERVER_HANDLE_STRUCT serverList[MAX_SERVERS];
-    short Active[MAX_SERVERS];
-    short Running[MAX_SERVERS];
-    int backupServerCount[MAX_SERVERS];
     int iServerCount;
+    SERVER_HANDLE_STRUCT** servers;       // Registered servers in join order
+    size_t iTableSize;                    // Power of 2, at least twice iServerCount
+    SERVER_HANDLE_STRUCT** table;         // Open addressing table keyed by ServerID
+} SERVER_SNAPSHOT_STRUCT;
+
+/*
+Readers (IsActive, GetActiveBackUp, ...) never lock: they enter a read section of the rcu domain,
+load the current snapshot and leave. Writers (AddServer, RemoveServer, ...) are serialized by
+severListMutex, publish a new snapshot and free the old one once every reader that could still
+see it has left (a grace period).
+Server handles themselves are never freed, the mount trie and the cache keep pointers to them.
+*/
+typedef struct SERVER_HANDLE_LIST_STRUCT
+{
+    _Atomic(SERVER_SNAPSHOT_STRUCT*) snapshot;
+    RCU_DOMAIN_STRUCT rcu;
     pthread_mutex_t severListMutex;
 } SERVER_HANDLE_LIST_STRUCT;
 
 
 SERVER_HANDLE_LIST_STRUCT* InitializeServerHandleList();
 
-int AddServer(SERVER_HANDLE_STRUCT *serverHandle, SERVER_HANDLE_LIST_STRUCT *serverHandleList);
+SERVER_HANDLE_STRUCT* AddServer(SERVER_HANDLE_STRUCT *serverHandle, SERVER_HANDLE_LIST_STRUCT *serverHandleList);
 
 int RemoveServer(unsigned long serverID, SERVER_HANDLE_LIST_STRUCT *serverHandleList);
 
@@ -45,10 +63,18 @@ int SetActive(unsigned long serverID, SERVER_HANDLE_LIST_STRUCT *serverHandleLis
 
 int AssignBackupServer(SERVER_HANDLE_LIST_STRUCT *serverHandleList, unsigned long serverID);
 
-unsigned long GetServerID(SERVER_HANDLE_STRUCT *serverHandle); 
+unsigned long GetServerID(SERVER_HANDLE_STRUCT *serverHandle);
 
 int IsActive(unsigned long serverID, SERVER_HANDLE_LIST_STRUCT *serverHandleList);
 
 SERVER_HANDLE_STRUCT* GetActiveBackUp(SERVER_HANDLE_LIST_STRUCT *serverHandleList, SERVER_HANDLE_STRUCT* BackUpList[]);
 
-#endif
\ No newline at end of file
+int GetServerCount(SERVER_HANDLE_LIST_STRUCT *serverHandleList);
+
+SERVER_HANDLE_STRUCT* RestoreServer(unsigned long serverID, const char *sAddress, SERVER_HANDLE_LIST_STRUCT *serverHandleList);
+
+int FindStaleServers(SERVER_HANDLE_STRUCT *serverHandle, SERVER_HANDLE_STRUCT **stale, int iMaxStale, SERVER_HANDLE_LIST_STRUCT *serverHandleList);
+
+void CloseServerSockets(SERVER_HANDLE_LIST_STRUCT *serverHandleList);
+
+#endif
@@ -0,0 +1,464 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+// Local Header Files
+#include "./Headers.h"
+#include "./Stats.h"
+#include "./Trie.h"
+#include "./Journal.h"
+#include "./LRU.h"
+#include "./ThreadPool.h"
+
+// Global Header Files
+#include "../Externals.h"
+#include "../Wire.h"
+
+extern CLIENT_HANDLE_LIST_STRUCT *clientHandleList;
+extern SERVER_HANDLE_LIST_STRUCT *serverHandleList;
+extern MOUNT_TRIE_STRUCT *MountTrie;
+extern LRUCache *MountCache;
+
+static pthread_key_t SlotKey;
+static _Atomic(STATS_SLOT_STRUCT *) SlotList = NULL;
+static atomic_int iSlotCount = 0;
+static __thread STATS_SLOT_STRUCT *ThreadSlot = NULL;
+static int iAdminPort = 0;
+
+// Names of the operations (indexed by opcode)
+static const char *OpNames[STATS_OP_COUNT] = {
+    "UNKNOWN", "READ", "WRITE", "CREATE", "DELETE", "INFO", "LIST",
+    "MOVE", "COPY", "RENAME", "CLOSE", "RESOLVE_BATCH", "SS_REPLY"};
+
+// Returns the histogram bucket of a latency
+static int Bucket_Index(uint64_t value)
+{
+    if (value >= (1ULL << STATS_MAX_VALUE_BITS))
+        value = (1ULL << STATS_MAX_VALUE_BITS) - 1;
+    if (value < (1ULL << STATS_SUB_BUCKET_BITS))
+        return (int)value;
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - STATS_SUB_BUCKET_BITS;
+    return ((shift + 1) << STATS_SUB_BUCKET_BITS) + (int)((value >> shift) & ((1ULL << STATS_SUB_BUCKET_BITS) - 1));
+}
+
+// Returns the highest latency counted in a bucket
+static uint64_t Bucket_Value(int index)
+{
+    int group = index >> STATS_SUB_BUCKET_BITS;
+    uint64_t sub = index & ((1 << STATS_SUB_BUCKET_BITS) - 1);
+    if (group == 0)
+        return sub;
+    uint64_t lower = ((1ULL << STATS_SUB_BUCKET_BITS) + sub) << (group - 1);
+    return lower + (1ULL << (group - 1)) - 1;
+}
+
+// Releases the slot of an exiting thread (its counters stay for the next owner)
+static void Release_Slot(void *slot)
+{
+    atomic_fetch_sub_explicit(&((STATS_SLOT_STRUCT *)slot)->iOwners, 1, memory_order_release);
+}
+
+// Returns the slot of the calling thread: a released one, a new one under STATS_MAX_SLOTS, or a shared one
+static STATS_SLOT_STRUCT *Get_Slot()
+{
+    if (ThreadSlot != NULL)
+        return ThreadSlot;
+
+    STATS_SLOT_STRUCT *slot;
+    for (slot = atomic_load(&SlotList); slot != NULL; slot = slot->next)
+    {
+        int expected = 0;
+        if (atomic_load_explicit(&slot->iOwners, memory_order_relaxed) == 0 && atomic_compare_exchange_strong(&slot->iOwners, &expected, 1))
+            break;
+    }
+
+    if (slot == NULL && atomic_fetch_add(&iSlotCount, 1) < STATS_MAX_SLOTS)
+    {
+        slot = (STATS_SLOT_STRUCT *)aligned_alloc(64, sizeof(STATS_SLOT_STRUCT));
+        if (CheckNull(slot, "[-]Stats: Error in allocating a slot"))
+        {
+            atomic_fetch_sub(&iSlotCount, 1);
+            return NULL;
+        }
+        memset(slot, 0, sizeof(STATS_SLOT_STRUCT));
+        atomic_store(&slot->iOwners, 1);
+
+        // Slots are only ever added at the head and never freed
+        slot->next = atomic_load(&SlotList);
+        while (!atomic_compare_exchange_weak(&SlotList, &slot->next, slot))
+            ;
+    }
+    else if (slot == NULL)
+    {
+        // Every slot is taken, share the one with the fewest threads
+        atomic_fetch_sub(&iSlotCount, 1);
+        for (STATS_SLOT_STRUCT *candidate = atomic_load(&SlotList); candidate != NULL; candidate = candidate->next)
+        {
+            if (slot == NULL || atomic_load_explicit(&candidate->iOwners, memory_order_relaxed) < atomic_load_explicit(&slot->iOwners, memory_order_relaxed))
+                slot = candidate;
+        }
+        if (slot == NULL)
+            return NULL;
+        atomic_fetch_add(&slot->iOwners, 1);
+    }
+
+    pthread_setspecific(SlotKey, slot);
+    ThreadSlot = slot;
+    return slot;
+}
+
+/**
+ * @brief Prepares the per-thread slots and starts the admin thread
+ * @param iPort: The port the report is served on (0 serves no port)
+ * @return: 0 on success, -1 on failure
+ */
+int Stats_Init(int iPort)
+{
+    if (pthread_key_create(&SlotKey, Release_Slot) != 0)
+        return -1;
+    if (iPort == 0)
+        return 0;
+
+    iAdminPort = iPort;
+    pthread_t tAdminThread;
+    int iThreadStatus = pthread_create(&tAdminThread, NULL, Admin_Stats_Thread, (void *)&iAdminPort);
+    if (CheckError(iThreadStatus, "[-]Stats_Init: Error in creating admin thread"))
+        return -1;
+    pthread_detach(tAdminThread);
+    return 0;
+}
+
+/**
+ * @brief Returns the monotonic time in nanoseconds
+ */
+uint64_t Stats_Now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// Allocates the histogram of an operation in a slot, returns the one of another thread of the slot if it was first
+static atomic_ulong *Get_Buckets(STATS_OP_STRUCT *op)
+{
+    atomic_ulong *buckets = (atomic_ulong *)calloc(STATS_BUCKET_COUNT, sizeof(atomic_ulong));
+    if (CheckNull(buckets, "[-]Stats: Error in allocating a histogram"))
+        return NULL;
+    atomic_ulong *expected = NULL;
+    if (!atomic_compare_exchange_strong_explicit(&op->buckets, &expected, buckets, memory_order_acq_rel, memory_order_acquire))
+    {
+        free(buckets);
+        return expected;
+    }
+    return buckets;
+}
+
+/**
+ * @brief Counts an operation in the slot of the calling thread
+ * @param iOperation: The opcode (unknown ones are counted as 0) or STATS_OP_SERVER_REPLY
+ * @param iStartNs: Stats_Now() when the operation started
+ * @param iFailed: Non zero if the operation failed
+ * @note: A slot may be shared past STATS_MAX_SLOTS threads, so the counters take relaxed atomic adds
+ *        (uncontended while the slot has a single thread)
+ */
+void Stats_Record(int iOperation, uint64_t iStartNs, int iFailed)
+{
+    STATS_SLOT_STRUCT *slot = Get_Slot();
+    if (slot == NULL)
+        return;
+    if (iOperation < 0 || iOperation >= STATS_OP_COUNT)
+        iOperation = 0;
+
+    uint64_t iLatencyNs = Stats_Now() - iStartNs;
+    STATS_OP_STRUCT *op = &slot->ops[iOperation];
+    atomic_ulong *buckets = atomic_load_explicit(&op->buckets, memory_order_acquire);
+    if (buckets == NULL)
+        buckets = Get_Buckets(op);
+    if (buckets != NULL)
+        atomic_fetch_add_explicit(&buckets[Bucket_Index(iLatencyNs)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&op->iCount, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&op->iTotalNs, iLatencyNs, memory_order_relaxed);
+    if (iFailed)
+        atomic_fetch_add_explicit(&op->iErrors, 1, memory_order_relaxed);
+    unsigned long iMaxNs = atomic_load_explicit(&op->iMaxNs, memory_order_relaxed);
+    while (iLatencyNs > iMaxNs && !atomic_compare_exchange_weak_explicit(&op->iMaxNs, &iMaxNs, iLatencyNs, memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+/**
+ * @brief Sums an operation over all the slots
+ * @param iOperation: The opcode or STATS_OP_SERVER_REPLY
+ * @param summary: Filled with the counts and the latency percentiles (microseconds)
+ * @note: Percentiles are the highest latency of their bucket (at most 1/16 above the real value)
+ */
+void Stats_Get_Op(int iOperation, STATS_OP_SUMMARY_STRUCT *summary)
+{
+    memset(summary, 0, sizeof(STATS_OP_SUMMARY_STRUCT));
+    if (iOperation < 0 || iOperation >= STATS_OP_COUNT)
+        return;
+
+    unsigned long buckets[STATS_BUCKET_COUNT] = {0};
+    unsigned long iTotalNs = 0, iMaxNs = 0, iSamples = 0;
+    for (STATS_SLOT_STRUCT *slot = atomic_load(&SlotList); slot != NULL; slot = slot->next)
+    {
+        STATS_OP_STRUCT *op = &slot->ops[iOperation];
+        if (atomic_load_explicit(&op->iCount, memory_order_relaxed) == 0)
+            continue;
+        summary->iCount += atomic_load_explicit(&op->iCount, memory_order_relaxed);
+        summary->iErrors += atomic_load_explicit(&op->iErrors, memory_order_relaxed);
+        iTotalNs += atomic_load_explicit(&op->iTotalNs, memory_order_relaxed);
+        unsigned long iSlotMaxNs = atomic_load_explicit(&op->iMaxNs, memory_order_relaxed);
+        if (iSlotMaxNs > iMaxNs)
+            iMaxNs = iSlotMaxNs;
+        atomic_ulong *opBuckets = atomic_load_explicit(&op->buckets, memory_order_acquire);
+        for (int i = 0; i < STATS_BUCKET_COUNT && opBuckets != NULL; i++)
+        {
+            unsigned long count = atomic_load_explicit(&opBuckets[i], memory_order_relaxed);
+            buckets[i] += count;
+            iSamples += count;
+        }
+    }
+    if (iSamples == 0)
+        return;
+
+    // The buckets may be a few records ahead of the counters read before them
+    summary->fMeanUs = summary->iCount ? iTotalNs / 1e3 / summary->iCount : 0;
+    summary->fMaxUs = iMaxNs / 1e3;
+    double *percentiles[] = {&summary->fP50Us, &summary->fP99Us, &summary->fP999Us};
+    const double ranks[] = {0.5, 0.99, 0.999};
+    unsigned long iSeen = 0;
+    int p = 0;
+    for (int i = 0; i < STATS_BUCKET_COUNT && p < 3; i++)
+    {
+        iSeen += buckets[i];
+        while (p < 3 && iSeen >= (unsigned long)(ranks[p] * iSamples + 0.5))
+        {
+            uint64_t value = Bucket_Value(i);
+            *percentiles[p++] = (value > iMaxNs ? iMaxNs : value) / 1e3;
+        }
+    }
+}
+
+/**
+ * @brief Writes the state of the Naming Server to a stream
+ * @param stream: The stream to write to (admin connection or log)
+ * @param iJson: Non zero for a single JSON object, zero for text
+ */
+void Stats_Report(FILE *stream, int iJson)
+{
+    STATS_OP_SUMMARY_STRUCT ops[STATS_OP_COUNT];
+    unsigned long iTotalOps = 0;
+    for (int i = 0; i < STATS_OP_COUNT; i++)
+    {
+        Stats_Get_Op(i, &ops[i]);
+        iTotalOps += ops[i].iCount;
+    }
+
+    // The mount table is reported by its journal, walking it is left to the snapshots
+    JOURNAL_STATS_STRUCT journalStats;
+    Journal_Get_Stats(&journalStats);
+
+    CACHE_STATS_STRUCT cacheStats;
+    getCacheStats(MountCache, &cacheStats);
+    unsigned long iLookups = cacheStats.iHits + cacheStats.iMisses;
+    double fHitRate = iLookups ? (double)cacheStats.iHits / iLookups : 0.0;
+
+    THREAD_POOL_STATS_STRUCT poolStats;
+    if (ClientWorkerPool != NULL)
+        GetThreadPoolStats(ClientWorkerPool, &poolStats);
+
+    int iClientCount = GetClientCount(clientHandleList);
+    int iServerCount = GetServerCount(serverHandleList);
+
+    if (iJson)
+    {
+        fprintf(stream, "{\"uptime_s\":%.3f,\"clients\":%d,\"servers\":%d,", Log_Clock(), iClientCount, iServerCount);
+        fprintf(stream, "\"journal\":{\"sequence\":%lu,\"durable\":%lu,\"inserts\":%lu,\"deletes\":%lu,\"renames\":%lu,\"commits\":%lu,\"syncs\":%lu,\"checkpoints\":%lu,\"bytes\":%llu,\"file_bytes\":%llu,\"failed\":%d},",
+                (unsigned long)journalStats.iSequence, (unsigned long)journalStats.iDurable, journalStats.iRecords[JOURNAL_INSERT],
+                journalStats.iRecords[JOURNAL_DELETE], journalStats.iRecords[JOURNAL_RENAME], journalStats.iCommits, journalStats.iSyncs,
+                journalStats.iCheckpoints, journalStats.iBytes, journalStats.iFileBytes, journalStats.iFailed);
+        fprintf(stream, "\"cache\":{\"size\":%d,\"capacity\":%d,\"hits\":%lu,\"misses\":%lu,\"hit_rate\":%.4f,\"evictions\":%lu},",
+                cacheStats.iSize, cacheStats.iCapacity, cacheStats.iHits, cacheStats.iMisses, fHitRate, cacheStats.iEvictions);
+        if (ClientWorkerPool != NULL)
+            fprintf(stream, "\"pool\":{\"workers\":%d,\"queue_depth\":%d,\"queue_capacity\":%d,\"max_queue_depth\":%d,\"requests\":%lu,\"blocked_enqueues\":%lu},",
+                    poolStats.iWorkerCount, poolStats.iQueueDepth, poolStats.iQueueCapacity, poolStats.iMaxQueueDepth, poolStats.iTotalRequests, poolStats.iBlockedEnqueues);
+        fprintf(stream, "\"ops\":{");
+        int iFirst = 1;
+        for (int i = 0; i < STATS_OP_COUNT; i++)
+        {
+            if (ops[i].iCount == 0)
+                continue;
+            fprintf(stream, "%s\"%s\":{\"count\":%lu,\"errors\":%lu,\"share\":%.4f,\"mean_us\":%.3f,\"p50_us\":%.3f,\"p99_us\":%.3f,\"p999_us\":%.3f,\"max_us\":%.3f}",
+                    iFirst ? "" : ",", OpNames[i], ops[i].iCount, ops[i].iErrors, (double)ops[i].iCount / iTotalOps,
+                    ops[i].fMeanUs, ops[i].fP50Us, ops[i].fP99Us, ops[i].fP999Us, ops[i].fMaxUs);
+            iFirst = 0;
+        }
+        fprintf(stream, "}}\n");
+        return;
+    }
+
+    fprintf(stream, "------------------------------------------------------------\n");
+    fprintf(stream, "Uptime: %.1fs\n", Log_Clock());
+    fprintf(stream, "Number of Current Clients: %d\n", iClientCount);
+    fprintf(stream, "Number of Current Servers: %d\n", iServerCount);
+    fprintf(stream, "Mount Journal: record %lu (%lu on disk), %lu inserts, %lu deletes, %lu renames in %lu writes, %lu syncs, %lu checkpoints (%llu bytes since the last)%s\n",
+            (unsigned long)journalStats.iSequence, (unsigned long)journalStats.iDurable, journalStats.iRecords[JOURNAL_INSERT],
+            journalStats.iRecords[JOURNAL_DELETE], journalStats.iRecords[JOURNAL_RENAME], journalStats.iCommits, journalStats.iSyncs,
+            journalStats.iCheckpoints, journalStats.iFileBytes, journalStats.iFailed ? ", FAILED" : "");
+    printCacheStats(MountCache, stream);
+    if (ClientWorkerPool != NULL)
+        PrintThreadPoolStats(ClientWorkerPool, stream);
+    fprintf(stream, "%-14s %10s %8s %7s %10s %10s %10s %10s %10s (us)\n", "Operation", "count", "errors", "share", "mean", "p50", "p99", "p999", "max");
+    for (int i = 0; i < STATS_OP_COUNT; i++)
+    {
+        if (ops[i].iCount == 0)
+            continue;
+        fprintf(stream, "%-14s %10lu %8lu %6.1f%% %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                OpNames[i], ops[i].iCount, ops[i].iErrors, 100.0 * ops[i].iCount / iTotalOps,
+                ops[i].fMeanUs, ops[i].fP50Us, ops[i].fP99Us, ops[i].fP999Us, ops[i].fMaxUs);
+    }
+    fprintf(stream, "------------------------------------------------------------\n");
+}
+
+static int Snapshot_Path(void *arg, void *Server_Handle, const char *path) // writes a line of the snapshot
+{
+    FILE *stream = (FILE *)arg;
+    return (fprintf(stream, "%lu %s\n", ((SERVER_HANDLE_STRUCT *)Server_Handle)->ServerID, path) < 0 || ferror(stream)) ? -1 : 0;
+}
+
+/**
+ * @brief Writes a snapshot of the mount table to a stream
+ * @param stream: The stream to write to (admin connection)
+ * @note: A header line "# record <sequence> nodes <n> paths <n> depth <n>" followed by one
+ *        "<server id> <path>" line per mounted path. The root and the journal sequence are taken
+ *        together in a write section that changes nothing (so it ends without waiting), the walk
+ *        then reads that root in a read section: the snapshot is exactly the table after the
+ *        journal record of the header while writers go on. A writer publishing during the walk
+ *        waits for it to end; the admin connection has a send timeout, a stalled reader ends the walk.
+ */
+static void Snapshot_Report(FILE *stream)
+{
+    TRIE_STATS_STRUCT trieStats;
+    JOURNAL_STATS_STRUCT journalStats;
+    atomic_long *token;
+
+    Trie_Write_Begin(MountTrie);
+    TrieNode *root = Trie_Read_Lock(MountTrie, &token);
+    Journal_Get_Stats(&journalStats);
+    Trie_Write_End(MountTrie);
+
+    Get_Trie_Stats(root, &trieStats);
+    fprintf(stream, "# record %lu nodes %lu paths %lu depth %d\n", (unsigned long)journalStats.iSequence,
+            trieStats.iNodeCount, trieStats.iPathCount, trieStats.iMaxDepth);
+    if (Walk_Trie(root, Snapshot_Path, stream) < 0)
+        LOG_ERROR("[-]Admin Stats Thread: Snapshot ended early");
+    Trie_Read_Unlock(token);
+}
+
+static ssize_t Admin_Stream_Write(void *cookie, const char *buffer, size_t size) // sends the buffered report
+{
+    return (Send_All(*(int *)cookie, buffer, size) < 0) ? -1 : (ssize_t)size;
+}
+
+/**
+ * @brief Answers an admin connection with a report
+ * @param sockfd: The admin connection
+ * @note: The optional request line picks the format: a line containing "json" for JSON,
+ *        "snapshot" for a snapshot of the mount table, anything else or nothing within
+ *        STATS_ADMIN_REQUEST_TIMEOUT_MS for text. An HTTP GET is answered with an HTTP
+ *        response (e.g. curl http://host:8082/json), its body ends with the connection.
+ * @note: The report is streamed to the connection as it is written, a snapshot of a large
+ *        table is never held in memory
+ */
+static void Serve_Admin_Connection(int sockfd)
+{
+    char sRequest[512] = {0};
+    struct pollfd pfd = {sockfd, POLLIN, 0};
+    if (poll(&pfd, 1, STATS_ADMIN_REQUEST_TIMEOUT_MS) > 0)
+    {
+        ssize_t n = recv(sockfd, sRequest, sizeof(sRequest) - 1, 0);
+        sRequest[n > 0 ? n : 0] = '\0';
+    }
+    int iHttp = strncmp(sRequest, "GET ", 4) == 0;
+    char *sEnd = strpbrk(sRequest, "\r\n");
+    if (sEnd != NULL)
+        *sEnd = '\0';
+    int iJson = strstr(sRequest, "json") != NULL;
+    int iSnapshot = strstr(sRequest, "snapshot") != NULL;
+
+    cookie_io_functions_t functions = {NULL, Admin_Stream_Write, NULL, NULL};
+    FILE *stream = fopencookie(&sockfd, "w", functions);
+    if (CheckNull(stream, "[-]Admin Stats Thread: Error in opening the connection stream"))
+        return;
+    if (iHttp)
+        fprintf(stream, "HTTP/1.0 200 OK\r\nContent-Type: %s\r\nConnection: close\r\n\r\n",
+                (iJson && !iSnapshot) ? "application/json" : "text/plain");
+    if (iSnapshot)
+        Snapshot_Report(stream);
+    else
+        Stats_Report(stream, iJson);
+    if (fclose(stream) != 0)
+        LOG_ERROR("[-]Admin Stats Thread: Error in sending report");
+}
+
+void *Admin_Stats_Thread(void *port)
+{
+    int iPort = *(int *)port;
+    LOG_INFO("[+]Admin Stats Thread Initialized");
+
+    // Create a socket
+    int iServerSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (CheckError(iServerSocket, "[-]Admin Stats Thread: Error in creating socket"))
+        return NULL;
+    // The server closes the admin connections, allow a restart while they are in TIME_WAIT
+    int iReuse = 1;
+    setsockopt(iServerSocket, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof(iReuse));
+
+    // Specify an address for the socket
+    struct sockaddr_in server_address;
+    server_address.sin_family = AF_INET;
+    server_address.sin_port = htons(iPort);
+    server_address.sin_addr.s_addr = INADDR_ANY;
+    memset(server_address.sin_zero, '\0', sizeof(server_address.sin_zero));
+
+    // Bind the socket to our specified IP and port (the server keeps running without stats)
+    int iBindStatus = bind(iServerSocket, (struct sockaddr *)&server_address, sizeof(server_address));
+    if (CheckError(iBindStatus, "[-]Admin Stats Thread: Error in binding socket to specified IP and port"))
+    {
+        LOG_ERROR("[-]Admin Stats Thread: Error in binding port %d", iPort);
+        close(iServerSocket);
+        return NULL;
+    }
+
+    // Listen for connections
+    int iListenStatus = listen(iServerSocket, MAX_QUEUE_SIZE);
+    if (CheckError(iListenStatus, "[-]Admin Stats Thread: Error in listening for connections"))
+    {
+        close(iServerSocket);
+        return NULL;
+    }
+
+    LOG_INFO("[+]Admin Stats Thread: Serving stats on port %d", iPort);
+
+    while (1)
+    {
+        int iAdminSocket = accept(iServerSocket, NULL, NULL);
+        if (CheckError(iAdminSocket, "[-]Admin Stats Thread: Error in accepting connection"))
+            continue;
+
+        // A stalled reader must not hold the thread
+        struct timeval timeout = {1, 0};
+        setsockopt(iAdminSocket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        Serve_Admin_Connection(iAdminSocket);
+        close(iAdminSocket);
+    }
+    return NULL;
+}
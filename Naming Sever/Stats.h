@@ -0,0 +1,72 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define DEFAULT_ADMIN_PORT 8082            // Port serving the stats report (0 disables it)
+#define STATS_ADMIN_REQUEST_TIMEOUT_MS 200 // Milliseconds the admin port waits for a request line
+#define STATS_SUB_BUCKET_BITS 4            // 16 linear buckets per power of 2 (values within 1/16)
+#define STATS_MAX_VALUE_BITS 36            // Latencies up to 2^36 ns (~68 s), longer ones are clamped
+#define STATS_BUCKET_COUNT ((STATS_MAX_VALUE_BITS - STATS_SUB_BUCKET_BITS + 1) << STATS_SUB_BUCKET_BITS)
+#define STATS_OP_SERVER_REPLY 12           // Replies of the storage servers (after the client opcodes)
+#define STATS_OP_COUNT 13                  // Client opcodes (0 for unknown ones) and STATS_OP_SERVER_REPLY
+#define STATS_MAX_SLOTS 64                 // Slots at most, threads past them share the slots
+
+/*
+Every thread serving requests counts them in a slot of its own, so recording an operation is a
+few relaxed atomic adds to cache lines no other thread writes. A slot is claimed on the first
+request of a thread and released when the thread exits; the next thread reuses it and keeps adding
+to its counters, so the totals never go backwards. There are at most STATS_MAX_SLOTS slots: past
+them (a thread per client with many clients) a new thread shares the slot with the fewest threads.
+Latencies go to log-linear (HDR style) histograms: exact below 16 ns, then 16 buckets per power of
+2. A histogram is allocated when its operation is first counted in a slot, so a slot only holds
+the histograms of the operations its threads served. The admin thread sums the slots when it is
+asked for a report.
+*/
+
+// Counters and latency histogram of one operation in one slot (written by the threads of the slot)
+typedef struct STATS_OP_STRUCT
+{
+    atomic_ulong iCount;
+    atomic_ulong iErrors;
+    atomic_ulong iTotalNs;
+    atomic_ulong iMaxNs;
+    _Atomic(atomic_ulong *) buckets;       // STATS_BUCKET_COUNT buckets, NULL until the operation is counted
+} STATS_OP_STRUCT;
+
+typedef struct STATS_SLOT_STRUCT
+{
+    atomic_int iOwners;                    // Live threads counting in the slot
+    struct STATS_SLOT_STRUCT *next;
+    STATS_OP_STRUCT ops[STATS_OP_COUNT];
+} __attribute__((aligned(64))) STATS_SLOT_STRUCT;
+
+// An operation summed over all the slots
+typedef struct STATS_OP_SUMMARY_STRUCT
+{
+    unsigned long iCount;
+    unsigned long iErrors;
+    double fMeanUs;
+    double fP50Us;
+    double fP99Us;
+    double fP999Us;
+    double fMaxUs;
+} STATS_OP_SUMMARY_STRUCT;
+
+// Prepares the per-thread slots and starts the admin thread (iAdminPort 0 serves no port)
+int Stats_Init(int iAdminPort);
+// Monotonic time in nanoseconds, passed to Stats_Record when the operation ends
+uint64_t Stats_Now();
+// Counts an operation started at iStartNs in the slot of the calling thread
+void Stats_Record(int iOperation, uint64_t iStartNs, int iFailed);
+// Sums an operation over all the slots
+void Stats_Get_Op(int iOperation, STATS_OP_SUMMARY_STRUCT *summary);
+// Writes the operations, cache, trie, pool, client and server counters as text or JSON
+void Stats_Report(FILE *stream, int iJson);
+
+// Thread answering every connection on the admin port with a report
+void *Admin_Stats_Thread(void *port);
+
+#endif
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// Local Header Files
+#include "./Headers.h"
+#include "./ThreadPool.h"
+#include "./Reactor.h"
+
+// Global Header Files
+#include "../Externals.h"
+#include "../colour.h"
+
+THREAD_POOL_STRUCT *ClientWorkerPool = NULL;
+
+/**
+ * @brief Creates a pool of workers fed by a bounded request queue
+ * @param iWorkerCount: Number of worker threads
+ * @param iQueueCapacity: Maximum number of requests waiting for a worker
+ * @return: The pool on success, NULL on failure
+ */
+THREAD_POOL_STRUCT *InitializeThreadPool(int iWorkerCount, int iQueueCapacity)
+{
+    THREAD_POOL_STRUCT *pool = (THREAD_POOL_STRUCT *)calloc(1, sizeof(THREAD_POOL_STRUCT));
+    if (CheckNull(pool, "[-]InitializeThreadPool: Error in allocating memory"))
+        return NULL;
+
+    pool->queue = (WORK_ITEM_STRUCT *)calloc(iQueueCapacity, sizeof(WORK_ITEM_STRUCT));
+    pool->workers = (pthread_t *)calloc(iWorkerCount, sizeof(pthread_t));
+    if (CheckNull(pool->queue, "[-]InitializeThreadPool: Error in allocating queue") || CheckNull(pool->workers, "[-]InitializeThreadPool: Error in allocating workers"))
+    {
+        free(pool->queue);
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+
+    pool->iQueueCapacity = iQueueCapacity;
+    pool->iWorkerCount = iWorkerCount;
+    pool->stats.iWorkerCount = iWorkerCount;
+    pool->stats.iQueueCapacity = iQueueCapacity;
+    pthread_mutex_init(&pool->poolMutex, NULL);
+    pthread_cond_init(&pool->notEmpty, NULL);
+    pthread_cond_init(&pool->notFull, NULL);
+
+    for (int i = 0; i < iWorkerCount; i++)
+    {
+        int iThreadStatus = pthread_create(&pool->workers[i], NULL, Client_Worker_Thread, (void *)pool);
+        if (CheckError(iThreadStatus, "[-]InitializeThreadPool: Error in creating worker thread"))
+            exit(EXIT_FAILURE);
+    }
+
+    LOG_INFO("[+]InitializeThreadPool: Started %d workers (queue depth %d)", iWorkerCount, iQueueCapacity);
+    return pool;
+}
+
+/**
+ * @brief Places a work item at the tail of the queue
+ * @param pool: The pool to submit to
+ * @param item: The item to be queued (copied into the queue)
+ * @note: Blocks while the queue is full, which stops the calling reactor from reading more requests.
+ *        A reference on the connection is taken for the queued item and dropped by the worker.
+ */
+static void Enqueue_Work_Item(THREAD_POOL_STRUCT *pool, WORK_ITEM_STRUCT *item)
+{
+    Retain_Client_Connection(item->connection);
+    item->fEnqueueTime = GetCurrTime(Clock);
+
+    pthread_mutex_lock(&pool->poolMutex);
+    if (pool->iQueueDepth == pool->iQueueCapacity)
+        pool->stats.iBlockedEnqueues++;
+    while (pool->iQueueDepth == pool->iQueueCapacity)
+        pthread_cond_wait(&pool->notFull, &pool->poolMutex);
+
+    pool->queue[pool->iTail] = *item;
+    pool->iTail = (pool->iTail + 1) % pool->iQueueCapacity;
+    pool->iQueueDepth++;
+    if (pool->iQueueDepth > pool->stats.iMaxQueueDepth)
+        pool->stats.iMaxQueueDepth = pool->iQueueDepth;
+
+    pthread_cond_signal(&pool->notEmpty);
+    pthread_mutex_unlock(&pool->poolMutex);
+}
+
+/**
+ * @brief Queues a client request for the workers
+ * @param pool: The pool to submit to
+ * @param connection: The connection the response is sent on
+ * @param ctx: The wire context of the request (copied into the queue)
+ * @param request: The request to be handled (copied into the queue)
+ * @return: 0 on success, -1 on failure
+ * @note: Blocks while the queue is full
+ */
+int ThreadPool_Submit(THREAD_POOL_STRUCT *pool, CLIENT_CONNECTION_STRUCT *connection, WIRE_CONTEXT_STRUCT *ctx, REQUEST_STRUCT *request)
+{
+    WORK_ITEM_STRUCT item;
+    memset(&item.batch, 0, sizeof(item.batch));
+    item.connection = connection;
+    item.context = *ctx;
+    item.request = *request;
+    Enqueue_Work_Item(pool, &item);
+    return 0;
+}
+
+/**
+ * @brief Queues a CMD_RESOLVE_BATCH request for the workers
+ * @param pool: The pool to submit to
+ * @param connection: The connection the results are sent on
+ * @param ctx: The wire context of the batch (copied into the queue)
+ * @param batch: The decoded batch, owned by the pool from here on (freed by the worker)
+ * @return: 0 on success, -1 on failure
+ * @note: Blocks while the queue is full
+ */
+int ThreadPool_Submit_Batch(THREAD_POOL_STRUCT *pool, CLIENT_CONNECTION_STRUCT *connection, WIRE_CONTEXT_STRUCT *ctx, RESOLVE_BATCH_STRUCT *batch)
+{
+    WORK_ITEM_STRUCT item;
+    memset(&item.request, 0, sizeof(item.request));
+    item.connection = connection;
+    item.context = *ctx;
+    item.batch = *batch;
+    item.request.iRequestOperation = CMD_RESOLVE_BATCH;
+    Enqueue_Work_Item(pool, &item);
+    return 0;
+}
+
+/**
+ * @brief Copies the current pool counters
+ * @param pool: The pool to inspect
+ * @param stats: Filled with the counters
+ */
+void GetThreadPoolStats(THREAD_POOL_STRUCT *pool, THREAD_POOL_STATS_STRUCT *stats)
+{
+    pthread_mutex_lock(&pool->poolMutex);
+    *stats = pool->stats;
+    stats->iQueueDepth = pool->iQueueDepth;
+    pthread_mutex_unlock(&pool->poolMutex);
+}
+
+/**
+ * @brief Writes the pool counters to a stream
+ * @param pool: The pool to inspect
+ * @param stream: The stream to write to (e.g. the log file)
+ */
+void PrintThreadPoolStats(THREAD_POOL_STRUCT *pool, FILE *stream)
+{
+    THREAD_POOL_STATS_STRUCT stats;
+    GetThreadPoolStats(pool, &stats);
+
+    double fAvgWaitTime = stats.iTotalRequests ? stats.fTotalWaitTime / stats.iTotalRequests : 0;
+    fprintf(stream, "Worker Pool: %d workers, queue depth %d/%d (max %d), %lu requests, %lu blocked enqueues\n",
+            stats.iWorkerCount, stats.iQueueDepth, stats.iQueueCapacity, stats.iMaxQueueDepth, stats.iTotalRequests, stats.iBlockedEnqueues);
+    fprintf(stream, "Worker Pool: queue wait avg %.6fs, max %.6fs\n", fAvgWaitTime, stats.fMaxWaitTime);
+}
+
+void *Client_Worker_Thread(void *threadPool)
+{
+    THREAD_POOL_STRUCT *pool = (THREAD_POOL_STRUCT *)threadPool;
+    LOG_INFO("[+]Client Worker Thread Initialized");
+
+    while (1)
+    {
+        pthread_mutex_lock(&pool->poolMutex);
+        while (pool->iQueueDepth == 0)
+            pthread_cond_wait(&pool->notEmpty, &pool->poolMutex);
+
+        WORK_ITEM_STRUCT item = pool->queue[pool->iHead];
+        pool->iHead = (pool->iHead + 1) % pool->iQueueCapacity;
+        pool->iQueueDepth--;
+
+        double fWaitTime = GetCurrTime(Clock) - item.fEnqueueTime;
+        pool->stats.iTotalRequests++;
+        pool->stats.fTotalWaitTime += fWaitTime;
+        if (fWaitTime > pool->stats.fMaxWaitTime)
+            pool->stats.fMaxWaitTime = fWaitTime;
+
+        pthread_cond_signal(&pool->notFull);
+        pthread_mutex_unlock(&pool->poolMutex);
+
+        if (item.batch.Paths != NULL)
+        {
+            Serve_Resolve_Batch(item.connection, &item.context, &item.batch);
+            Free_Resolve_Batch(&item.batch);
+        }
+        else
+            Serve_Client_Request(item.connection, &item.context, &item.request);
+        Release_Client_Connection(item.connection);
+    }
+
+    return NULL;
+}
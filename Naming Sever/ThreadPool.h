@@ -0,0 +1,72 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include "../Externals.h"
+#include "./Reactor.h"
+#include <stdio.h>
+#include <pthread.h>
+
+#define DEFAULT_POOL_WORKERS 4       // Number of worker threads serving client requests
+#define MAX_POOL_WORKERS 256
+#define DEFAULT_POOL_QUEUE_DEPTH 1024 // Number of requests that can wait for a worker
+#define MAX_POOL_QUEUE_DEPTH 1048576
+
+// A decoded client request waiting for a worker
+typedef struct WORK_ITEM_STRUCT
+{
+    CLIENT_CONNECTION_STRUCT* connection;  // Connection the response is sent on (holds a reference)
+    WIRE_CONTEXT_STRUCT context;           // Wire version and request ID the response is encoded with
+    REQUEST_STRUCT request;                // Request to be handled
+    RESOLVE_BATCH_STRUCT batch;            // Paths of a CMD_RESOLVE_BATCH (Paths is NULL for other requests, owned by the item)
+    double fEnqueueTime;                   // Time at which the request was queued
+} WORK_ITEM_STRUCT;
+
+// Snapshot of the pool counters
+typedef struct THREAD_POOL_STATS_STRUCT
+{
+    int iWorkerCount;                  // Number of worker threads
+    int iQueueCapacity;                // Maximum number of queued requests
+    int iQueueDepth;                   // Number of currently queued requests
+    int iMaxQueueDepth;                // Highest queue depth observed
+    unsigned long iTotalRequests;      // Number of requests dequeued by the workers
+    unsigned long iBlockedEnqueues;    // Number of enqueues that had to wait for a free slot
+    double fTotalWaitTime;             // Sum of the time requests spent in the queue (seconds)
+    double fMaxWaitTime;               // Longest time a request spent in the queue (seconds)
+} THREAD_POOL_STATS_STRUCT;
+
+// Fixed-size pool of workers fed by a bounded MPMC ring buffer
+typedef struct THREAD_POOL_STRUCT
+{
+    WORK_ITEM_STRUCT* queue;           // Ring buffer of iQueueCapacity items
+    int iQueueCapacity;
+    int iHead;                         // Index of the next item to dequeue
+    int iTail;                         // Index of the next free slot
+    int iQueueDepth;
+
+    pthread_t* workers;
+    int iWorkerCount;
+
+    pthread_mutex_t poolMutex;
+    pthread_cond_t notEmpty;           // Signalled when an item is queued
+    pthread_cond_t notFull;            // Signalled when an item is dequeued
+
+    THREAD_POOL_STATS_STRUCT stats;    // Protected by poolMutex
+} THREAD_POOL_STRUCT;
+
+extern THREAD_POOL_STRUCT* ClientWorkerPool;
+
+// Creates the pool and starts its workers
+THREAD_POOL_STRUCT* InitializeThreadPool(int iWorkerCount, int iQueueCapacity);
+// Queues a request, blocking while the queue is full
+int ThreadPool_Submit(THREAD_POOL_STRUCT* pool, CLIENT_CONNECTION_STRUCT* connection, WIRE_CONTEXT_STRUCT* ctx, REQUEST_STRUCT* request);
+// Queues a CMD_RESOLVE_BATCH request (the pool takes ownership of the batch)
+int ThreadPool_Submit_Batch(THREAD_POOL_STRUCT* pool, CLIENT_CONNECTION_STRUCT* connection, WIRE_CONTEXT_STRUCT* ctx, RESOLVE_BATCH_STRUCT* batch);
+// Copies the current pool counters
+void GetThreadPoolStats(THREAD_POOL_STRUCT* pool, THREAD_POOL_STATS_STRUCT* stats);
+// Writes the pool counters to a stream
+void PrintThreadPoolStats(THREAD_POOL_STRUCT* pool, FILE* stream);
+
+// Thread that dequeues and serves client requests
+void* Client_Worker_Thread(void* pool);
+
+#endif
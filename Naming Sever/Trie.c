@@ -2,120 +2,651 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+
+// Interned token: the pool owns one copy of every distinct name, nodes reference it
+typedef struct TOKEN_ENTRY {
+    struct TOKEN_ENTRY *next;
+    uint32_t hash;
+    uint32_t refs;
+    char token[];
+} TOKEN_ENTRY;
+
+#define TOKEN_ENTRY_OF(tok) ((TOKEN_ENTRY *)((char *)(tok) - offsetof(TOKEN_ENTRY, token)))
+#define TOKEN_POOL_INITIAL_BUCKETS 1024
+
+static TOKEN_ENTRY **TokenBuckets = NULL;
+static size_t iTokenBucketCount = 0;
+static size_t iTokenPoolCount = 0;
+
+// Walk position in the trie: token pos of node (parent is the node holding node as a child)
+typedef struct TRIE_CURSOR {
+    TrieNode *node;
+    TrieNode *parent;
+    int pos;
+} TRIE_CURSOR;
 
 // local helper functions
-TrieNode *getNode() // returns a new node
+uint32_t Hash(const char *path_token) // returns the hash of a token
 {
-    TrieNode *node = (TrieNode *)calloc(1, sizeof(TrieNode));
-    return node;
+    // djb2 algorithm, finalized so the low bits can index a table
+    uint32_t hash = 5381;
+    int c;
+    while ((c = (unsigned char)*path_token++))
+        hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3b;
+    hash ^= hash >> 16;
+    return hash;
 }
 
-int Hash(char *path_token) // returns the index of the child in the children array with given token
+static uint32_t Token_Hash(const char *token) // hash of an interned token
 {
-    if (path_token == NULL)
-        return -1;
+    return TOKEN_ENTRY_OF(token)->hash;
+}
 
-    // djb2 algorithm
-    unsigned long hash = 5381;
-    int c;
-    while (c = *path_token++)
-        hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
-    return hash % MAX_CHILDREN;
+static const char *Intern_Token(const char *token) // returns the pooled copy of a token (referenced once more)
+{
+    uint32_t hash = Hash(token);
+    if (TokenBuckets != NULL)
+    {
+        for (TOKEN_ENTRY *entry = TokenBuckets[hash & (iTokenBucketCount - 1)]; entry != NULL; entry = entry->next)
+        {
+            if (entry->hash == hash && strcmp(entry->token, token) == 0)
+            {
+                entry->refs++;
+                return entry->token;
+            }
+        }
+    }
+
+    // Keep at most one token per bucket on average
+    if (iTokenPoolCount >= iTokenBucketCount)
+    {
+        size_t iBucketCount = iTokenBucketCount ? 2 * iTokenBucketCount : TOKEN_POOL_INITIAL_BUCKETS;
+        TOKEN_ENTRY **buckets = (TOKEN_ENTRY **)calloc(iBucketCount, sizeof(TOKEN_ENTRY *));
+        if (buckets == NULL)
+            return NULL;
+        for (size_t i = 0; i < iTokenBucketCount; i++)
+        {
+            TOKEN_ENTRY *entry = TokenBuckets[i];
+            while (entry != NULL)
+            {
+                TOKEN_ENTRY *next = entry->next;
+                entry->next = buckets[entry->hash & (iBucketCount - 1)];
+                buckets[entry->hash & (iBucketCount - 1)] = entry;
+                entry = next;
+            }
+        }
+        free(TokenBuckets);
+        TokenBuckets = buckets;
+        iTokenBucketCount = iBucketCount;
+    }
+
+    size_t len = strlen(token);
+    TOKEN_ENTRY *entry = (TOKEN_ENTRY *)malloc(sizeof(TOKEN_ENTRY) + len + 1);
+    if (entry == NULL)
+        return NULL;
+    entry->hash = hash;
+    entry->refs = 1;
+    memcpy(entry->token, token, len + 1);
+    entry->next = TokenBuckets[hash & (iTokenBucketCount - 1)];
+    TokenBuckets[hash & (iTokenBucketCount - 1)] = entry;
+    iTokenPoolCount++;
+    return entry->token;
 }
-int Recursive_Delete(TrieNode *root) // deletes the subtree for the given node
+
+static void Release_Token(const char *token) // drops a reference, the token is freed with its last one
 {
-    if (root == NULL)
-        return -1;
-    for (int i = 0; i < MAX_CHILDREN; i++)
+    TOKEN_ENTRY *entry = TOKEN_ENTRY_OF(token);
+    if (--entry->refs > 0)
+        return;
+
+    TOKEN_ENTRY **link = &TokenBuckets[entry->hash & (iTokenBucketCount - 1)];
+    while (*link != entry)
+        link = &(*link)->next;
+    *link = entry->next;
+    free(entry);
+
+    if (--iTokenPoolCount == 0)
+    {
+        free(TokenBuckets);
+        TokenBuckets = NULL;
+        iTokenBucketCount = 0;
+    }
+}
+
+static int Is_Hashed(TrieChildren *children) // larger blocks are open addressing tables
+{
+    return children->iCapacity > TRIE_MEDIUM_CHILDREN;
+}
+
+static TrieChild *Find_Child_Slot(TrieChildren *children, const char *token, uint32_t hash) // returns the slot of the child with the given token else NULL
+{
+    if (children == NULL)
+        return NULL;
+
+    if (!Is_Hashed(children))
     {
-        if (root->children[i] != NULL)
+        for (uint32_t i = 0; i < children->iCount; i++)
         {
-            Recursive_Delete(root->children[i]);
-            root->children[i] = NULL;
+            if (Token_Hash(children->slots[i].token) == hash && strcmp(children->slots[i].token, token) == 0)
+                return &children->slots[i];
         }
+        return NULL;
+    }
+
+    uint32_t mask = children->iCapacity - 1;
+    for (uint32_t i = hash & mask; children->slots[i].token != NULL; i = (i + 1) & mask)
+    {
+        if (Token_Hash(children->slots[i].token) == hash && strcmp(children->slots[i].token, token) == 0)
+            return &children->slots[i];
     }
-    free(root);
+    return NULL;
+}
+
+static TrieNode *Find_Child(TrieNode *node, const char *token) // returns the child with the given token else NULL
+{
+    TrieChild *slot = Find_Child_Slot(node->children, token, Hash(token));
+    return slot == NULL ? NULL : slot->node;
+}
+
+static void Put_Child(TrieChildren *children, const char *token, TrieNode *child) // block must have room
+{
+    TrieChild *slot = &children->slots[children->iCount];
+    if (Is_Hashed(children))
+    {
+        uint32_t mask = children->iCapacity - 1;
+        uint32_t i = Token_Hash(token) & mask;
+        while (children->slots[i].token != NULL)
+            i = (i + 1) & mask;
+        slot = &children->slots[i];
+    }
+    slot->token = token;
+    slot->node = child;
+    children->iCount++;
+}
+
+static void Retain_Token(const char *token) // adds a reference to an interned token
+{
+    TOKEN_ENTRY_OF(token)->refs++;
+}
+
+static void Free_Node(TrieNode *node) // frees a node and drops its tokens (not its children)
+{
+    for (int i = 0; i < node->iTokenCount; i++)
+        Release_Token(node->tokens[i]);
+    free(node);
+}
+
+static int Retire(MOUNT_TRIE_STRUCT *trie, void *ptr, int iIsNode, uint32_t iVersion) // frees a node or block once no reader can see it
+{
+    // Created by the open write section, it was never published
+    if (iVersion == trie->iVersion)
+    {
+        if (iIsNode)
+            Free_Node((TrieNode *)ptr);
+        else
+            free(ptr);
+        return 0;
+    }
+
+    if (trie->iRetiredCount == trie->iRetiredCapacity)
+    {
+        size_t iCapacity = trie->iRetiredCapacity ? 2 * trie->iRetiredCapacity : 64;
+        TRIE_RETIRED_STRUCT *retired = (TRIE_RETIRED_STRUCT *)realloc(trie->retired, iCapacity * sizeof(TRIE_RETIRED_STRUCT));
+        if (retired == NULL)
+            return -1;
+        trie->retired = retired;
+        trie->iRetiredCapacity = iCapacity;
+    }
+    trie->retired[trie->iRetiredCount].ptr = ptr;
+    trie->retired[trie->iRetiredCount].iIsNode = iIsNode;
+    trie->iRetiredCount++;
     return 0;
 }
-int Get_Directory_Tree_Full(TrieNode *root, char *buffer, int lvl) // returns a string with the full tree path
+
+static void Retire_Subtree(MOUNT_TRIE_STRUCT *trie, TrieNode *node) // retires a node, its children and their blocks
 {
-    if (root == NULL)
+    if (node->children != NULL)
+    {
+        for (uint32_t i = 0; i < node->children->iCapacity; i++)
+        {
+            if (node->children->slots[i].token != NULL)
+                Retire_Subtree(trie, node->children->slots[i].node);
+        }
+        Retire(trie, node->children, 0, node->children->iVersion);
+    }
+    Retire(trie, node, 1, node->iVersion);
+}
+
+static TrieNode *Own_Node(MOUNT_TRIE_STRUCT *trie, TrieNode **link) // makes the node at link private to the write section
+{
+    TrieNode *node = *link;
+    if (node->iVersion == trie->iVersion)
+        return node;
+
+    size_t size = sizeof(TrieNode) + node->iTokenCount * sizeof(const char *);
+    TrieNode *copy = (TrieNode *)malloc(size);
+    if (copy == NULL)
+        return NULL;
+    memcpy(copy, node, size);
+    copy->iVersion = trie->iVersion;
+    for (int i = 0; i < copy->iTokenCount; i++)
+        Retain_Token(copy->tokens[i]);
+
+    if (Retire(trie, node, 1, node->iVersion) < 0)
+    {
+        Free_Node(copy);
+        return NULL;
+    }
+    *link = copy;
+    return copy;
+}
+
+static int Own_Children(MOUNT_TRIE_STRUCT *trie, TrieNode *node) // makes the children block of a private node private
+{
+    TrieChildren *children = node->children;
+    if (children == NULL || children->iVersion == trie->iVersion)
+        return 0;
+
+    size_t size = sizeof(TrieChildren) + children->iCapacity * sizeof(TrieChild);
+    TrieChildren *copy = (TrieChildren *)malloc(size);
+    if (copy == NULL)
         return -1;
-    for (int i = 0; i < lvl; i++)
+    memcpy(copy, children, size);
+    copy->iVersion = trie->iVersion;
+
+    if (Retire(trie, children, 0, children->iVersion) < 0)
     {
-        if (i%2 == 0 || i == 0)
-            strncat(buffer,"|",MAX_BUFFER_SIZE - strlen(buffer) - 1);
-        else
-            strncat(buffer," ",MAX_BUFFER_SIZE - strlen(buffer) - 1);    }
+        free(copy);
+        return -1;
+    }
+    node->children = copy;
+    return 0;
+}
 
-    strncat(buffer, "|-", MAX_BUFFER_SIZE - strlen(buffer) - 1);
-    strncat(buffer, root->path_token, MAX_BUFFER_SIZE - strlen(buffer) - 1);
-    strncat(buffer, "\n", MAX_BUFFER_SIZE - strlen(buffer) - 1);
+static TrieNode *Own_Child(MOUNT_TRIE_STRUCT *trie, TrieNode *node, const char *token) // makes the child with the given token private, NULL if absent
+{
+    if (Own_Children(trie, node) < 0)
+        return NULL;
+    TrieChild *slot = Find_Child_Slot(node->children, token, Hash(token));
+    if (slot == NULL)
+        return NULL;
+    return Own_Node(trie, &slot->node);
+}
 
-    for (int i = 0; i < MAX_CHILDREN; i++)
+static int Add_Child(MOUNT_TRIE_STRUCT *trie, TrieNode *node, const char *token, TrieNode *child) // node is private, token is the interned first token of child
+{
+    TrieChildren *children = node->children;
+    int full = children == NULL || children->iCount == children->iCapacity ||
+               (Is_Hashed(children) && (children->iCount + 1) * 100 > children->iCapacity * TRIE_LARGE_MAX_LOAD);
+    if (full)
     {
-        if (root->children[i] != NULL)
+        // Move to the next block size
+        uint32_t iCapacity = TRIE_SMALL_CHILDREN;
+        if (children != NULL)
+            iCapacity = children->iCapacity == TRIE_SMALL_CHILDREN ? TRIE_MEDIUM_CHILDREN : 2 * children->iCapacity;
+
+        TrieChildren *grown = (TrieChildren *)calloc(1, sizeof(TrieChildren) + iCapacity * sizeof(TrieChild));
+        if (grown == NULL)
+            return -1;
+        grown->iCapacity = iCapacity;
+        grown->iVersion = trie->iVersion;
+        if (children != NULL)
         {
-            int err = Get_Directory_Tree_Full(root->children[i], buffer, lvl + 1);
-            if (err < 0)
+            for (uint32_t i = 0; i < children->iCapacity; i++)
+            {
+                if (children->slots[i].token != NULL)
+                    Put_Child(grown, children->slots[i].token, children->slots[i].node);
+            }
+            if (Retire(trie, children, 0, children->iVersion) < 0)
+            {
+                free(grown);
                 return -1;
+            }
+        }
+        node->children = children = grown;
+    }
+    else if (Own_Children(trie, node) < 0)
+        return -1;
+
+    Put_Child(node->children, token, child);
+    return 0;
+}
+
+static int Remove_Child(MOUNT_TRIE_STRUCT *trie, TrieNode *node, const char *token) // node is private, removes the child with the given token
+{
+    if (Own_Children(trie, node) < 0)
+        return -1;
+    TrieChildren *children = node->children;
+    TrieChild *slot = Find_Child_Slot(children, token, Hash(token));
+    if (slot == NULL)
+        return -1;
+
+    if (!Is_Hashed(children))
+    {
+        *slot = children->slots[--children->iCount];
+        children->slots[children->iCount].token = NULL;
+        children->slots[children->iCount].node = NULL;
+    }
+    else
+    {
+        // Backward shift deletion keeps every probe sequence unbroken
+        uint32_t mask = children->iCapacity - 1;
+        uint32_t hole = slot - children->slots;
+        uint32_t i = hole;
+        while (1)
+        {
+            i = (i + 1) & mask;
+            if (children->slots[i].token == NULL)
+                break;
+            uint32_t home = Token_Hash(children->slots[i].token) & mask;
+            int stays = (hole <= i) ? (hole < home && home <= i) : (hole < home || home <= i);
+            if (stays)
+                continue;
+            children->slots[hole] = children->slots[i];
+            hole = i;
+        }
+        children->slots[hole].token = NULL;
+        children->slots[hole].node = NULL;
+        children->iCount--;
+    }
+
+    if (children->iCount == 0)
+    {
+        node->children = NULL;
+        free(children); // private to the write section
+    }
+    return 0;
+}
+
+static TrieNode *New_Node(char **tokens, int count, void *Server_Handle, uint32_t iVersion) // returns a new node for a chain of tokens
+{
+    TrieNode *node = (TrieNode *)malloc(sizeof(TrieNode) + count * sizeof(const char *));
+    if (node == NULL)
+        return NULL;
+    node->Server_Handle = Server_Handle;
+    node->children = NULL;
+    node->iTokenCount = 0;
+    node->iVersion = iVersion;
+    for (int i = 0; i < count; i++)
+    {
+        node->tokens[i] = Intern_Token(tokens[i]);
+        if (node->tokens[i] == NULL)
+        {
+            for (int j = 0; j < i; j++)
+                Release_Token(node->tokens[j]);
+            free(node);
+            return NULL;
+        }
+    }
+    node->iTokenCount = count;
+    return node;
+}
+
+static int Split_Node(MOUNT_TRIE_STRUCT *trie, TrieNode *node, int count) // node is private, keeps its first count tokens, the rest becomes its only child
+{
+    int rest = node->iTokenCount - count;
+    TrieNode *tail = (TrieNode *)malloc(sizeof(TrieNode) + rest * sizeof(const char *));
+    if (tail == NULL)
+        return -1;
+    tail->Server_Handle = node->Server_Handle;
+    tail->children = node->children;
+    tail->iTokenCount = rest;
+    tail->iVersion = trie->iVersion;
+    memcpy(tail->tokens, node->tokens + count, rest * sizeof(const char *));
+
+    node->children = NULL;
+    node->iTokenCount = count;
+    if (Add_Child(trie, node, tail->tokens[0], tail) < 0)
+    {
+        node->children = tail->children;
+        node->iTokenCount += rest;
+        free(tail);
+        return -1;
+    }
+    return 0;
+}
+
+static void Free_Subtree(TrieNode *node) // frees a node, its children and their tokens
+{
+    if (node->children != NULL)
+    {
+        for (uint32_t i = 0; i < node->children->iCapacity; i++)
+        {
+            if (node->children->slots[i].token != NULL)
+                Free_Subtree(node->children->slots[i].node);
         }
+        free(node->children);
+    }
+    Free_Node(node);
+}
+
+static void Cursor_Init(TRIE_CURSOR *cursor, TrieNode *root)
+{
+    cursor->node = root;
+    cursor->parent = NULL;
+    cursor->pos = root->iTokenCount - 1;
+}
+
+static int Cursor_Step(TRIE_CURSOR *cursor, const char *token) // moves to the given token below the cursor, -1 if absent
+{
+    if (cursor->pos + 1 < cursor->node->iTokenCount)
+    {
+        if (strcmp(cursor->node->tokens[cursor->pos + 1], token) != 0)
+            return -1;
+        cursor->pos++;
+        return 0;
     }
+
+    TrieNode *child = Find_Child(cursor->node, token);
+    if (child == NULL)
+        return -1;
+    cursor->parent = cursor->node;
+    cursor->node = child;
+    cursor->pos = 0;
     return 0;
 }
 
+static int Compare_Children(const void *a, const void *b)
+{
+    return strcmp(((const TrieChild *)a)->token, ((const TrieChild *)b)->token);
+}
+
+static int Sorted_Children(TrieNode *node, TrieChild **sorted) // copies the children of a node in name order
+{
+    *sorted = NULL;
+    if (node->children == NULL)
+        return 0;
+    TrieChild *list = (TrieChild *)malloc(node->children->iCount * sizeof(TrieChild));
+    if (list == NULL)
+        return -1;
+    int count = 0;
+    for (uint32_t i = 0; i < node->children->iCapacity; i++)
+    {
+        if (node->children->slots[i].token != NULL)
+            list[count++] = node->children->slots[i];
+    }
+    qsort(list, count, sizeof(TrieChild), Compare_Children);
+    *sorted = list;
+    return count;
+}
+
+/**
+ * @brief Splits a path into its tokens, skipping the first one (CWD of the Storage Server)
+ * @param path_cpy: A writable copy of the path (tokenized in place)
+ * @param tokens: Filled with the tokens
+ * @param max_tokens: The size of tokens
+ * @return: The number of tokens, -1 if there are more than max_tokens
+ */
+int Tokenize_Path(char *path_cpy, char **tokens, int max_tokens)
+{
+    char *save_ptr = NULL;
+    char *path_token = strtok_r(path_cpy, "/", &save_ptr);
+    path_token = strtok_r(NULL, "/", &save_ptr);
+
+    int count = 0;
+    while (path_token != NULL)
+    {
+        if (count == max_tokens)
+            return -1;
+        tokens[count++] = path_token;
+        path_token = strtok_r(NULL, "/", &save_ptr);
+    }
+    return count;
+}
+
 // global functions
 /**
  * @brief Initializes the trie
- * @return: The root node of the empty trie
+ * @param root_token: The name of the root node
+ * @return: The empty trie, NULL on failure
+ */
+MOUNT_TRIE_STRUCT *Init_Trie(char *root_token) // returns an empty trie
+{
+    MOUNT_TRIE_STRUCT *trie = (MOUNT_TRIE_STRUCT *)aligned_alloc(64, sizeof(MOUNT_TRIE_STRUCT));
+    if (trie == NULL)
+        return NULL;
+    memset(trie, 0, sizeof(MOUNT_TRIE_STRUCT));
+
+    TrieNode *root = New_Node(&root_token, 1, NULL, trie->iVersion);
+    if (root == NULL)
+    {
+        free(trie);
+        return NULL;
+    }
+    atomic_init(&trie->root, root);
+    trie->draft = root;
+    RCU_Init(&trie->rcu);
+    pthread_mutex_init(&trie->writeLock, NULL);
+    return trie;
+}
+/**
+ * @brief Enters a read section
+ * @param trie: The trie
+ * @param token: Filled with what Trie_Read_Unlock needs to leave the section
+ * @return: The root to read, valid until Trie_Read_Unlock
+ * @note: Never blocks, not even behind an open write section
+ */
+TrieNode *Trie_Read_Lock(MOUNT_TRIE_STRUCT *trie, atomic_long **token)
+{
+    *token = RCU_Read_Lock(&trie->rcu);
+    return atomic_load(&trie->root);
+}
+/**
+ * @brief Leaves a read section
+ * @param token: The token filled by Trie_Read_Lock
  */
-TrieNode *Init_Trie() // returns the root node of the empty trie
+void Trie_Read_Unlock(atomic_long *token)
 {
-    TrieNode *root = getNode();
-    return root;
+    RCU_Read_Unlock(token);
+}
+/**
+ * @brief Opens a write section (waits for the write section of another writer to end)
+ * @param trie: The trie
+ */
+void Trie_Write_Begin(MOUNT_TRIE_STRUCT *trie)
+{
+    pthread_mutex_lock(&trie->writeLock);
+    trie->iVersion++;
+    trie->draft = atomic_load(&trie->root);
+}
+/**
+ * @brief Publishes the changes of the write section and closes it
+ * @param trie: The trie
+ * @note: Returns once the nodes replaced in the section are freed (after a grace period)
+ */
+void Trie_Write_End(MOUNT_TRIE_STRUCT *trie)
+{
+    if (trie->draft != atomic_load(&trie->root))
+    {
+        atomic_store(&trie->root, trie->draft);
+        RCU_Synchronize(&trie->rcu);
+    }
+
+    for (size_t i = 0; i < trie->iRetiredCount; i++)
+    {
+        if (trie->retired[i].iIsNode)
+            Free_Node((TrieNode *)trie->retired[i].ptr);
+        else
+            free(trie->retired[i].ptr);
+    }
+    trie->iRetiredCount = 0;
+    pthread_mutex_unlock(&trie->writeLock);
 }
 /**
  * @brief Inserts the path in the trie
- * @param root: The root node of the trie
- * @param path: The path to be inserted
+ * @param trie: The trie (in a write section)
+ * @param path: The path to be inserted (tokenized in place)
  * @param Server_Handle: The server handle of the path
  * @return: 0 on success, -1 on failure
+ * @note: Directories created for the path get the same server handle, existing ones keep theirs
  */
-int Insert_Path(TrieNode *root, char *path, void *Server_Handle)
+int Insert_Path(MOUNT_TRIE_STRUCT *trie, char *path, void *Server_Handle)
 {
-    if (root == NULL || path == NULL || Server_Handle == NULL)
+    if (trie == NULL || path == NULL || Server_Handle == NULL)
         return -1;
 
-    TrieNode *curr = root;
-    char *path_token = strtok(path, "/");
     // Ignore the first token as it is CWD for Storage Server
-    path_token = strtok(NULL, "/");
+    char *tokens[TRIE_MAX_DEPTH];
+    int count = Tokenize_Path(path, tokens, TRIE_MAX_DEPTH);
+    if (count < 0)
+        return -1;
 
-    while (path_token != NULL)
+    TrieNode *curr = Own_Node(trie, &trie->draft);
+    if (curr == NULL)
+        return -1;
+    int pos = curr->iTokenCount - 1;
+    int depth = 0;
+    while (depth < count)
     {
-        int index = Hash(path_token);
-
-        // Check if the current node has a valid path_token
-        // if (curr->Server_Handle == NULL) {
-        //     strcpy(curr->path_token, path_token);
-        //     curr->Server_Handle = Server_Handle;
-        // }
-
-        if (curr->children[index] == NULL)
+        if (pos + 1 < curr->iTokenCount)
         {
-            curr->children[index] = getNode();
-            if (curr->children[index] == NULL)
+            if (strcmp(curr->tokens[pos + 1], tokens[depth]) == 0)
+            {
+                pos++;
+                depth++;
+                continue;
+            }
+            // The path branches off inside the chain of the node
+            if (Split_Node(trie, curr, pos + 1) < 0)
                 return -1;
-            strcpy(curr->children[index]->path_token, path_token);
-            curr->children[index]->Server_Handle = Server_Handle;
         }
 
-        curr = curr->children[index];
-        path_token = strtok(NULL, "/");
+        if (Find_Child(curr, tokens[depth]) == NULL)
+        {
+            // A single node holds the remaining tokens
+            TrieNode *child = New_Node(tokens + depth, count - depth, Server_Handle, trie->iVersion);
+            if (child == NULL)
+                return -1;
+            if (Add_Child(trie, curr, child->tokens[0], child) < 0)
+            {
+                Free_Subtree(child);
+                return -1;
+            }
+            return 0;
+        }
+        curr = Own_Child(trie, curr, tokens[depth]);
+        if (curr == NULL)
+            return -1;
+        pos = 0;
+        depth++;
     }
 
-    // Set the final node's Server_Handle
-    curr->Server_Handle = Server_Handle;
+    // Set the final node's Server_Handle, the tokens of the chain around it keep theirs
+    if (curr->Server_Handle != Server_Handle)
+    {
+        if (pos + 1 < curr->iTokenCount && Split_Node(trie, curr, pos + 1) < 0)
+            return -1;
+        if (pos > 0)
+        {
+            if (Split_Node(trie, curr, pos) < 0)
+                return -1;
+            curr = curr->children->slots[0].node;
+        }
+        curr->Server_Handle = Server_Handle;
+    }
 
     return 0;
 }
@@ -130,144 +661,618 @@ void *Get_Server(TrieNode *root, char *path) // returns the server handle of the
 {
     if (root == NULL || path == NULL)
         return NULL;
-    TrieNode *curr = root;
-    char *path_cpy = (char *)calloc(strlen(path) + 1, sizeof(char));
-    strcpy(path_cpy, path);
-    char *path_token = strtok(path_cpy, "/");
-    path_token = strtok(NULL, "/");
+    char *path_cpy = strdup(path);
+    if (path_cpy == NULL)
+        return NULL;
+
+    TRIE_CURSOR cursor;
+    Cursor_Init(&cursor, root);
+    char *save_ptr = NULL;
+    char *path_token = strtok_r(path_cpy, "/", &save_ptr);
+    path_token = strtok_r(NULL, "/", &save_ptr);
     while (path_token != NULL)
     {
-        int index = Hash(path_token);
-        if (curr->children[index] == NULL)
+        if (Cursor_Step(&cursor, path_token) < 0)
+        {
+            free(path_cpy);
             return NULL;
-        curr = curr->children[index];
-        path_token = strtok(NULL, "/");
+        }
+        path_token = strtok_r(NULL, "/", &save_ptr);
     }
     free(path_cpy);
-    return curr->Server_Handle;
+    return cursor.node->Server_Handle;
 }
 /**
- * @brief Deletes the path from the trie
- * @param root: The root node of the trie
- * @param path: The path to be deleted
- * @return: 0 on success, -1 on failure
- * @note: Deletes the subtree for the given path
+ * @brief Checks whether a path has entries below it
+ * @param root: The root node of the trie (or the draft of a write section)
+ * @param path: The path, the first token is skipped as in Insert_Path
+ * @return: 1 if the path has entries, 0 if it has none, -1 if it is not present
  */
-int Delete_Path(TrieNode *root, char *path) // deletes the path from the trie
+int Has_Entries(TrieNode *root, char *path)
 {
     if (root == NULL || path == NULL)
         return -1;
-    TrieNode *curr = root;
-    TrieNode *prev = NULL;
-    char *path_token = strtok(path, "/");
-    int index;
-    while (path_token != NULL)
+    char path_cpy[MAX_PATH_LEN];
+    char *tokens[TRIE_MAX_DEPTH];
+    strncpy(path_cpy, path, MAX_PATH_LEN - 1);
+    path_cpy[MAX_PATH_LEN - 1] = '\0';
+    int count = Tokenize_Path(path_cpy, tokens, TRIE_MAX_DEPTH);
+    if (count < 0)
+        return -1;
+
+    TRIE_CURSOR cursor;
+    Cursor_Init(&cursor, root);
+    for (int depth = 0; depth < count; depth++)
     {
-        index = Hash(path_token);
-        if (curr->children[index] == NULL)
+        if (Cursor_Step(&cursor, tokens[depth]) < 0)
             return -1;
-        prev = curr;
-        curr = curr->children[index];
-        path_token = strtok(NULL, "/");
     }
+    return (cursor.pos + 1 < cursor.node->iTokenCount) || (cursor.node->children != NULL && cursor.node->children->iCount > 0);
+}
 
-    // Delete the subtree for the given path
-    prev->children[index] = NULL;
-    return Recursive_Delete(curr);
+typedef struct BATCH_PATH
+{
+    char *path;
+    int index;
+} BATCH_PATH;
+
+int Compare_Batch_Paths(const void *a, const void *b)
+{
+    return strcmp(((const BATCH_PATH *)a)->path, ((const BATCH_PATH *)b)->path);
 }
+
 /**
- * @brief Deletes the trie
+ * @brief Returns the server handles of many paths in a single pass over the trie
  * @param root: The root node of the trie
+ * @param paths: The paths to be resolved
+ * @param count: The number of paths
+ * @param servers: Filled with the server handle of every path (NULL if not present)
+ * @return: The number of paths found, -1 on failure
+ * @note: The paths are visited in sorted order so that paths sharing directories are next to
+ *        each other, and the walk of a path restarts from the deepest position it shares with the
+ *        previous one instead of from the root.
+ */
+int Get_Servers_Batch(TrieNode *root, char **paths, int count, void **servers)
+{
+    if (root == NULL || paths == NULL || servers == NULL || count < 0)
+        return -1;
+
+    BATCH_PATH *order = (BATCH_PATH *)malloc((count ? count : 1) * sizeof(BATCH_PATH));
+    if (order == NULL)
+        return -1;
+    for (int i = 0; i < count; i++)
+    {
+        order[i].path = paths[i];
+        order[i].index = i;
+    }
+    qsort(order, count, sizeof(BATCH_PATH), Compare_Batch_Paths);
+
+    // Tokens of the current and of the previous path (the two buffers are swapped every path)
+    char path_cpy[2][MAX_PATH_LEN];
+    char *tokens[2][TRIE_BATCH_MAX_DEPTH];
+    int token_count[2] = {0, 0};
+    // walk[d] is the position reached after d tokens of the previous path, walked entries are valid
+    TRIE_CURSOR walk[TRIE_BATCH_MAX_DEPTH + 1];
+    int walked = 0;
+    int curr_buf = 0, found = 0;
+    Cursor_Init(&walk[0], root);
+
+    for (int i = 0; i < count; i++)
+    {
+        int prev_buf = curr_buf ^ 1;
+        char *path = order[i].path;
+        servers[order[i].index] = NULL;
+
+        strncpy(path_cpy[curr_buf], path, MAX_PATH_LEN - 1);
+        path_cpy[curr_buf][MAX_PATH_LEN - 1] = '\0';
+        token_count[curr_buf] = Tokenize_Path(path_cpy[curr_buf], tokens[curr_buf], TRIE_BATCH_MAX_DEPTH);
+        if (strlen(path) >= MAX_PATH_LEN || token_count[curr_buf] < 0)
+        {
+            // Too deep for the shared walk, resolve it on its own
+            servers[order[i].index] = Get_Server(root, path);
+            found += servers[order[i].index] != NULL;
+            walked = 0;
+            token_count[curr_buf] = 0;
+            curr_buf = prev_buf;
+            continue;
+        }
+
+        // Skip the directories shared with the previous path
+        int depth = 0;
+        while (depth < walked && depth < token_count[curr_buf] && depth < token_count[prev_buf] && strcmp(tokens[curr_buf][depth], tokens[prev_buf][depth]) == 0)
+            depth++;
+
+        TRIE_CURSOR cursor = walk[depth];
+        int present = 1;
+        while (depth < token_count[curr_buf])
+        {
+            if (Cursor_Step(&cursor, tokens[curr_buf][depth]) < 0)
+            {
+                present = 0;
+                break;
+            }
+            walk[++depth] = cursor;
+        }
+
+        walked = depth;
+        if (present)
+        {
+            servers[order[i].index] = cursor.node->Server_Handle;
+            found += cursor.node->Server_Handle != NULL;
+        }
+        curr_buf = prev_buf;
+    }
+
+    free(order);
+    return found;
+}
+/**
+ * @brief Deletes the path from the trie
+ * @param trie: The trie (in a write section)
+ * @param path: The path to be deleted (tokenized in place)
  * @return: 0 on success, -1 on failure
- * @note: Deletes the trie recursively
+ * @note: Deletes the subtree for the given path, the first token is skipped as in Insert_Path
  */
-int Delete_Trie(TrieNode *root) // deletes the trie
+int Delete_Path(MOUNT_TRIE_STRUCT *trie, char *path) // deletes the path from the trie
 {
-    if (root == NULL)
+    if (trie == NULL || path == NULL)
         return -1;
-    for (int i = 0; i < MAX_CHILDREN; i++)
+
+    char *tokens[TRIE_MAX_DEPTH];
+    int count = Tokenize_Path(path, tokens, TRIE_MAX_DEPTH);
+    // The root cannot be deleted
+    if (count <= 0)
+        return -1;
+
+    // Check that the path exists before copying anything
+    TRIE_CURSOR cursor;
+    Cursor_Init(&cursor, trie->draft);
+    for (int depth = 0; depth < count; depth++)
     {
-        if (root->children[i] != NULL)
+        if (Cursor_Step(&cursor, tokens[depth]) < 0)
+            return -1;
+    }
+
+    TrieNode *parent = NULL;
+    TrieNode *curr = Own_Node(trie, &trie->draft);
+    if (curr == NULL)
+        return -1;
+    int pos = curr->iTokenCount - 1;
+    for (int depth = 0; depth < count; depth++)
+    {
+        if (pos + 1 < curr->iTokenCount)
         {
-            Delete_Trie(root->children[i]);
+            pos++;
+            continue;
         }
+        parent = curr;
+        curr = Own_Child(trie, curr, tokens[depth]);
+        if (curr == NULL)
+            return -1;
+        pos = 0;
     }
-    free(root);
+
+    if (pos > 0)
+    {
+        // Cut the chain before the deleted token
+        if (curr->children != NULL)
+        {
+            for (uint32_t i = 0; i < curr->children->iCapacity; i++)
+            {
+                if (curr->children->slots[i].token != NULL)
+                    Retire_Subtree(trie, curr->children->slots[i].node);
+            }
+            Retire(trie, curr->children, 0, curr->children->iVersion);
+            curr->children = NULL;
+        }
+        for (int i = pos; i < curr->iTokenCount; i++)
+            Release_Token(curr->tokens[i]);
+        curr->iTokenCount = pos;
+        return 0;
+    }
+
+    // Delete the subtree for the given path
+    if (Remove_Child(trie, parent, curr->tokens[0]) < 0)
+        return -1;
+    Retire_Subtree(trie, curr);
+    return 0;
+}
+/**
+ * @brief Deletes the trie
+ * @param trie: The trie
+ * @return: 0 on success, -1 on failure
+ * @note: Deletes the trie recursively, no reader or writer may be left
+ */
+int Delete_Trie(MOUNT_TRIE_STRUCT *trie) // deletes the trie
+{
+    if (trie == NULL)
+        return -1;
+    Free_Subtree(atomic_load(&trie->root));
+    free(trie->retired);
+    pthread_mutex_destroy(&trie->writeLock);
+    free(trie);
     return 0;
 }
 
 // helper global functions
+static int Walk_Node(TrieNode *node, char *path, size_t length, TRIE_WALK_FUNC func, void *arg, long *count) // calls func for the mounted paths of a subtree
+{
+    for (int pos = 0; pos < node->iTokenCount; pos++)
+    {
+        int n = snprintf(path + length, MAX_PATH_LEN - length, "%s%s", length ? "/" : "", node->tokens[pos]);
+        if (n < 0 || (size_t)n >= MAX_PATH_LEN - length)
+            return 0;
+        length += n;
+        if (node->Server_Handle != NULL)
+        {
+            if (func(arg, node->Server_Handle, path) < 0)
+                return -1;
+            (*count)++;
+        }
+    }
+
+    if (node->children == NULL)
+        return 0;
+    for (uint32_t i = 0; i < node->children->iCapacity; i++)
+    {
+        if (node->children->slots[i].token != NULL && Walk_Node(node->children->slots[i].node, path, length, func, arg, count) < 0)
+            return -1;
+    }
+    return 0;
+}
 /**
- * @brief Prints the trie
- * @param root: The root node of the trie
- * @param lvl: The level of the node in the trie
- * @note: Prints the trie recursively
+ * @brief Calls a function for every mounted path of the trie
+ * @param root: The root node of the trie (returned by Trie_Read_Lock, or the draft of a write section)
+ * @param func: Called with the server handle and the path, a negative return stops the walk
+ * @param arg: Passed to func
+ * @return: The number of paths visited, -1 if func stopped the walk
+ * @note: Walks the whole trie in table order (not sorted, a directory before its entries), only for
+ *        snapshots and checkpoints. Paths are relative to the root, like the paths of the requests
  */
-void Print_Trie(TrieNode *root, int lvl) // prints the trie
+long Walk_Trie(TrieNode *root, TRIE_WALK_FUNC func, void *arg)
 {
-    if (root == NULL)
+    char path[MAX_PATH_LEN];
+    long count = 0;
+    if (root == NULL || root->children == NULL)
+        return 0;
+    for (uint32_t i = 0; i < root->children->iCapacity; i++)
+    {
+        if (root->children->slots[i].token != NULL && Walk_Node(root->children->slots[i].node, path, 0, func, arg, &count) < 0)
+            return -1;
+    }
+    return count;
+}
+static void Count_Node(TrieNode *node, int depth, TRIE_STATS_STRUCT *stats) // adds a node and its subtree to the stats
+{
+    depth += node->iTokenCount;
+    stats->iNodeCount++;
+    if (node->Server_Handle != NULL)
+        stats->iPathCount += node->iTokenCount;
+    if (depth > stats->iMaxDepth)
+        stats->iMaxDepth = depth;
+
+    if (node->children == NULL)
         return;
-    for (int i = 0; i < lvl; i++)
+    for (uint32_t i = 0; i < node->children->iCapacity; i++)
     {
-        if (i%2 == 0)
-            printf("|");
+        if (node->children->slots[i].token != NULL)
+            Count_Node(node->children->slots[i].node, depth, stats);
+    }
+}
+/**
+ * @brief Counts the nodes and the mounted paths of the trie
+ * @param root: The root node of the trie (returned by Trie_Read_Lock)
+ * @param stats: Filled with the counts
+ */
+void Get_Trie_Stats(TrieNode *root, TRIE_STATS_STRUCT *stats) // counts the nodes and paths of the trie
+{
+    memset(stats, 0, sizeof(TRIE_STATS_STRUCT));
+    if (root != NULL)
+        Count_Node(root, 0, stats);
+}
+// Open frame of a listing walk: a node, the next token of its chain to list and the next child to walk
+typedef struct TRIE_LIST_FRAME {
+    TrieNode *node;
+    TrieChild *sorted;          // children in name order, NULL when walked in table order
+    uint32_t iChildCount;       // entries of sorted, or slots of the table
+    uint32_t iNext;             // next child to walk (the one being walked while a deeper frame is open)
+    int iToken;                 // next token of the chain to list
+    int iDepth;                 // depth of the first token of the chain (below 0 for the listed node)
+    int iStepLength;            // length of the cursor step that led to the node
+} TRIE_LIST_FRAME;
+
+typedef struct TRIE_LIST_WALK {
+    TRIE_LIST_FRAME *frames;
+    int iCount;
+    int iCapacity;
+    int iStepsLength;           // length of the cursor steps of the open frames
+} TRIE_LIST_WALK;
+
+#define TRIE_LIST_STATE_LENGTH 18 // longest ":<token>.<child>" closing a cursor (hex, 32 bit each)
+#define TRIE_LIST_SKIP_LENGTH 17  // longest "+<skip>" after it (hex, 64 bit)
+
+static int List_Push(TRIE_LIST_WALK *walk, TrieNode *node, int iToken, int iDepth, int iStepLength) // opens a frame for a node
+{
+    if (walk->iCount == walk->iCapacity)
+    {
+        int iCapacity = walk->iCapacity ? 2 * walk->iCapacity : 16;
+        TRIE_LIST_FRAME *frames = (TRIE_LIST_FRAME *)realloc(walk->frames, iCapacity * sizeof(TRIE_LIST_FRAME));
+        if (frames == NULL)
+            return -1;
+        walk->frames = frames;
+        walk->iCapacity = iCapacity;
+    }
+
+    TRIE_LIST_FRAME *frame = &walk->frames[walk->iCount];
+    frame->node = node;
+    frame->sorted = NULL;
+    frame->iChildCount = 0;
+    frame->iNext = 0;
+    frame->iToken = iToken;
+    frame->iDepth = iDepth;
+    frame->iStepLength = iStepLength;
+    if (node->children != NULL && node->children->iCount > 0)
+    {
+        if (!Is_Hashed(node->children) || node->children->iCount <= TRIE_LIST_SORT_MAX)
+        {
+            int count = Sorted_Children(node, &frame->sorted);
+            if (count < 0)
+                return -1;
+            frame->iChildCount = count;
+        }
         else
-            printf(" ");
+            frame->iChildCount = node->children->iCapacity;
     }
-    unsigned long server_id = root->Server_Handle == NULL ? -1 : ((SERVER_HANDLE_STRUCT*)root->Server_Handle)->ServerID;
-    printf("|-%s (Server ID: %lu)\n", root->path_token, server_id);
-    for (int i = 0; i < MAX_CHILDREN; i++)
+    walk->iCount++;
+    walk->iStepsLength += iStepLength;
+    return 0;
+}
+
+static void List_Pop(TRIE_LIST_WALK *walk) // closes the deepest frame, its parent moves to its next child
+{
+    TRIE_LIST_FRAME *frame = &walk->frames[--walk->iCount];
+    walk->iStepsLength -= frame->iStepLength;
+    free(frame->sorted);
+    if (walk->iCount > 0)
+        walk->frames[walk->iCount - 1].iNext++;
+}
+
+static TrieChild *List_Child(TRIE_LIST_FRAME *frame, uint32_t i) // child i of a frame, NULL for an empty slot of a table
+{
+    if (frame->sorted != NULL)
+        return &frame->sorted[i];
+    TrieChild *child = &frame->node->children->slots[i];
+    return child->token == NULL ? NULL : child;
+}
+
+static int List_Step_Length(uint32_t i, const char *token) // length of the cursor step to child i
+{
+    return snprintf(NULL, 0, "%x.%x/", i, Token_Hash(token));
+}
+
+/**
+ * @brief Reopens the frames of a listing walk from a cursor
+ * @param walk: The walk, holding the frame of the listed node
+ * @param sCursor: The cursor of the previous page
+ * @param iSkip: Set to the entries already listed below the next child ("+<skip>" closing the cursor)
+ * @return: 0 on success, -1 if the cursor is malformed, -2 on error
+ * @note: A child that is gone (or moved after its table grew) ends the resumption at its index,
+ *        the walk then goes on with the child that took its place
+ */
+static int List_Resume(TRIE_LIST_WALK *walk, const char *sCursor, unsigned long *iSkip)
+{
+    const char *p = sCursor;
+    *iSkip = 0;
+    while (*p != ':')
     {
-        if (root->children[i] != NULL)
+        char *end;
+        unsigned long i = strtoul(p, &end, 16);
+        if (end == p || *end != '.')
+            return -1;
+        p = end + 1;
+        unsigned long hash = strtoul(p, &end, 16);
+        if (end == p || *end != '/')
+            return -1;
+        p = end + 1;
+
+        TRIE_LIST_FRAME *frame = &walk->frames[walk->iCount - 1];
+        frame->iToken = frame->node->iTokenCount;
+        TrieChild *child = (i < frame->iChildCount) ? List_Child(frame, i) : NULL;
+        if (child == NULL || Token_Hash(child->token) != hash)
+        {
+            child = NULL;
+            for (uint32_t j = 0; j < frame->iChildCount && child == NULL; j++)
+            {
+                TrieChild *candidate = List_Child(frame, j);
+                if (candidate != NULL && Token_Hash(candidate->token) == hash)
+                {
+                    child = candidate;
+                    i = j;
+                }
+            }
+        }
+        if (child == NULL)
         {
-            Print_Trie(root->children[i], lvl + 1);
+            frame->iNext = (i < frame->iChildCount) ? i : frame->iChildCount;
+            return 0;
         }
+        frame->iNext = i;
+        if (List_Push(walk, child->node, 0, frame->iDepth + frame->node->iTokenCount, List_Step_Length(i, child->token)) < 0)
+            return -2;
     }
-    return;
+
+    char *end;
+    unsigned long iToken = strtoul(p + 1, &end, 16);
+    if (end == p + 1 || *end != '.')
+        return -1;
+    p = end + 1;
+    unsigned long iNext = strtoul(p, &end, 16);
+    if (end == p || (*end != '\0' && *end != '+'))
+        return -1;
+    if (*end == '+')
+    {
+        p = end + 1;
+        *iSkip = strtoul(p, &end, 16);
+        if (end == p || *end != '\0')
+            return -1;
+    }
+    TRIE_LIST_FRAME *frame = &walk->frames[walk->iCount - 1];
+    if (iToken > (unsigned long)frame->node->iTokenCount || (walk->iCount == 1 && (long)iToken < -frame->iDepth))
+        return -1;
+    frame->iToken = iToken;
+    frame->iNext = (iNext < frame->iChildCount) ? iNext : frame->iChildCount;
+    return 0;
+}
+
+static void List_Cursor(TRIE_LIST_WALK *walk, int iCount, unsigned long iSkip, char *sCursor) // writes the position of the first iCount frames of the walk (fits by construction)
+{
+    int n = 0;
+    for (int k = 1; k < iCount; k++)
+        n += sprintf(sCursor + n, "%x.%x/", walk->frames[k - 1].iNext, Token_Hash(walk->frames[k].node->tokens[0]));
+    TRIE_LIST_FRAME *frame = &walk->frames[iCount - 1];
+    n += sprintf(sCursor + n, ":%x.%x", frame->iToken, frame->iNext);
+    if (iSkip > 0)
+        sprintf(sCursor + n, "+%lx", iSkip);
 }
+
 /**
- * @brief Populates the buffer with subtree path for a given path
- * @param root: The root node of the trie
- * @param path: The path for which the subtree path is to be returned
- * @param buffer: The buffer to be populated
- * @return: The buffer with subtree path for a given path
- * @note: Returns 0 on success, -1 if the path is not present in the trie and -2 on error
- * @note: The buffer should be allocated before calling this function (assumes buffer is big enough)
+ * @brief Fills the buffer with the next page of the directory tree under a path
+ * @param root: The root node of the trie (returned by Trie_Read_Lock)
+ * @param path: The listed directory
+ * @param list: The limits of the page and the cursor of the previous page (updated for the next one)
+ * @param buffer: Filled with one "|-<name>" line per entry, indented by its depth
+ * @param size: The size of the buffer, the page leaves room for the cursor, a newline and the NUL
+ * @return: The number of entries listed, -1 if the path is not present in the trie, -2 on error
+ *          (out of memory or a buffer too small for an entry) and -3 if the cursor is malformed
+ * @note: The walk is linear in the entries listed, a page never re-renders the entries before it
+ * @note: Every entry keeps room for the cursor the page would end with, the steps of the open
+ *        frames and their longest state (TRIE_LIST_STATE_LENGTH). A step down that the cursor
+ *        (TRIE_LIST_CURSOR_SIZE) or the page could not hold ends the page before it. On a page
+ *        without entries yet the child is listed anyway and a page ending below it points at the
+ *        child with the count of its entries already listed, which the next page skips.
  */
-int Get_Directory_Tree(TrieNode *root, char *path, char* buffer) // fills the buffer with subtree path for a given path
+int Get_Directory_Page(TrieNode *root, char *path, TRIE_LIST_STRUCT *list, char *buffer, size_t size) // fills the buffer with the next page of the directory tree
 {
-    if (root == NULL || path == NULL)
+    if (root == NULL || path == NULL || size == 0)
         return -2;
-    // itterate to the node for the given path
-    TrieNode *curr = root;
+    buffer[0] = '\0';
 
-    char *path_cpy = (char *) malloc(strlen(path) + 1);
-    memset(path_cpy, 0, strlen(path) + 1);
+    char *path_cpy = strdup(path);
+    if (path_cpy == NULL)
+        return -2;
 
-    strcpy(path_cpy, path);
-    char *path_token = strtok(path_cpy, "/");
-    path_token = strtok(NULL, "/");
+    // itterate to the position for the given path
+    TRIE_CURSOR cursor;
+    Cursor_Init(&cursor, root);
+    char *save_ptr = NULL;
+    char *path_token = strtok_r(path_cpy, "/", &save_ptr);
+    path_token = strtok_r(NULL, "/", &save_ptr);
     while (path_token != NULL)
     {
-        int index = Hash(path_token);
-        if (curr->children[index] == NULL)
+        if (Cursor_Step(&cursor, path_token) < 0)
         {
             free(path_cpy);
-            strcpy(buffer, "Invalid Path");
             return -1;
         }
-        curr = curr->children[index];
-        path_token = strtok(NULL, "/");
+        path_token = strtok_r(NULL, "/", &save_ptr);
     }
     free(path_cpy);
 
-    // Recursively get the subtree path
-    // char *subtree_path = (char *)calloc(MAX_BUFFER_SIZE, sizeof(char));
+    TRIE_LIST_WALK walk = {NULL, 0, 0, 0};
+    unsigned long iSkip = 0;
+    int err = List_Push(&walk, cursor.node, cursor.pos, -cursor.pos, 0) < 0 ? -2 : 0;
+    if (err == 0 && list->sCursor[0] != '\0')
+    {
+        err = List_Resume(&walk, list->sCursor, &iSkip);
+        err = (err == -1) ? -3 : err;
+    }
+    if (err == 0 && walk.iStepsLength + TRIE_LIST_STATE_LENGTH + TRIE_LIST_SKIP_LENGTH + 2 > size)
+        err = -2;
 
-    if(Get_Directory_Tree_Full(curr,buffer , 0) < 0)
+    int iEntries = 0;
+    size_t iUsed = 0;
+    int iDeepFrame = 0;            // frames up to the child out of reach of the cursor (0 while the walk is within it)
+    int iDeepSteps = 0;            // length of the cursor steps above that child
+    unsigned long iDeepListed = 0; // entries listed below that child, on this page and the ones before
+    int iDeepEnd = 0;              // the page ends below that child
+    while (err == 0 && walk.iCount > 0)
     {
-        strcpy(buffer, "Error in getting subtree directory");
-        return -2;
+        if (iDeepFrame > 0 && walk.iCount < iDeepFrame)
+        {
+            iDeepFrame = 0;
+            iSkip = 0;
+        }
+        TRIE_LIST_FRAME *frame = &walk.frames[walk.iCount - 1];
+        if (frame->iToken < frame->node->iTokenCount)
+        {
+            // The next token of the chain, deeper tokens and children are cut by the depth limit
+            int depth = frame->iDepth + frame->iToken;
+            if (list->iMaxDepth > 0 && depth > list->iMaxDepth)
+            {
+                List_Pop(&walk);
+                continue;
+            }
+            if (iDeepFrame > 0 && iSkip > 0)
+            {
+                // Listed by a previous page
+                iSkip--;
+                iDeepListed++;
+                frame->iToken++;
+                continue;
+            }
+            const char *token = frame->node->tokens[frame->iToken];
+            size_t length = depth + 3 + strlen(token);
+            size_t iCursorLength = (iDeepFrame > 0) ? iDeepSteps + TRIE_LIST_STATE_LENGTH + TRIE_LIST_SKIP_LENGTH
+                                                    : walk.iStepsLength + TRIE_LIST_STATE_LENGTH;
+            if ((list->iMaxEntries > 0 && iEntries == list->iMaxEntries) || iUsed + length + iCursorLength + 2 > size)
+            {
+                err = (iEntries == 0) ? -2 : 0;
+                iDeepEnd = (iDeepFrame > 0);
+                break;
+            }
+            for (int i = 0; i < depth; i++)
+                buffer[iUsed++] = (i % 2 == 0) ? '|' : ' ';
+            iUsed += sprintf(buffer + iUsed, "|-%s\n", token);
+            iEntries++;
+            iDeepListed += (iDeepFrame > 0);
+            frame->iToken++;
+            continue;
+        }
+
+        int iChildDepth = frame->iDepth + frame->node->iTokenCount;
+        while (frame->iNext < frame->iChildCount && List_Child(frame, frame->iNext) == NULL)
+            frame->iNext++;
+        if (frame->iNext == frame->iChildCount || (list->iMaxDepth > 0 && iChildDepth > list->iMaxDepth))
+        {
+            iSkip = (iDeepFrame > 0) ? iSkip : 0;
+            List_Pop(&walk);
+            continue;
+        }
+        TrieChild *child = List_Child(frame, frame->iNext);
+        int iStepLength = List_Step_Length(frame->iNext, child->token);
+        size_t iCursorLength = walk.iStepsLength + iStepLength + TRIE_LIST_STATE_LENGTH;
+        if (iDeepFrame == 0 && (iSkip > 0 || iCursorLength + TRIE_LIST_SKIP_LENGTH >= TRIE_LIST_CURSOR_SIZE || iUsed + iCursorLength + 2 > size))
+        {
+            // The cursor cannot take the step: the page ends before the child, or the child is
+            // listed with its entries counted from the position of this frame
+            if (iEntries > 0 && iSkip == 0)
+                break;
+            iDeepFrame = walk.iCount + 1;
+            iDeepSteps = walk.iStepsLength;
+            iDeepListed = 0;
+        }
+        if (List_Push(&walk, child->node, 0, iChildDepth, iStepLength) < 0)
+            err = -2;
     }
-    return 0; 
+
+    if (err == 0 && iDeepEnd)
+        List_Cursor(&walk, iDeepFrame - 1, iDeepListed, list->sCursor);
+    else if (err == 0 && walk.iCount > 0)
+        List_Cursor(&walk, walk.iCount, 0, list->sCursor);
+    else
+        list->sCursor[0] = '\0';
+    while (walk.iCount > 0)
+        List_Pop(&walk);
+    free(walk.frames);
+    return (err == 0) ? iEntries : err;
 }
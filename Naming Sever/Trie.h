@@ -2,27 +2,123 @@
 #define __TRIE_H__
 
 #include "Headers.h"
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "./RCU.h"
 
-#define MAX_CHILDREN 512 // specifies the maximum nummber of contents in a directory (Keep High for good hash performance)
+#define TRIE_BATCH_MAX_DEPTH 64 // deeper paths of a batch are resolved on their own
+#define TRIE_MAX_DEPTH (MAX_PATH_LEN / 2) // a path of MAX_PATH_LEN bytes has at most this many tokens
+#define TRIE_SMALL_CHILDREN 4   // children of a small node (scanned)
+#define TRIE_MEDIUM_CHILDREN 16 // children of a medium node (scanned), larger nodes are hashed
+#define TRIE_LARGE_MAX_LOAD 75  // percentage of a hashed node's slots in use before it doubles
+#define TRIE_LIST_SORT_MAX 256  // directories with more entries are listed in table order
+#define TRIE_LIST_CURSOR_SIZE 512 // longest continuation cursor of a listing page (NUL included)
 
+/*
+The mount table is a path compressed radix tree over path tokens.
+- A node stands for a chain of one or more tokens (a directory with a single entry and its entry
+  share a node until another path branches off in between). Every token of the chain maps to the
+  node's Server_Handle.
+- Tokens are interned: each distinct name is stored once and nodes only hold pointers to it.
+- The children of a node are kept in a block whose size adapts to their number: 4 and 16 entry
+  blocks are scanned, larger blocks are open addressing tables keyed by the token hash. Lookups
+  always compare the full token, so siblings never collide.
+Readers never lock: they walk the root published in the MOUNT_TRIE_STRUCT inside a read section
+(Trie_Read_Lock/Trie_Read_Unlock). Writers open a write section (Trie_Write_Begin), which takes the
+write lock, and never modify a published node or child block in place: they copy it once per
+section (copies are stamped with the section's version and may then be changed freely), link the
+copy in place of the original along the path from a draft root, and retire the original. Closing
+the section (Trie_Write_End) publishes the draft root and frees the retired nodes after a grace
+period. A storage server registering many paths does it in a single section, so readers see
+either none or all of them and the writer waits for a single grace period.
+The interned token pool is only touched by writers.
+
+A directory listing (LIST) is served in pages. A page walks the tree depth first from where the
+previous one stopped and ends with an opaque cursor: the position of the walk as the index (and
+token hash) of the child taken at every level, plus the next token and child of the deepest node.
+The next page resumes by following those indices, so it costs the depth of the tree and not the
+entries already listed, and no state is kept between pages. Directories of up to
+TRIE_LIST_SORT_MAX entries are listed in name order, larger ones in the order of their table.
+A page ends early rather than take a step its cursor (TRIE_LIST_CURSOR_SIZE) cannot hold. The next
+page takes it and, when it ends below it, points at the child and the entries listed under it
+("+<skip>"), so a tree of any depth is listed: resuming there costs the entries skipped.
+Entries added or removed between two pages may be missed or listed twice.
+*/
+
+// An entry of a children block (token is NULL for an empty slot of a hashed block)
+typedef struct TrieChild {
+    const char* token;          // interned first token of the child
+    struct TrieNode* node;
+} TrieChild;
+
+typedef struct TrieChildren {
+    uint32_t iCount;
+    uint32_t iCapacity;         // TRIE_SMALL_CHILDREN, TRIE_MEDIUM_CHILDREN or a larger power of 2 (hashed)
+    uint32_t iVersion;          // write section that created the block
+    TrieChild slots[];
+} TrieChildren;
 
 typedef struct TrieNode {
-    char path_token[MAX_PATH_LEN];
     void* Server_Handle;
-    struct TrieNode* children[MAX_CHILDREN];
-}TrieNode;
+    TrieChildren* children;     // NULL for a leaf
+    uint16_t iTokenCount;       // length of the token chain of the node
+    uint32_t iVersion;          // write section that created the node
+    const char* tokens[];       // interned tokens of the chain
+} TrieNode;
+
+// A node or child block replaced in a write section, freed after the grace period
+typedef struct TRIE_RETIRED_STRUCT {
+    void* ptr;
+    int iIsNode;
+} TRIE_RETIRED_STRUCT;
+
+typedef struct MOUNT_TRIE_STRUCT {
+    _Atomic(TrieNode*) root;            // root seen by the readers
+    TrieNode* draft;                    // root changed by the open write section
+    uint32_t iVersion;                  // version of the open write section (wraps after 2^32 sections)
+    TRIE_RETIRED_STRUCT* retired;
+    size_t iRetiredCount;
+    size_t iRetiredCapacity;
+    RCU_DOMAIN_STRUCT rcu;
+    pthread_mutex_t writeLock;
+} MOUNT_TRIE_STRUCT;
+
+// A page of a directory listing
+typedef struct TRIE_LIST_STRUCT {
+    int iMaxDepth;              // deepest entry listed, the directory itself is at depth 0 (0 for no limit)
+    int iMaxEntries;            // entries of the page (0 for as many as fit)
+    char sCursor[TRIE_LIST_CURSOR_SIZE]; // in: where the previous page stopped ("" for the first page), out: where this one stopped ("" after the last page)
+} TRIE_LIST_STRUCT;
+
+// Size of the trie seen by a reader
+typedef struct TRIE_STATS_STRUCT {
+    unsigned long iNodeCount;
+    unsigned long iPathCount;   // tokens mapped to a server
+    int iMaxDepth;              // tokens on the longest path (root included)
+} TRIE_STATS_STRUCT;
+
+// Called by Walk_Trie for every mounted path (relative to the root), a negative return stops the walk
+typedef int (*TRIE_WALK_FUNC)(void* arg, void* Server_Handle, const char* path);
+
+MOUNT_TRIE_STRUCT* Init_Trie(char* root_token); // returns an empty trie
+int Delete_Trie(MOUNT_TRIE_STRUCT* trie); // deletes the trie (no reader or writer may be left)
+
+TrieNode* Trie_Read_Lock(MOUNT_TRIE_STRUCT* trie, atomic_long** token); // enters a read section, returns the root to read
+void Trie_Read_Unlock(atomic_long* token); // leaves a read section
+void Trie_Write_Begin(MOUNT_TRIE_STRUCT* trie); // opens a write section
+void Trie_Write_End(MOUNT_TRIE_STRUCT* trie); // publishes the changes of the write section and closes it
+
+int Insert_Path(MOUNT_TRIE_STRUCT* trie, char* path, void* Server_Handle); // inserts the path in the trie (in a write section)
+int Delete_Path(MOUNT_TRIE_STRUCT* trie, char* path); // deletes the path from the trie (in a write section)
 
-// TrieNode* getNode(); // returns a new node
-// int Hash(char* path_token); // returns the index of the child in the children array else -1
-TrieNode* Init_Trie(); // returns the root node of the empty trie
-int Insert_Path(TrieNode* root,char* path, void* Server_Handle); // inserts the path in the trie
+// Readers, root is returned by Trie_Read_Lock
 void* Get_Server(TrieNode* root, char* path); // returns the server handle of the path
-int Delete_Path(TrieNode* root, char* path); // deletes the path from the trie
-int Delete_Trie(TrieNode* root); // deletes the trie
-// int Recursive_Delete(TrieNode* root); // deletes the trie recursively
+int Get_Servers_Batch(TrieNode* root, char** paths, int count, void** servers); // resolves many paths sharing the walks of common directories
+int Has_Entries(TrieNode* root, char* path); // checks whether a path has entries below it
 
-void Print_Trie(TrieNode* root, int lvl); // prints the trie
-int Get_Directory_Tree(TrieNode* root, char* path, char* buffer); // Populates the buffer with the directory tree
-// char* Get_Directory_Tree_Full(TrieNode* root, char* cur_dir, int lvl); // returns a string with the full tree path
+long Walk_Trie(TrieNode* root, TRIE_WALK_FUNC func, void* arg); // calls func for every mounted path of the trie
+void Get_Trie_Stats(TrieNode* root, TRIE_STATS_STRUCT* stats); // counts the nodes and paths of the trie
+int Get_Directory_Page(TrieNode* root, char* path, TRIE_LIST_STRUCT* list, char* buffer, size_t size); // fills the buffer with the next page of the directory tree
 
-#endif
\ No newline at end of file
+#endif
@@ -2,10 +2,14 @@
 #define __HEADERS_H__
 
 #include <stdio.h>
+#include <netinet/in.h>
 #include "./Trie.h"
+#include "../Log.h"
+#include "../Trace.h"
 
 # define MAX_CONN_Q 5
 #define LOG_FLUSH_INTERVAL 10
+#define SS_MOUNT_PATHS_SIZE (1024 * 1024) // Size of the mount path list sent to the Naming Server
 
 
 // structure for client object
@@ -30,13 +34,16 @@ double GetCurrTime(CLOCK* clock);
 // Trie* File_Trie;
 // int NS_Write_Socket;
 
-extern FILE* Log_File;
 extern CLOCK* Clock;
+extern int NS_Wire_Version;
 
 void* NS_Listner_Thread(void* arg);
 void* Client_Listner_Thread(void* arg);
 void* Client_Handler_Thread(void* arg);
 
+// Connects to the Naming Server (exits on failure)
+int Connect_Naming_Server(struct sockaddr_in* NS_Addr);
+
 
 
 // Populates the File_Trie with the contents of the cwd
@@ -3,23 +3,28 @@
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <dirent.h>
 #include <unistd.h>
 #include <string.h>
+#include <fcntl.h>
+#include <signal.h>
 
 #include "./Headers.h"
+#include "./Transfer.h"
 #include "./Trie.h"
 #include "./ErrorCodes.h"
 #include "../Externals.h"
+#include "../Wire.h"
 #include "../colour.h"
 
 int NS_Write_Socket;
 Trie *File_Trie;
 unsigned long Server_ID;
+int NS_Wire_Version;
 
-FILE *Log_File;
 CLOCK *Clock;
 
 /**
@@ -49,7 +54,7 @@ CLOCK *InitClock()
     CLOCK *C = (CLOCK *)malloc(sizeof(CLOCK));
     if (CheckNull(C, "[-]InitClock: Error in allocating memory"))
     {
-        fprintf(Log_File, "[-]InitClock: Error in allocating memory \n");
+        LOG_ERROR("[-]InitClock: Error in allocating memory ");
         exit(EXIT_FAILURE);
     }
 
@@ -57,7 +62,7 @@ CLOCK *InitClock()
     C->bootTime = GetCurrTime(C);
     if (CheckError(C->bootTime, "[-]InitClock: Error in getting current time"))
     {
-        fprintf(Log_File, "[-]InitClock: Error in getting current time\n");
+        LOG_ERROR("[-]InitClock: Error in getting current time");
         free(C);
         exit(EXIT_FAILURE);
     }
@@ -65,7 +70,7 @@ CLOCK *InitClock()
     int err = clock_gettime(CLOCK_MONOTONIC_RAW, &C->Btime);
     if (CheckError(err, "[-]InitClock: Error in getting current time"))
     {
-        fprintf(Log_File, "[-]InitClock: Error in getting current time\n");
+        LOG_ERROR("[-]InitClock: Error in getting current time");
         free(C);
         exit(EXIT_FAILURE);
     }
@@ -82,14 +87,14 @@ double GetCurrTime(CLOCK *Clock)
 {
     if (CheckNull(Clock, "[-]GetCurrTime: Invalid clock object"))
     {
-        fprintf(Log_File, "[-]GetCurrTime: Invalid clock object\n");
+        LOG_ERROR("[-]GetCurrTime: Invalid clock object");
         return -1;
     }
     struct timespec time;
     int err = clock_gettime(CLOCK_MONOTONIC_RAW, &time);
     if (CheckError(err, "[-]GetCurrTime: Error in getting current time"))
     {
-        fprintf(Log_File, "[-]GetCurrTime: Error in getting current time\n");
+        LOG_ERROR("[-]GetCurrTime: Error in getting current time");
         return -1;
     }
     return (time.tv_sec + time.tv_nsec * 1e-9) - (Clock->bootTime);
@@ -107,7 +112,7 @@ int Populate_Trie(Trie *root, char *dir)
     int Num_Entries = scandir(dir, &namelist, NULL, alphasort);
     if (CheckError(Num_Entries, "[-]scandir: Error in getting directory entries"))
     {
-        fprintf(Log_File, "[-]scandir: Error in getting directory entries");
+        LOG_ERROR("[-]scandir: Error in getting directory entries");
         return -1;
     }
 
@@ -131,7 +136,7 @@ int Populate_Trie(Trie *root, char *dir)
         int err = trie_insert(root, path);
         if (CheckError(err, "[-]Populate_Trie: Error in adding file/folder to trie"))
         {
-            fprintf(Log_File, "[-]Populate_Trie: Error in adding file/folder to trie\n");
+            LOG_ERROR("[-]Populate_Trie: Error in adding file/folder to trie");
             return -1;
         }
 
@@ -141,15 +146,13 @@ int Populate_Trie(Trie *root, char *dir)
             err += Populate_Trie(root, dir_path);
             if (CheckError(err, "[-]Populate_Trie: Error in populating trie"))
             {
-                printf("Error Path: %s\n", path);
-                fprintf(Log_File, "[-]Populate_Trie: Error in recursively adding folder contents to trie (Path: %s) [Time Stamp: %f]\n", path, GetCurrTime(Clock));
+                LOG_ERROR("[-]Populate_Trie: Error in recursively adding folder contents to trie (Path: %s)", path);
             }
         }
 
         if (err < 0)
         {
-            printf("[+]Populate_Trie: Error Detected while populating %d paths\n", -1 * err);
-            fprintf(Log_File, "[+]Populate_Trie: Error Detected while populating %d paths [Time Stamp: %f]\n", -1 * err, GetCurrTime(Clock));
+            LOG_ERROR("[+]Populate_Trie: Error Detected while populating %d paths", -1 * err);
             return -1;
         }
     }
@@ -167,7 +170,7 @@ Trie *Initialize_File_Trie()
     Trie *root = trie_init();
     if (CheckNull(root, "[-]Initialize_File_Trie: Error in initializing trie"))
     {
-        fprintf(Log_File, "[-]Initialize_File_Trie: Error in initializing trie\n");
+        LOG_ERROR("[-]Initialize_File_Trie: Error in initializing trie");
         return NULL;
     }
     strcpy(root->path_token, "Mount");
@@ -175,7 +178,7 @@ Trie *Initialize_File_Trie()
     char cwd[MAX_BUFFER_SIZE];
     if (getcwd(cwd, sizeof(cwd)) == NULL)
     {
-        fprintf(Log_File, "[-]Initialize_File_Trie: Error in getting cwd\n");
+        LOG_ERROR("[-]Initialize_File_Trie: Error in getting cwd");
         return NULL;
     }
     printf("[+]Initialize_File_Trie: Trie initialized at path:\n %s (CWD)\n", cwd);
@@ -184,7 +187,7 @@ Trie *Initialize_File_Trie()
     int err = Populate_Trie(root, ".");
     if (CheckError(err, "[-]Initialize_File_Trie: Error in populating trie"))
     {
-        fprintf(Log_File, "[-]Initialize_File_Trie: Error in populating trie\n");
+        LOG_ERROR("[-]Initialize_File_Trie: Error in populating trie");
         return NULL;
     }
 
@@ -193,7 +196,7 @@ Trie *Initialize_File_Trie()
     err = trie_print(root, buffer, 0);
     if (CheckError(err, "[-]Initialize_File_Trie: Error in getting mount paths"))
     {
-        fprintf(Log_File, "[-]Initialize_File_Trie: Error in getting mount paths\n");
+        LOG_ERROR("[-]Initialize_File_Trie: Error in getting mount paths");
         return NULL;
     }
     printf("[+]Initialize_File_Trie: Mount Paths Hosted: \n%s\n", buffer);
@@ -213,7 +216,7 @@ void *NS_Listner_Thread(void *arg)
     int NS_Listen_Socket = socket(AF_INET, SOCK_STREAM, 0);
     if (CheckError(NS_Listen_Socket, "[-]NS_Listner_Thread: Error in creating socket for listening to Name Server"))
     {
-        fprintf(Log_File, "[-]NS_Listner_Thread: Error in creating socket for listening to Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]NS_Listner_Thread: Error in creating socket for listening to Name Server");
         exit(EXIT_FAILURE);
     }
 
@@ -224,11 +227,13 @@ void *NS_Listner_Thread(void *arg)
     NS_Listen_Addr.sin_addr.s_addr = INADDR_ANY;
     memset(NS_Listen_Addr.sin_zero, '\0', sizeof(NS_Listen_Addr.sin_zero));
 
-    // Bind the socket to the address
+    // Bind the socket to the address (connections of a previous run may still be in TIME_WAIT)
+    int iReuse = 1;
+    setsockopt(NS_Listen_Socket, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof(iReuse));
     int err = bind(NS_Listen_Socket, (struct sockaddr *)&NS_Listen_Addr, sizeof(NS_Listen_Addr));
     if (CheckError(err, "[-]NS_Listner_Thread: Error in binding socket to address"))
     {
-        fprintf(Log_File, "[-]NS_Listner_Thread: Error in binding socket to address [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]NS_Listner_Thread: Error in binding socket to address");
         exit(EXIT_FAILURE);
     }
 
@@ -236,12 +241,11 @@ void *NS_Listner_Thread(void *arg)
     err = listen(NS_Listen_Socket, 5);
     if (CheckError(err, "[-]NS_Listner_Thread: Error in listening for connections"))
     {
-        fprintf(Log_File, "[-]NS_Listner_Thread: Error in listening for connections [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]NS_Listner_Thread: Error in listening for connections");
         exit(EXIT_FAILURE);
     }
 
-    printf("[+]NS_Listner_Thread: Listening for connections on Port: %d\n", NSPort);
-    fprintf(Log_File, "[+]NS_Listner_Thread: Listening for connections on Port: %d [Time Stamp: %f]\n", NSPort, GetCurrTime(Clock));
+    LOG_INFO("[+]NS_Listner_Thread: Listening for connections on Port: %d", NSPort);
 
     // Accept connections
     struct sockaddr_in NS_Client_Addr;
@@ -253,45 +257,46 @@ void *NS_Listner_Thread(void *arg)
 
     if (CheckError(NS_Client_Socket, "[-]NS_Listner_Thread: Error in accepting connections"))
     {
-        fprintf(Log_File, "[-]NS_Listner_Thread: Error in accepting connections [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]NS_Listner_Thread: Error in accepting connections");
         exit(EXIT_FAILURE);
     }
     else if (strncmp(ns_IP, NS_IP, IP_LENGTH) != 0)
     {
-        printf(RED "[-]NS_Listner_Thread: Connection Rejected from %s:%d\n" CRESET, ns_IP, ns_Port);
-        fprintf(Log_File, "[-]NS_Listner_Thread: Connection Rejected from %s:%d [Time Stamp: %f]\n", ns_IP, ns_Port, GetCurrTime(Clock));
+        LOG_ERROR("[-]NS_Listner_Thread: Connection Rejected from %s:%d", ns_IP, ns_Port);
         exit(EXIT_FAILURE);
     }
 
-    printf(GRN "[+]NS_Listner_Thread: Connection Established with Naming Server\n" CRESET);
-    fprintf(Log_File, "[+]NS_Listner_Thread: Connection Established with Naming Server [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]NS_Listner_Thread: Connection Established with Naming Server");
 
+    // The wire version is detected from the first request of the Name Server
+    WIRE_CONTEXT_STRUCT NS_Context = {WIRE_VERSION_UNKNOWN, 0};
     while (IsSocketConnected(NS_Client_Socket))
     {
         REQUEST_STRUCT NS_Response_Struct;
         REQUEST_STRUCT *NS_Response = &NS_Response_Struct;
 
         // Receive the request from the Name Server
-        int err = recv(NS_Client_Socket, NS_Response, sizeof(RESPONSE_STRUCT), 0);
+        int err = Recv_Request(NS_Client_Socket, &NS_Context, NS_Response);
         if (CheckError(err, "[-]NS_Listner_Thread: Error in receiving data from Name Server"))
         {
-            fprintf(Log_File, "[-]NS_Listner_Thread: Error in receiving data from Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]NS_Listner_Thread: Error in receiving data from Name Server");
             exit(EXIT_FAILURE);
         }
         else if (err == 0)
         {
-            printf(RED "[-]NS_Listner_Thread: Connection with Name Server Closed\n" CRESET);
-            fprintf(Log_File, "[-]NS_Listner_Thread: Connection with Name Server Closed [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]NS_Listner_Thread: Connection with Name Server Closed");
             break;
         }
 
+        // Continue the trace of the request the Name Server forwarded (if it carries one)
+        Trace_Set_Context(NS_Context.iTraceID, NS_Context.iParentSpanID);
+        TRACE_SPAN_STRUCT span, lockSpan;
+        Trace_Begin(&span, CommandName(NS_Response->iRequestOperation));
+        Trace_Detail(&span, "%s", NS_Response->sRequestPath);
+
         // Print the request received from the Name Server
-        printf(GRN "[+]NS_Listner_Thread: Request Received from Name Server\n" CRESET);
-        fprintf(Log_File, "[+]NS_Listner_Thread: Request Received from Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
-        printf("Request Operation: %d\n", NS_Response->iRequestOperation);
-        printf("Request Path: %s\n", NS_Response->sRequestPath);
-        printf("Request Flag: %d\n", NS_Response->iRequestFlags);
-        printf("Request Client ID: %lu\n", NS_Response->iRequestClientID);
+        LOG_INFO("[+]NS_Listner_Thread: Request Received from Name Server");
+        LOG_DEBUG("[+]NS_Listner_Thread: Request Operation: %d, Path: %s, Flag: %d, Client ID: %lu", NS_Response->iRequestOperation, NS_Response->sRequestPath, NS_Response->iRequestFlags, NS_Response->iRequestClientID);
 
         RESPONSE_STRUCT NS_Request_Struct;
         RESPONSE_STRUCT *NS_Request = &NS_Request_Struct;
@@ -333,57 +338,76 @@ void *NS_Listner_Thread(void *arg)
             // resolve the path and rename requested path to new path
             // send an ack to server after completion
 
-            char *file_path = NS_Response->sRequestPath;
-            char *new_name = __strtok_r(file_path, " ", &file_path);
-
-            int present = trie_search(File_Trie, file_path);
-            if (!present)
+            // The request path is "<Source Path> <Target Name>"
+            char request_path[MAX_BUFFER_SIZE];
+            strncpy(request_path, NS_Response->sRequestPath, MAX_BUFFER_SIZE);
+            char *new_name = NULL;
+            char *file_path = __strtok_r(request_path, " ", &new_name);
+            new_name = (new_name != NULL) ? __strtok_r(new_name, " \t\n", &new_name) : NULL;
+            if (file_path == NULL || new_name == NULL || strchr(new_name, '/') != NULL)
             {
+                NS_Request->iResponseFlags = RESPONSE_FLAG_FAILURE;
                 NS_Request->iResponseErrorCode = ERROR_INVALID_PATH;
-                strncpy(NS_Request->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
-                printf(RED "[-]NS_Listner_Thread: File Not Found\n" CRESET);
-                fprintf(Log_File, "[-]NS_Listner_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
+                strncpy(NS_Request->sResponseData, "Invalid Rename Target", MAX_BUFFER_SIZE);
+                LOG_ERROR("[-]NS_Listner_Thread: Invalid Rename Target");
                 break;
             }
 
             char path_cpy[MAX_BUFFER_SIZE];
             strncpy(path_cpy, file_path, MAX_BUFFER_SIZE);
+            int present = trie_search(File_Trie, path_cpy);
+            if (!present)
+            {
+                NS_Request->iResponseFlags = RESPONSE_FLAG_FAILURE;
+                NS_Request->iResponseErrorCode = ERROR_INVALID_PATH;
+                strncpy(NS_Request->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
+                LOG_ERROR("[-]NS_Listner_Thread: File Not Found");
+                break;
+            }
 
             // Get the corresponding Lock for the file
+            strncpy(path_cpy, file_path, MAX_BUFFER_SIZE);
             Reader_Writer_Lock *lock = trie_get_path_lock(File_Trie, path_cpy);
 
-            // Remove first token from the path (Mount)
+            // Remove first token from the path (Mount), the target stays in the same directory
+            strncpy(path_cpy, file_path, MAX_BUFFER_SIZE);
             char *path = NULL;
             __strtok_r(path_cpy, "/", &path);
+            char new_path[MAX_BUFFER_SIZE];
+            char *last_sep = strrchr(path, '/');
+            if (last_sep == NULL)
+                snprintf(new_path, MAX_BUFFER_SIZE, "%s", new_name);
+            else
+                snprintf(new_path, MAX_BUFFER_SIZE, "%.*s/%s", (int)(last_sep - path), path, new_name);
+
+            Trace_Begin(&lockSpan, "lock_wait");
+            Write_Lock(lock);
+            Trace_End(&lockSpan);
+            int err = rename(path, new_path);
+            Write_Unlock(lock);
 
-            // Update the trie with the new path
-            int err = trie_rename(File_Trie, file_path, new_name);
             if (err < 0)
             {
+                NS_Request->iResponseFlags = RESPONSE_FLAG_FAILURE;
                 NS_Request->iResponseErrorCode = ERROR_INVALID_OPERATION;
                 strncpy(NS_Request->sResponseData, "Error in renaming file", MAX_BUFFER_SIZE);
-                printf(RED "[-]NS_Listner_Thread: Error in renaming file\n" CRESET);
-                fprintf(Log_File, "[-]NS_Listner_Thread: Error in renaming file [Time Stamp: %f]\n", GetCurrTime(Clock));
+                LOG_ERROR("[-]NS_Listner_Thread: Error in renaming file");
                 break;
             }
 
-            Write_Lock(lock);
-            err = rename(path, new_name);
-            Write_Unlock(lock);
-
+            // Update the trie with the new path
+            strncpy(path_cpy, file_path, MAX_BUFFER_SIZE);
+            err = trie_rename(File_Trie, path_cpy, new_name);
             if (err < 0)
             {
-                NS_Request->iResponseErrorCode = ERROR_INVALID_OPERATION;
-                strncpy(NS_Request->sResponseData, "Error in renaming file", MAX_BUFFER_SIZE);
-                printf(RED "[-]NS_Listner_Thread: Error in renaming file\n" CRESET);
-                fprintf(Log_File, "[-]NS_Listner_Thread: Error in renaming file [Time Stamp: %f]\n", GetCurrTime(Clock));
-                break;
+                LOG_ERROR("[-]NS_Listner_Thread: Error in renaming trie entry of %s", file_path);
             }
 
+            NS_Request->iResponseFlags = RESPONSE_FLAG_SUCCESS;
             NS_Request->iResponseErrorCode = ERROR_CODE_SUCCESS;
-            snprintf(NS_Request->sResponseData, MAX_BUFFER_SIZE, "File Renamed Successfully %lu", NS_Response->iRequestClientID);
+            strncpy(NS_Request->sResponseData, "File Renamed Successfully", MAX_BUFFER_SIZE);
 
-            printf(GRN "[+]NS_Listner_Thread: File Renamed Successfully\n" CRESET);
+            LOG_INFO("[+]NS_Listner_Thread: File Renamed Successfully");
 
             break;
         }
@@ -399,21 +423,31 @@ void *NS_Listner_Thread(void *arg)
         {
             NS_Request->iResponseErrorCode = ERROR_INVALID_OPERATION;
             strncpy(NS_Request->sResponseData, "Invalid Operation", MAX_BUFFER_SIZE);
-            printf(RED "[-]NS_Listner_Thread: Invalid Operation\n" CRESET);
-            fprintf(Log_File, "[-]NS_Listner_Thread: Invalid Operation [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]NS_Listner_Thread: Invalid Operation");
             break;
         }
         }
 
-        // Send the response to the Name Server
-        err = send(NS_Client_Socket, NS_Request, sizeof(RESPONSE_STRUCT), 0);
+        // A v1 Name Server routes the ACK of a rename by the client ID appended to the data
+        if (NS_Request->iResponseOperation == CMD_RENAME && NS_Context.iVersion != WIRE_VERSION_2)
+        {
+            char data[MAX_BUFFER_SIZE];
+            strncpy(data, NS_Request->sResponseData, MAX_BUFFER_SIZE);
+            snprintf(NS_Request->sResponseData, MAX_BUFFER_SIZE, "%.900s %lu", data, NS_Response->iRequestClientID);
+        }
+
+        // Send the response to the Name Server (echoing the request ID)
+        err = Send_Response(NS_Client_Socket, &NS_Context, NS_Request);
+        if (NS_Request->iResponseErrorCode != ERROR_CODE_SUCCESS)
+            Trace_Error(&span, NS_Request->iResponseErrorCode);
+        Trace_End(&span);
+        Trace_Clear();
         if (CheckError(err, "[-]NS_Listner_Thread: Error in sending data to Name Server"))
         {
-            fprintf(Log_File, "[-]NS_Listner_Thread: Error in sending data to Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]NS_Listner_Thread: Error in sending data to Name Server");
             exit(EXIT_FAILURE);
         }
-        printf(GRN "[+]NS_Listner_Thread: Response Sent to Name Server\n" CRESET);
-        fprintf(Log_File, "[+]NS_Listner_Thread: Response Sent to Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_INFO("[+]NS_Listner_Thread: Response Sent to Name Server");
 
     }
     return NULL;
@@ -432,7 +466,7 @@ void *Client_Listner_Thread(void *arg)
     int Client_Listen_Socket = socket(AF_INET, SOCK_STREAM, 0);
     if (CheckError(Client_Listen_Socket, "[-]Client_Listner_Thread: Error in creating socket for listening to Client"))
     {
-        fprintf(Log_File, "[-]Client_Listner_Thread: Error in creating socket for listening to Client [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Client_Listner_Thread: Error in creating socket for listening to Client");
         exit(EXIT_FAILURE);
     }
 
@@ -443,11 +477,13 @@ void *Client_Listner_Thread(void *arg)
     Client_Listen_Addr.sin_addr.s_addr = INADDR_ANY;
     memset(Client_Listen_Addr.sin_zero, '\0', sizeof(Client_Listen_Addr.sin_zero));
 
-    // Bind the socket to the address
+    // Bind the socket to the address (connections of a previous run may still be in TIME_WAIT)
+    int iReuse = 1;
+    setsockopt(Client_Listen_Socket, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof(iReuse));
     int err = bind(Client_Listen_Socket, (struct sockaddr *)&Client_Listen_Addr, sizeof(Client_Listen_Addr));
     if (CheckError(err, "[-]Client_Listner_Thread: Error in binding socket to address"))
     {
-        fprintf(Log_File, "[-]Client_Listner_Thread: Error in binding socket to address [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Client_Listner_Thread: Error in binding socket to address");
         exit(EXIT_FAILURE);
     }
 
@@ -455,12 +491,11 @@ void *Client_Listner_Thread(void *arg)
     err = listen(Client_Listen_Socket, MAX_CONN_Q);
     if (CheckError(err, "[-]Client_Listner_Thread: Error in listening for connections"))
     {
-        fprintf(Log_File, "[-]Client_Listner_Thread: Error in listening for connections [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Client_Listner_Thread: Error in listening for connections");
         exit(EXIT_FAILURE);
     }
 
-    printf("[+]Client_Listner_Thread: Listening for connections on Port: %d\n", ClientPort);
-    fprintf(Log_File, "[+]Client_Listner_Thread: Listening for connections on Port: %d [Time Stamp: %f]\n", ClientPort, GetCurrTime(Clock));
+    LOG_INFO("[+]Client_Listner_Thread: Listening for connections on Port: %d", ClientPort);
 
     struct sockaddr_in Client_Addr;
     socklen_t Client_Addr_Size = sizeof(Client_Addr);
@@ -471,34 +506,112 @@ void *Client_Listner_Thread(void *arg)
         char *client_IP = inet_ntoa(Client_Addr.sin_addr);
         int client_Port = ntohs(Client_Addr.sin_port);
 
-        Client client;
-        client.socket = Client_Socket;
-        client.IP = client_IP;
-        client.port = client_Port;
-
         if (CheckError(Client_Socket, "[-]Client_Listner_Thread: Error in accepting connections"))
         {
-            fprintf(Log_File, "[-]Client_Listner_Thread: Error in accepting connections [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Client_Listner_Thread: Error in accepting connections");
             exit(EXIT_FAILURE);
         }
 
-        printf(GRN "[+]Client_Listner_Thread: Connection Established with Client\n" CRESET);
-        fprintf(Log_File, "[+]Client_Listner_Thread: Connection Established with Client [Time Stamp: %f]\n", GetCurrTime(Clock));
+        // The handler owns (and frees) its copy, the next accept may come before it starts
+        Client *client = (Client *)malloc(sizeof(Client));
+        if (CheckNull(client, "[-]Client_Listner_Thread: Error in allocating memory"))
+        {
+            LOG_ERROR("[-]Client_Listner_Thread: Error in allocating memory");
+            close(Client_Socket);
+            continue;
+        }
+        client->socket = Client_Socket;
+        client->IP = client_IP;
+        client->port = client_Port;
 
-        // Create a thread to handle the request
+        LOG_INFO("[+]Client_Listner_Thread: Connection Established with Client");
+
+        // Create a thread to handle the request (nobody joins it)
         pthread_t Client_Handler;
-        err = pthread_create(&Client_Handler, NULL, Client_Handler_Thread, (void *)&client);
+        err = pthread_create(&Client_Handler, NULL, Client_Handler_Thread, (void *)client);
         if (CheckError(err, "[-]Client_Listner_Thread: Error in creating thread for handling client request"))
         {
-            fprintf(Log_File, "[-]Client_Listner_Thread: Error in creating thread for handling client request [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Client_Listner_Thread: Error in creating thread for handling client request");
             exit(EXIT_FAILURE);
         }
-        fprintf(Log_File, "[+]Client_Listner_Thread: Thread Created for handling client request [Time Stamp: %f]\n", GetCurrTime(Clock));
+        pthread_detach(Client_Handler);
+        LOG_INFO("[+]Client_Listner_Thread: Thread Created for handling client request");
     }
 
     return NULL;
 }
 
+/**
+ * @brief Ends the data stream of a READ or WRITE that failed before any data
+ * @param stop: The stop sequence a v1 stream was started with
+ * @param iStatus: The error, sent in the end frame of a v2 stream
+ */
+static void End_Stream_Early(int sockfd, WIRE_CONTEXT_STRUCT *ctx, const char *stop, int iStatus)
+{
+    if (ctx->iVersion == WIRE_VERSION_1)
+    {
+        // v1 clients print the frame before the stop sequence
+        char msg[] = RED "Error Fetching File" reset "\n";
+        Send_Legacy_Frame(sockfd, msg, sizeof(msg) - 1);
+        Send_All(sockfd, stop, WIRE_LEGACY_FRAME);
+        return;
+    }
+    Send_Data_Status(sockfd, ctx, iStatus);
+}
+
+/**
+ * @brief Sends a whole file on a v1 data stream and ends it
+ * @param iFileSize: The size of the file
+ * @param stop: The stop sequence the stream was started with
+ * @return: 0 on success, -1 on failure
+ * @note: The whole frames go through Transfer_File, the last partial frame is NUL padded
+ */
+static int Send_Legacy_File(int sockfd, int fd, uint64_t iFileSize, const char *stop)
+{
+    uint64_t iWholeFrames = iFileSize - iFileSize % WIRE_LEGACY_FRAME;
+    int err = (Transfer_File(sockfd, fd, 0, iWholeFrames) != (ssize_t)iWholeFrames);
+    if (!err && iWholeFrames < iFileSize)
+    {
+        char frame[WIRE_LEGACY_FRAME];
+        ssize_t iRead = pread(fd, frame, iFileSize - iWholeFrames, iWholeFrames);
+        err = (iRead < 0) || (Send_Legacy_Frame(sockfd, frame, iRead) < 0);
+    }
+    err = err || (Send_All(sockfd, stop, WIRE_LEGACY_FRAME) < 0);
+    return err ? -1 : 0;
+}
+
+/**
+ * @brief Receives a v1 data stream into a file
+ * @param buffer: iBufferSize bytes the frames are gathered in, a full buffer is written with one pwrite
+ * @param iOffset: Where the data goes in the file
+ * @param stop: The stop sequence the stream was started with
+ * @param iReceived: Set to the data bytes received
+ * @return: 0 on success, -1 on failure
+ * @note: After a failed write the rest of the stream is only drained, so the client still gets the response
+ */
+static int Recv_Legacy_File(int sockfd, int fd, off_t iOffset, char *buffer, size_t iBufferSize, const char *stop, uint64_t *iReceived)
+{
+    char frame[WIRE_LEGACY_FRAME];
+    size_t iFill = 0, iData = 0;
+    int iFrame, iDiskError = 0;
+    *iReceived = 0;
+    while ((iFrame = Recv_Legacy_Frame(sockfd, frame, stop, &iData)) > 0)
+    {
+        if (iFill + iData > iBufferSize)
+        {
+            iDiskError = iDiskError || Transfer_Write(fd, buffer, iFill, iOffset) < 0;
+            iOffset += iFill;
+            iFill = 0;
+        }
+        memcpy(buffer + iFill, frame, iData);
+        iFill += iData;
+        *iReceived += iData;
+    }
+    if (iFrame == 0 && !iDiskError && iFill > 0)
+        iDiskError = (Transfer_Write(fd, buffer, iFill, iOffset) < 0);
+    return (iFrame < 0 || iDiskError) ? -1 : 0;
+}
+
 /**
  * @brief Thread to handle requests from the Client.
  * @param arg: The socket to communicate with the client.
@@ -507,34 +620,40 @@ void *Client_Listner_Thread(void *arg)
 void *Client_Handler_Thread(void *arg)
 {
     Client client = *(Client *)arg;
+    free(arg);
     int Client_Socket = client.socket;
     char *client_IP = client.IP;
     int client_Port = client.port;
 
     // Receive the request from the Client
+    // The wire version is detected from the request itself
+    WIRE_CONTEXT_STRUCT Client_Context = {WIRE_VERSION_UNKNOWN, 0};
     REQUEST_STRUCT Client_Request;
     REQUEST_STRUCT *Client_Request_Struct = &Client_Request;
-    int err = recv(Client_Socket, Client_Request_Struct, sizeof(REQUEST_STRUCT), 0);
+    int err = Recv_Request(Client_Socket, &Client_Context, Client_Request_Struct);
     if (err < 0)
     {
-        printf(RED "[-]Client_Handler_Thread: Error in receiving data from Client (IP: %s, Port: %d)\n" CRESET, client_IP, client_Port);
-        fprintf(Log_File, "[-]Client_Handler_Thread: Error in receiving data from Client (IP: %s, Port: %d) [Time Stamp: %f]\n", client_IP, client_Port, GetCurrTime(Clock));
-        exit(EXIT_FAILURE);
+        // A broken client connection only ends its own request
+        LOG_ERROR("[-]Client_Handler_Thread: Error in receiving data from Client (IP: %s, Port: %d)", client_IP, client_Port);
+        close(Client_Socket);
+        return NULL;
     }
     else if (err == 0)
     {
-        printf(RED "[-]Client_Handler_Thread: Connection with Client Closed Unexpectedly\n" CRESET);
-        fprintf(Log_File, "[-]Client_Handler_Thread: Connection with Client Closed Unexpectedly [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Client_Handler_Thread: Connection with Client Closed Unexpectedly");
+        close(Client_Socket);
         return NULL;
     }
 
+    // Continue the trace of the client (if the request carries one)
+    Trace_Set_Context(Client_Context.iTraceID, Client_Context.iParentSpanID);
+    TRACE_SPAN_STRUCT span, lockSpan;
+    Trace_Begin(&span, CommandName(Client_Request_Struct->iRequestOperation));
+    Trace_Detail(&span, "%s", Client_Request_Struct->sRequestPath);
+
     // Print the request received from the Client
-    printf(GRN "[+]Client_Handler_Thread: Request Received from Client (IP: %s, Port: %d)\n" CRESET, client_IP, client_Port);
-    fprintf(Log_File, "[+]Client_Handler_Thread: Request Received from Client (IP: %s, Port: %d) [Time Stamp: %f]\n", client_IP, client_Port, GetCurrTime(Clock));
-    printf("Request Operation: %d\n", Client_Request_Struct->iRequestOperation);
-    printf("Request Path: %s\n", Client_Request_Struct->sRequestPath);
-    printf("Request Flag: %d\n", Client_Request_Struct->iRequestFlags);
-    printf("Request Client ID: %lu\n", Client_Request_Struct->iRequestClientID);
+    LOG_INFO("[+]Client_Handler_Thread: Request Received from Client (IP: %s, Port: %d)", client_IP, client_Port);
+    LOG_DEBUG("[+]Client_Handler_Thread: Request Operation: %d, Path: %s, Flag: %d, Client ID: %lu", Client_Request_Struct->iRequestOperation, Client_Request_Struct->sRequestPath, Client_Request_Struct->iRequestFlags, Client_Request_Struct->iRequestClientID);
 
     RESPONSE_STRUCT Client_Response;
     RESPONSE_STRUCT *Client_Response_Struct = &Client_Response;
@@ -547,13 +666,11 @@ void *Client_Handler_Thread(void *arg)
     {
     case CMD_READ:
     {
-        // generate a random stop sequence
-        char stop_sequence[MAX_BUFFER_SIZE];
-        memset(stop_sequence, 0, MAX_BUFFER_SIZE);
-        snprintf(stop_sequence, MAX_BUFFER_SIZE, "STOP%d", rand() % 1000);
-
-        // send the stop sequence to the client
-        send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
+        // A v1 stream starts with its stop sequence, whatever happens next
+        char stop[WIRE_LEGACY_FRAME];
+        int iLegacy = (Client_Context.iVersion == WIRE_VERSION_1);
+        if (iLegacy)
+            Send_Legacy_Stop(Client_Socket, stop);
 
         // Check if the file is exposed by the server
         char file_path[MAX_BUFFER_SIZE];
@@ -561,24 +678,20 @@ void *Client_Handler_Thread(void *arg)
 
         strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
 
-        int present = trie_search(File_Trie, Client_Request_Struct->sRequestPath);
+        int present = trie_search(File_Trie, file_path);
         if (!present)
         {
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_PATH;
             strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
-            printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
-            fprintf(Log_File, "[-]Client_Handler_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
-
-            // send a error buffer to indicate file not found
-            char msg[] = RED "Error Fetching File" reset "\n";
-            printf("%s\n", msg);
-            send(Client_Socket, &msg, sizeof(msg), 0);
-            send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
+            LOG_ERROR("[-]Client_Handler_Thread: File Not Found");
 
+            // end the (empty) data stream with the error
+            End_Stream_Early(Client_Socket, &Client_Context, stop, ERROR_INVALID_PATH);
             break;
         }
 
-        // Get the corresponding Lock for the file
+        // Get the corresponding Lock for the file (the search tokenized the copy)
+        strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
         Reader_Writer_Lock *lock = trie_get_path_lock(File_Trie, file_path);
 
         memset(file_path, 0, MAX_BUFFER_SIZE);
@@ -588,54 +701,94 @@ void *Client_Handler_Thread(void *arg)
         char *path = NULL;
         __strtok_r(file_path, "/", &path);
 
+        Trace_Begin(&lockSpan, "lock_wait");
         Read_Lock(lock);
-        // Open the file and read it's contents
-        FILE *file = fopen(path, "r");
-        if (CheckNull(file, "[-]Client_Handler_Thread: Error in opening file"))
+        Trace_End(&lockSpan);
+        // Open the file, its size fixes the length of the stream
+        int fd = open(path, O_RDONLY);
+        struct stat file_stat;
+        if (fd < 0 || fstat(fd, &file_stat) < 0)
         {
+            CheckError(-1, "[-]Client_Handler_Thread: Error in opening file");
+            if (fd >= 0)
+                close(fd);
             Read_Unlock(lock);
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_ACCESS;
             strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
-            printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
-            fprintf(Log_File, "[-]Client_Handler_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
-
-            // send a error buffer to indicate file not found
-            char msg[] = RED "Error Fetching File" reset "\n";
-            send(Client_Socket, &msg, sizeof(msg), 0);
-            send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
+            LOG_ERROR("[-]Client_Handler_Thread: File Not Found");
 
+            // end the (empty) data stream with the error
+            End_Stream_Early(Client_Socket, &Client_Context, stop, ERROR_INVALID_ACCESS);
             break;
         }
 
-        char buffer[MAX_BUFFER_SIZE];
-        memset(buffer, 0, MAX_BUFFER_SIZE);
-
-        while (fread(buffer, 1, MAX_BUFFER_SIZE, file) > 0)
+        // The range asked for is cut at the end of the file (the whole file without a range)
+        WIRE_DATA_END_STRUCT streamEnd = {0, 0, (uint64_t)file_stat.st_size, WIRE_DATA_OK};
+        uint64_t iLength = streamEnd.iFileSize;
+        if (Client_Context.iRange)
         {
-            send(Client_Socket, buffer, MAX_BUFFER_SIZE, 0);
-            memset(buffer, 0, MAX_BUFFER_SIZE);
+            streamEnd.iOffset = (Client_Context.iRangeOffset < streamEnd.iFileSize) ? Client_Context.iRangeOffset : streamEnd.iFileSize;
+            iLength = streamEnd.iFileSize - streamEnd.iOffset;
+            if (Client_Context.iRangeLength > 0 && Client_Context.iRangeLength < iLength)
+                iLength = Client_Context.iRangeLength;
         }
-
+        posix_fadvise(fd, streamEnd.iOffset, iLength, POSIX_FADV_SEQUENTIAL);
+
+        // The bytes go from the page cache to the socket (Transfer.c) in frames of up to WIRE_DATA_CHUNK
+        // bytes. The socket stays corked so every header leaves with the data after it (closing the
+        // connection flushes the end of the stream and the response)
+        int iCork = 1;
+        setsockopt(Client_Socket, IPPROTO_TCP, TCP_CORK, &iCork, sizeof(iCork));
+        TRACE_SPAN_STRUCT sendSpan;
+        Trace_Begin(&sendSpan, "net_send");
+        Trace_Detail(&sendSpan, "%llu bytes at %llu", (unsigned long long)iLength, (unsigned long long)streamEnd.iOffset);
+        uint64_t iSent = 0;
+        int err = 0;
+        if (iLegacy)
+        {
+            // v1 has no ranges, the whole file goes in legacy frames with the stop sequence after it
+            err = (Send_Legacy_File(Client_Socket, fd, iLength, stop) < 0);
+            iSent = iLength;
+        }
+        while (iSent < iLength && !err)
+        {
+            size_t iFrame = (iLength - iSent < WIRE_DATA_CHUNK) ? iLength - iSent : WIRE_DATA_CHUNK;
+            err = (Send_Data_Header(Client_Socket, &Client_Context, iFrame) < 0) || (Transfer_File(Client_Socket, fd, streamEnd.iOffset + iSent, iFrame) != (ssize_t)iFrame);
+            iSent += err ? 0 : iFrame;
+        }
+        close(fd);
         Read_Unlock(lock);
-        // send the stop sequence to the client to indicate end of file
-        send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
 
-        int err = ferror(file);
         if (err)
         {
+            // A frame was cut short, nothing else can be framed on the connection
+            shutdown(Client_Socket, SHUT_RDWR);
+            Trace_End(&sendSpan);
             Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_ACCESS;
             strncpy(Client_Response_Struct->sResponseData, "Error in reading file", MAX_BUFFER_SIZE);
-            printf(RED "[-]Client_Handler_Thread: Error in reading file\n" CRESET);
-            fprintf(Log_File, "[-]Client_Handler_Thread: Error in reading file [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Client_Handler_Thread: Error in reading file");
+            break;
+        }
+
+        // end the data stream with the range sent (a v1 stream is already ended)
+        streamEnd.iStreamBytes = iSent;
+        err = !iLegacy && (Send_Data_End(Client_Socket, &Client_Context, &streamEnd) < 0);
+        Trace_End(&sendSpan);
+        if (err)
+        {
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_ACCESS;
+            strncpy(Client_Response_Struct->sResponseData, "Error in reading file", MAX_BUFFER_SIZE);
+            LOG_ERROR("[-]Client_Handler_Thread: Error in reading file");
             break;
         }
 
         Client_Response_Struct->iResponseErrorCode = ERROR_CODE_SUCCESS;
         strncpy(Client_Response_Struct->sResponseData, "File Read Successfully", MAX_BUFFER_SIZE);
 
-        printf(GRN "[+]Client_Handler_Thread: File Read Successfully\n" CRESET);
-        fprintf(Log_File, "[+]Client_Handler_Thread: File Read Successfully [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_INFO("[+]Client_Handler_Thread: File Read Successfully");
+        break;
     }
     case CMD_WRITE:
     {
@@ -645,18 +798,20 @@ void *Client_Handler_Thread(void *arg)
         {
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_FLAG;
             strncpy(Client_Response_Struct->sResponseData, "Invalid Write Flag", MAX_BUFFER_SIZE);
-            printf(RED "[-]Client_Handler_Thread: Invalid Write Flag\n" CRESET);
-            fprintf(Log_File, "[-]Client_Handler_Thread: Invalid Write Flag [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Client_Handler_Thread: Invalid Write Flag");
+
+            // end the (empty) data stream of the server with the error, the client sends nothing
+            // (a v1 stream was not started yet, the response is all the client gets)
+            if (Client_Context.iVersion != WIRE_VERSION_1)
+                Send_Data_Status(Client_Socket, &Client_Context, ERROR_INVALID_FLAG);
             break;
         }
 
-        // generate a random stop sequence
-        char stop_sequence[MAX_BUFFER_SIZE];
-        memset(stop_sequence, 0, MAX_BUFFER_SIZE);
-        snprintf(stop_sequence, MAX_BUFFER_SIZE, "STOP%d", rand() % 1000);
-
-        // send the stop sequence to the client
-        send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
+        // A v1 stream starts with its stop sequence once the flag is valid
+        char stop[WIRE_LEGACY_FRAME];
+        int iLegacy = (Client_Context.iVersion == WIRE_VERSION_1);
+        if (iLegacy)
+            Send_Legacy_Stop(Client_Socket, stop);
 
         // Check if the file is exposed by the server
         char file_path[MAX_BUFFER_SIZE];
@@ -664,24 +819,19 @@ void *Client_Handler_Thread(void *arg)
 
         strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
 
-        int present = trie_search(File_Trie, Client_Request_Struct->sRequestPath);
+        int present = trie_search(File_Trie, file_path);
         if (!present)
         {
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_PATH;
             strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
-            printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
-            fprintf(Log_File, "[-]Client_Handler_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
-
-            // send a error buffer to indicate file not found
-            char msg[] = RED "Error Fetching File" reset "\n";
-            printf("%s\n", msg);
-            send(Client_Socket, &msg, sizeof(msg), 0);
-            send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
+            LOG_ERROR("[-]Client_Handler_Thread: File Not Found");
 
+            End_Stream_Early(Client_Socket, &Client_Context, stop, ERROR_INVALID_PATH);
             break;
         }
 
-        // Get the corresponding Lock for the file
+        // Get the corresponding Lock for the file (the search tokenized the copy)
+        strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
         Reader_Writer_Lock *lock = trie_get_path_lock(File_Trie, file_path);
 
         memset(file_path, 0, MAX_BUFFER_SIZE);
@@ -691,61 +841,114 @@ void *Client_Handler_Thread(void *arg)
         char *path = NULL;
         __strtok_r(file_path, "/", &path);
 
-        // Open the file and write to it with the specified flag
-        char *mode = (write_flag == REQUEST_FLAG_OVERWRITE) ? "w" : "a";
+        // Open the file with the specified flag, an append starts at its current end
+        int flags = O_WRONLY | O_CREAT | ((write_flag == REQUEST_FLAG_OVERWRITE) ? O_TRUNC : 0);
 
+        Trace_Begin(&lockSpan, "lock_wait");
         Write_Lock(lock);
-        FILE *file = fopen(path, mode);
-        if (CheckNull(file, "[-]Client_Handler_Thread: Error in opening file"))
+        Trace_End(&lockSpan);
+        size_t iBufferSize = Wire_Write_Buffer_Size();
+        char *buffer = (char *)malloc(iBufferSize);
+        int fd = open(path, flags, 0666);
+        off_t iOffset = (fd >= 0 && write_flag == REQUEST_FLAG_APPEND) ? lseek(fd, 0, SEEK_END) : 0;
+        if (CheckNull(buffer, "[-]Client_Handler_Thread: Error in allocating memory") ||
+            CheckError(fd, "[-]Client_Handler_Thread: Error in opening file") || iOffset < 0)
         {
+            if (fd >= 0)
+                close(fd);
+            Write_Unlock(lock);
+            free(buffer);
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_ACCESS;
             strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
-            printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
-            fprintf(Log_File, "[-]Client_Handler_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
-
-            // send a error buffer to indicate file not found
-            char msg[] = RED "Error Opening File" reset "\n";
-            send(Client_Socket, &msg, sizeof(msg), 0);
-            send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
+            LOG_ERROR("[-]Client_Handler_Thread: File Not Found");
 
+            End_Stream_Early(Client_Socket, &Client_Context, stop, ERROR_INVALID_ACCESS);
             break;
         }
 
-        char buffer[MAX_BUFFER_SIZE];
-        memset(buffer, 0, MAX_BUFFER_SIZE);
+        // The file is open, the client may send its data stream (a v1 client already got the go-ahead)
+        int err = !iLegacy && (Send_Data_Status(Client_Socket, &Client_Context, WIRE_DATA_OK) < 0);
+        int iDiskError = 0;
+
+        WIRE_HEADER_STRUCT header;
+        WIRE_DATA_END_STRUCT streamEnd;
+        uint64_t iReceived = 0;
+        size_t iFill = 0;
 
         // receive the file contents from the client
-        while (recv(Client_Socket, buffer, MAX_BUFFER_SIZE, 0) > 0)
+        // Frames are gathered until the buffer is full, each pwrite writes a whole buffer
+        // The receives and writes interleave, each is summed over the whole file
+        TRACE_SPAN_STRUCT recvSpan, diskSpan;
+        Trace_Begin_Sum(&recvSpan, "net_recv");
+        Trace_Begin_Sum(&diskSpan, "disk_write");
+        if (iLegacy)
         {
-            // check if the stop sequence is received
-            if (strncmp(buffer, stop_sequence, MAX_BUFFER_SIZE) == 0)
+            // A v1 stream ends at the stop sequence, without a count or status to check
+            err = (Recv_Legacy_File(Client_Socket, fd, iOffset, buffer, iBufferSize, stop, &iReceived) < 0);
+            streamEnd.iStatus = WIRE_DATA_OK;
+            streamEnd.iStreamBytes = iReceived;
+        }
+        while (!err && !iLegacy)
+        {
+            Trace_Resume(&recvSpan);
+            err = (Recv_Data_Header(Client_Socket, &header, &streamEnd) <= 0);
+            Trace_Pause(&recvSpan);
+            if (err || header.iFrameType == FRAME_DATA_END)
                 break;
 
-            size_t writeSize = fwrite(buffer, 1, strlen(buffer), file);
-            printf("Writing %ld bytes to file\n", writeSize);
-            fprintf(Log_File, "Writing %ld bytes to file\n", writeSize);
-            memset(buffer, 0, MAX_BUFFER_SIZE);
+            // A frame can end in the next buffer
+            size_t iLeft = header.iPayloadLength;
+            while (iLeft > 0 && !err)
+            {
+                size_t iChunk = (iLeft < iBufferSize - iFill) ? iLeft : iBufferSize - iFill;
+                Trace_Resume(&recvSpan);
+                err = (Recv_All(Client_Socket, buffer + iFill, iChunk) <= 0);
+                Trace_Pause(&recvSpan);
+                iFill += iChunk;
+                iLeft -= iChunk;
+                iReceived += iChunk;
+                if (err || iFill < iBufferSize)
+                    continue;
+
+                // After a failed write the rest of the stream is only drained, so the client still gets the response
+                Trace_Resume(&diskSpan);
+                iDiskError = iDiskError || Transfer_Write(fd, buffer, iFill, iOffset) < 0;
+                Trace_Pause(&diskSpan);
+                iOffset += iFill;
+                iFill = 0;
+            }
         }
+        if (!err && !iDiskError && iFill > 0)
+        {
+            Trace_Resume(&diskSpan);
+            iDiskError = (Transfer_Write(fd, buffer, iFill, iOffset) < 0);
+            Trace_Pause(&diskSpan);
+        }
+        Trace_End(&recvSpan);
+        Trace_End(&diskSpan);
+        free(buffer);
 
+        // The client ends its stream with its status and the number of bytes it sent
+        if (!err)
+            err = (streamEnd.iStatus != WIRE_DATA_OK || streamEnd.iStreamBytes != iReceived);
+        LOG_DEBUG("[+]Client_Handler_Thread: Wrote %llu bytes to file", (unsigned long long)iReceived);
+
+        err |= iDiskError;
+        err |= (close(fd) != 0);
         Write_Unlock(lock);
-        int err = ferror(file);
         if (err)
         {
             Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_ACCESS;
             strncpy(Client_Response_Struct->sResponseData, "Error in writing file", MAX_BUFFER_SIZE);
-            printf(RED "[-]Client_Handler_Thread: Error in writing file\n" CRESET);
-            fprintf(Log_File, "[-]Client_Handler_Thread: Error in writing file [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Client_Handler_Thread: Error in writing file");
             break;
         }
 
-        fclose(file);
-
         Client_Response_Struct->iResponseErrorCode = ERROR_CODE_SUCCESS;
         strncpy(Client_Response_Struct->sResponseData, "File Written Successfully", MAX_BUFFER_SIZE);
 
-        printf(GRN "[+]Client_Handler_Thread: File Written Successfully\n" CRESET);
-        fprintf(Log_File, "[+]Client_Handler_Thread: File Written Successfully [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_INFO("[+]Client_Handler_Thread: File Written Successfully");
         break;
     }
     case CMD_INFO:
@@ -756,17 +959,17 @@ void *Client_Handler_Thread(void *arg)
 
         strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
 
-        int present = trie_search(File_Trie, Client_Request_Struct->sRequestPath);
+        int present = trie_search(File_Trie, file_path);
         if (!present)
         {
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_PATH;
             strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
-            printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
-            fprintf(Log_File, "[-]Client_Handler_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Client_Handler_Thread: File Not Found");
             break;
         }
 
-        // Get the corresponding Lock for the file
+        // Get the corresponding Lock for the file (the search tokenized the copy)
+        strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
         Reader_Writer_Lock *lock = trie_get_path_lock(File_Trie, file_path);
 
         memset(file_path, 0, MAX_BUFFER_SIZE);
@@ -780,7 +983,9 @@ void *Client_Handler_Thread(void *arg)
         PATH_INFO_STRUCT *info_struct = &info;
         memset(info_struct, 0, sizeof(PATH_INFO_STRUCT));
 
+        Trace_Begin(&lockSpan, "lock_wait");
         Read_Lock(lock);
+        Trace_End(&lockSpan);
         // Check if path is a file, executable or a directory
         struct stat file_stat;
         int err = stat(path, &file_stat);
@@ -790,8 +995,7 @@ void *Client_Handler_Thread(void *arg)
         {
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_PATH;
             strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
-            printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
-            fprintf(Log_File, "[-]Client_Handler_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Client_Handler_Thread: File Not Found");
             break;
         }
 
@@ -799,7 +1003,7 @@ void *Client_Handler_Thread(void *arg)
         Client_Response_Struct->iResponseErrorCode = ERROR_CODE_SUCCESS;
         strncpy(Client_Response_Struct->sResponseData, "File Info Fetched Successfully", MAX_BUFFER_SIZE);
 
-        send(Client_Socket, Client_Response_Struct, sizeof(RESPONSE_STRUCT), 0);
+        Send_Response(Client_Socket, &Client_Context, Client_Response_Struct);
 
         // Populate Info Struct
         strncpy(info_struct->sPath, path, MAX_BUFFER_SIZE);
@@ -812,11 +1016,13 @@ void *Client_Handler_Thread(void *arg)
         info_struct->iPathLinks = file_stat.st_nlink;
 
         // send the info struct to the client
-        send(Client_Socket, info_struct, sizeof(PATH_INFO_STRUCT), 0);
+        Send_Path_Info(Client_Socket, &Client_Context, info_struct);
 
-        printf(GRN "[+]Client_Handler_Thread: File Info Fetched Successfully\n" CRESET);
-        fprintf(Log_File, "[+]Client_Handler_Thread: File Info Fetched Successfully [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_INFO("[+]Client_Handler_Thread: File Info Fetched Successfully");
 
+        Trace_End(&span);
+        Trace_Clear();
+        close(Client_Socket);
         return NULL;
     }
     case CMD_CREATE:
@@ -828,67 +1034,75 @@ void *Client_Handler_Thread(void *arg)
     {
         Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_AUTHENTICATION;
         strncpy(Client_Response_Struct->sResponseData, "Invalid Authentication", MAX_BUFFER_SIZE);
-        printf(RED "[-]Client_Handler_Thread: Client Requested a Indirect Secure Operation\n" CRESET);
-        fprintf(Log_File, "[-]Client_Handler_Thread: Client Requested a Indirect Secure Operation [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Client_Handler_Thread: Client Requested a Indirect Secure Operation");
         break;
     }
     default:
     {
         Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_OPERATION;
         strncpy(Client_Response_Struct->sResponseData, "Invalid Operation", MAX_BUFFER_SIZE);
-        printf(RED "[-]Client_Handler_Thread: Invalid Request Operation\n" CRESET);
-        fprintf(Log_File, "[-]Client_Handler_Thread: Invalid Request Operation [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Client_Handler_Thread: Invalid Request Operation");
 
         break;
     }
     }
 
     // Send the response to the Client
-    err = send(Client_Socket, Client_Response_Struct, sizeof(RESPONSE_STRUCT), 0);
+    err = Send_Response(Client_Socket, &Client_Context, Client_Response_Struct);
+    if (Client_Response_Struct->iResponseErrorCode != ERROR_CODE_SUCCESS)
+        Trace_Error(&span, Client_Response_Struct->iResponseErrorCode);
+    Trace_End(&span);
+    Trace_Clear();
+    close(Client_Socket);
     if (err < 0)
     {
-        printf(RED "[-]Client_Handler_Thread: Error in sending data to Client (IP: %s, Port: %d)\n" CRESET, client_IP, client_Port);
-        fprintf(Log_File, "[-]Client_Handler_Thread: Error in sending data to Client (IP: %s, Port: %d) [Time Stamp: %f]\n", client_IP, client_Port, GetCurrTime(Clock));
-        exit(EXIT_FAILURE);
+        LOG_ERROR("[-]Client_Handler_Thread: Error in sending data to Client (IP: %s, Port: %d)", client_IP, client_Port);
+        return NULL;
     }
     else if (err == 0)
     {
-        printf(RED "[-]Client_Handler_Thread: Connection with Client Closed Unexpectedly\n" CRESET);
-        fprintf(Log_File, "[-]Client_Handler_Thread: Connection with Client Closed Unexpectedly [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]Client_Handler_Thread: Connection with Client Closed Unexpectedly");
         return NULL;
     }
 
-    printf(GRN "[+]Client_Handler_Thread: Response Sent to Client (IP: %s, Port: %d)\n" CRESET, client_IP, client_Port);
-    fprintf(Log_File, "[+]Client_Handler_Thread: Response Sent to Client (IP: %s, Port: %d) [Time Stamp: %f]\n", client_IP, client_Port, GetCurrTime(Clock));
+    LOG_INFO("[+]Client_Handler_Thread: Response Sent to Client (IP: %s, Port: %d)", client_IP, client_Port);
 
     return NULL;
 }
 
 /**
- * @brief Thread to flush the logs to the log file.
- * @note: The logs are flushed every LOG_FLUSH_INTERVAL seconds.
+ * @brief Thread to periodically write the hosted paths to the logs.
+ * @note: The paths (and the counters of the transfer engines) are written every LOG_FLUSH_INTERVAL
+ *        seconds (the log writer thread does the I/O).
  */
 void *Log_Flusher_Thread()
 {
     while (1)
     {
         sleep(LOG_FLUSH_INTERVAL);
-        printf(BBLK "[+]Log Flusher Thread: Flushing logs\n" reset);
+        LOG_INFO("[+]Log Flusher Thread: Logging hosted paths");
 
-        fprintf(Log_File, "[+]Log Flusher Thread: Flushing logs [Time Stamp: %f]\n", GetCurrTime(Clock));
-        fprintf(Log_File, "------------------------------------------------------------\n");
         char buffer[MAX_BUFFER_SIZE];
         memset(buffer, 0, MAX_BUFFER_SIZE);
         int err = trie_print(File_Trie, buffer, 0);
         if (CheckError(err, "[-]Log_Flusher_Thread: Error in getting mount paths"))
         {
-            fprintf(Log_File, "[-]Log_Flusher_Thread: Error in getting mount paths [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("[-]Log_Flusher_Thread: Error in getting mount paths");
             exit(EXIT_FAILURE);
         }
-        fprintf(Log_File, "%s\n", buffer);
-        fprintf(Log_File, "------------------------------------------------------------\n");
 
-        fflush(Log_File);
+        char state[MAX_BUFFER_SIZE + 128];
+        snprintf(state, sizeof(state), "------------------------------------------------------------\n%s\n"
+                                       "------------------------------------------------------------\n", buffer);
+        Log_Raw(state);
+
+        TRANSFER_STATS_STRUCT transferStats;
+        Transfer_Get_Stats(&transferStats);
+        LOG_INFO("[+]Log Flusher Thread: Transfers sendfile %lu (%llu bytes), splice %lu (%llu bytes), copy %lu (%llu bytes)",
+                 transferStats.iTransfers[TRANSFER_SENDFILE], transferStats.iBytes[TRANSFER_SENDFILE],
+                 transferStats.iTransfers[TRANSFER_SPLICE], transferStats.iBytes[TRANSFER_SPLICE],
+                 transferStats.iTransfers[TRANSFER_COPY], transferStats.iBytes[TRANSFER_COPY]);
+        LOG_INFO("[+]Log Flusher Thread: Writes %lu (%llu bytes)", transferStats.iWrites, transferStats.iWriteBytes);
     }
     return NULL;
 }
@@ -899,13 +1113,35 @@ void *Log_Flusher_Thread()
  */
 void exit_handler()
 {
-    printf(BRED "[-]Server Exiting\n" reset);
-    fprintf(Log_File, "[-]Server Exiting [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_ERROR("[-]Server Exiting");
     trie_destroy(File_Trie);
-    fclose(Log_File);
+    Log_Shutdown();
     return;
 }
 
+/**
+ * @brief Opens a connection to the Naming Server.
+ * @param NS_Addr: The address of the Naming Server.
+ * @return: The connected socket (exits on failure).
+ */
+int Connect_Naming_Server(struct sockaddr_in *NS_Addr)
+{
+    int NS_Socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (CheckError(NS_Socket, "[-]Connect_Naming_Server: Error in creating socket for sending data to Name Server"))
+    {
+        LOG_ERROR("[-]Connect_Naming_Server: Error in creating socket for sending data to Name Server");
+        exit(EXIT_FAILURE);
+    }
+
+    int err = connect(NS_Socket, (struct sockaddr *)NS_Addr, sizeof(struct sockaddr_in));
+    if (CheckError(err, "[-]Connect_Naming_Server: Error in connecting to Name Server"))
+    {
+        LOG_ERROR("[-]Connect_Naming_Server: Error in connecting to Name Server");
+        exit(EXIT_FAILURE);
+    }
+    return NS_Socket;
+}
+
 int main()
 {
     printf("Enter (2)Port Number You want to use for Communication:\t");
@@ -915,23 +1151,27 @@ int main()
     // Register the exit handler
     atexit(exit_handler);
 
-    // Initialize the log file
-    Log_File = fopen("./SSlog.log", "w");
-    if (Log_File == NULL)
+    // Initialize the log file (level, sampling, console echo and format are read from the NFS_LOG_* variables)
+    LOG_CONFIG_STRUCT LogConfig;
+    Log_Default_Config(&LogConfig, 1);
+    if (Log_Init("./SSlog", &LogConfig) < 0)
     {
         fprintf(stderr, "Error opening log file\n");
         exit(1);
     }
+    Trace_Init("Storage Server");
+
+    // A client leaving in the middle of a transfer must not kill the server (sendfile has no MSG_NOSIGNAL)
+    signal(SIGPIPE, SIG_IGN);
 
     // Initialize the clock
     Clock = InitClock();
     if (CheckNull(Clock, "[-]main: Error in initializing clock"))
     {
-        fprintf(Log_File, "[-]main: Error in initializing clock [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]main: Error in initializing clock");
         exit(EXIT_FAILURE);
     }
-    fprintf(Log_File, "[+]Server Initialized [Time Stamp: %f]\n", GetCurrTime(Clock));
-    printf("[+]Server Initialized\n");
+    LOG_INFO("[+]Server Initialized");
 
     // Create a thread to flush the logs periodically
     pthread_t tLogFlusherThread;
@@ -945,7 +1185,7 @@ int main()
     File_Trie = Initialize_File_Trie();
     if (CheckNull(File_Trie, "[-]main: Error in initializing file trie"))
     {
-        fprintf(Log_File, "[-]main: Error in initializing file trie [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]main: Error in initializing file trie");
         exit(EXIT_FAILURE);
     }
 
@@ -956,96 +1196,88 @@ int main()
     NS_Addr.sin_addr.s_addr = inet_addr(NS_IP);
     memset(NS_Addr.sin_zero, '\0', sizeof(NS_Addr.sin_zero));
 
-    // Socket for sending data to Name Server
-    NS_Write_Socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (CheckError(NS_Write_Socket, "[-]main: Error in creating socket for sending data to Name Server"))
+    // Connect to the Name Server and negotiate the wire version
+    NS_Write_Socket = Connect_Naming_Server(&NS_Addr);
+    NS_Wire_Version = Wire_Client_Hello(NS_Write_Socket);
+    if (NS_Wire_Version == WIRE_VERSION_1)
     {
-        fprintf(Log_File, "[-]main: Error in creating socket for sending data to Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
-        exit(EXIT_FAILURE);
+        // The Name Server did not answer the HELLO, reconnect and talk v1
+        close(NS_Write_Socket);
+        NS_Write_Socket = Connect_Naming_Server(&NS_Addr);
     }
-    int err = connect(NS_Write_Socket, (struct sockaddr *)&NS_Addr, sizeof(NS_Addr));
-    if (CheckError(err, "[-]main: Error in connecting to Name Server"))
+    else if (CheckError(NS_Wire_Version, "[-]main: Error in negotiating wire version with Name Server"))
     {
-        fprintf(Log_File, "[-]main: Error in connecting to Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]main: Error in negotiating wire version with Name Server");
         exit(EXIT_FAILURE);
     }
-    else
+    LOG_INFO("[+]Connection Established with Naming Server (Wire Protocol v%d)", NS_Wire_Version);
+
+    // The mount path list is no longer limited to a single buffer (v1 truncates it while sending)
+    SERVER_INIT_INFO_STRUCT SS_Init_Info;
+    SS_Init_Info.sServerPort_Client = ClientPort;
+    SS_Init_Info.sServerPort_NServer = NSPort;
+    SS_Init_Info.MountPaths = (char *)calloc(SS_MOUNT_PATHS_SIZE, sizeof(char));
+    if (CheckNull(SS_Init_Info.MountPaths, "[-]main: Error in allocating memory"))
     {
-        printf("[+]Connection Established with Naming Server\n");
-        fprintf(Log_File, "[+]Connection Established with Naming Server [Time Stamp: %f]\n", GetCurrTime(Clock));
-    }
-    STORAGE_SERVER_INIT_STRUCT Packet;
-    STORAGE_SERVER_INIT_STRUCT *SS_Init_Struct = &Packet;
-
-    /*
-    STORAGE_SERVER_INIT_STRUCT *SS_Init_Struct = (STORAGE_SERVER_INIT_STRUCT *)malloc(sizeof(STORAGE_SERVER_INIT_STRUCT));
-    if (CheckNull(SS_Init_Struct, "[-]main: Error in allocating memory"))
-    {
-        fprintf(Log_File, "[-]main: Error in allocating memory [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]main: Error in allocating memory");
         exit(EXIT_FAILURE);
     }
-    */
 
-    SS_Init_Struct->sServerPort_Client = ClientPort;
-    SS_Init_Struct->sServerPort_NServer = NSPort;
     char root_path[MAX_BUFFER_SIZE] = "./";
-    memset(SS_Init_Struct->MountPaths, 0, MAX_BUFFER_SIZE);
-    err = trie_paths(File_Trie, SS_Init_Struct->MountPaths, root_path);
+    int err = trie_paths(File_Trie, SS_Init_Info.MountPaths, root_path);
     if (CheckError(err, "[-]main: Error in getting mount paths"))
     {
-        fprintf(Log_File, "[-]main: Error in getting mount paths [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]main: Error in getting mount paths");
         exit(EXIT_FAILURE);
     }
+    SS_Init_Info.iMountPathsLength = strlen(SS_Init_Info.MountPaths);
 
-    // printf("[+]main: Sent Mounted Paths: \n%s\n", SS_Init_Struct->MountPaths);
-
-    err = send(NS_Write_Socket, SS_Init_Struct, sizeof(STORAGE_SERVER_INIT_STRUCT), 0);
-    if (err != sizeof(STORAGE_SERVER_INIT_STRUCT))
+    WIRE_CONTEXT_STRUCT NS_Context = {NS_Wire_Version, 0};
+    err = Send_Server_Init(NS_Write_Socket, &NS_Context, &SS_Init_Info);
+    free(SS_Init_Info.MountPaths);
+    if (err <= 0)
     {
-        fprintf(Log_File, "[-]main: Error in sending data to Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]main: Error in sending data to Name Server");
         exit(EXIT_FAILURE);
     }
-    fprintf(Log_File, "[+]Initialization Packet Sent to Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Initialization Packet Sent to Name Server");
 
     // receive the Server ID from the Name Server
     err = recv(NS_Write_Socket, &Server_ID, sizeof(unsigned long), 0);
     if (CheckError(err, "[-]main: Error in receiving data from Name Server"))
     {
-        fprintf(Log_File, "[-]main: Error in receiving data from Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]main: Error in receiving data from Name Server");
         exit(EXIT_FAILURE);
     }
     else if (err == 0)
     {
-        printf(RED "[-]main: Connection with Name Server Closed Unexpectedly\n" CRESET);
-        fprintf(Log_File, "[-]main: Connection with Name Server Closed Unexpectedly [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]main: Connection with Name Server Closed Unexpectedly");
         return 1;
     }
 
-    printf("[+]Connection Established with Naming Server\n");
-    fprintf(Log_File, "[+]Connection Established with Naming Server [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Connection Established with Naming Server");
 
-    printf(BWHT "[+]Server ID: %lu\n" CRESET, Server_ID);
-    fprintf(Log_File, "[+]Server ID: %lu [Time Stamp: %f]\n", Server_ID, GetCurrTime(Clock));
+    LOG_INFO("[+]Server ID: %lu", Server_ID);
 
     // Setup Listner for Name Server
     pthread_t NS_Listner;
     err = pthread_create(&NS_Listner, NULL, NS_Listner_Thread, (void *)&NSPort);
     if (CheckError(err, "[-]main: Error in creating thread for Name Server Listner"))
     {
-        fprintf(Log_File, "[-]main: Error in creating thread for Name Server Listner [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]main: Error in creating thread for Name Server Listner");
         exit(EXIT_FAILURE);
     }
-    fprintf(Log_File, "[+]Name Server Listner Thread Created [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Name Server Listner Thread Created");
 
     // Setup Listner for Client
     pthread_t Client_Listner;
     err = pthread_create(&Client_Listner, NULL, Client_Listner_Thread, (void *)&ClientPort);
     if (CheckError(err, "[-]main: Error in creating thread for Client Listner"))
     {
-        fprintf(Log_File, "[-]main: Error in creating thread for Client Listner [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("[-]main: Error in creating thread for Client Listner");
         exit(EXIT_FAILURE);
     }
-    fprintf(Log_File, "[+]Client Listner Thread Created [Time Stamp: %f]\n", GetCurrTime(Clock));
+    LOG_INFO("[+]Client Listner Thread Created");
 
     // Wait for the threads to finish
     pthread_join(NS_Listner, NULL);
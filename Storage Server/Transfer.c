@@ -0,0 +1,204 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+
+#include "./Transfer.h"
+
+static atomic_ulong TransferCount[3];
+static atomic_ullong TransferBytes[3];
+static atomic_ulong WriteCount;
+static atomic_ullong WriteBytes;
+
+// An engine the file (or socket) does not support, the next one is tried
+static int Unsupported(int err)
+{
+    return err == EINVAL || err == ENOSYS || err == EOPNOTSUPP || err == ENOTSUP;
+}
+
+/**
+ * @brief Sends a part of a file with sendfile
+ * @return: The bytes sent, -1 on failure (errno set)
+ * @note: Stops short only on failure
+ */
+static ssize_t Send_File(int sockfd, int fd, off_t offset, size_t length)
+{
+    size_t sent = 0;
+    while (sent < length)
+    {
+        size_t count = (length - sent < TRANSFER_CHUNK) ? length - sent : TRANSFER_CHUNK;
+        ssize_t n = sendfile(sockfd, fd, &offset, count);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return (sent > 0) ? (ssize_t)sent : -1;
+        if (n == 0)
+            break; // the file is shorter than expected
+        sent += n;
+    }
+    return sent;
+}
+
+/**
+ * @brief Sends a part of a file with splice, through a pipe
+ * @return: The bytes sent, -1 on failure (errno set)
+ */
+static ssize_t Splice_File(int sockfd, int fd, off_t offset, size_t length)
+{
+    int pipefd[2];
+    if (pipe(pipefd) < 0)
+        return -1;
+    fcntl(pipefd[1], F_SETPIPE_SZ, TRANSFER_PIPE_SIZE);
+
+    size_t sent = 0;
+    int err = 0;
+    while (sent < length && err == 0)
+    {
+        size_t count = (length - sent < TRANSFER_CHUNK) ? length - sent : TRANSFER_CHUNK;
+        ssize_t in = splice(fd, &offset, pipefd[1], NULL, count, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (in < 0 && errno == EINTR)
+            continue;
+        if (in <= 0)
+        {
+            err = (in < 0) ? errno : 0;
+            break;
+        }
+        // Drain the pipe into the socket
+        while (in > 0)
+        {
+            ssize_t out = splice(pipefd[0], NULL, sockfd, NULL, in, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (out < 0 && errno == EINTR)
+                continue;
+            if (out <= 0)
+            {
+                err = (out < 0) ? errno : EPIPE;
+                break;
+            }
+            in -= out;
+            sent += out;
+        }
+    }
+    close(pipefd[0]);
+    close(pipefd[1]);
+    if (err != 0 && sent == 0)
+    {
+        errno = err;
+        return -1;
+    }
+    return sent;
+}
+
+/**
+ * @brief Sends a part of a file through a user space buffer
+ * @return: The bytes sent, -1 on failure
+ */
+static ssize_t Copy_File(int sockfd, int fd, off_t offset, size_t length)
+{
+    char *buffer = (char *)malloc(TRANSFER_COPY_SIZE);
+    if (buffer == NULL)
+        return -1;
+    size_t sent = 0;
+    while (sent < length)
+    {
+        size_t count = (length - sent < TRANSFER_COPY_SIZE) ? length - sent : TRANSFER_COPY_SIZE;
+        ssize_t n = pread(fd, buffer, count, offset + sent);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        size_t done = 0;
+        while (done < (size_t)n)
+        {
+            ssize_t out = send(sockfd, buffer + done, n - done, MSG_NOSIGNAL);
+            if (out < 0 && errno == EINTR)
+                continue;
+            if (out <= 0)
+            {
+                free(buffer);
+                return (sent + done > 0) ? (ssize_t)(sent + done) : -1;
+            }
+            done += out;
+        }
+        sent += n;
+    }
+    free(buffer);
+    return sent;
+}
+
+/**
+ * @brief Sends a part of a file on a socket
+ * @param sockfd: The socket (blocking)
+ * @param fd: The file, opened for reading
+ * @param offset: Where the part starts in the file
+ * @param length: The bytes to send
+ * @return: The bytes sent (less than length if the file is shorter, or the connection broke), -1 on failure
+ * @note: The offset of fd is not moved, so a file can serve several transfers at once
+ */
+ssize_t Transfer_File(int sockfd, int fd, off_t offset, size_t length)
+{
+    if (length == 0)
+        return 0;
+
+    int engine = TRANSFER_SENDFILE;
+    ssize_t sent = Send_File(sockfd, fd, offset, length);
+    if (sent < 0 && Unsupported(errno))
+    {
+        engine = TRANSFER_SPLICE;
+        sent = Splice_File(sockfd, fd, offset, length);
+    }
+    if (sent < 0 && Unsupported(errno))
+    {
+        engine = TRANSFER_COPY;
+        sent = Copy_File(sockfd, fd, offset, length);
+    }
+    if (sent < 0)
+        return -1;
+
+    atomic_fetch_add(&TransferCount[engine], 1);
+    atomic_fetch_add(&TransferBytes[engine], sent);
+    return sent;
+}
+
+/**
+ * @brief Writes a buffer to a file at an offset
+ * @param fd: The file, opened for writing
+ * @param buffer: The bytes to write
+ * @param length: The bytes to write
+ * @param offset: Where they go in the file
+ * @return: 0 once every byte is written, -1 on failure
+ * @note: The offset of fd is not moved
+ */
+int Transfer_Write(int fd, const void *buffer, size_t length, off_t offset)
+{
+    const char *data = (const char *)buffer;
+    while (length > 0)
+    {
+        ssize_t n = pwrite(fd, data, length, offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        atomic_fetch_add(&WriteCount, 1);
+        atomic_fetch_add(&WriteBytes, n);
+        data += n;
+        length -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+void Transfer_Get_Stats(TRANSFER_STATS_STRUCT *stats)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        stats->iTransfers[i] = atomic_load(&TransferCount[i]);
+        stats->iBytes[i] = atomic_load(&TransferBytes[i]);
+    }
+    stats->iWrites = atomic_load(&WriteCount);
+    stats->iWriteBytes = atomic_load(&WriteBytes);
+}
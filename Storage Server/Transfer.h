@@ -0,0 +1,38 @@
+#ifndef __TRANSFER_H__
+#define __TRANSFER_H__
+
+#include <sys/types.h>
+
+#define TRANSFER_CHUNK (4 * 1024 * 1024)     // Bytes moved per sendfile/splice call (keeps a call short)
+#define TRANSFER_PIPE_SIZE (1024 * 1024)     // Capacity asked for the splice pipe
+#define TRANSFER_COPY_SIZE (64 * 1024)       // Buffer of the read/send fallback
+
+// Engines, in the order they are tried
+#define TRANSFER_SENDFILE 0
+#define TRANSFER_SPLICE 1
+#define TRANSFER_COPY 2
+
+/*
+File bytes go from the page cache to the socket without passing through user space: sendfile first,
+splice through a pipe when the file system does not support sendfile, and a plain read/send copy
+when neither is supported. The engine is picked per transfer (a failure before any byte was moved
+falls back to the next one), a failure after that is a failure of the transfer.
+The data of a WRITE goes the other way in whole buffers (see Wire_Write_Buffer_Size), one pwrite each.
+*/
+
+typedef struct TRANSFER_STATS_STRUCT
+{
+    unsigned long iTransfers[3];             // Transfers completed, by engine
+    unsigned long long iBytes[3];            // Bytes moved, by engine
+    unsigned long iWrites;                   // pwrite calls of Transfer_Write
+    unsigned long long iWriteBytes;          // Bytes written by Transfer_Write
+} TRANSFER_STATS_STRUCT;
+
+// Sends length bytes of fd from offset on a blocking socket, returns the bytes sent or -1
+ssize_t Transfer_File(int sockfd, int fd, off_t offset, size_t length);
+// Writes length bytes of a buffer at offset of fd, returns 0 or -1
+int Transfer_Write(int fd, const void *buffer, size_t length, off_t offset);
+// Copies the counters of the engines and of the writes
+void Transfer_Get_Stats(TRANSFER_STATS_STRUCT *stats);
+
+#endif
@@ -107,7 +107,7 @@ int trie_paths_helper(Trie *file_trie, char *buffer, char *cur_dir)
             Read_Lock(file_trie->Lock);
             if (CheckError(status, "trie_paths_helper: Error printing to buffer"))
             {
-                fprintf(Log_File, "trie_paths_helper: Error printing to buffer [Time Stamp: %f]\n", GetCurrTime(Clock));
+                LOG_ERROR("trie_paths_helper: Error printing to buffer");
                 return -1;
             }
         }
@@ -160,7 +160,7 @@ int trie_insert(Trie *file_trie, char *path)
             if (CheckNull(curr->children[index], "trie_insert: Error initializing trie node"))
             {
                 Write_Unlock(curr->Lock);
-                fprintf(Log_File, "trie_insert: Error initializing trie node [Time Stamp: %f]\n", GetCurrTime(Clock));
+                LOG_ERROR("trie_insert: Error initializing trie node");
                 return -1;
             }
             strncpy(curr->children[index]->path_token, path_token, TOKEN_SIZE);
@@ -251,7 +251,7 @@ int trie_delete(Trie *file_trie, char *path)
             int status = trie_destroy(curr->children[i]);
             if (CheckError(status, "trie_delete: Error deleting children"))
             {
-                fprintf(Log_File, "trie_delete: Error deleting children [Time Stamp: %f]\n", GetCurrTime(Clock));
+                LOG_ERROR("trie_delete: Error deleting children");
                 return -1;
             }
             curr->children[i] = NULL;
@@ -282,7 +282,7 @@ int trie_destroy(Trie *file_trie)
             int status = trie_destroy(file_trie->children[i]);
             if (CheckError(status, "trie_destroy: Error deleting children"))
             {
-                fprintf(Log_File, "trie_destroy: Error deleting children [Time Stamp: %f]\n", GetCurrTime(Clock));
+                LOG_ERROR("trie_destroy: Error deleting children");
                 return -1;
             }
             file_trie->children[i] = NULL;
@@ -375,7 +375,7 @@ int trie_print(Trie *file_trie, char *buffer, int level)
     if (CheckError(status, "trie_print: Error printing to buffer"))
     {
         Read_Unlock(file_trie->Lock);
-        fprintf(Log_File, "trie_print: Error printing to buffer [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("trie_print: Error printing to buffer");
         return -1;
     }
 
@@ -386,7 +386,7 @@ int trie_print(Trie *file_trie, char *buffer, int level)
             status = trie_print(file_trie->children[i], buffer, level + 1);
             if (CheckError(status, "trie_print: Error printing to buffer"))
             {
-                fprintf(Log_File, "trie_print: Error printing to buffer [Time Stamp: %f]\n", GetCurrTime(Clock));
+                LOG_ERROR("trie_print: Error printing to buffer");
                 return -1;
             }
         }
@@ -425,7 +425,7 @@ int trie_paths(Trie *file_trie, char *buffer, char *root)
         if (CheckNull(curr->children[index], "trie_paths: Error traversing to root"))
         {
             Read_Unlock(curr->Lock);
-            fprintf(Log_File, "trie_paths: Error traversing to root [Time Stamp: %f]\n", GetCurrTime(Clock));
+            LOG_ERROR("trie_paths: Error traversing to root");
             return -1;
         }
 
@@ -438,7 +438,7 @@ int trie_paths(Trie *file_trie, char *buffer, char *root)
     int status = trie_paths_helper(curr, buffer, root_path);
     if (CheckError(status, "trie_paths: Error printing to buffer"))
     {
-        fprintf(Log_File, "trie_paths: Error printing to buffer [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LOG_ERROR("trie_paths: Error printing to buffer");
         return -1;
     }
     return 0;
@@ -0,0 +1,254 @@
+#include "./Trace.h"
+#include "./Log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+static int iTraceSampleRate = 1;
+static atomic_ulong iTraceRequests = 0;
+static atomic_ulong iNextID = 0;
+static uint64_t iIDSeed = 0;
+static int iProcessID = 0;
+
+static __thread uint64_t iThreadTraceID = 0;
+static __thread uint64_t iThreadSpanID = 0;
+static __thread int iThreadID = 0;
+
+// Microseconds of CLOCK_REALTIME (comparable between processes of a machine)
+static uint64_t Trace_Now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+// Returns a new non zero id (unique between processes with high probability)
+static uint64_t Trace_New_ID()
+{
+    // splitmix64 of a per process seed and a counter
+    uint64_t z = iIDSeed + atomic_fetch_add(&iNextID, 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+// Appends text escaped for a JSON string
+static size_t Json_Escape(char *sOut, size_t iOutSize, const char *sText)
+{
+    size_t n = 0;
+    for (; *sText != '\0' && n + 7 < iOutSize; sText++)
+    {
+        unsigned char c = (unsigned char)*sText;
+        if (c == '"' || c == '\\')
+        {
+            sOut[n++] = '\\';
+            sOut[n++] = c;
+        }
+        else if (c < 0x20)
+            n += snprintf(sOut + n, iOutSize - n, "\\u%04x", c);
+        else
+            sOut[n++] = c;
+    }
+    sOut[n] = '\0';
+    return n;
+}
+
+/**
+ * @brief Names the process in the trace file and reads the sampling rate of the client
+ * @param sProcessName: Name shown for the process (e.g. "Naming Server")
+ * @note: Call after Log_Init, does nothing when the trace file is not open
+ */
+void Trace_Init(const char *sProcessName)
+{
+    if (!Log_Trace_Enabled())
+        return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    iProcessID = getpid();
+    iIDSeed = ((uint64_t)iProcessID << 32) ^ (uint64_t)now.tv_sec * 1000000000ULL ^ now.tv_nsec;
+
+    char *sValue = getenv(TRACE_ENV_SAMPLE);
+    if (sValue != NULL && atoi(sValue) > 0)
+        iTraceSampleRate = atoi(sValue);
+
+    char sName[TRACE_MAX_DETAIL];
+    Json_Escape(sName, sizeof(sName), sProcessName);
+    char sEvent[TRACE_MAX_EVENT];
+    int iLength = snprintf(sEvent, sizeof(sEvent), "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"%s\"}},\n", iProcessID, sName);
+    Log_Trace_Event(sEvent, iLength);
+}
+
+int Trace_Enabled()
+{
+    return Log_Trace_Enabled();
+}
+
+/**
+ * @brief Starts a trace for the next request of the calling thread (client side)
+ * @return: The trace id, 0 if tracing is off or the request is not sampled
+ */
+uint64_t Trace_Start()
+{
+    iThreadTraceID = 0;
+    iThreadSpanID = 0;
+    if (!Log_Trace_Enabled() || (atomic_fetch_add(&iTraceRequests, 1) % iTraceSampleRate) != 0)
+        return 0;
+    iThreadTraceID = Trace_New_ID();
+    return iThreadTraceID;
+}
+
+/**
+ * @brief Continues the trace of a received request on the calling thread
+ * @param iTraceID: The trace id of the request (0 for an untraced request)
+ * @param iParentID: The span of the sender the request belongs to
+ */
+void Trace_Set_Context(uint64_t iTraceID, uint64_t iParentID)
+{
+    iThreadTraceID = Log_Trace_Enabled() ? iTraceID : 0;
+    iThreadSpanID = iParentID;
+}
+
+void Trace_Get_Context(uint64_t *iTraceID, uint64_t *iSpanID)
+{
+    *iTraceID = iThreadTraceID;
+    *iSpanID = iThreadSpanID;
+}
+
+void Trace_Clear()
+{
+    iThreadTraceID = 0;
+    iThreadSpanID = 0;
+}
+
+/**
+ * @brief Opens a span as a child of the current span of the thread
+ * @param span: The span (usually on the stack), passed to Trace_End
+ * @param sName: Name of the span (kept by pointer until Trace_End)
+ */
+void Trace_Begin(TRACE_SPAN_STRUCT *span, const char *sName)
+{
+    span->iTraceID = iThreadTraceID;
+    if (span->iTraceID == 0)
+        return;
+    span->sName = sName;
+    span->iSpanID = Trace_New_ID();
+    span->iParentID = iThreadSpanID;
+    span->iSum = 0;
+    span->iError = 0;
+    span->sDetail[0] = '\0';
+    iThreadSpanID = span->iSpanID;
+    span->iStartUs = Trace_Now();
+}
+
+/**
+ * @brief Opens a span summing the intervals between Trace_Resume and Trace_Pause
+ * @note: The span never becomes the current span
+ */
+void Trace_Begin_Sum(TRACE_SPAN_STRUCT *span, const char *sName)
+{
+    span->iTraceID = iThreadTraceID;
+    if (span->iTraceID == 0)
+        return;
+    span->sName = sName;
+    span->iSpanID = Trace_New_ID();
+    span->iParentID = iThreadSpanID;
+    span->iSum = 1;
+    span->iError = 0;
+    span->sDetail[0] = '\0';
+    span->iStartUs = 0;
+    span->iDurationUs = 0;
+    span->iResumeUs = 0;
+    span->iIntervals = 0;
+}
+
+void Trace_Resume(TRACE_SPAN_STRUCT *span)
+{
+    if (span->iTraceID == 0)
+        return;
+    span->iResumeUs = Trace_Now();
+    if (span->iIntervals++ == 0)
+        span->iStartUs = span->iResumeUs;
+}
+
+void Trace_Pause(TRACE_SPAN_STRUCT *span)
+{
+    if (span->iTraceID == 0 || span->iResumeUs == 0)
+        return;
+    span->iDurationUs += Trace_Now() - span->iResumeUs;
+    span->iResumeUs = 0;
+}
+
+/**
+ * @brief Sets the detail shown in the args of a span (e.g. the path of a request)
+ */
+void Trace_Detail(TRACE_SPAN_STRUCT *span, const char *sFormat, ...)
+{
+    if (span->iTraceID == 0)
+        return;
+    char sDetail[TRACE_MAX_DETAIL];
+    va_list args;
+    va_start(args, sFormat);
+    vsnprintf(sDetail, sizeof(sDetail), sFormat, args);
+    va_end(args);
+    Json_Escape(span->sDetail, sizeof(span->sDetail), sDetail);
+}
+
+void Trace_Error(TRACE_SPAN_STRUCT *span, int iErrorCode)
+{
+    if (span->iTraceID == 0)
+        return;
+    span->iError = iErrorCode;
+}
+
+/**
+ * @brief Records a span and makes its parent the current span again
+ * @note: A sum span is recorded with the sum of its intervals (and their number)
+ */
+void Trace_End(TRACE_SPAN_STRUCT *span)
+{
+    if (span->iTraceID == 0)
+        return;
+    uint64_t iDurationUs;
+    if (span->iSum)
+    {
+        Trace_Pause(span);
+        if (span->iIntervals == 0)
+            return;
+        iDurationUs = span->iDurationUs;
+    }
+    else
+    {
+        iDurationUs = Trace_Now() - span->iStartUs;
+        // Spans may end out of order on error paths, only the current one hands back to its parent
+        if (iThreadSpanID == span->iSpanID)
+            iThreadSpanID = span->iParentID;
+    }
+    if (iThreadID == 0)
+        iThreadID = (int)syscall(SYS_gettid);
+
+    char sName[TRACE_MAX_DETAIL];
+    Json_Escape(sName, sizeof(sName), span->sName);
+    char sEvent[TRACE_MAX_EVENT];
+    int iLength = snprintf(sEvent, sizeof(sEvent),
+                           "{\"name\":\"%s\",\"cat\":\"nfs\",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,\"pid\":%d,\"tid\":%d,"
+                           "\"args\":{\"trace\":\"%016lx\",\"span\":\"%016lx\",\"parent\":\"%016lx\"",
+                           sName, (unsigned long)span->iStartUs, (unsigned long)iDurationUs, iProcessID, iThreadID,
+                           (unsigned long)span->iTraceID, (unsigned long)span->iSpanID, (unsigned long)span->iParentID);
+    if (span->iSum)
+        iLength += snprintf(sEvent + iLength, sizeof(sEvent) - iLength, ",\"intervals\":%lu", span->iIntervals);
+    if (span->iError != 0)
+        iLength += snprintf(sEvent + iLength, sizeof(sEvent) - iLength, ",\"error\":%d", span->iError);
+    if (span->sDetail[0] != '\0')
+        iLength += snprintf(sEvent + iLength, sizeof(sEvent) - iLength, ",\"detail\":\"%s\"", span->sDetail);
+    iLength += snprintf(sEvent + iLength, sizeof(sEvent) - iLength, "}},\n");
+    if (iLength >= (int)sizeof(sEvent))
+        return;
+    Log_Trace_Event(sEvent, iLength);
+}
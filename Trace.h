@@ -0,0 +1,61 @@
+// Request tracing shared by the Naming Server, the Storage Server and the Client
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdint.h>
+
+#define TRACE_ENV_SAMPLE "NFS_TRACE_SAMPLE" // Client: trace 1 in N requests (tracing itself is enabled by NFS_TRACE)
+#define TRACE_MAX_DETAIL 256                // Longest detail of a span, longer ones are truncated
+#define TRACE_MAX_EVENT 1024                // Longest event line
+
+/*
+A request is traced end to end when the client starts a trace for it (Trace_Start). Every process
+keeps the trace of the request it is serving in a per-thread context: spans opened by the thread
+become children of the current span, and requests sent by the thread carry the trace id and the
+current span id in their v2 header (see Wire.h), so the receiving process continues the same
+trace (Trace_Set_Context). Untraced requests only cost a thread-local check per span.
+Finished spans are queued to the logger and written by its writer thread to <log name>.trace.json
+as Chrome trace events ("ph":"X", microseconds of CLOCK_REALTIME so that the files of processes
+on the same machine line up). The files of every process can be merged (make trace in the Naming
+Server) and loaded in chrome://tracing or Perfetto, the trace id is in the args of every span.
+*/
+
+typedef struct TRACE_SPAN_STRUCT
+{
+    const char *sName;
+    uint64_t iTraceID;              // 0 if the span is not recorded
+    uint64_t iSpanID;
+    uint64_t iParentID;
+    uint64_t iStartUs;
+    uint64_t iDurationUs;           // Summed intervals of a sum span
+    uint64_t iResumeUs;             // Start of the open interval of a sum span (0 if paused)
+    unsigned long iIntervals;       // Number of intervals of a sum span
+    int iSum;                       // Opened by Trace_Begin_Sum
+    int iError;                     // Error code of a failed operation (0 if none)
+    char sDetail[TRACE_MAX_DETAIL];
+} TRACE_SPAN_STRUCT;
+
+// Names the process in the trace and reads the client sampling rate
+void Trace_Init(const char *sProcessName);
+int Trace_Enabled();
+
+// Context of the calling thread
+uint64_t Trace_Start();                                            // Client: starts a (sampled) trace, returns its id or 0
+void Trace_Set_Context(uint64_t iTraceID, uint64_t iParentID);     // Servers: continues the trace of a received request
+void Trace_Get_Context(uint64_t *iTraceID, uint64_t *iSpanID);     // Trace and current span, sent with requests
+void Trace_Clear();                                                // Ends the trace of the thread
+
+// Spans (not recorded when the thread has no trace)
+void Trace_Begin(TRACE_SPAN_STRUCT *span, const char *sName);      // Opens a child of the current span and makes it current
+void Trace_End(TRACE_SPAN_STRUCT *span);                           // Records the span, its parent becomes current again
+void Trace_Detail(TRACE_SPAN_STRUCT *span, const char *sFormat, ...) __attribute__((format(printf, 2, 3)));
+void Trace_Error(TRACE_SPAN_STRUCT *span, int iErrorCode);         // Marks the span as failed with an error code
+
+// Sum spans time interleaved work (e.g. the disk reads and sends of a transfer loop): the
+// Trace_Resume..Trace_Pause intervals are summed and recorded from the start of the first one
+void Trace_Begin_Sum(TRACE_SPAN_STRUCT *span, const char *sName);
+void Trace_Resume(TRACE_SPAN_STRUCT *span);
+void Trace_Pause(TRACE_SPAN_STRUCT *span);
+
+#endif // _TRACE_H_
@@ -0,0 +1,1110 @@
+#include "./Wire.h"
+#include "./Externals.h"
+#include "./Trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <endian.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <arpa/inet.h>
+
+/**
+ * @brief Sends the complete buffer on a blocking socket
+ * @param sockfd: The socket to send on
+ * @param buffer: The data to be sent
+ * @param length: The number of bytes to be sent
+ * @return: length on success, -1 on failure
+ */
+int Send_All(int sockfd, const void *buffer, size_t length)
+{
+    const char *data = (const char *)buffer;
+    size_t sent = 0;
+    while (sent < length)
+    {
+        ssize_t iSendStatus = send(sockfd, data + sent, length - sent, MSG_NOSIGNAL);
+        if (iSendStatus < 0 && errno == EINTR)
+            continue;
+        if (iSendStatus <= 0)
+            return -1;
+        sent += iSendStatus;
+    }
+    return (int)length;
+}
+
+/**
+ * @brief Receives exactly length bytes from a blocking socket
+ * @param sockfd: The socket to receive from
+ * @param buffer: The buffer to fill
+ * @param length: The number of bytes to be received
+ * @return: length on success, 0 if the peer closed the connection, -1 on failure
+ */
+int Recv_All(int sockfd, void *buffer, size_t length)
+{
+    char *data = (char *)buffer;
+    size_t received = 0;
+    while (received < length)
+    {
+        ssize_t iRecvStatus = recv(sockfd, data + received, length - received, 0);
+        if (iRecvStatus < 0 && errno == EINTR)
+            continue;
+        if (iRecvStatus < 0)
+            return -1;
+        if (iRecvStatus == 0)
+            return 0;
+        received += iRecvStatus;
+    }
+    return (int)length;
+}
+
+/**
+ * @brief Detects the wire version of the next message on a socket without consuming it
+ * @param sockfd: The socket to inspect
+ * @return: WIRE_VERSION_1 or WIRE_VERSION_2, 0 if the peer closed the connection, -1 on failure
+ */
+int Wire_Detect_Version(int sockfd)
+{
+    uint32_t magic;
+    ssize_t iRecvStatus;
+    do
+        iRecvStatus = recv(sockfd, &magic, sizeof(magic), MSG_PEEK | MSG_WAITALL);
+    while (iRecvStatus < 0 && errno == EINTR);
+
+    if (iRecvStatus <= 0)
+        return (int)iRecvStatus;
+    if (iRecvStatus < (ssize_t)sizeof(magic))
+        return WIRE_VERSION_1;
+    return (ntohl(magic) == WIRE_MAGIC) ? WIRE_VERSION_2 : WIRE_VERSION_1;
+}
+
+/**
+ * @brief Writes a v2 header into a buffer
+ * @return: WIRE_HEADER_SIZE
+ */
+static int Wire_Encode_Header(char *buffer, int iFrameType, int iOperation, int iFlags, uint32_t iRequestID, int iErrorCode, int iExtensions, size_t iPayloadLength)
+{
+    WIRE_HEADER_STRUCT header;
+    header.iMagic = htonl(WIRE_MAGIC);
+    header.iFrameType = (uint8_t)iFrameType;
+    header.iOperation = (uint8_t)iOperation;
+    header.iFlags = (int16_t)htons((uint16_t)(int16_t)iFlags);
+    header.iRequestID = htonl(iRequestID);
+    header.iErrorCode = htons((uint16_t)iErrorCode);
+    header.iExtensions = htons((uint16_t)iExtensions);
+    header.iPayloadLength = htonl((uint32_t)iPayloadLength);
+    memcpy(buffer, &header, WIRE_HEADER_SIZE);
+    return WIRE_HEADER_SIZE;
+}
+
+/**
+ * @brief Parses a v2 header from a buffer of at least WIRE_HEADER_SIZE bytes
+ * @param buffer: The received bytes
+ * @param header: Filled with the header in host byte order
+ * @return: 0 on success, -1 if the header is invalid
+ */
+int Wire_Decode_Header(const char *buffer, WIRE_HEADER_STRUCT *header)
+{
+    memcpy(header, buffer, WIRE_HEADER_SIZE);
+    header->iMagic = ntohl(header->iMagic);
+    header->iFlags = (int16_t)ntohs((uint16_t)header->iFlags);
+    header->iRequestID = ntohl(header->iRequestID);
+    header->iErrorCode = ntohs(header->iErrorCode);
+    header->iExtensions = ntohs(header->iExtensions);
+    header->iPayloadLength = ntohl(header->iPayloadLength);
+
+    if (header->iMagic != WIRE_MAGIC || header->iPayloadLength > WIRE_MAX_PAYLOAD || (header->iExtensions & ~WIRE_EXT_KNOWN))
+        return -1;
+    return 0;
+}
+
+/**
+ * @brief Receives a v2 frame of the expected type into a caller buffer
+ * @param iFrameType: The expected FRAME_* type, 0 to accept any frame
+ * @param payload: Buffer for the payload (iPayloadSize bytes)
+ * @return: Number of bytes received, 0 if the peer closed the connection, -1 on failure
+ * @note: A frame with a payload larger than the buffer is a protocol error
+ */
+int Recv_Frame(int sockfd, int iFrameType, WIRE_HEADER_STRUCT *header, char *payload, size_t iPayloadSize)
+{
+    char buffer[WIRE_HEADER_SIZE];
+    int iRecvStatus = Recv_All(sockfd, buffer, WIRE_HEADER_SIZE);
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+
+    if (Wire_Decode_Header(buffer, header) < 0 || (iFrameType && header->iFrameType != iFrameType) || header->iPayloadLength > iPayloadSize)
+        return -1;
+
+    if (header->iPayloadLength > 0)
+    {
+        iRecvStatus = Recv_All(sockfd, payload, header->iPayloadLength);
+        if (iRecvStatus <= 0)
+            return iRecvStatus;
+    }
+    return WIRE_HEADER_SIZE + header->iPayloadLength;
+}
+
+/**
+ * @brief Receives a v2 frame of the expected type into a freshly allocated buffer
+ * @param iFrameType: The expected FRAME_* type, 0 to accept any frame
+ * @param payload: Set to the allocated payload (NUL terminated), to be freed by the caller
+ * @param iMaxPayload: Largest payload accepted
+ * @return: Number of bytes received, 0 if the peer closed the connection, -1 on failure
+ * @note: Used for the frames that do not fit the fixed size buffers (e.g. batches)
+ */
+int Recv_Frame_Alloc(int sockfd, int iFrameType, WIRE_HEADER_STRUCT *header, char **payload, size_t iMaxPayload)
+{
+    *payload = NULL;
+    char buffer[WIRE_HEADER_SIZE];
+    int iRecvStatus = Recv_All(sockfd, buffer, WIRE_HEADER_SIZE);
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+
+    if (Wire_Decode_Header(buffer, header) < 0 || (iFrameType && header->iFrameType != iFrameType) || header->iPayloadLength > iMaxPayload)
+        return -1;
+
+    char *data = (char *)malloc(header->iPayloadLength + 1);
+    if (data == NULL)
+        return -1;
+    if (header->iPayloadLength > 0)
+    {
+        iRecvStatus = Recv_All(sockfd, data, header->iPayloadLength);
+        if (iRecvStatus <= 0)
+        {
+            free(data);
+            return iRecvStatus;
+        }
+    }
+    data[header->iPayloadLength] = '\0';
+    *payload = data;
+    return WIRE_HEADER_SIZE + header->iPayloadLength;
+}
+
+/**
+ * @brief Resolves the version of an incoming message (detecting it if still unknown)
+ * @return: The version, 0 if the peer closed the connection, -1 on failure
+ */
+static int Wire_Recv_Version(int sockfd, WIRE_CONTEXT_STRUCT *ctx)
+{
+    if (ctx->iVersion == WIRE_VERSION_UNKNOWN)
+    {
+        int iVersion = Wire_Detect_Version(sockfd);
+        if (iVersion <= 0)
+            return iVersion;
+        ctx->iVersion = iVersion;
+    }
+    return ctx->iVersion;
+}
+
+/**
+ * @brief Encodes a request in the version of the context
+ * @param ctx: The wire context (its request ID is sent in v2, with the trace of the calling thread if it has one
+ *             and the byte range of a READ)
+ * @param request: The request to be encoded
+ * @param buffer: The output buffer (at least sizeof(REQUEST_STRUCT) bytes)
+ * @param size: Size of the output buffer
+ * @return: The encoded length, -1 on failure (a byte range cannot be sent in v1)
+ */
+int Wire_Encode_Request(WIRE_CONTEXT_STRUCT *ctx, REQUEST_STRUCT *request, char *buffer, size_t size)
+{
+    if (ctx->iVersion != WIRE_VERSION_2)
+    {
+        if (size < sizeof(REQUEST_STRUCT) || ctx->iRange)
+            return -1;
+        memcpy(buffer, request, sizeof(REQUEST_STRUCT));
+        return sizeof(REQUEST_STRUCT);
+    }
+
+    uint64_t iTraceID, iSpanID;
+    Trace_Get_Context(&iTraceID, &iSpanID);
+    int iExtensions = (iTraceID ? WIRE_EXT_TRACE : 0) | (ctx->iRange ? WIRE_EXT_RANGE : 0);
+    size_t iTraceLength = iTraceID ? WIRE_TRACE_EXT_SIZE : 0;
+    size_t iRangeLength = ctx->iRange ? WIRE_RANGE_EXT_SIZE : 0;
+
+    size_t iPathLength = strnlen(request->sRequestPath, MAX_BUFFER_SIZE - 1);
+    size_t iPayloadLength = iTraceLength + iRangeLength + sizeof(uint64_t) + iPathLength;
+    if (size < WIRE_HEADER_SIZE + iPayloadLength)
+        return -1;
+
+    int offset = Wire_Encode_Header(buffer, FRAME_REQUEST, request->iRequestOperation, request->iRequestFlags, ctx->iRequestID, 0, iExtensions, iPayloadLength);
+    if (iTraceID)
+    {
+        uint64_t iTrace[2] = {htobe64(iTraceID), htobe64(iSpanID)};
+        memcpy(buffer + offset, iTrace, sizeof(iTrace));
+        offset += sizeof(iTrace);
+        iPayloadLength -= sizeof(iTrace);
+    }
+    if (ctx->iRange)
+    {
+        uint64_t iRange[2] = {htobe64(ctx->iRangeOffset), htobe64(ctx->iRangeLength)};
+        memcpy(buffer + offset, iRange, sizeof(iRange));
+        offset += sizeof(iRange);
+        iPayloadLength -= sizeof(iRange);
+    }
+    uint64_t iClientID = htobe64((uint64_t)request->iRequestClientID);
+    memcpy(buffer + offset, &iClientID, sizeof(iClientID));
+    memcpy(buffer + offset + sizeof(iClientID), request->sRequestPath, iPathLength);
+    return offset + iPayloadLength;
+}
+
+/**
+ * @brief Decodes the payload of a v2 request frame
+ * @param header: The decoded header
+ * @param payload: The header->iPayloadLength payload bytes
+ * @param ctx: Receives the request ID, the trace of the request (0 if untraced) and its byte range
+ * @param request: Filled with the request
+ * @return: 0 on success, -1 on failure
+ */
+int Wire_Decode_Request(WIRE_HEADER_STRUCT *header, const char *payload, WIRE_CONTEXT_STRUCT *ctx, REQUEST_STRUCT *request)
+{
+    size_t iLength = header->iPayloadLength;
+    ctx->iTraceID = 0;
+    ctx->iParentSpanID = 0;
+    ctx->iRange = 0;
+    ctx->iRangeOffset = 0;
+    ctx->iRangeLength = 0;
+    if (header->iFrameType == FRAME_REQUEST && (header->iExtensions & WIRE_EXT_TRACE))
+    {
+        uint64_t iTrace[2];
+        if (iLength < sizeof(iTrace))
+            return -1;
+        memcpy(iTrace, payload, sizeof(iTrace));
+        ctx->iTraceID = be64toh(iTrace[0]);
+        ctx->iParentSpanID = be64toh(iTrace[1]);
+        payload += sizeof(iTrace);
+        iLength -= sizeof(iTrace);
+    }
+    if (header->iFrameType == FRAME_REQUEST && (header->iExtensions & WIRE_EXT_RANGE))
+    {
+        uint64_t iRange[2];
+        if (iLength < sizeof(iRange))
+            return -1;
+        memcpy(iRange, payload, sizeof(iRange));
+        ctx->iRange = 1;
+        ctx->iRangeOffset = be64toh(iRange[0]);
+        ctx->iRangeLength = be64toh(iRange[1]);
+        payload += sizeof(iRange);
+        iLength -= sizeof(iRange);
+    }
+    if (header->iFrameType != FRAME_REQUEST || iLength < sizeof(uint64_t) || iLength - sizeof(uint64_t) >= MAX_BUFFER_SIZE)
+        return -1;
+
+    memset(request, 0, sizeof(REQUEST_STRUCT));
+    uint64_t iClientID;
+    memcpy(&iClientID, payload, sizeof(iClientID));
+    request->iRequestOperation = header->iOperation;
+    request->iRequestFlags = header->iFlags;
+    request->iRequestClientID = (unsigned long)be64toh(iClientID);
+    memcpy(request->sRequestPath, payload + sizeof(iClientID), iLength - sizeof(iClientID));
+    ctx->iRequestID = header->iRequestID;
+    return 0;
+}
+
+/**
+ * @brief Decodes the payload of a v2 RESPONSE frame
+ * @param header: The decoded header of the frame
+ * @param payload: The payload bytes (header->iPayloadLength of them)
+ * @param ctx: Receives the request ID of the frame
+ * @param response: Filled with the response
+ * @return: 0 on success, -1 if the frame is not a valid response
+ */
+int Wire_Decode_Response(WIRE_HEADER_STRUCT *header, const char *payload, WIRE_CONTEXT_STRUCT *ctx, RESPONSE_STRUCT *response)
+{
+    if (header->iFrameType != FRAME_RESPONSE || header->iPayloadLength < sizeof(uint64_t) || header->iPayloadLength - sizeof(uint64_t) >= MAX_BUFFER_SIZE)
+        return -1;
+
+    memset(response, 0, sizeof(RESPONSE_STRUCT));
+    uint64_t iServerID;
+    memcpy(&iServerID, payload, sizeof(iServerID));
+    response->iResponseOperation = header->iOperation;
+    response->iResponseFlags = header->iFlags;
+    response->iResponseErrorCode = header->iErrorCode;
+    response->iResponseServerID = (unsigned long)be64toh(iServerID);
+    memcpy(response->sResponseData, payload + sizeof(iServerID), header->iPayloadLength - sizeof(iServerID));
+    ctx->iRequestID = header->iRequestID;
+    return 0;
+}
+
+/**
+ * @brief Decodes the payload of a v2 ACK frame
+ * @return: 0 on success, -1 if the frame is not a valid ACK
+ */
+int Wire_Decode_Ack(WIRE_HEADER_STRUCT *header, const char *payload, WIRE_CONTEXT_STRUCT *ctx, ACK_STRUCT *ack)
+{
+    if (header->iFrameType != FRAME_ACK || header->iPayloadLength >= MAX_BUFFER_SIZE)
+        return -1;
+
+    memset(ack, 0, sizeof(ACK_STRUCT));
+    memcpy(ack->sAckData, payload, header->iPayloadLength);
+    ack->iAckFlags = header->iFlags;
+    ack->iAckErrorCode = header->iErrorCode;
+    ctx->iRequestID = header->iRequestID;
+    return 0;
+}
+
+/**
+ * @brief Encodes a response in the version of the context
+ * @param ctx: The wire context (its request ID is echoed in v2)
+ * @param response: The response to be encoded
+ * @param buffer: The output buffer (at least sizeof(RESPONSE_STRUCT) bytes)
+ * @param size: Size of the output buffer
+ * @return: The encoded length, -1 on failure
+ */
+int Wire_Encode_Response(WIRE_CONTEXT_STRUCT *ctx, RESPONSE_STRUCT *response, char *buffer, size_t size)
+{
+    if (ctx->iVersion != WIRE_VERSION_2)
+    {
+        if (size < sizeof(RESPONSE_STRUCT))
+            return -1;
+        memcpy(buffer, response, sizeof(RESPONSE_STRUCT));
+        return sizeof(RESPONSE_STRUCT);
+    }
+
+    size_t iDataLength = strnlen(response->sResponseData, MAX_BUFFER_SIZE - 1);
+    size_t iPayloadLength = sizeof(uint64_t) + iDataLength;
+    if (size < WIRE_HEADER_SIZE + iPayloadLength)
+        return -1;
+
+    int offset = Wire_Encode_Header(buffer, FRAME_RESPONSE, response->iResponseOperation, response->iResponseFlags, ctx->iRequestID, response->iResponseErrorCode, 0, iPayloadLength);
+    uint64_t iServerID = htobe64((uint64_t)response->iResponseServerID);
+    memcpy(buffer + offset, &iServerID, sizeof(iServerID));
+    memcpy(buffer + offset + sizeof(iServerID), response->sResponseData, iDataLength);
+    return offset + iPayloadLength;
+}
+
+/**
+ * @brief Encodes an ACK in the version of the context
+ * @param ctx: The wire context (its request ID is echoed in v2)
+ * @return: The encoded length, -1 on failure
+ */
+int Wire_Encode_Ack(WIRE_CONTEXT_STRUCT *ctx, ACK_STRUCT *ack, char *buffer, size_t size)
+{
+    if (ctx->iVersion != WIRE_VERSION_2)
+    {
+        if (size < sizeof(ACK_STRUCT))
+            return -1;
+        memcpy(buffer, ack, sizeof(ACK_STRUCT));
+        return sizeof(ACK_STRUCT);
+    }
+
+    size_t iDataLength = strnlen(ack->sAckData, MAX_BUFFER_SIZE - 1);
+    if (size < WIRE_HEADER_SIZE + iDataLength)
+        return -1;
+
+    int offset = Wire_Encode_Header(buffer, FRAME_ACK, 0, ack->iAckFlags, ctx->iRequestID, ack->iAckErrorCode, 0, iDataLength);
+    memcpy(buffer + offset, ack->sAckData, iDataLength);
+    return offset + iDataLength;
+}
+
+/**
+ * @brief Encodes a HELLO frame advertising a protocol version
+ * @return: The encoded length, -1 on failure
+ */
+int Wire_Encode_Hello(int iVersion, char *buffer, size_t size)
+{
+    if (size < WIRE_HEADER_SIZE)
+        return -1;
+    return Wire_Encode_Header(buffer, FRAME_HELLO, iVersion, 0, 0, 0, 0, 0);
+}
+
+/**
+ * @brief Encodes a CMD_RESOLVE_BATCH request frame (v2 only)
+ * @param ctx: The wire context (its request ID is sent)
+ * @param ClientID: The ID of the requesting client
+ * @param Paths: The paths to be resolved
+ * @param iPathCount: Number of paths (at most WIRE_MAX_BATCH_PATHS)
+ * @param buffer: Set to the allocated frame, to be freed by the caller
+ * @return: The encoded length, -1 on failure
+ */
+int Wire_Encode_Resolve_Batch(WIRE_CONTEXT_STRUCT *ctx, unsigned long ClientID, char **Paths, uint32_t iPathCount, char **buffer)
+{
+    *buffer = NULL;
+    if (ctx->iVersion != WIRE_VERSION_2 || iPathCount == 0 || iPathCount > WIRE_MAX_BATCH_PATHS)
+        return -1;
+
+    size_t iPayloadLength = sizeof(uint64_t) + sizeof(uint32_t);
+    for (uint32_t i = 0; i < iPathCount; i++)
+    {
+        size_t iPathLength = strnlen(Paths[i], MAX_BUFFER_SIZE);
+        if (iPathLength >= MAX_BUFFER_SIZE)
+            return -1;
+        iPayloadLength += sizeof(uint16_t) + iPathLength;
+    }
+    if (iPayloadLength > WIRE_MAX_BATCH_PAYLOAD)
+        return -1;
+
+    char *frame = (char *)malloc(WIRE_HEADER_SIZE + iPayloadLength);
+    if (frame == NULL)
+        return -1;
+
+    size_t offset = Wire_Encode_Header(frame, FRAME_RESOLVE_BATCH, CMD_RESOLVE_BATCH, 0, ctx->iRequestID, 0, 0, iPayloadLength);
+    uint64_t iClientID = htobe64((uint64_t)ClientID);
+    uint32_t iCount = htonl(iPathCount);
+    memcpy(frame + offset, &iClientID, sizeof(iClientID));
+    offset += sizeof(iClientID);
+    memcpy(frame + offset, &iCount, sizeof(iCount));
+    offset += sizeof(iCount);
+    for (uint32_t i = 0; i < iPathCount; i++)
+    {
+        uint16_t iPathLength = (uint16_t)strnlen(Paths[i], MAX_BUFFER_SIZE);
+        uint16_t iLength = htons(iPathLength);
+        memcpy(frame + offset, &iLength, sizeof(iLength));
+        memcpy(frame + offset + sizeof(iLength), Paths[i], iPathLength);
+        offset += sizeof(iLength) + iPathLength;
+    }
+
+    *buffer = frame;
+    return (int)offset;
+}
+
+/**
+ * @brief Decodes the payload of a CMD_RESOLVE_BATCH request frame
+ * @param header: The decoded header
+ * @param payload: The header->iPayloadLength payload bytes
+ * @param ctx: Receives the request ID
+ * @param batch: Filled with the paths (release with Free_Resolve_Batch)
+ * @return: 0 on success, -1 if the frame is malformed
+ */
+int Wire_Decode_Resolve_Batch(WIRE_HEADER_STRUCT *header, const char *payload, WIRE_CONTEXT_STRUCT *ctx, RESOLVE_BATCH_STRUCT *batch)
+{
+    memset(batch, 0, sizeof(RESOLVE_BATCH_STRUCT));
+    if (header->iFrameType != FRAME_RESOLVE_BATCH || header->iPayloadLength < sizeof(uint64_t) + sizeof(uint32_t) || header->iPayloadLength > WIRE_MAX_BATCH_PAYLOAD)
+        return -1;
+
+    uint64_t iClientID;
+    uint32_t iCount;
+    memcpy(&iClientID, payload, sizeof(iClientID));
+    memcpy(&iCount, payload + sizeof(iClientID), sizeof(iCount));
+    iCount = ntohl(iCount);
+    if (iCount == 0 || iCount > WIRE_MAX_BATCH_PATHS)
+        return -1;
+
+    // Every path gets its own NUL terminator in PathData
+    batch->Paths = (char **)malloc(iCount * sizeof(char *));
+    batch->PathData = (char *)malloc(header->iPayloadLength + iCount);
+    if (batch->Paths == NULL || batch->PathData == NULL)
+    {
+        Free_Resolve_Batch(batch);
+        return -1;
+    }
+
+    size_t offset = sizeof(iClientID) + sizeof(iCount);
+    size_t iDataOffset = 0;
+    for (uint32_t i = 0; i < iCount; i++)
+    {
+        uint16_t iPathLength;
+        if (offset + sizeof(iPathLength) > header->iPayloadLength)
+        {
+            Free_Resolve_Batch(batch);
+            return -1;
+        }
+        memcpy(&iPathLength, payload + offset, sizeof(iPathLength));
+        iPathLength = ntohs(iPathLength);
+        offset += sizeof(iPathLength);
+        if (iPathLength >= MAX_BUFFER_SIZE || offset + iPathLength > header->iPayloadLength)
+        {
+            Free_Resolve_Batch(batch);
+            return -1;
+        }
+
+        batch->Paths[i] = batch->PathData + iDataOffset;
+        memcpy(batch->Paths[i], payload + offset, iPathLength);
+        batch->Paths[i][iPathLength] = '\0';
+        iDataOffset += iPathLength + 1;
+        offset += iPathLength;
+    }
+
+    batch->ClientID = (unsigned long)be64toh(iClientID);
+    batch->iPathCount = iCount;
+    ctx->iRequestID = header->iRequestID;
+    return 0;
+}
+
+/**
+ * @brief Releases the memory of a decoded batch
+ */
+void Free_Resolve_Batch(RESOLVE_BATCH_STRUCT *batch)
+{
+    free(batch->Paths);
+    free(batch->PathData);
+    batch->Paths = NULL;
+    batch->PathData = NULL;
+    batch->iPathCount = 0;
+}
+
+/**
+ * @brief Encodes the results of a CMD_RESOLVE_BATCH request
+ * @param ctx: The wire context of the batch (its request ID is echoed)
+ * @param results: One result per path, in the order of the batch
+ * @param iResultCount: Number of results
+ * @param buffer: Set to the allocated frame, to be freed by the caller
+ * @return: The encoded length, -1 on failure
+ */
+int Wire_Encode_Resolve_Results(WIRE_CONTEXT_STRUCT *ctx, RESOLVE_RESULT_STRUCT *results, uint32_t iResultCount, char **buffer)
+{
+    *buffer = NULL;
+    if (iResultCount > WIRE_MAX_BATCH_PATHS)
+        return -1;
+
+    size_t iPayloadLength = sizeof(uint32_t) + iResultCount * WIRE_RESOLVE_RESULT_SIZE;
+    char *frame = (char *)malloc(WIRE_HEADER_SIZE + iPayloadLength);
+    if (frame == NULL)
+        return -1;
+
+    size_t offset = Wire_Encode_Header(frame, FRAME_RESOLVE_RESULTS, CMD_RESOLVE_BATCH, RESPONSE_FLAG_SUCCESS, ctx->iRequestID, 0, 0, iPayloadLength);
+    uint32_t iCount = htonl(iResultCount);
+    memcpy(frame + offset, &iCount, sizeof(iCount));
+    offset += sizeof(iCount);
+    for (uint32_t i = 0; i < iResultCount; i++)
+    {
+        uint64_t iServerID = htobe64((uint64_t)results[i].iServerID);
+        struct in_addr address;
+        if (inet_pton(AF_INET, results[i].sServerIP, &address) != 1)
+            address.s_addr = 0;
+        uint16_t iPort = htons((uint16_t)results[i].iServerPort);
+        int16_t iFlags = (int16_t)htons((uint16_t)(int16_t)results[i].iFlags);
+        uint16_t iErrorCode = htons((uint16_t)results[i].iErrorCode);
+        uint16_t iReserved = 0;
+
+        memcpy(frame + offset, &iServerID, sizeof(iServerID));
+        memcpy(frame + offset + 8, &address.s_addr, sizeof(address.s_addr));
+        memcpy(frame + offset + 12, &iPort, sizeof(iPort));
+        memcpy(frame + offset + 14, &iFlags, sizeof(iFlags));
+        memcpy(frame + offset + 16, &iErrorCode, sizeof(iErrorCode));
+        memcpy(frame + offset + 18, &iReserved, sizeof(iReserved));
+        offset += WIRE_RESOLVE_RESULT_SIZE;
+    }
+
+    *buffer = frame;
+    return (int)offset;
+}
+
+/**
+ * @brief Decodes the payload of a FRAME_RESOLVE_RESULTS frame
+ * @param header: The decoded header
+ * @param payload: The header->iPayloadLength payload bytes
+ * @param ctx: Receives the request ID
+ * @param results: Set to the allocated results, to be freed by the caller
+ * @param iResultCount: Set to the number of results
+ * @return: 0 on success, -1 if the frame is malformed
+ */
+int Wire_Decode_Resolve_Results(WIRE_HEADER_STRUCT *header, const char *payload, WIRE_CONTEXT_STRUCT *ctx, RESOLVE_RESULT_STRUCT **results, uint32_t *iResultCount)
+{
+    *results = NULL;
+    *iResultCount = 0;
+    if (header->iFrameType != FRAME_RESOLVE_RESULTS || header->iPayloadLength < sizeof(uint32_t))
+        return -1;
+
+    uint32_t iCount;
+    memcpy(&iCount, payload, sizeof(iCount));
+    iCount = ntohl(iCount);
+    if (iCount > WIRE_MAX_BATCH_PATHS || header->iPayloadLength != sizeof(uint32_t) + iCount * WIRE_RESOLVE_RESULT_SIZE)
+        return -1;
+
+    RESOLVE_RESULT_STRUCT *decoded = (RESOLVE_RESULT_STRUCT *)calloc(iCount ? iCount : 1, sizeof(RESOLVE_RESULT_STRUCT));
+    if (decoded == NULL)
+        return -1;
+
+    const char *entry = payload + sizeof(uint32_t);
+    for (uint32_t i = 0; i < iCount; i++, entry += WIRE_RESOLVE_RESULT_SIZE)
+    {
+        uint64_t iServerID;
+        struct in_addr address;
+        uint16_t iPort, iErrorCode;
+        int16_t iFlags;
+        memcpy(&iServerID, entry, sizeof(iServerID));
+        memcpy(&address.s_addr, entry + 8, sizeof(address.s_addr));
+        memcpy(&iPort, entry + 12, sizeof(iPort));
+        memcpy(&iFlags, entry + 14, sizeof(iFlags));
+        memcpy(&iErrorCode, entry + 16, sizeof(iErrorCode));
+
+        decoded[i].iServerID = (unsigned long)be64toh(iServerID);
+        inet_ntop(AF_INET, &address, decoded[i].sServerIP, IP_LENGTH);
+        decoded[i].iServerPort = ntohs(iPort);
+        decoded[i].iFlags = (int16_t)ntohs((uint16_t)iFlags);
+        decoded[i].iErrorCode = ntohs(iErrorCode);
+    }
+
+    *results = decoded;
+    *iResultCount = iCount;
+    ctx->iRequestID = header->iRequestID;
+    return 0;
+}
+
+int Send_Request(int sockfd, WIRE_CONTEXT_STRUCT *ctx, REQUEST_STRUCT *request)
+{
+    char buffer[sizeof(REQUEST_STRUCT) > WIRE_MAX_REQUEST_FRAME ? sizeof(REQUEST_STRUCT) : WIRE_MAX_REQUEST_FRAME];
+    int length = Wire_Encode_Request(ctx, request, buffer, sizeof(buffer));
+    if (length < 0)
+        return -1;
+    return Send_All(sockfd, buffer, length);
+}
+
+int Recv_Request(int sockfd, WIRE_CONTEXT_STRUCT *ctx, REQUEST_STRUCT *request)
+{
+    int iVersion = Wire_Recv_Version(sockfd, ctx);
+    if (iVersion <= 0)
+        return iVersion;
+    if (iVersion == WIRE_VERSION_1)
+        return Recv_All(sockfd, request, sizeof(REQUEST_STRUCT));
+
+    WIRE_HEADER_STRUCT header;
+    char payload[WIRE_TRACE_EXT_SIZE + WIRE_RANGE_EXT_SIZE + sizeof(uint64_t) + MAX_BUFFER_SIZE];
+    int iRecvStatus = Recv_Frame(sockfd, FRAME_REQUEST, &header, payload, sizeof(payload));
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+    if (Wire_Decode_Request(&header, payload, ctx, request) < 0)
+        return -1;
+    return iRecvStatus;
+}
+
+int Send_Response(int sockfd, WIRE_CONTEXT_STRUCT *ctx, RESPONSE_STRUCT *response)
+{
+    char buffer[sizeof(RESPONSE_STRUCT) + WIRE_HEADER_SIZE];
+    int length = Wire_Encode_Response(ctx, response, buffer, sizeof(buffer));
+    if (length < 0)
+        return -1;
+    return Send_All(sockfd, buffer, length);
+}
+
+int Recv_Response(int sockfd, WIRE_CONTEXT_STRUCT *ctx, RESPONSE_STRUCT *response)
+{
+    int iVersion = Wire_Recv_Version(sockfd, ctx);
+    if (iVersion <= 0)
+        return iVersion;
+    if (iVersion == WIRE_VERSION_1)
+        return Recv_All(sockfd, response, sizeof(RESPONSE_STRUCT));
+
+    WIRE_HEADER_STRUCT header;
+    char payload[sizeof(uint64_t) + MAX_BUFFER_SIZE];
+    int iRecvStatus = Recv_Frame(sockfd, FRAME_RESPONSE, &header, payload, sizeof(payload));
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+    if (Wire_Decode_Response(&header, payload, ctx, response) < 0)
+        return -1;
+    return iRecvStatus;
+}
+
+int Send_Ack(int sockfd, WIRE_CONTEXT_STRUCT *ctx, ACK_STRUCT *ack)
+{
+    char buffer[WIRE_HEADER_SIZE + sizeof(ACK_STRUCT)];
+    int length = Wire_Encode_Ack(ctx, ack, buffer, sizeof(buffer));
+    if (length < 0)
+        return -1;
+    return Send_All(sockfd, buffer, length);
+}
+
+int Recv_Ack(int sockfd, WIRE_CONTEXT_STRUCT *ctx, ACK_STRUCT *ack)
+{
+    int iVersion = Wire_Recv_Version(sockfd, ctx);
+    if (iVersion <= 0)
+        return iVersion;
+    if (iVersion == WIRE_VERSION_1)
+        return Recv_All(sockfd, ack, sizeof(ACK_STRUCT));
+
+    WIRE_HEADER_STRUCT header;
+    char payload[MAX_BUFFER_SIZE];
+    int iRecvStatus = Recv_Frame(sockfd, FRAME_ACK, &header, payload, sizeof(payload));
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+    if (Wire_Decode_Ack(&header, payload, ctx, ack) < 0)
+        return -1;
+    return iRecvStatus;
+}
+
+int Send_Path_Info(int sockfd, WIRE_CONTEXT_STRUCT *ctx, PATH_INFO_STRUCT *info)
+{
+    if (ctx->iVersion != WIRE_VERSION_2)
+        return Send_All(sockfd, info, sizeof(PATH_INFO_STRUCT));
+
+    char buffer[WIRE_HEADER_SIZE + 7 * sizeof(int32_t) + MAX_BUFFER_SIZE];
+    int32_t fields[7] = {
+        (int32_t)htonl(info->iPathType), (int32_t)htonl(info->iPathSize), (int32_t)htonl(info->iPathPermission),
+        (int32_t)htonl(info->iPathCreationTime), (int32_t)htonl(info->iPathModificationTime),
+        (int32_t)htonl(info->iPathAccessTime), (int32_t)htonl(info->iPathLinks)};
+    size_t iPathLength = strnlen(info->sPath, MAX_BUFFER_SIZE - 1);
+
+    int offset = Wire_Encode_Header(buffer, FRAME_PATH_INFO, CMD_INFO, 0, ctx->iRequestID, 0, 0, sizeof(fields) + iPathLength);
+    memcpy(buffer + offset, fields, sizeof(fields));
+    memcpy(buffer + offset + sizeof(fields), info->sPath, iPathLength);
+    return Send_All(sockfd, buffer, offset + sizeof(fields) + iPathLength);
+}
+
+int Recv_Path_Info(int sockfd, WIRE_CONTEXT_STRUCT *ctx, PATH_INFO_STRUCT *info)
+{
+    int iVersion = Wire_Recv_Version(sockfd, ctx);
+    if (iVersion <= 0)
+        return iVersion;
+    if (iVersion == WIRE_VERSION_1)
+        return Recv_All(sockfd, info, sizeof(PATH_INFO_STRUCT));
+
+    WIRE_HEADER_STRUCT header;
+    char payload[7 * sizeof(int32_t) + MAX_BUFFER_SIZE];
+    int iRecvStatus = Recv_Frame(sockfd, FRAME_PATH_INFO, &header, payload, sizeof(payload));
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+    if (header.iPayloadLength < 7 * sizeof(int32_t) || header.iPayloadLength - 7 * sizeof(int32_t) >= MAX_BUFFER_SIZE)
+        return -1;
+
+    int32_t fields[7];
+    memcpy(fields, payload, sizeof(fields));
+    memset(info, 0, sizeof(PATH_INFO_STRUCT));
+    info->iPathType = (int32_t)ntohl(fields[0]);
+    info->iPathSize = (int32_t)ntohl(fields[1]);
+    info->iPathPermission = (int32_t)ntohl(fields[2]);
+    info->iPathCreationTime = (int32_t)ntohl(fields[3]);
+    info->iPathModificationTime = (int32_t)ntohl(fields[4]);
+    info->iPathAccessTime = (int32_t)ntohl(fields[5]);
+    info->iPathLinks = (int32_t)ntohl(fields[6]);
+    memcpy(info->sPath, payload + sizeof(fields), header.iPayloadLength - sizeof(fields));
+    ctx->iRequestID = header.iRequestID;
+    return iRecvStatus;
+}
+
+/**
+ * @brief Sends the Storage Server Init Packet
+ * @note: v1 truncates the mount paths to the MAX_BUFFER_SIZE of STORAGE_SERVER_INIT_STRUCT,
+ *        v2 sends the complete list
+ */
+int Send_Server_Init(int sockfd, WIRE_CONTEXT_STRUCT *ctx, SERVER_INIT_INFO_STRUCT *init)
+{
+    if (ctx->iVersion != WIRE_VERSION_2)
+    {
+        STORAGE_SERVER_INIT_STRUCT packet;
+        memset(&packet, 0, sizeof(packet));
+        packet.sServerPort_Client = init->sServerPort_Client;
+        packet.sServerPort_NServer = init->sServerPort_NServer;
+        strncpy(packet.MountPaths, init->MountPaths, MAX_BUFFER_SIZE - 1);
+        return Send_All(sockfd, &packet, sizeof(packet));
+    }
+
+    size_t iPayloadLength = 2 * sizeof(int32_t) + init->iMountPathsLength;
+    if (iPayloadLength > WIRE_MAX_PAYLOAD)
+        return -1;
+
+    char *buffer = (char *)malloc(WIRE_HEADER_SIZE + iPayloadLength);
+    if (buffer == NULL)
+        return -1;
+
+    int offset = Wire_Encode_Header(buffer, FRAME_SERVER_INIT, 0, 0, ctx->iRequestID, 0, 0, iPayloadLength);
+    int32_t ports[2] = {(int32_t)htonl(init->sServerPort_Client), (int32_t)htonl(init->sServerPort_NServer)};
+    memcpy(buffer + offset, ports, sizeof(ports));
+    memcpy(buffer + offset + sizeof(ports), init->MountPaths, init->iMountPathsLength);
+
+    int iSendStatus = Send_All(sockfd, buffer, offset + iPayloadLength);
+    free(buffer);
+    return iSendStatus;
+}
+
+/**
+ * @brief Receives the Storage Server Init Packet
+ * @note: init->MountPaths is allocated here and must be freed by the caller
+ */
+int Recv_Server_Init(int sockfd, WIRE_CONTEXT_STRUCT *ctx, SERVER_INIT_INFO_STRUCT *init)
+{
+    memset(init, 0, sizeof(SERVER_INIT_INFO_STRUCT));
+    int iVersion = Wire_Recv_Version(sockfd, ctx);
+    if (iVersion <= 0)
+        return iVersion;
+
+    if (iVersion == WIRE_VERSION_1)
+    {
+        STORAGE_SERVER_INIT_STRUCT packet;
+        int iRecvStatus = Recv_All(sockfd, &packet, sizeof(packet));
+        if (iRecvStatus <= 0)
+            return iRecvStatus;
+
+        init->sServerPort_Client = packet.sServerPort_Client;
+        init->sServerPort_NServer = packet.sServerPort_NServer;
+        init->iMountPathsLength = strnlen(packet.MountPaths, MAX_BUFFER_SIZE);
+        init->MountPaths = (char *)calloc(init->iMountPathsLength + 1, 1);
+        if (init->MountPaths == NULL)
+            return -1;
+        memcpy(init->MountPaths, packet.MountPaths, init->iMountPathsLength);
+        return iRecvStatus;
+    }
+
+    char buffer[WIRE_HEADER_SIZE];
+    int iRecvStatus = Recv_All(sockfd, buffer, WIRE_HEADER_SIZE);
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+
+    WIRE_HEADER_STRUCT header;
+    if (Wire_Decode_Header(buffer, &header) < 0 || header.iFrameType != FRAME_SERVER_INIT || header.iPayloadLength < 2 * sizeof(int32_t))
+        return -1;
+
+    int32_t ports[2];
+    iRecvStatus = Recv_All(sockfd, ports, sizeof(ports));
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+
+    init->sServerPort_Client = (int32_t)ntohl(ports[0]);
+    init->sServerPort_NServer = (int32_t)ntohl(ports[1]);
+    init->iMountPathsLength = header.iPayloadLength - sizeof(ports);
+    init->MountPaths = (char *)calloc(init->iMountPathsLength + 1, 1);
+    if (init->MountPaths == NULL)
+        return -1;
+
+    if (init->iMountPathsLength > 0)
+    {
+        iRecvStatus = Recv_All(sockfd, init->MountPaths, init->iMountPathsLength);
+        if (iRecvStatus <= 0)
+        {
+            free(init->MountPaths);
+            init->MountPaths = NULL;
+            return iRecvStatus;
+        }
+    }
+    ctx->iRequestID = header.iRequestID;
+    return WIRE_HEADER_SIZE + header.iPayloadLength;
+}
+
+/**
+ * @brief Sends a header and its payload with as few system calls as possible
+ * @return: The number of bytes sent, -1 on failure
+ * @note: A header written on its own would be held back by Nagle until the previous frame is acked
+ */
+static int Send_Frame_Vector(int sockfd, const char *header, const void *payload, size_t iPayloadLength)
+{
+    struct iovec iov[2] = {{(void *)header, WIRE_HEADER_SIZE}, {(void *)payload, iPayloadLength}};
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = (iPayloadLength > 0) ? 2 : 1;
+
+    size_t length = WIRE_HEADER_SIZE + iPayloadLength;
+    size_t sent = 0;
+    while (sent < length)
+    {
+        ssize_t iSendStatus = sendmsg(sockfd, &message, MSG_NOSIGNAL);
+        if (iSendStatus < 0 && errno == EINTR)
+            continue;
+        if (iSendStatus <= 0)
+            return -1;
+        sent += iSendStatus;
+
+        // Skip what went out of the vector
+        while (message.msg_iovlen > 0 && (size_t)iSendStatus >= message.msg_iov->iov_len)
+        {
+            iSendStatus -= message.msg_iov->iov_len;
+            message.msg_iov++;
+            message.msg_iovlen--;
+        }
+        if (message.msg_iovlen > 0)
+        {
+            message.msg_iov->iov_base = (char *)message.msg_iov->iov_base + iSendStatus;
+            message.msg_iov->iov_len -= iSendStatus;
+        }
+    }
+    return (int)length;
+}
+
+/**
+ * @brief Sends a FRAME_DATA frame of a data stream
+ * @param ctx: The request the stream belongs to
+ * @param data: The bytes of the frame
+ * @param length: 1 to WIRE_DATA_CHUNK bytes
+ * @return: The number of bytes sent, -1 on failure
+ */
+int Send_Data(int sockfd, WIRE_CONTEXT_STRUCT *ctx, const void *data, size_t length)
+{
+    if (length == 0 || length > WIRE_DATA_CHUNK)
+        return -1;
+    char header[WIRE_HEADER_SIZE];
+    Wire_Encode_Header(header, FRAME_DATA, 0, 0, ctx->iRequestID, 0, 0, length);
+    return Send_Frame_Vector(sockfd, header, data, length);
+}
+
+/**
+ * @brief Sends the header of a FRAME_DATA frame whose length bytes the caller sends next
+ * @return: WIRE_HEADER_SIZE, -1 on failure
+ * @note: For payloads that do not pass through user space (sendfile)
+ */
+int Send_Data_Header(int sockfd, WIRE_CONTEXT_STRUCT *ctx, size_t length)
+{
+    if (length == 0 || length > WIRE_DATA_CHUNK)
+        return -1;
+    char header[WIRE_HEADER_SIZE];
+    Wire_Encode_Header(header, FRAME_DATA, 0, 0, ctx->iRequestID, 0, 0, length);
+    return Send_All(sockfd, header, WIRE_HEADER_SIZE);
+}
+
+/**
+ * @brief Ends a data stream
+ * @param end: The byte count and status of the stream (with the range and file size of a READ)
+ * @return: The number of bytes sent, -1 on failure
+ */
+int Send_Data_End(int sockfd, WIRE_CONTEXT_STRUCT *ctx, WIRE_DATA_END_STRUCT *end)
+{
+    char header[WIRE_HEADER_SIZE];
+    uint64_t fields[3] = {htobe64(end->iStreamBytes), htobe64(end->iOffset), htobe64(end->iFileSize)};
+    Wire_Encode_Header(header, FRAME_DATA_END, 0, 0, ctx->iRequestID, end->iStatus, 0, WIRE_DATA_END_SIZE);
+    return Send_Frame_Vector(sockfd, header, fields, WIRE_DATA_END_SIZE);
+}
+
+/**
+ * @brief Sends an empty data stream, which only carries a status
+ * @param iStatus: WIRE_DATA_OK, or the error that stopped the stream before any data
+ * @return: The number of bytes sent, -1 on failure
+ */
+int Send_Data_Status(int sockfd, WIRE_CONTEXT_STRUCT *ctx, int iStatus)
+{
+    WIRE_DATA_END_STRUCT end = {0, 0, 0, iStatus};
+    return Send_Data_End(sockfd, ctx, &end);
+}
+
+/**
+ * @brief Receives the next frame header of a data stream
+ * @param header: The decoded header, FRAME_DATA (header->iPayloadLength bytes follow on the socket)
+ *                or FRAME_DATA_END
+ * @param end: Filled from a FRAME_DATA_END frame
+ * @return: Number of bytes received, 0 if the peer closed the connection, -1 on failure
+ */
+int Recv_Data_Header(int sockfd, WIRE_HEADER_STRUCT *header, WIRE_DATA_END_STRUCT *end)
+{
+    char buffer[WIRE_HEADER_SIZE];
+    int iRecvStatus = Recv_All(sockfd, buffer, WIRE_HEADER_SIZE);
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+    if (Wire_Decode_Header(buffer, header) < 0)
+        return -1;
+
+    if (header->iFrameType == FRAME_DATA)
+        return (header->iPayloadLength > 0 && header->iPayloadLength <= WIRE_DATA_CHUNK) ? WIRE_HEADER_SIZE : -1;
+    if (header->iFrameType != FRAME_DATA_END || header->iPayloadLength != WIRE_DATA_END_SIZE)
+        return -1;
+
+    uint64_t fields[3];
+    iRecvStatus = Recv_All(sockfd, fields, sizeof(fields));
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+    end->iStreamBytes = be64toh(fields[0]);
+    end->iOffset = be64toh(fields[1]);
+    end->iFileSize = be64toh(fields[2]);
+    end->iStatus = header->iErrorCode;
+    return WIRE_HEADER_SIZE + WIRE_DATA_END_SIZE;
+}
+
+/**
+ * @brief Starts a v1 data stream with a new stop sequence
+ * @param stop: Filled with the stop sequence (WIRE_LEGACY_FRAME bytes), which also ends the stream
+ * @return: The number of bytes sent, -1 on failure
+ */
+int Send_Legacy_Stop(int sockfd, char *stop)
+{
+    memset(stop, 0, WIRE_LEGACY_FRAME);
+    snprintf(stop, WIRE_LEGACY_FRAME, "STOP%d", rand() % 1000);
+    return Send_All(sockfd, stop, WIRE_LEGACY_FRAME);
+}
+
+/**
+ * @brief Sends a frame of a v1 data stream
+ * @param data: The bytes of the frame
+ * @param length: Up to WIRE_LEGACY_FRAME bytes, a shorter frame is NUL padded
+ * @return: The number of bytes sent, -1 on failure
+ */
+int Send_Legacy_Frame(int sockfd, const void *data, size_t length)
+{
+    char frame[WIRE_LEGACY_FRAME];
+    if (length > WIRE_LEGACY_FRAME)
+        return -1;
+    memcpy(frame, data, length);
+    memset(frame + length, 0, WIRE_LEGACY_FRAME - length);
+    return Send_All(sockfd, frame, WIRE_LEGACY_FRAME);
+}
+
+/**
+ * @brief Receives the next frame of a v1 data stream
+ * @param frame: WIRE_LEGACY_FRAME bytes
+ * @param stop: The stop sequence of the stream
+ * @param iDataLength: Set to the data bytes of a data frame (up to its first NUL)
+ * @return: 1 for a data frame, 0 for the stop sequence, -1 on failure (the peer closing included)
+ */
+int Recv_Legacy_Frame(int sockfd, char *frame, const char *stop, size_t *iDataLength)
+{
+    if (Recv_All(sockfd, frame, WIRE_LEGACY_FRAME) <= 0)
+        return -1;
+    if (memcmp(frame, stop, WIRE_LEGACY_FRAME) == 0)
+        return 0;
+    *iDataLength = strnlen(frame, WIRE_LEGACY_FRAME);
+    return 1;
+}
+
+/**
+ * @brief Returns the size of the buffers a WRITE moves its data through
+ * @return: WIRE_WRITE_BUFFER, or the size set in NFS_WRITE_BUFFER clamped to
+ *          WIRE_WRITE_BUFFER_MIN..WIRE_WRITE_BUFFER_MAX
+ * @note: An unreadable value keeps the default
+ */
+size_t Wire_Write_Buffer_Size()
+{
+    char *sValue = getenv(WIRE_ENV_WRITE_BUFFER);
+    if (sValue == NULL)
+        return WIRE_WRITE_BUFFER;
+
+    char *end = NULL;
+    unsigned long long iSize = strtoull(sValue, &end, 10);
+    if (end == sValue)
+        return WIRE_WRITE_BUFFER;
+    if (*end == 'K' || *end == 'k')
+        iSize <<= 10;
+    else if (*end == 'M' || *end == 'm')
+        iSize <<= 20;
+    else if (*end != '\0')
+        return WIRE_WRITE_BUFFER;
+
+    if (iSize < WIRE_WRITE_BUFFER_MIN)
+        return WIRE_WRITE_BUFFER_MIN;
+    return (iSize > WIRE_WRITE_BUFFER_MAX) ? WIRE_WRITE_BUFFER_MAX : iSize;
+}
+
+/**
+ * @brief Offers v2 on a freshly connected long-lived connection
+ * @param sockfd: The connected socket
+ * @return: WIRE_VERSION_2 if the peer accepted, WIRE_VERSION_1 if it did not answer in time, -1 on failure
+ * @note: A v1 peer has consumed the HELLO bytes as part of a struct, so on WIRE_VERSION_1
+ *        the caller must reconnect before talking v1
+ */
+int Wire_Client_Hello(int sockfd)
+{
+    char buffer[WIRE_HEADER_SIZE];
+    Wire_Encode_Hello(WIRE_VERSION_2, buffer, sizeof(buffer));
+    if (Send_All(sockfd, buffer, WIRE_HEADER_SIZE) < 0)
+        return -1;
+
+    struct pollfd pfd;
+    pfd.fd = sockfd;
+    pfd.events = POLLIN;
+    int iPollStatus = poll(&pfd, 1, WIRE_HELLO_TIMEOUT);
+    if (iPollStatus < 0)
+        return -1;
+    if (iPollStatus == 0)
+        return WIRE_VERSION_1;
+
+    WIRE_HEADER_STRUCT header;
+    if (Recv_Frame(sockfd, FRAME_HELLO, &header, NULL, 0) <= 0)
+        return -1;
+    return (header.iOperation >= WIRE_VERSION_2) ? WIRE_VERSION_2 : WIRE_VERSION_1;
+}
+
+/**
+ * @brief Answers the HELLO frame of a peer (the next frame on the socket must be a HELLO)
+ * @param sockfd: The accepted socket
+ * @return: The negotiated version, 0 if the peer closed the connection, -1 on failure
+ */
+int Wire_Server_Hello(int sockfd)
+{
+    WIRE_HEADER_STRUCT header;
+    int iRecvStatus = Recv_Frame(sockfd, FRAME_HELLO, &header, NULL, 0);
+    if (iRecvStatus <= 0)
+        return iRecvStatus;
+
+    int iVersion = (header.iOperation >= WIRE_VERSION_2) ? WIRE_VERSION_2 : WIRE_VERSION_1;
+    char buffer[WIRE_HEADER_SIZE];
+    Wire_Encode_Hello(iVersion, buffer, sizeof(buffer));
+    if (Send_All(sockfd, buffer, WIRE_HEADER_SIZE) < 0)
+        return -1;
+    return iVersion;
+}
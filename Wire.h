@@ -0,0 +1,240 @@
+// Wire format shared by the Client, Naming Server and Storage Server
+
+#ifndef _WIRE_H_
+#define _WIRE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "./Externals.h"
+
+/*
+WIRE PROTOCOL VERSIONS
+    v1: The fixed size structs of Externals.h are sent as raw memory (>1 KB per message)
+    v2: A fixed 20 byte header followed by a variable length payload
+        All integers are sent in network byte order
+
+::: Negotiation :::
+    Long-lived connections (Client -> NS, SS -> NS) start with a HELLO frame sent by the
+    connecting side. A v2 peer answers with a HELLO frame, a v1 peer never answers and the
+    connecting side reconnects and talks v1.
+    Short-lived connections (Client -> SS, NS -> SS) are detected by the receiver by peeking
+    at the first 4 bytes for WIRE_MAGIC (a v1 struct starts with a small operation code).
+
+::: Header Extensions :::
+    iExtensions of the header flags optional blocks placed at the start of the payload (and
+    counted in iPayloadLength). A frame with an unknown extension bit is rejected.
+    WIRE_EXT_TRACE (requests only): [u64 Trace ID][u64 Parent Span ID] of a traced request (see Trace.h)
+    WIRE_EXT_RANGE (READ requests only): [u64 Offset][u64 Length] of the bytes wanted, a length of 0
+        reads to the end of the file. Follows the trace block when both are present.
+
+::: Data Streams :::
+    The file data of a READ (Storage Server -> Client) and of a WRITE (Client -> Storage Server)
+    travels as FRAME_DATA frames of raw bytes (1 to WIRE_DATA_CHUNK bytes, no padding, any byte
+    value) ended by one FRAME_DATA_END frame. The end frame carries the number of bytes of the
+    stream and, in iErrorCode, the status of its sender (WIRE_DATA_OK, or the error that ended
+    the stream early, e.g. a missing file before any data). A receiver treats the stream as
+    failed unless the status is WIRE_DATA_OK and the count matches what it received.
+    The end of a READ stream also carries the range actually sent and the size of the file: a
+    range is cut at the end of the file (an offset past it gives an empty stream).
+    READ : request, stream of the file (or of its range), RESPONSE
+    WRITE: request, empty stream of the server (its status tells whether the file is open for
+           writing), stream of the client (only after a WIRE_DATA_OK), RESPONSE
+    The stream frames carry the request ID. They are only used on v2 connections (see below).
+    Both ends of a WRITE move its data through a buffer of Wire_Write_Buffer_Size() bytes: the
+    client sends each buffer of input as frames of WIRE_DATA_CHUNK, the server gathers frames
+    until its buffer is full and writes it to the file with a single pwrite.
+
+::: Legacy Data Streams (v1) :::
+    A v1 connection keeps the framing READ and WRITE had before the data streams: the Storage
+    Server first sends a stop sequence ("STOP<n>", NUL padded to WIRE_LEGACY_FRAME bytes), the
+    data follows in WIRE_LEGACY_FRAME byte frames and the stop sequence ends it. A frame holds
+    text: its data ends at its first NUL, so v1 cannot carry NUL bytes, and there are no byte
+    ranges, no byte count and no status (an error before the data is a message frame, then the
+    stop sequence). The RESPONSE follows as before.
+    READ : request, stop sequence, frames of the file, stop sequence, RESPONSE
+    WRITE: request, stop sequence (only for a valid flag), frames of the client, stop sequence, RESPONSE
+
+::: Request IDs :::
+    A v2 request carries an ID chosen by its sender. The RESPONSE and any later ACK caused by
+    the request echo that ID, so a connection may have many requests in flight and their
+    replies may arrive in any order. v1 replies carry no ID and arrive in request order.
+*/
+
+#define WIRE_VERSION_UNKNOWN 0
+#define WIRE_VERSION_1 1
+#define WIRE_VERSION_2 2
+
+#define WIRE_MAGIC 0x4E465332        // "NFS2"
+#define WIRE_HEADER_SIZE 20
+#define WIRE_MAX_PAYLOAD (16 * 1024 * 1024)
+#define WIRE_TRACE_EXT_SIZE 16
+#define WIRE_RANGE_EXT_SIZE 16
+#define WIRE_MAX_REQUEST_FRAME (WIRE_HEADER_SIZE + WIRE_TRACE_EXT_SIZE + WIRE_RANGE_EXT_SIZE + 8 + MAX_BUFFER_SIZE)
+#define WIRE_HELLO_TIMEOUT 500       // Milliseconds to wait for a HELLO reply before falling back to v1
+
+// Frame Types
+#define FRAME_HELLO 1
+#define FRAME_REQUEST 2
+#define FRAME_RESPONSE 3
+#define FRAME_ACK 4
+#define FRAME_PATH_INFO 5
+#define FRAME_SERVER_INIT 6
+#define FRAME_RESOLVE_BATCH 7
+#define FRAME_RESOLVE_RESULTS 8
+#define FRAME_DATA 9
+#define FRAME_DATA_END 10
+
+// Header Extensions
+#define WIRE_EXT_TRACE 0x0001
+#define WIRE_EXT_RANGE 0x0002
+#define WIRE_EXT_KNOWN (WIRE_EXT_TRACE | WIRE_EXT_RANGE)
+
+// Batched path resolution (CMD_RESOLVE_BATCH)
+#define WIRE_MAX_BATCH_PATHS 4096
+#define WIRE_MAX_BATCH_PAYLOAD (1024 * 1024)
+#define WIRE_RESOLVE_RESULT_SIZE 20
+#define WIRE_MAX_BATCH_RESULTS_PAYLOAD (sizeof(uint32_t) + WIRE_MAX_BATCH_PATHS * WIRE_RESOLVE_RESULT_SIZE)
+
+// Data streams (READ and WRITE)
+#define WIRE_DATA_CHUNK (1024 * 1024)    // Largest payload of a FRAME_DATA frame
+#define WIRE_DATA_END_SIZE 24
+#define WIRE_DATA_OK 0                   // Status of a complete stream
+#define WIRE_WRITE_BUFFER (1024 * 1024)              // Default buffer of the two ends of a WRITE
+#define WIRE_WRITE_BUFFER_MIN (256 * 1024)
+#define WIRE_WRITE_BUFFER_MAX (4 * 1024 * 1024)
+#define WIRE_ENV_WRITE_BUFFER "NFS_WRITE_BUFFER"     // Overrides WIRE_WRITE_BUFFER (bytes, K and M suffixes)
+#define WIRE_LEGACY_FRAME MAX_BUFFER_SIZE            // Frame of a v1 data stream
+
+// v2 frame header (payload follows immediately)
+typedef struct __attribute__((packed)) WIRE_HEADER_STRUCT
+{
+    uint32_t iMagic;         // WIRE_MAGIC
+    uint8_t iFrameType;      // FRAME_*
+    uint8_t iOperation;      // CMD_* (protocol version for FRAME_HELLO)
+    int16_t iFlags;          // Request/Response/ACK flags
+    uint32_t iRequestID;     // Request ID chosen by the sender, echoed in the RESPONSE/ACK it causes
+    uint16_t iErrorCode;     // Error Code
+    uint16_t iExtensions;    // WIRE_EXT_* blocks at the start of the payload
+    uint32_t iPayloadLength; // Number of payload bytes after the header
+} WIRE_HEADER_STRUCT;
+
+/*
+v2 PAYLOADS
+    FRAME_REQUEST     : [u64 Client ID][Path]
+    FRAME_RESPONSE    : [u64 Server ID][Data]
+    FRAME_ACK         : [Data]
+    FRAME_PATH_INFO   : [i32 Type][i32 Size][i32 Permission][i32 Creation][i32 Modification][i32 Access][i32 Links][Path]
+    FRAME_SERVER_INIT : [i32 Client Port][i32 NServer Port][\n separated mount paths (no size limit)]
+    FRAME_RESOLVE_BATCH   : [u64 Client ID][u32 Count][Count x ([u16 Length][Path])]
+    FRAME_RESOLVE_RESULTS : [u32 Count][Count x ([u64 Server ID][u32 IPv4][u16 Port][i16 Flags][u16 Error Code][u16 Reserved])]
+        The results are in the order of the paths of the batch. A path that could not be
+        resolved has RESPONSE_FLAG_FAILURE and an error code, the batch itself never fails
+        as a whole unless it is malformed.
+    FRAME_DATA        : [Data]
+    FRAME_DATA_END    : [u64 Stream Bytes][u64 Offset][u64 File Size] (status in the error code of the header,
+                        offset and size are 0 outside of READ)
+*/
+
+// Per message state that does not fit in the v1 structs
+typedef struct WIRE_CONTEXT_STRUCT
+{
+    int iVersion;            // Version spoken on the connection (WIRE_VERSION_UNKNOWN to detect on receive)
+    uint32_t iRequestID;     // Request ID of the last frame sent/received
+    uint64_t iTraceID;       // Trace of the last request received (0 if untraced)
+    uint64_t iParentSpanID;  // Span of the sender the request belongs to
+    int iRange;              // The READ asks for a byte range (v2 only, sent as WIRE_EXT_RANGE)
+    uint64_t iRangeOffset;
+    uint64_t iRangeLength;   // 0 to read to the end of the file
+} WIRE_CONTEXT_STRUCT;
+
+// End of a data stream
+typedef struct WIRE_DATA_END_STRUCT
+{
+    uint64_t iStreamBytes;   // Data bytes of the stream
+    uint64_t iOffset;        // Offset in the file of the first byte (READ)
+    uint64_t iFileSize;      // Size of the whole file (READ)
+    int iStatus;             // WIRE_DATA_OK, or the error that ended the stream
+} WIRE_DATA_END_STRUCT;
+
+// Storage Server Init Packet with a variable length path list
+typedef struct SERVER_INIT_INFO_STRUCT
+{
+    int sServerPort_Client;
+    int sServerPort_NServer;
+    char *MountPaths;        // \n separated list of mount paths (malloc'd, NUL terminated)
+    size_t iMountPathsLength;
+} SERVER_INIT_INFO_STRUCT;
+
+// Decoded CMD_RESOLVE_BATCH request
+typedef struct RESOLVE_BATCH_STRUCT
+{
+    unsigned long ClientID;
+    uint32_t iPathCount;
+    char **Paths;            // iPathCount NUL terminated paths (point into PathData)
+    char *PathData;
+} RESOLVE_BATCH_STRUCT;
+
+// Resolution of a single path of a batch
+typedef struct RESOLVE_RESULT_STRUCT
+{
+    unsigned long iServerID;
+    char sServerIP[IP_LENGTH];
+    int iServerPort;
+    int iFlags;              // RESPONSE_FLAG_* (BACKUP_RESPONSE if a backup server was chosen)
+    int iErrorCode;
+} RESOLVE_RESULT_STRUCT;
+
+// Socket helpers
+int Send_All(int sockfd, const void *buffer, size_t length);
+int Recv_All(int sockfd, void *buffer, size_t length);
+int Wire_Detect_Version(int sockfd);
+
+// Buffer codecs (return the encoded length, -1 on failure)
+int Wire_Encode_Request(WIRE_CONTEXT_STRUCT *ctx, REQUEST_STRUCT *request, char *buffer, size_t size);
+int Wire_Encode_Response(WIRE_CONTEXT_STRUCT *ctx, RESPONSE_STRUCT *response, char *buffer, size_t size);
+int Wire_Encode_Ack(WIRE_CONTEXT_STRUCT *ctx, ACK_STRUCT *ack, char *buffer, size_t size);
+int Wire_Encode_Hello(int iVersion, char *buffer, size_t size);
+int Wire_Decode_Header(const char *buffer, WIRE_HEADER_STRUCT *header);
+int Wire_Decode_Request(WIRE_HEADER_STRUCT *header, const char *payload, WIRE_CONTEXT_STRUCT *ctx, REQUEST_STRUCT *request);
+int Wire_Decode_Response(WIRE_HEADER_STRUCT *header, const char *payload, WIRE_CONTEXT_STRUCT *ctx, RESPONSE_STRUCT *response);
+int Wire_Decode_Ack(WIRE_HEADER_STRUCT *header, const char *payload, WIRE_CONTEXT_STRUCT *ctx, ACK_STRUCT *ack);
+
+// Batch codecs (the encoders allocate *buffer, the decoders allocate the output arrays)
+int Wire_Encode_Resolve_Batch(WIRE_CONTEXT_STRUCT *ctx, unsigned long ClientID, char **Paths, uint32_t iPathCount, char **buffer);
+int Wire_Decode_Resolve_Batch(WIRE_HEADER_STRUCT *header, const char *payload, WIRE_CONTEXT_STRUCT *ctx, RESOLVE_BATCH_STRUCT *batch);
+void Free_Resolve_Batch(RESOLVE_BATCH_STRUCT *batch);
+int Wire_Encode_Resolve_Results(WIRE_CONTEXT_STRUCT *ctx, RESOLVE_RESULT_STRUCT *results, uint32_t iResultCount, char **buffer);
+int Wire_Decode_Resolve_Results(WIRE_HEADER_STRUCT *header, const char *payload, WIRE_CONTEXT_STRUCT *ctx, RESOLVE_RESULT_STRUCT **results, uint32_t *iResultCount);
+
+// Blocking socket codecs (return the number of bytes moved, 0 if the peer closed, -1 on failure)
+int Recv_Frame(int sockfd, int iFrameType, WIRE_HEADER_STRUCT *header, char *payload, size_t iPayloadSize);
+int Recv_Frame_Alloc(int sockfd, int iFrameType, WIRE_HEADER_STRUCT *header, char **payload, size_t iMaxPayload);
+int Send_Request(int sockfd, WIRE_CONTEXT_STRUCT *ctx, REQUEST_STRUCT *request);
+int Recv_Request(int sockfd, WIRE_CONTEXT_STRUCT *ctx, REQUEST_STRUCT *request);
+int Send_Response(int sockfd, WIRE_CONTEXT_STRUCT *ctx, RESPONSE_STRUCT *response);
+int Recv_Response(int sockfd, WIRE_CONTEXT_STRUCT *ctx, RESPONSE_STRUCT *response);
+int Send_Ack(int sockfd, WIRE_CONTEXT_STRUCT *ctx, ACK_STRUCT *ack);
+int Recv_Ack(int sockfd, WIRE_CONTEXT_STRUCT *ctx, ACK_STRUCT *ack);
+int Send_Path_Info(int sockfd, WIRE_CONTEXT_STRUCT *ctx, PATH_INFO_STRUCT *info);
+int Recv_Path_Info(int sockfd, WIRE_CONTEXT_STRUCT *ctx, PATH_INFO_STRUCT *info);
+int Send_Server_Init(int sockfd, WIRE_CONTEXT_STRUCT *ctx, SERVER_INIT_INFO_STRUCT *init);
+int Recv_Server_Init(int sockfd, WIRE_CONTEXT_STRUCT *ctx, SERVER_INIT_INFO_STRUCT *init);
+
+// Data stream codecs (return the number of bytes moved, 0 if the peer closed, -1 on failure)
+int Send_Data(int sockfd, WIRE_CONTEXT_STRUCT *ctx, const void *data, size_t length);
+int Send_Data_Header(int sockfd, WIRE_CONTEXT_STRUCT *ctx, size_t length);
+int Send_Data_End(int sockfd, WIRE_CONTEXT_STRUCT *ctx, WIRE_DATA_END_STRUCT *end);
+int Send_Data_Status(int sockfd, WIRE_CONTEXT_STRUCT *ctx, int iStatus);
+int Recv_Data_Header(int sockfd, WIRE_HEADER_STRUCT *header, WIRE_DATA_END_STRUCT *end);
+size_t Wire_Write_Buffer_Size();
+
+// Legacy data stream codecs for v1 connections (the senders return the number of bytes sent or -1)
+int Send_Legacy_Stop(int sockfd, char *stop);
+int Send_Legacy_Frame(int sockfd, const void *data, size_t length);
+int Recv_Legacy_Frame(int sockfd, char *frame, const char *stop, size_t *iDataLength); // 1 data, 0 stop, -1 failure
+
+// Version negotiation
+int Wire_Client_Hello(int sockfd);
+int Wire_Server_Hello(int sockfd);
+
+#endif // _WIRE_H_